@@ -34,6 +34,7 @@ void
 TFB_BBox_Reset (void)
 {
 	TFB_BBox.valid = 0;
+	TFB_BBox.numRects = 0;
 }
 
 void
@@ -64,6 +65,108 @@ TFB_BBox_SetClipRect (const RECT *r)
 		TFB_BBox.clip.extent.height = maxHeight - TFB_BBox.clip.corner.y;
 }
 
+// Keeping a rectangle apart costs an extra texture upload and scaler
+// pass; that only pays off when it saves more than this many pixels
+#define BBOX_RECT_OVERHEAD 1024
+
+static inline int
+rectArea (const RECT *r)
+{
+	return r->extent.width * r->extent.height;
+}
+
+static void
+unionRect (RECT *dst, const RECT *r)
+{
+	int x1 = dst->corner.x;
+	int y1 = dst->corner.y;
+	int x2 = dst->corner.x + dst->extent.width;
+	int y2 = dst->corner.y + dst->extent.height;
+
+	if (r->corner.x < x1)
+		x1 = r->corner.x;
+	if (r->corner.y < y1)
+		y1 = r->corner.y;
+	if (r->corner.x + r->extent.width > x2)
+		x2 = r->corner.x + r->extent.width;
+	if (r->corner.y + r->extent.height > y2)
+		y2 = r->corner.y + r->extent.height;
+
+	dst->corner.x = x1;
+	dst->corner.y = y1;
+	dst->extent.width = x2 - x1;
+	dst->extent.height = y2 - y1;
+}
+
+static BOOLEAN
+rectsOverlap (const RECT *r1, const RECT *r2)
+{
+	return r1->corner.x < r2->corner.x + r2->extent.width
+			&& r2->corner.x < r1->corner.x + r1->extent.width
+			&& r1->corner.y < r2->corner.y + r2->extent.height
+			&& r2->corner.y < r1->corner.y + r1->extent.height;
+}
+
+// Adds a clipped, non-empty rectangle to the region and the list.
+// The list is kept free of overlaps: a new rectangle swallows any it
+// touches, then also any whose merge costs less than keeping it apart.
+static void
+registerClippedRect (RECT r)
+{
+	if (!TFB_BBox.valid)
+	{
+		TFB_BBox.valid = 1;
+		TFB_BBox.region = r;
+		TFB_BBox.numRects = 0;
+	}
+	else
+		unionRect (&TFB_BBox.region, &r);
+
+	for (;;)
+	{
+		int best = -1;
+		int bestCost = 0;
+		int i;
+
+		for (i = 0; i < TFB_BBox.numRects; ++i)
+		{
+			const RECT *e = &TFB_BBox.rects[i];
+			RECT u;
+			int cost;
+
+			if (rectsOverlap (e, &r))
+			{	// must merge
+				best = i;
+				bestCost = 0;
+				break;
+			}
+
+			u = *e;
+			unionRect (&u, &r);
+			cost = rectArea (&u) - rectArea (e) - rectArea (&r)
+					- BBOX_RECT_OVERHEAD;
+			if (best < 0 || cost < bestCost)
+			{
+				best = i;
+				bestCost = cost;
+			}
+		}
+
+		if (best < 0 || (bestCost > 0
+				&& TFB_BBox.numRects < TFB_BBOX_MAX_RECTS))
+		{
+			TFB_BBox.rects[TFB_BBox.numRects] = r;
+			++TFB_BBox.numRects;
+			return;
+		}
+
+		// Merge and try the grown rectangle against the rest
+		unionRect (&r, &TFB_BBox.rects[best]);
+		--TFB_BBox.numRects;
+		TFB_BBox.rects[best] = TFB_BBox.rects[TFB_BBox.numRects];
+	}
+}
+
 void
 TFB_BBox_RegisterPoint (int x, int y) 
 {
@@ -71,6 +174,7 @@ TFB_BBox_RegisterPoint (int x, int y)
 	int y1 = TFB_BBox.clip.corner.y;
 	int x2 = TFB_BBox.clip.corner.x + TFB_BBox.clip.extent.width - 1;
 	int y2 = TFB_BBox.clip.corner.y + TFB_BBox.clip.extent.height - 1;
+	RECT r;
 
 	/* Constrain coordinates */
 	if (x < x1) x = x1;
@@ -78,48 +182,40 @@ TFB_BBox_RegisterPoint (int x, int y)
 	if (y < y1) y = y1;
 	if (y >= y2) y = y2;
 
-	/* Is this the first point?  If so, set a pixel-region and return. */
-	if (!TFB_BBox.valid)
-	{
-		TFB_BBox.valid = 1;
-		TFB_BBox.region.corner.x = x;
-		TFB_BBox.region.corner.y = y;
-		TFB_BBox.region.extent.width = 1;
-		TFB_BBox.region.extent.height = 1;
-		return;
-	}
-
-	/* Otherwise expand the rectangle if necessary. */
-	x1 = TFB_BBox.region.corner.x; 
-	y1 = TFB_BBox.region.corner.y;
-	x2 = TFB_BBox.region.corner.x + TFB_BBox.region.extent.width - 1;
-	y2 = TFB_BBox.region.corner.y + TFB_BBox.region.extent.height - 1;
-
-	if (x < x1) {
-		TFB_BBox.region.corner.x = x;
-		TFB_BBox.region.extent.width += x1 - x;
-	}
-	if (y < y1) {
-		TFB_BBox.region.corner.y = y;
-		TFB_BBox.region.extent.height += y1 - y;
-	}
-	if (x > x2) {
-		TFB_BBox.region.extent.width += x - x2;
-	}
-	if (y > y2) {
-		TFB_BBox.region.extent.height += y - y2;
-	}
+	r.corner.x = x;
+	r.corner.y = y;
+	r.extent.width = 1;
+	r.extent.height = 1;
+	registerClippedRect (r);
 }
 
 void
 TFB_BBox_RegisterRect (const RECT *r)
 {
-	/* RECT will still register as a corner point of the cliprect even
-	 * if it does not intersect with the cliprect at all. This is not
-	 * a problem, as more is not less. */
-	TFB_BBox_RegisterPoint (r->corner.x, r->corner.y);
-	TFB_BBox_RegisterPoint (r->corner.x + r->extent.width - 1,
-			r->corner.y + r->extent.height - 1);
+	/* Only the part inside the cliprect can change on screen. */
+	int x1 = TFB_BBox.clip.corner.x;
+	int y1 = TFB_BBox.clip.corner.y;
+	int x2 = TFB_BBox.clip.corner.x + TFB_BBox.clip.extent.width;
+	int y2 = TFB_BBox.clip.corner.y + TFB_BBox.clip.extent.height;
+	RECT c;
+
+	if (r->corner.x > x1)
+		x1 = r->corner.x;
+	if (r->corner.y > y1)
+		y1 = r->corner.y;
+	if (r->corner.x + r->extent.width < x2)
+		x2 = r->corner.x + r->extent.width;
+	if (r->corner.y + r->extent.height < y2)
+		y2 = r->corner.y + r->extent.height;
+
+	if (x1 >= x2 || y1 >= y2)
+		return;
+
+	c.corner.x = x1;
+	c.corner.y = y1;
+	c.extent.width = x2 - x1;
+	c.extent.height = y2 - y1;
+	registerClippedRect (c);
 }
 
 void
@@ -26,11 +26,15 @@
  * of which are only callable by the thread that is permitted to touch
  * the screen.  No explicit locks should therefore be required. */
 
+#define TFB_BBOX_MAX_RECTS 8
+
 typedef struct {
 	int valid;   // If zero, the next point registered becomes the region
 	RECT region; // The actual modified rectangle
 	RECT clip;   // Points outside of this rectangle are pushed to
 		     // the closest border point
+	int numRects;                    // The modified rectangles inside
+	RECT rects[TFB_BBOX_MAX_RECTS];  // 'region'; these never overlap
 } TFB_BoundingBox;
 
 extern TFB_BoundingBox TFB_BBox;
@@ -29,96 +29,104 @@
 #include "options.h"
 #include "libs/graphics/font.h"
 #include "uqm/setup.h"
-
-static RecursiveMutex DCQ_Mutex;
+#include SDL_INCLUDE(SDL_atomic.h)
+#include SDL_INCLUDE(SDL_thread.h)
+
+// The DCQ is a single-producer/single-consumer ring.  The game thread
+// is the only producer and owns InsertionPoint and Batching; the main()
+// thread is the only consumer and owns Front.  Back marks the end of the
+// commands the consumer may see.  Commands queued while batching sit
+// between Back and InsertionPoint until the batch is published, which
+// is a single store to Back.  Nothing is locked; the producer only
+// blocks when the ring is full.
+typedef struct tfb_drawcommandqueue
+{
+	SDL_atomic_t Front;
+	SDL_atomic_t Back;
+	int InsertionPoint;
+	int Batching;
+} TFB_DrawCommandQueue;
+
+static TFB_DrawCommandQueue DrawCommandQueue;
+// Consumer's copy of Back, refreshed when it runs out of commands
+static int DCQ_PopBack;
+
+static TFB_DrawCommand DCQ[DCQ_MAX];
+// Set for commands DCQ_CullCommands() found to be redundant
+static BYTE DCQ_Culled[DCQ_MAX];
+
+// Commands queued by the consumer thread itself (only REINITVIDEO, from
+// ProcessUtilityKeys()) cannot go into the ring without a second
+// producer.  They are kept here and popped after the ring drains.
+#define DCQ_LOCAL_MAX 4
+static TFB_DrawCommand DCQ_Local[DCQ_LOCAL_MAX];
+static int DCQ_LocalCount;
+static SDL_threadID DCQ_ConsumerThread;
 
 CondVar RenderingCond;
 
-TFB_DrawCommand DCQ[DCQ_MAX];
-
-TFB_DrawCommandQueue DrawCommandQueue;
-
 #define FPS_PERIOD  (ONE_SECOND / 20)
 int RenderedFrames = 0;
 
 
-// Wait for the queue to be emptied.
-static void
-TFB_WaitForSpace (int requested_slots)
+static inline int
+DCQ_Distance (int from, int to)
 {
-	int old_depth, i;
-	log_add (log_Debug, "DCQ overload (Size = %d, FullSize = %d, "
-			"Requested = %d).  Sleeping until renderer is done.",
-			DrawCommandQueue.Size, DrawCommandQueue.FullSize,
-			requested_slots);
-	// Restore the DCQ locking level.  I *think* this is
-	// always 1, but...
-	TFB_BatchReset ();
-	old_depth = GetRecursiveMutexDepth (DCQ_Mutex);
-	for (i = 0; i < old_depth; i++)
-		UnlockRecursiveMutex (DCQ_Mutex);
-	WaitCondVar (RenderingCond);
-	for (i = 0; i < old_depth; i++)
-		LockRecursiveMutex (DCQ_Mutex);
-	log_add (log_Debug, "DCQ clear (Size = %d, FullSize = %d).  Continuing.",
-			DrawCommandQueue.Size, DrawCommandQueue.FullSize);
+	return (to >= from) ? (to - from) : (to + DCQ_MAX - from);
 }
 
-void
-Lock_DCQ (int slots)
+// Number of commands visible to the consumer
+static inline int
+DCQ_Size (void)
 {
-	LockRecursiveMutex (DCQ_Mutex);
-	while (DrawCommandQueue.FullSize >= DCQ_MAX - slots)
-	{
-		TFB_WaitForSpace (slots);
-	}
+	return DCQ_Distance (SDL_AtomicGet (&DrawCommandQueue.Front),
+			SDL_AtomicGet (&DrawCommandQueue.Back));
 }
 
-void
-Unlock_DCQ (void)
+// Number of occupied slots, including batched commands.
+// Only meaningful on the producer thread.
+static inline int
+DCQ_FullSize (void)
 {
-	UnlockRecursiveMutex (DCQ_Mutex);
+	return DCQ_Distance (SDL_AtomicGet (&DrawCommandQueue.Front),
+			DrawCommandQueue.InsertionPoint);
 }
 
-// Always have the DCQ locked when calling this.
+static inline void
+Publish_DCQ (void)
+{
+	SDL_AtomicSet (&DrawCommandQueue.Back, DrawCommandQueue.InsertionPoint);
+}
+
+// Wait for the renderer to make room in the queue.
 static void
-Synchronize_DCQ (void)
+TFB_WaitForSpace (int requested_slots)
 {
-	if (!DrawCommandQueue.Batching)
-	{
-		int front = DrawCommandQueue.Front;
-		int back  = DrawCommandQueue.InsertionPoint;
-		DrawCommandQueue.Back = DrawCommandQueue.InsertionPoint;
-		if (front <= back)
-		{
-			DrawCommandQueue.Size = (back - front);
-		}
-		else
-		{
-			DrawCommandQueue.Size = (back + DCQ_MAX - front);
-		}
-		DrawCommandQueue.FullSize = DrawCommandQueue.Size;
-	}
+	log_add (log_Debug, "DCQ overload (Size = %d, FullSize = %d, "
+			"Requested = %d).  Sleeping until renderer is done.",
+			DCQ_Size (), DCQ_FullSize (), requested_slots);
+	// The renderer cannot free any slots it cannot see
+	TFB_BatchReset ();
+	WaitCondVar (RenderingCond);
+	log_add (log_Debug, "DCQ clear (Size = %d, FullSize = %d).  Continuing.",
+			DCQ_Size (), DCQ_FullSize ());
 }
 
 void
 TFB_BatchGraphics (void)
 {
-	LockRecursiveMutex (DCQ_Mutex);
 	DrawCommandQueue.Batching++;
-	UnlockRecursiveMutex (DCQ_Mutex);
 }
 
 void
 TFB_UnbatchGraphics (void)
 {	
-	LockRecursiveMutex (DCQ_Mutex);
 	if (DrawCommandQueue.Batching)
 	{
 		DrawCommandQueue.Batching--;
 	}
-	Synchronize_DCQ ();
-	UnlockRecursiveMutex (DCQ_Mutex);
+	if (!DrawCommandQueue.Batching)
+		Publish_DCQ ();
 }
 
 // Cancel all pending batch operations, making them unbatched.  This will
@@ -127,10 +135,8 @@ TFB_UnbatchGraphics (void)
 void
 TFB_BatchReset (void)
 {
-	LockRecursiveMutex (DCQ_Mutex);
 	DrawCommandQueue.Batching = 0;
-	Synchronize_DCQ ();
-	UnlockRecursiveMutex (DCQ_Mutex);
+	Publish_DCQ ();
 }
 
 
@@ -139,18 +145,18 @@ TFB_BatchReset (void)
 void
 Init_DrawCommandQueue (void)
 {
-	DrawCommandQueue.Back = 0;
-	DrawCommandQueue.Front = 0;
+	SDL_AtomicSet (&DrawCommandQueue.Front, 0);
+	SDL_AtomicSet (&DrawCommandQueue.Back, 0);
 	DrawCommandQueue.InsertionPoint = 0;
 	DrawCommandQueue.Batching = 0;
-	DrawCommandQueue.FullSize = 0;
-	DrawCommandQueue.Size = 0;
+	DCQ_PopBack = 0;
+	DCQ_LocalCount = 0;
+	memset (DCQ_Culled, 0, sizeof DCQ_Culled);
+	// Init is done by main(), which is also the thread flushing the DCQ
+	DCQ_ConsumerThread = SDL_ThreadID ();
 
 	TFB_BBox_Init (CanvasWidth, CanvasHeight);
 
-	DCQ_Mutex = CreateRecursiveMutex ("DCQ",
-			SYNC_CLASS_TOPLEVEL | SYNC_CLASS_VIDEO);
-
 	RenderingCond = CreateCondVar ("DCQ empty",
 			SYNC_CLASS_TOPLEVEL | SYNC_CLASS_VIDEO);
 }
@@ -158,81 +164,118 @@ Init_DrawCommandQueue (void)
 void
 Uninit_DrawCommandQueue (void)
 {
+	TFB_DrawCullStats stats;
+
+	TFB_GetDrawCullStats (&stats);
+	log_add (log_Info, "DCQ culling: %lu commands culled, %lu rects "
+			"merged, %lu scissor changes skipped, %llu pixels saved",
+			(unsigned long)stats.culled, (unsigned long)stats.merged,
+			(unsigned long)stats.scissors,
+			(unsigned long long)stats.pixels);
+
 	if (RenderingCond)
 	{
 		DestroyCondVar (RenderingCond);
 		RenderingCond = 0;
 	}
-
-	if (DCQ_Mutex)
-	{
-		DestroyRecursiveMutex (DCQ_Mutex);
-		DCQ_Mutex = 0;
-	}
 }
 
 void
 TFB_DrawCommandQueue_Push (TFB_DrawCommand* Command)
 {
-	Lock_DCQ (1);
+	int next;
+
+	if (SDL_ThreadID () == DCQ_ConsumerThread)
+	{
+		if (DCQ_LocalCount == DCQ_LOCAL_MAX)
+		{
+			log_add (log_Warning, "DCQ: too many commands queued from "
+					"the rendering thread; dropping command %d",
+					(int)Command->Type);
+			return;
+		}
+		DCQ_Local[DCQ_LocalCount++] = *Command;
+		return;
+	}
+
+	while (DCQ_FullSize () >= DCQ_MAX - 1)
+	{
+		TFB_WaitForSpace (1);
+	}
+
+	next = (DrawCommandQueue.InsertionPoint + 1) % DCQ_MAX;
 	DCQ[DrawCommandQueue.InsertionPoint] = *Command;
-	DrawCommandQueue.InsertionPoint = (DrawCommandQueue.InsertionPoint + 1)
-			% DCQ_MAX;
-	DrawCommandQueue.FullSize++;
-	Synchronize_DCQ ();
-	Unlock_DCQ ();
+	DrawCommandQueue.InsertionPoint = next;
+
+	if (!DrawCommandQueue.Batching)
+		Publish_DCQ ();
+	else if (DCQ_FullSize () > DCQ_FORCE_BREAK_SIZE)
+		TFB_BatchReset ();
 }
 
+// Only call from the consumer (main()) thread
 int
 TFB_DrawCommandQueue_Pop (TFB_DrawCommand *target)
 {
-	LockRecursiveMutex (DCQ_Mutex);
+	int front = SDL_AtomicGet (&DrawCommandQueue.Front);
 
-	if (DrawCommandQueue.Size == 0)
+	for (;;)
 	{
-		Unlock_DCQ ();
-		return (0);
+		int back;
+
+		// Skip over culled commands
+		while (front != DCQ_PopBack && DCQ_Culled[front])
+		{
+			DCQ_Culled[front] = FALSE;
+			front = (front + 1) % DCQ_MAX;
+		}
+		if (front != DCQ_PopBack)
+			break;
+
+		// Pick up whatever the producer has published since
+		SDL_AtomicSet (&DrawCommandQueue.Front, front);
+		back = SDL_AtomicGet (&DrawCommandQueue.Back);
+		if (back == DCQ_PopBack)
+			break;
+		DCQ_PopBack = back;
 	}
 
-	if (DrawCommandQueue.Front == DrawCommandQueue.Back &&
-			DrawCommandQueue.Size != DCQ_MAX)
+	if (front == DCQ_PopBack)
 	{
-		log_add (log_Debug, "Augh!  Assertion failure in DCQ!  "
-				"Front == Back, Size != DCQ_MAX");
-		DrawCommandQueue.Size = 0;
-		Unlock_DCQ ();
-		return (0);
-	}
+		int i;
+
+		if (DCQ_LocalCount == 0)
+			return (0);
 
-	*target = DCQ[DrawCommandQueue.Front];
-	DrawCommandQueue.Front = (DrawCommandQueue.Front + 1) % DCQ_MAX;
+		*target = DCQ_Local[0];
+		--DCQ_LocalCount;
+		for (i = 0; i < DCQ_LocalCount; ++i)
+			DCQ_Local[i] = DCQ_Local[i + 1];
+		return 1;
+	}
 
-	DrawCommandQueue.Size--;
-	DrawCommandQueue.FullSize--;
-	UnlockRecursiveMutex (DCQ_Mutex);
+	*target = DCQ[front];
+	SDL_AtomicSet (&DrawCommandQueue.Front, (front + 1) % DCQ_MAX);
 
 	return 1;
 }
 
+// Drops all commands visible to the renderer.
+// Only call from the consumer (main()) thread
 void
 TFB_DrawCommandQueue_Clear ()
 {
-	LockRecursiveMutex (DCQ_Mutex);
-	DrawCommandQueue.Size = 0;
-	DrawCommandQueue.Front = 0;
-	DrawCommandQueue.Back = 0;
-	DrawCommandQueue.Batching = 0;
-	DrawCommandQueue.FullSize = 0;
-	DrawCommandQueue.InsertionPoint = 0;
-	UnlockRecursiveMutex (DCQ_Mutex);
+	DCQ_PopBack = SDL_AtomicGet (&DrawCommandQueue.Back);
+	SDL_AtomicSet (&DrawCommandQueue.Front, DCQ_PopBack);
+	memset (DCQ_Culled, 0, sizeof DCQ_Culled);
+	DCQ_LocalCount = 0;
 }
 
 static void
 checkExclusiveThread (TFB_DrawCommand* DrawCommand)
 {
 #ifdef DEBUG_DCQ_THREADS
-	static uint32 exclusiveThreadId;
-	extern uint32 SDL_ThreadID(void);
+	static SDL_threadID exclusiveThreadId;
 
 	// Only one thread is currently allowed to enqueue commands
 	// This is not a technical limitation but rather a semantical one atm.
@@ -373,17 +416,433 @@ RenderFPS (int *fps)
 #define MIN(a,b) (((a)<(b)) ? (a) : (b))
 #endif
 
+// Overdraw culling.
+// Before TFB_FlushGraphics runs the visible commands, it makes one pass
+// over them to drop work that can never reach the screen:
+//  - drawing that a later opaque rectangle fill or screen-to-screen copy
+//    completely covers, as long as nothing reads that screen in between;
+//  - scissor commands that leave the clip rectangle as it was;
+//  - rectangle fills that continue the previous fill with the same color
+//    and mode, which are merged into it.
+// Culled commands stay in the ring and are skipped by Pop.
+// Run with --nodrawcull to compare against the unoptimized path.
+
+typedef struct
+{
+	BOOLEAN known;
+			// FALSE when we do not know what the main screen clips to
+	BOOLEAN enabled;
+	RECT rect;
+} DCQ_ClipState;
+
+#define DCQ_MAX_COVERS 8
+
+typedef struct
+{
+	RECT rect[DCQ_MAX_COVERS];
+	int count;
+} DCQ_Covers;
+
+// Clip state each command runs with, as an index into DCQ_Clips
+static int DCQ_ClipIndex[DCQ_MAX];
+static DCQ_ClipState DCQ_Clips[DCQ_MAX + 1];
+// Clip state of the main screen after the last executed command.
+// Screens start out unclipped.
+static DCQ_ClipState DCQ_ScreenClip = { TRUE, FALSE, {{0, 0}, {0, 0}} };
+
+static TFB_DrawCullStats DCQ_CullStats;
+
+// Intersects r with clip; FALSE if nothing is left
+static BOOLEAN
+DCQ_ClipRect (RECT *r, const RECT *clip)
+{
+	int x1 = r->corner.x;
+	int y1 = r->corner.y;
+	int x2 = x1 + r->extent.width;
+	int y2 = y1 + r->extent.height;
+
+	if (x1 < clip->corner.x)
+		x1 = clip->corner.x;
+	if (y1 < clip->corner.y)
+		y1 = clip->corner.y;
+	if (x2 > clip->corner.x + clip->extent.width)
+		x2 = clip->corner.x + clip->extent.width;
+	if (y2 > clip->corner.y + clip->extent.height)
+		y2 = clip->corner.y + clip->extent.height;
+	if (x1 >= x2 || y1 >= y2)
+		return FALSE;
+
+	r->corner.x = x1;
+	r->corner.y = y1;
+	r->extent.width = x2 - x1;
+	r->extent.height = y2 - y1;
+	return TRUE;
+}
+
+static inline BOOLEAN
+DCQ_RectInside (const RECT *r, const RECT *outer)
+{
+	return r->corner.x >= outer->corner.x
+			&& r->corner.y >= outer->corner.y
+			&& r->corner.x + r->extent.width
+				<= outer->corner.x + outer->extent.width
+			&& r->corner.y + r->extent.height
+				<= outer->corner.y + outer->extent.height;
+}
+
+// Pixels a command would have touched in the area bounded by r
+static DWORD
+DCQ_RectPixels (RECT r, SCREEN dest, const DCQ_ClipState *clip)
+{
+	RECT canvas;
+
+	canvas.corner.x = 0;
+	canvas.corner.y = 0;
+	canvas.extent.width = CanvasWidth;
+	canvas.extent.height = CanvasHeight;
+	if (!DCQ_ClipRect (&r, &canvas))
+		return 0;
+	if (dest == TFB_SCREEN_MAIN && clip->known && clip->enabled
+			&& !DCQ_ClipRect (&r, &clip->rect))
+		return 0;
+	return (DWORD)r.extent.width * r.extent.height;
+}
+
+// Area of the screen a command may draw to, ignoring the clip rect.
+// Returns FALSE for commands that do not draw, or that we should not
+// drop because executing them has other effects.
+static BOOLEAN
+DCQ_CommandBounds (const TFB_DrawCommand *DC, SCREEN *dest, RECT *r)
+{
+	switch (DC->Type)
+	{
+		case TFB_DRAWCOMMANDTYPE_LINE:
+		{
+			const TFB_DrawCommand_Line *cmd = &DC->data.line;
+			// Thick lines may be drawn centered; be generous
+			r->corner.x = MIN (cmd->x1, cmd->x2) - cmd->thickness;
+			r->corner.y = MIN (cmd->y1, cmd->y2) - cmd->thickness;
+			r->extent.width = abs (cmd->x1 - cmd->x2)
+					+ 2 * cmd->thickness + 1;
+			r->extent.height = abs (cmd->y1 - cmd->y2)
+					+ 2 * cmd->thickness + 1;
+			*dest = cmd->destBuffer;
+			return TRUE;
+		}
+
+		case TFB_DRAWCOMMANDTYPE_RECTANGLE:
+			*r = DC->data.rect.rect;
+			*dest = DC->data.rect.destBuffer;
+			return TRUE;
+
+		case TFB_DRAWCOMMANDTYPE_IMAGE:
+		{
+			const TFB_DrawCommand_Image *cmd = &DC->data.image;
+			EXTENT size;
+
+			// Colormaps and DRAW_ALPHA change the image itself, and
+			// scaled images only know their size once scaled.
+			if (!cmd->image || cmd->colormap || cmd->scale
+					|| cmd->drawMode.kind == DRAW_ALPHA)
+				return FALSE;
+
+			LockMutex (cmd->image->mutex);
+			TFB_DrawCanvas_GetExtent (cmd->image->NormalImg, &size);
+			r->corner.x = cmd->x - cmd->image->NormalHs.x;
+			r->corner.y = cmd->y - cmd->image->NormalHs.y;
+			UnlockMutex (cmd->image->mutex);
+			r->extent = size;
+			*dest = cmd->destBuffer;
+			return TRUE;
+		}
+
+		case TFB_DRAWCOMMANDTYPE_FILLEDIMAGE:
+		{
+			const TFB_DrawCommand_FilledImage *cmd = &DC->data.filledimage;
+			EXTENT size;
+
+			if (!cmd->image || cmd->scale
+					|| cmd->drawMode.kind == DRAW_ALPHA)
+				return FALSE;
+
+			LockMutex (cmd->image->mutex);
+			TFB_DrawCanvas_GetExtent (cmd->image->NormalImg, &size);
+			r->corner.x = cmd->x - cmd->image->NormalHs.x;
+			r->corner.y = cmd->y - cmd->image->NormalHs.y;
+			UnlockMutex (cmd->image->mutex);
+			r->extent = size;
+			*dest = cmd->destBuffer;
+			return TRUE;
+		}
+
+		case TFB_DRAWCOMMANDTYPE_FONTCHAR:
+		{
+			const TFB_DrawCommand_FontChar *cmd = &DC->data.fontchar;
+			r->corner.x = cmd->x - cmd->fontchar->HotSpot.x;
+			r->corner.y = cmd->y - cmd->fontchar->HotSpot.y;
+			r->extent = cmd->fontchar->extent;
+			*dest = cmd->destBuffer;
+			return TRUE;
+		}
+
+		case TFB_DRAWCOMMANDTYPE_COPY:
+			*r = DC->data.copy.rect;
+			*dest = DC->data.copy.destBuffer;
+			return TRUE;
+	}
+	return FALSE;
+}
+
+// Whether the command replaces every pixel in its bounds
+static BOOLEAN
+DCQ_IsOpaqueCover (const TFB_DrawCommand *DC)
+{
+	if (DC->Type == TFB_DRAWCOMMANDTYPE_RECTANGLE)
+	{
+		const TFB_DrawCommand_Rect *cmd = &DC->data.rect;
+		// Translucent colors turn into DRAW_ALPHA on screen canvases
+		return cmd->drawMode.kind == DRAW_REPLACE && cmd->color.a == 0xff;
+	}
+	if (DC->Type == TFB_DRAWCOMMANDTYPE_COPY)
+	{	// Screens have no alpha channel, so copies are opaque
+		return DC->data.copy.srcBuffer != DC->data.copy.destBuffer;
+	}
+	return FALSE;
+}
+
+static BOOLEAN
+DCQ_TryMergeRects (TFB_DrawCommand_Rect *prev, const TFB_DrawCommand_Rect *cmd)
+{
+	RECT *a = &prev->rect;
+	const RECT *b = &cmd->rect;
+
+	if (prev->destBuffer != cmd->destBuffer
+			|| prev->drawMode.kind != cmd->drawMode.kind
+			|| prev->drawMode.factor != cmd->drawMode.factor
+			|| !sameColor (prev->color, cmd->color))
+		return FALSE;
+
+	if (a->corner.y == b->corner.y && a->extent.height == b->extent.height
+			&& a->extent.width + b->extent.width <= 0x7fff)
+	{
+		if (a->corner.x + a->extent.width == b->corner.x)
+		{
+			a->extent.width += b->extent.width;
+			return TRUE;
+		}
+		if (b->corner.x + b->extent.width == a->corner.x)
+		{
+			a->corner.x = b->corner.x;
+			a->extent.width += b->extent.width;
+			return TRUE;
+		}
+	}
+	if (a->corner.x == b->corner.x && a->extent.width == b->extent.width
+			&& a->extent.height + b->extent.height <= 0x7fff)
+	{
+		if (a->corner.y + a->extent.height == b->corner.y)
+		{
+			a->extent.height += b->extent.height;
+			return TRUE;
+		}
+		if (b->corner.y + b->extent.height == a->corner.y)
+		{
+			a->corner.y = b->corner.y;
+			a->extent.height += b->extent.height;
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+static void
+DCQ_AddCover (DCQ_Covers *covers, const RECT *r)
+{
+	int i;
+
+	if (covers->count < DCQ_MAX_COVERS)
+	{
+		covers->rect[covers->count++] = *r;
+		return;
+	}
+	// Keep the largest ones
+	for (i = 0; i < DCQ_MAX_COVERS; ++i)
+	{
+		const RECT *c = &covers->rect[i];
+		if ((DWORD)c->extent.width * c->extent.height
+				< (DWORD)r->extent.width * r->extent.height)
+		{
+			covers->rect[i] = *r;
+			return;
+		}
+	}
+}
+
+static BOOLEAN
+DCQ_IsCovered (const DCQ_Covers *covers, const RECT *r)
+{
+	int i;
+
+	for (i = 0; i < covers->count; ++i)
+	{
+		if (DCQ_RectInside (r, &covers->rect[i]))
+			return TRUE;
+	}
+	return FALSE;
+}
+
+// Marks culled commands among the next count queued ones.
+// Only call from the consumer (main()) thread
+static void
+DCQ_CullCommands (int count)
+{
+	DCQ_Covers covers[TFB_GFX_NUMSCREENS];
+	DCQ_ClipState clip = DCQ_ScreenClip;
+	const int front = SDL_AtomicGet (&DrawCommandQueue.Front);
+	TFB_DrawCommand_Rect *prevRect = NULL;
+	int numClips = 0;
+	int k, i;
+
+	// Forward: follow the clip rect, drop redundant scissor changes and
+	// merge rectangle fills.
+	DCQ_Clips[0] = clip;
+	for (k = 0; k < count; ++k)
+	{
+		TFB_DrawCommand *DC;
+
+		i = (front + k) % DCQ_MAX;
+		DC = &DCQ[i];
+		DCQ_ClipIndex[i] = numClips;
+		if (DCQ_Culled[i])
+			continue;
+
+		switch (DC->Type)
+		{
+			case TFB_DRAWCOMMANDTYPE_SCISSORENABLE:
+				if (clip.known && clip.enabled
+						&& rectsEqual (clip.rect, DC->data.scissor.rect))
+				{
+					DCQ_Culled[i] = TRUE;
+					DCQ_CullStats.scissors++;
+					continue;
+				}
+				clip.known = TRUE;
+				clip.enabled = TRUE;
+				clip.rect = DC->data.scissor.rect;
+				DCQ_Clips[++numClips] = clip;
+				prevRect = NULL;
+				break;
+
+			case TFB_DRAWCOMMANDTYPE_SCISSORDISABLE:
+				if (clip.known && !clip.enabled)
+				{
+					DCQ_Culled[i] = TRUE;
+					DCQ_CullStats.scissors++;
+					continue;
+				}
+				clip.known = TRUE;
+				clip.enabled = FALSE;
+				DCQ_Clips[++numClips] = clip;
+				prevRect = NULL;
+				break;
+
+			case TFB_DRAWCOMMANDTYPE_REINITVIDEO:
+				clip.known = FALSE;
+				DCQ_Clips[++numClips] = clip;
+				prevRect = NULL;
+				break;
+
+			case TFB_DRAWCOMMANDTYPE_RECTANGLE:
+				if (prevRect && DCQ_TryMergeRects (prevRect, &DC->data.rect))
+				{
+					DCQ_Culled[i] = TRUE;
+					DCQ_CullStats.merged++;
+					continue;
+				}
+				prevRect = &DC->data.rect;
+				break;
+
+			default:
+				prevRect = NULL;
+				break;
+		}
+	}
+
+	// Backward: remember what the rest of the frame overwrites, and
+	// drop drawing that ends up entirely underneath.
+	memset (covers, 0, sizeof covers);
+	for (k = count - 1; k >= 0; --k)
+	{
+		TFB_DrawCommand *DC;
+		const DCQ_ClipState *cmdClip;
+		SCREEN dest;
+		RECT r;
+
+		i = (front + k) % DCQ_MAX;
+		if (DCQ_Culled[i])
+			continue;
+		DC = &DCQ[i];
+		cmdClip = &DCQ_Clips[DCQ_ClipIndex[i]];
+
+		switch (DC->Type)
+		{
+			case TFB_DRAWCOMMANDTYPE_CALLBACK:
+			case TFB_DRAWCOMMANDTYPE_SENDSIGNAL:
+			case TFB_DRAWCOMMANDTYPE_REINITVIDEO:
+				// Anything may look at the screens after these
+				memset (covers, 0, sizeof covers);
+				continue;
+
+			case TFB_DRAWCOMMANDTYPE_COPYTOIMAGE:
+				covers[DC->data.copytoimage.srcBuffer].count = 0;
+				continue;
+		}
+
+		if (!DCQ_CommandBounds (DC, &dest, &r))
+			continue;
+
+		if (DCQ_IsCovered (&covers[dest], &r))
+		{
+			DCQ_Culled[i] = TRUE;
+			DCQ_CullStats.culled++;
+			DCQ_CullStats.pixels += DCQ_RectPixels (r, dest, cmdClip);
+			continue;
+		}
+
+		if (DC->Type == TFB_DRAWCOMMANDTYPE_COPY)
+			covers[DC->data.copy.srcBuffer].count = 0;
+
+		if (DCQ_IsOpaqueCover (DC))
+		{
+			if (dest == TFB_SCREEN_MAIN && !cmdClip->known)
+				continue;
+			if (dest == TFB_SCREEN_MAIN && cmdClip->enabled
+					&& !DCQ_ClipRect (&r, &cmdClip->rect))
+				continue;
+			DCQ_AddCover (&covers[dest], &r);
+		}
+	}
+}
+
+void
+TFB_GetDrawCullStats (TFB_DrawCullStats *stats)
+{
+	*stats = DCQ_CullStats;
+}
+
 // Only call from main() thread!!
 void
 TFB_FlushGraphics (void)
 {
 	int commands_handled;
+	int commands_left;
 	static int fps = 0;
 	BOOLEAN livelock_deterrence;
+	QWORD flushStart = GetPerfCounter ();
 
-	// This is technically a locking violation on DrawCommandQueue.Size,
-	// but it is likely to not be very destructive.
-	if (DrawCommandQueue.Size == 0)
+	memset (&TFB_FrameStageTimes, 0, sizeof TFB_FrameStageTimes);
+
+	if (DCQ_Size () == 0 && DCQ_LocalCount == 0)
 	{
 		static int last_fade = 255;
 		static int last_transition = 255;
@@ -406,6 +865,7 @@ TFB_FlushGraphics (void)
 		
 		last_fade = current_fade;
 		last_transition = current_transition;
+		TFB_FrameStageTimes.flush = GetPerfCounter () - flushStart;
 		BroadcastCondVar (RenderingCond);
 		return;
 	}
@@ -413,18 +873,22 @@ TFB_FlushGraphics (void)
 	if (GfxFlags & TFB_GFXFLAGS_SHOWFPS)
 		computeFPS (&fps);
 
+	if (!optNoDrawCulling)
+		DCQ_CullCommands (DCQ_Size ());
+
 	commands_handled = 0;
+	commands_left = 0;
 	livelock_deterrence = FALSE;
 
-	if (DrawCommandQueue.FullSize > DCQ_FORCE_BREAK_SIZE)
-	{
-		TFB_BatchReset ();
-	}
-
-	if (DrawCommandQueue.Size > DCQ_FORCE_SLOWDOWN_SIZE)
+	// Livelock deterrence no longer blocks the producer.  Instead we
+	// only process the commands that are visible when it kicks in, and
+	// leave the rest for the next frame.  The producer is slowed down
+	// by the ring filling up.  Continuity breaks for oversized batches
+	// are done by the producer in TFB_DrawCommandQueue_Push().
+	if (DCQ_Size () > DCQ_FORCE_SLOWDOWN_SIZE)
 	{
-		Lock_DCQ (-1);
 		livelock_deterrence = TRUE;
+		commands_left = DCQ_Size () + DCQ_LocalCount;
 	}
 
 	TFB_BBox_Reset ();
@@ -433,6 +897,9 @@ TFB_FlushGraphics (void)
 	{
 		TFB_DrawCommand DC;
 
+		if (livelock_deterrence && commands_left-- == 0)
+			break;
+
 		if (!TFB_DrawCommandQueue_Pop (&DC))
 		{
 			// the Queue is now empty.
@@ -440,13 +907,12 @@ TFB_FlushGraphics (void)
 		}
 
 		++commands_handled;
-		if (!livelock_deterrence && commands_handled + DrawCommandQueue.Size
+		if (!livelock_deterrence && commands_handled + DCQ_Size ()
 				> DCQ_LIVELOCK_MAX)
 		{
 			// log_add (log_Debug, "Initiating livelock deterrence!");
 			livelock_deterrence = TRUE;
-			
-			Lock_DCQ (-1);
+			commands_left = DCQ_Size () + DCQ_LocalCount;
 		}
 
 		switch (DC.Type)
@@ -582,6 +1048,9 @@ TFB_FlushGraphics (void)
 				TFB_DrawCanvas_SetClipRect (
 						TFB_GetScreenCanvas (TFB_SCREEN_MAIN), &cmd->rect);
 				TFB_BBox_SetClipRect (&DC.data.scissor.rect);
+				DCQ_ScreenClip.known = TRUE;
+				DCQ_ScreenClip.enabled = TRUE;
+				DCQ_ScreenClip.rect = cmd->rect;
 				break;
 			}
 			
@@ -589,6 +1058,8 @@ TFB_FlushGraphics (void)
 				TFB_DrawCanvas_SetClipRect (
 						TFB_GetScreenCanvas (TFB_SCREEN_MAIN), NULL);
 				TFB_BBox_SetClipRect (NULL);
+				DCQ_ScreenClip.known = TRUE;
+				DCQ_ScreenClip.enabled = FALSE;
 				break;
 			
 			case TFB_DRAWCOMMANDTYPE_COPYTOIMAGE:
@@ -607,6 +1078,7 @@ TFB_FlushGraphics (void)
 				TFB_DrawCanvas_CopyRect (
 						TFB_GetScreenCanvas (cmd->srcBuffer), &cmd->rect,
 						DC_image->NormalImg, dstPt);
+				TFB_DrawImage_DiscardCollisionMask (DC_image);
 				UnlockMutex (DC_image->mutex);
 				break;
 			}
@@ -650,6 +1122,8 @@ TFB_FlushGraphics (void)
 				int oldFlags = GfxFlags;
 				int oldWidth = WindowWidth;
 				int oldHeight = WindowHeight;
+
+				DCQ_ScreenClip.known = FALSE;
 				if (TFB_ReInitGraphics (cmd->driver, cmd->flags,
 						cmd->width, cmd->height, &resolutionFactor,
 						&optWindowType))
@@ -679,21 +1153,21 @@ TFB_FlushGraphics (void)
 		}
 	}
 
-	if (livelock_deterrence)
-		Unlock_DCQ ();
-
 	if (GfxFlags & TFB_GFXFLAGS_SHOWFPS)
 		RenderFPS (&fps);
 	
 	TFB_SwapBuffers (TFB_REDRAW_NO);
 	RenderedFrames++;
+	TFB_FrameStageTimes.flush = GetPerfCounter () - flushStart;
 	BroadcastCondVar (RenderingCond);
 }
 
+// Only call from main() thread, after the game thread is gone
 void
 TFB_PurgeDanglingGraphics (void)
 {
-	Lock_DCQ (-1);
+	// Commands still held in a batch were never published
+	TFB_BatchReset ();
 
 	for (;;)
 	{
@@ -733,5 +1207,4 @@ TFB_PurgeDanglingGraphics (void)
 			}
 		}
 	}
-	Unlock_DCQ ();
 }
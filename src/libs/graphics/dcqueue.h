@@ -29,8 +29,10 @@
 // the game freezes.  Thus, if the queue starts out larger than
 // DCQ_FORCE_SLOWDOWN_SIZE, or DCQ_LIVELOCK_MAX commands find
 // themselves being processed in one go, livelock deterrence is
-// enabled, and TFB_FlushGraphics locks the DCQ until it has processed
-// all entries.  If batched but pending commands exceed DCQ_FORCE_BREAK_SIZE,
+// enabled, and TFB_FlushGraphics only processes the entries that
+// were queued at that point, leaving the rest for the next frame.
+// The game thread is then held back by the queue filling up.
+// If batched but pending commands exceed DCQ_FORCE_BREAK_SIZE,
 // a continuity break is performed.  This will effectively slow down the 
 // game logic, a fate we seek to avoid - however, it seems to be unavoidable
 // on slower machines.  Even there, it's seems nonexistent outside of
@@ -364,6 +364,7 @@ SetFrameTransparentColor (FRAME frame, Color color)
 
 	// TODO: This should defer to TFB_DrawImage instead
 	TFB_DrawCanvas_SetTransparentColor (img->NormalImg, color, FALSE);
+	TFB_DrawImage_DiscardCollisionMask (img);
 	
 	UnlockMutex (img->mutex);
 }
@@ -593,6 +594,7 @@ BOOLEAN
 WriteFramePixelColors (FRAME frame, const Color *pixels, int width, int height)
 {
 	TFB_Image *img;
+	BOOLEAN ret;
 
 	if (!frame)
 		return FALSE;
@@ -601,8 +603,14 @@ WriteFramePixelColors (FRAME frame, const Color *pixels, int width, int height)
 
 	// TODO: Do we need to lock the img->mutex here?
 	img = frame->image;
-	return TFB_DrawCanvas_SetPixelColors (img->NormalImg, pixels,
+	ret = TFB_DrawCanvas_SetPixelColors (img->NormalImg, pixels,
 			width, height);
+
+	LockMutex (img->mutex);
+	TFB_DrawImage_DiscardCollisionMask (img);
+	UnlockMutex (img->mutex);
+
+	return ret;
 }
 
 BOOLEAN
@@ -631,6 +639,7 @@ BOOLEAN
 WriteFramePixelIndexes (FRAME frame, const BYTE *pixels, int width, int height)
 {
 	TFB_Image *img;
+	BOOLEAN ret;
 
 	if (!frame)
 		return FALSE;
@@ -639,6 +648,12 @@ WriteFramePixelIndexes (FRAME frame, const BYTE *pixels, int width, int height)
 
 	// TODO: Do we need to lock the img->mutex here?
 	img = frame->image;
-	return TFB_DrawCanvas_SetPixelIndexes (img->NormalImg, pixels,
+	ret = TFB_DrawCanvas_SetPixelIndexes (img->NormalImg, pixels,
 			width, height);
+
+	LockMutex (img->mutex);
+	TFB_DrawImage_DiscardCollisionMask (img);
+	UnlockMutex (img->mutex);
+
+	return ret;
 }
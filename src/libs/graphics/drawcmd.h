@@ -166,16 +166,6 @@ typedef struct tfb_drawcommand
 
 // Queue Stuff
 
-typedef struct tfb_drawcommandqueue
-{
-	int Front;
-	int Back;
-	int InsertionPoint;
-	int Batching;
-	volatile int FullSize;
-	volatile int Size;
-} TFB_DrawCommandQueue;
-
 void Init_DrawCommandQueue (void);
 
 void Uninit_DrawCommandQueue (void);
@@ -192,12 +182,21 @@ int TFB_DrawCommandQueue_Pop (TFB_DrawCommand* Command);
 
 void TFB_DrawCommandQueue_Clear (void);
 
-extern TFB_DrawCommandQueue DrawCommandQueue;
-
 void TFB_EnqueueDrawCommand (TFB_DrawCommand* DrawCommand);
 
-void Lock_DCQ (int slots);
+// Work skipped by the overdraw culling pass in TFB_FlushGraphics
+typedef struct
+{
+	DWORD culled;
+			// drawing commands fully covered by later opaque ones
+	DWORD merged;
+			// rectangle fills merged into the previous one
+	DWORD scissors;
+			// scissor changes that did not change anything
+	QWORD pixels;
+			// pixels the culled commands would have drawn
+} TFB_DrawCullStats;
 
-void Unlock_DCQ (void);
+void TFB_GetDrawCullStats (TFB_DrawCullStats *stats);
 
 #endif
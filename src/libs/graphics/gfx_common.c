@@ -51,6 +51,8 @@ int TFB_DEBUG_HALT = 0;
 
 volatile int TransitionAmount = 255;
 
+TFB_FrameTimes TFB_FrameStageTimes;
+
 static int gscale = GSCALE_IDENTITY;
 static int gscale_mode = TFB_SCALE_NEAREST;
 
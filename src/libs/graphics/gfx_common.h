@@ -58,6 +58,9 @@ enum
 #define TFB_GFXFLAGS_SCALE_SOFT_ONLY \
 		( TFB_GFXFLAGS_SCALE_ANY & ~TFB_GFXFLAGS_SCALE_BILINEAR )
 #define TFB_GFXFLAGS_EX_FULLSCREEN      (1<<8)
+// Software scalers enlarge 2x unless one of these is set
+#define TFB_GFXFLAGS_SCALE_3X           (1<<9)
+#define TFB_GFXFLAGS_SCALE_4X           (1<<10)
 
 // The flag variable itself
 extern int GfxFlags;
@@ -104,6 +107,19 @@ extern int FrameRateTickBase;
 void TFB_FlushGraphics (void); // Only call from main thread!!
 void TFB_PurgeDanglingGraphics (void); // Only call from main thread as part of shutdown.
 
+// Where the last TFB_FlushGraphics() spent its time, in GetPerfCounter()
+// ticks. 'swap' is part of 'flush'; 'scale' and 'upload' are part of
+// 'swap'. Only meaningful on the main thread.
+typedef struct
+{
+	QWORD flush;
+	QWORD swap;
+	QWORD scale;
+	QWORD upload;
+} TFB_FrameTimes;
+
+extern TFB_FrameTimes TFB_FrameStageTimes;
+
 extern int fs_height; 
 extern int fs_width;
 
@@ -0,0 +1,107 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+// AVX2 blend span kernels
+//  The file is built without special compiler flags; the functions
+//  carry the target attribute and are only called when the CPU
+//  reports AVX2 support.
+
+#include "port.h"
+#include "libs/graphics/sdl/sdl_common.h"
+#include "primitives.h"
+#include "blendspan.h"
+
+#if defined(BLEND_AVX2)
+
+#include <immintrin.h>
+
+#define BLEND_(name) Blend_AVX2_ ## name
+#if defined(__GNUC__) || defined(__clang__)
+#	define BLEND_FN __attribute__ ((target ("avx2")))
+#else
+#	define BLEND_FN
+#endif
+#define VEC __m256i
+#define VEC_PIXELS 8
+
+#define V_ZERO()            _mm256_setzero_si256 ()
+#define V_LOAD(p)           _mm256_loadu_si256 ((const __m256i *)(p))
+#define V_STORE(p, v)       _mm256_storeu_si256 ((__m256i *)(p), v)
+#define V_SET1_32(x)        _mm256_set1_epi32 (x)
+#define V_SET1_16(x)        _mm256_set1_epi16 ((short)(x))
+#define V_SET_PIXW(w0, w1, w2, w3) \
+		_mm256_set_epi16 (w3, w2, w1, w0, w3, w2, w1, w0, \
+			w3, w2, w1, w0, w3, w2, w1, w0)
+#define V_AND(a, b)         _mm256_and_si256 (a, b)
+#define V_OR(a, b)          _mm256_or_si256 (a, b)
+#define V_XOR(a, b)         _mm256_xor_si256 (a, b)
+#define V_ANDNOT(a, b)      _mm256_andnot_si256 (a, b)
+#define V_ADDS_U8(a, b)     _mm256_adds_epu8 (a, b)
+#define V_SUBS_U8(a, b)     _mm256_subs_epu8 (a, b)
+#define V_UNPACKLO_8(a, b)  _mm256_unpacklo_epi8 (a, b)
+#define V_UNPACKHI_8(a, b)  _mm256_unpackhi_epi8 (a, b)
+#define V_UNPACKLO_16(a, b) _mm256_unpacklo_epi16 (a, b)
+#define V_UNPACKHI_16(a, b) _mm256_unpackhi_epi16 (a, b)
+#define V_PACKUS_16(a, b)   _mm256_packus_epi16 (a, b)
+#define V_PACKS_32(a, b)    _mm256_packs_epi32 (a, b)
+#define V_ADD_16(a, b)      _mm256_add_epi16 (a, b)
+#define V_SUB_16(a, b)      _mm256_sub_epi16 (a, b)
+#define V_MULLO_16(a, b)    _mm256_mullo_epi16 (a, b)
+#define V_MULHI_16(a, b)    _mm256_mulhi_epi16 (a, b)
+#define V_MULHI_U16(a, b)   _mm256_mulhi_epu16 (a, b)
+#define V_MADD_16(a, b)     _mm256_madd_epi16 (a, b)
+#define V_MAX_16(a, b)      _mm256_max_epi16 (a, b)
+#define V_MIN_16(a, b)      _mm256_min_epi16 (a, b)
+#define V_CMPGT_16(a, b)    _mm256_cmpgt_epi16 (a, b)
+#define V_SRLI_16(a, n)     _mm256_srli_epi16 (a, n)
+#define V_SLLI_16(a, n)     _mm256_slli_epi16 (a, n)
+#define V_SRAI_16(a, n)     _mm256_srai_epi16 (a, n)
+#define V_ADD_32(a, b)      _mm256_add_epi32 (a, b)
+#define V_SUB_32(a, b)      _mm256_sub_epi32 (a, b)
+#define V_SRLI_32(a, n)     _mm256_srli_epi32 (a, n)
+#define V_SRAI_32(a, n)     _mm256_srai_epi32 (a, n)
+#define V_SHUF_32(a, n)     _mm256_shuffle_epi32 (a, n)
+#define V_SHUFLO_16(a, n)   _mm256_shufflelo_epi16 (a, n)
+#define V_SHUFHI_16(a, n)   _mm256_shufflehi_epi16 (a, n)
+#define V_UNPACKLO_32(a, b) _mm256_unpacklo_epi32 (a, b)
+#define V_UNPACKHI_32(a, b) _mm256_unpackhi_epi32 (a, b)
+#define V_BSRLI_8(a)        _mm256_srli_si256 (a, 8)
+#define V_CMPEQ_32(a, b)    _mm256_cmpeq_epi32 (a, b)
+#define V_MOVEMASK_32(a)    _mm256_movemask_ps (_mm256_castsi256_ps (a))
+#define V_SET_LANES_32(l0, l1) \
+		_mm256_inserti128_si256 (_mm256_castsi128_si256 ( \
+			_mm_set1_epi32 (l0)), _mm_set1_epi32 (l1), 1)
+#define V_LOAD_QUADS(p0, p1, pitch) \
+		_mm256_inserti128_si256 (_mm256_castsi128_si256 ( \
+			Blend_AVX2_LoadQuad (p0, pitch)), \
+			Blend_AVX2_LoadQuad (p1, pitch), 1)
+#define VECF __m256
+#define VF_FROM_I32(a)      _mm256_cvtepi32_ps (a)
+#define VF_TO_I32(a)        _mm256_cvttps_epi32 (a)
+#define VF_DIV(a, b)        _mm256_div_ps (a, b)
+
+BLEND_FN static inline __m128i
+Blend_AVX2_LoadQuad (const Uint8 *p, int pitch)
+{
+	return _mm_unpacklo_epi64 (_mm_loadl_epi64 ((const __m128i *)p),
+			_mm_loadl_epi64 ((const __m128i *)(p + pitch)));
+}
+
+#include "rescalex86.h"
+#include "spherex86.h"
+#include "blendx86.h"
+
+#endif /* BLEND_AVX2 */
@@ -0,0 +1,90 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+// SSE2 blend span kernels
+
+#include "port.h"
+#include "libs/graphics/sdl/sdl_common.h"
+#include "primitives.h"
+#include "blendspan.h"
+
+#if defined(BLEND_SSE2)
+
+#include <emmintrin.h>
+
+#define BLEND_(name) Blend_SSE2_ ## name
+#define BLEND_FN
+#define VEC __m128i
+#define VEC_PIXELS 4
+
+#define V_ZERO()            _mm_setzero_si128 ()
+#define V_LOAD(p)           _mm_loadu_si128 ((const __m128i *)(p))
+#define V_STORE(p, v)       _mm_storeu_si128 ((__m128i *)(p), v)
+#define V_SET1_32(x)        _mm_set1_epi32 (x)
+#define V_SET1_16(x)        _mm_set1_epi16 ((short)(x))
+#define V_SET_PIXW(w0, w1, w2, w3) \
+		_mm_set_epi16 (w3, w2, w1, w0, w3, w2, w1, w0)
+#define V_AND(a, b)         _mm_and_si128 (a, b)
+#define V_OR(a, b)          _mm_or_si128 (a, b)
+#define V_XOR(a, b)         _mm_xor_si128 (a, b)
+#define V_ANDNOT(a, b)      _mm_andnot_si128 (a, b)
+#define V_ADDS_U8(a, b)     _mm_adds_epu8 (a, b)
+#define V_SUBS_U8(a, b)     _mm_subs_epu8 (a, b)
+#define V_UNPACKLO_8(a, b)  _mm_unpacklo_epi8 (a, b)
+#define V_UNPACKHI_8(a, b)  _mm_unpackhi_epi8 (a, b)
+#define V_UNPACKLO_16(a, b) _mm_unpacklo_epi16 (a, b)
+#define V_UNPACKHI_16(a, b) _mm_unpackhi_epi16 (a, b)
+#define V_PACKUS_16(a, b)   _mm_packus_epi16 (a, b)
+#define V_PACKS_32(a, b)    _mm_packs_epi32 (a, b)
+#define V_ADD_16(a, b)      _mm_add_epi16 (a, b)
+#define V_SUB_16(a, b)      _mm_sub_epi16 (a, b)
+#define V_MULLO_16(a, b)    _mm_mullo_epi16 (a, b)
+#define V_MULHI_16(a, b)    _mm_mulhi_epi16 (a, b)
+#define V_MULHI_U16(a, b)   _mm_mulhi_epu16 (a, b)
+#define V_MADD_16(a, b)     _mm_madd_epi16 (a, b)
+#define V_MAX_16(a, b)      _mm_max_epi16 (a, b)
+#define V_MIN_16(a, b)      _mm_min_epi16 (a, b)
+#define V_CMPGT_16(a, b)    _mm_cmpgt_epi16 (a, b)
+#define V_SRLI_16(a, n)     _mm_srli_epi16 (a, n)
+#define V_SLLI_16(a, n)     _mm_slli_epi16 (a, n)
+#define V_SRAI_16(a, n)     _mm_srai_epi16 (a, n)
+#define V_ADD_32(a, b)      _mm_add_epi32 (a, b)
+#define V_SUB_32(a, b)      _mm_sub_epi32 (a, b)
+#define V_SRLI_32(a, n)     _mm_srli_epi32 (a, n)
+#define V_SRAI_32(a, n)     _mm_srai_epi32 (a, n)
+#define V_SHUF_32(a, n)     _mm_shuffle_epi32 (a, n)
+#define V_SHUFLO_16(a, n)   _mm_shufflelo_epi16 (a, n)
+#define V_SHUFHI_16(a, n)   _mm_shufflehi_epi16 (a, n)
+#define V_UNPACKLO_32(a, b) _mm_unpacklo_epi32 (a, b)
+#define V_UNPACKHI_32(a, b) _mm_unpackhi_epi32 (a, b)
+#define V_BSRLI_8(a)        _mm_srli_si128 (a, 8)
+#define V_CMPEQ_32(a, b)    _mm_cmpeq_epi32 (a, b)
+#define V_MOVEMASK_32(a)    _mm_movemask_ps (_mm_castsi128_ps (a))
+#define V_SET_LANES_32(l0, l1) \
+		_mm_set1_epi32 (l0)
+#define V_LOAD_QUADS(p0, p1, pitch) \
+		_mm_unpacklo_epi64 (_mm_loadl_epi64 ((const __m128i *)(p0)), \
+			_mm_loadl_epi64 ((const __m128i *)((p0) + (pitch))))
+#define VECF __m128
+#define VF_FROM_I32(a)      _mm_cvtepi32_ps (a)
+#define VF_TO_I32(a)        _mm_cvttps_epi32 (a)
+#define VF_DIV(a, b)        _mm_div_ps (a, b)
+
+#include "rescalex86.h"
+#include "spherex86.h"
+#include "blendx86.h"
+
+#endif /* BLEND_SSE2 */
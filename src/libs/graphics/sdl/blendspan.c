@@ -0,0 +1,81 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+// Platform selection for the blend span kernels
+
+#include "port.h"
+#include "libs/graphics/sdl/sdl_common.h"
+#include "libs/log.h"
+#include "primitives.h"
+#include "blendspan.h"
+
+const Blend_Funcs_t Blend_C_Functions = { NULL };
+
+const Blend_Funcs_t *Blend_Funcs = &Blend_C_Functions;
+
+typedef struct
+{
+	PLATFORM_TYPE platform;
+	const Blend_Funcs_t *funcs;
+	const char *name;
+} Blend_PlatDef_t;
+
+// first supported entry wins
+// add better platform techs to the top
+static const Blend_PlatDef_t
+Blend_PlatDefs[] =
+{
+#ifdef BLEND_AVX2
+	{PLATFORM_AVX2,     &Blend_AVX2_Functions,  "AVX2"},
+#endif
+#ifdef BLEND_SSE2
+	{PLATFORM_SSE2,     &Blend_SSE2_Functions,  "SSE2"},
+#endif
+	// Default
+	{PLATFORM_C,        &Blend_C_Functions,     "plain C"}
+};
+
+static BOOLEAN
+Blend_HasPlatform (PLATFORM_TYPE platform)
+{
+	switch (platform)
+	{
+	case PLATFORM_SSE2:
+		return SDL_HasSSE2 () == SDL_TRUE;
+	case PLATFORM_AVX2:
+		return SDL_HasAVX2 () == SDL_TRUE;
+	case PLATFORM_C:
+		return TRUE;
+	default:
+		return FALSE;
+	}
+}
+
+void
+Blend_PrepPlatform (void)
+{
+	const Blend_PlatDef_t *pdef;
+
+	for (pdef = Blend_PlatDefs; pdef->platform != PLATFORM_C; ++pdef)
+	{
+		if ((!force_platform || force_platform == pdef->platform)
+				&& Blend_HasPlatform (pdef->platform))
+			break;
+	}
+
+	log_add (log_Info, "Blend spans are using %s code", pdef->name);
+	Blend_Funcs = pdef->funcs;
+}
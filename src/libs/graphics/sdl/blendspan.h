@@ -0,0 +1,137 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef LIBS_GRAPHICS_SDL_BLENDSPAN_H_
+#define LIBS_GRAPHICS_SDL_BLENDSPAN_H_
+
+#include "libs/platform.h"
+
+// Which vector kernels can be compiled in
+#if defined(USE_PLATFORM_ACCEL)
+#	if defined(__SSE2__) || defined(_M_X64) \
+			|| (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#		define BLEND_SSE2
+#	endif
+#	if defined(BLEND_SSE2) && (defined(__clang__) \
+			|| (defined(__GNUC__) && (__GNUC__ > 4 \
+			|| (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))) \
+			|| (defined(_MSC_VER) && _MSC_VER >= 1800))
+#		define BLEND_AVX2
+#	endif
+#endif /* USE_PLATFORM_ACCEL */
+
+// Vectorized span kernel for one DrawMode kind.
+// A kernel blends the longest leading part of the span that it can do
+// in whole vectors and returns the number of pixels it processed; the
+// plain C span code in primitives.c finishes the rest. Kernels only
+// handle a uniform factor and 32bpp formats with 8-bit byte-aligned
+// channels. They return 0 for anything else. The results must be
+// identical to the plain C code.
+typedef int (* Blend_SpanFunc) (Uint32 *dst, const Uint32 *src, int srcinc,
+		int factor, int count, const SDL_PixelFormat *fmt);
+
+// One run of a destination row of TFB_DrawCanvas_Rescale_Bilinear() or
+// _Trilinear(). All source pixels of the run, and the ones right and
+// below them, must be inside the image (and the mipmap). Index 0 is
+// the image, index 1 the mipmap.
+// The source formats must match the destination in the RGB channels,
+// which are 8 bits and byte-aligned, and any alpha channel must be in
+// the one remaining byte ('ashift').
+typedef struct
+{
+	Uint32 *dst;           // first destination pixel
+	int count;             // pixels in the run
+	const Uint8 *row[2];   // source row of the first pixel
+	int pitch[2];
+	int sx[2];             // 16.16 source x of the first pixel
+	int fsx[2];            // 16.16 source x increment
+	int v[2];              // fraction of the source y (0..255)
+	Uint32 mk[2];          // presence mask and key as in canvas.c
+	Uint32 ck[2];
+	Uint32 solid[2];       // alpha of present pixels without alpha
+	Uint32 rgbmask;        // destination RGB channels
+	int ashift;
+	int dst_has_alpha;
+	Uint32 transparent;
+	int ratio;             // image v. mipmap importance, 0..256
+} Blend_RescaleRow;
+
+// A rescale kernel does the longest leading part of the run that it
+// can do in whole vectors and returns the number of pixels it did.
+// The results must be identical to the plain C code in canvas.c.
+typedef int (* Blend_RescaleFunc) (const Blend_RescaleRow *row);
+
+// One row of the orbit planet sphere as RenderPlanetSphereRows() in
+// uqm/planets/plangen.c draws it without a shield. Every pixel blends
+// the topo pixels (x0,y0), (x1,y0), (x0,y1) and (x1,y1) with the
+// 16-bit weights m[], which sum to within a few units of 65536
+// (m[0] == 0 is the exact pixel at (x0,y0)), and lights the result with
+// the diffuse light and the elevation at (x0,y0) times the weight sum.
+// Pixels are 4 bytes of 8-bit channels; 'alpha' is the pixel with only
+// the alpha byte set.
+typedef struct
+{
+	Uint32 *dst;           // first destination pixel
+	int count;             // pixels in the row
+	const Uint32 *pixels;  // topo pixels, 'pitch' per row
+	int pitch;
+	const Sint8 *elevs;    // elevations, 'width' per row
+	int width;
+	int offset;            // elevation x of topo x 0
+	const Uint16 *x0, *y0; // of the first destination pixel
+	const Uint16 *x1, *y1;
+	const Uint16 (*m)[4];
+	const Uint32 *light;   // 16.16 diffuse light, 0 is a clear pixel
+	Uint32 alpha;
+} Blend_SphereRow;
+
+// A sphere kernel does the longest leading part of the row that it
+// can do in whole vectors and returns the number of pixels it did.
+// The results must be identical to the plain C code in plangen.c.
+typedef int (* Blend_SphereFunc) (const Blend_SphereRow *row);
+
+typedef struct
+{
+	Blend_SpanFunc additive;
+	Blend_SpanFunc alpha;
+	Blend_SpanFunc multiply;
+	Blend_SpanFunc overlay;
+	Blend_SpanFunc screen;
+	Blend_SpanFunc grayscale;
+	Blend_SpanFunc linearburn;
+	Blend_SpanFunc hypertoquasi;
+	Blend_SpanFunc desaturate;
+	Blend_RescaleFunc rescale_bilinear;
+	Blend_RescaleFunc rescale_trilinear;
+	Blend_SphereFunc sphere_light;
+} Blend_Funcs_t;
+
+// Currently selected kernels
+extern const Blend_Funcs_t *Blend_Funcs;
+
+void Blend_PrepPlatform (void);
+
+// Plain C: no kernels at all
+extern const Blend_Funcs_t Blend_C_Functions;
+
+#ifdef BLEND_SSE2
+extern const Blend_Funcs_t Blend_SSE2_Functions;
+#endif
+#ifdef BLEND_AVX2
+extern const Blend_Funcs_t Blend_AVX2_Functions;
+#endif
+
+#endif /* LIBS_GRAPHICS_SDL_BLENDSPAN_H_ */
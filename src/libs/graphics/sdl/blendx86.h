@@ -0,0 +1,400 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+// x86 blend span kernels
+//  Template
+//    #included by blend_sse2.c and blend_avx2.c, which define the
+//    vector type, the V_xxx operations, VEC_PIXELS, BLEND_FN and
+//    the BLEND_(name) naming macro.
+//
+//  Channels are processed as 16-bit words: every vector of pixels is
+//  unpacked into a low and a high half, blended and packed back.
+//  All the x86 pack/unpack operations work within 128-bit lanes, so
+//  the words of one pixel always stay together.
+
+#ifndef BLEND_
+#	error "blendx86.h is a template and must be #included"
+#endif
+
+// Checks the format for 8-bit channels at byte boundaries
+BLEND_FN static inline int
+BLEND_(FormatOk) (const SDL_PixelFormat *fmt)
+{
+	return fmt->BytesPerPixel == 4
+			&& (fmt->Rshift & 7) == 0 && fmt->Rmask == (0xffu << fmt->Rshift)
+			&& (fmt->Gshift & 7) == 0 && fmt->Gmask == (0xffu << fmt->Gshift)
+			&& (fmt->Bshift & 7) == 0 && fmt->Bmask == (0xffu << fmt->Bshift);
+}
+
+// RGB channel bytes of every pixel
+#define BLEND_RGBMASK(fmt) \
+		V_SET1_32 ((int)((fmt)->Rmask | (fmt)->Gmask | (fmt)->Bmask))
+
+// Per-pixel word weights for V_MADD_16 of an unpacked half
+#define BLEND_WEIGHTS(fmt, wr, wg, wb) \
+		V_SET_PIXW ( \
+			BLEND_(ByteWeight) (fmt, 0, wr, wg, wb), \
+			BLEND_(ByteWeight) (fmt, 1, wr, wg, wb), \
+			BLEND_(ByteWeight) (fmt, 2, wr, wg, wb), \
+			BLEND_(ByteWeight) (fmt, 3, wr, wg, wb))
+
+BLEND_FN static inline short
+BLEND_(ByteWeight) (const SDL_PixelFormat *fmt, int byte, int wr, int wg,
+		int wb)
+{
+	if (fmt->Rshift == byte * 8)
+		return (short)wr;
+	else if (fmt->Gshift == byte * 8)
+		return (short)wg;
+	else if (fmt->Bshift == byte * 8)
+		return (short)wb;
+	return 0;
+}
+
+// Weighted channel sum of every pixel of an unpacked half, broadcast
+// to all 4 words of that pixel; 'shift' is applied to the 32-bit sum
+#define BLEND_PIXSUM(x, w, shift) \
+		BLEND_(Broadcast) (V_SRLI_32 (BLEND_(PairSum) (V_MADD_16 (x, w)), \
+			shift))
+
+BLEND_FN static inline VEC
+BLEND_(PairSum) (VEC m)
+{
+	return V_ADD_32 (m, V_SHUF_32 (m, 0xb1 /* 2,3,0,1 */));
+}
+
+BLEND_FN static inline VEC
+BLEND_(Broadcast) (VEC s)
+{	// dwords hold values < 0x10000
+	s = V_SHUFLO_16 (s, 0xa0 /* 2,2,0,0 */);
+	return V_SHUFHI_16 (s, 0xa0 /* 2,2,0,0 */);
+}
+
+// alpha_blend() of words; 'a' is the factor, 'na' is 256 - factor.
+// (sc * a + dc * (256 - a)) >> 8 is equal to the scalar
+// (((sc - dc) * a) >> 8) + dc, but never leaves unsigned 16 bits.
+// A factor of 255 must be passed as a=256 to return 'sc' unchanged.
+BLEND_FN static inline VEC
+BLEND_(Mix16) (VEC d, VEC s, VEC a, VEC na)
+{
+	return V_SRLI_16 (V_ADD_16 (V_MULLO_16 (s, a), V_MULLO_16 (d, na)), 8);
+}
+
+// overlay_blend() of words
+BLEND_FN static inline VEC
+BLEND_(Overlay16) (VEC d, VEC s)
+{
+	const VEC c128 = V_SET1_16 (128);
+	const VEC c255 = V_SET1_16 (255);
+	VEC ds = V_SRLI_16 (V_MULLO_16 (d, s), 7);
+	VEC hi = V_SUB_16 (V_SUB_16 (V_SLLI_16 (V_ADD_16 (d, s), 1), c255),
+			ds);
+	VEC m = V_CMPGT_16 (c128, d);
+
+	hi = V_MIN_16 (V_MAX_16 (hi, V_ZERO ()), c255);
+	return V_OR (V_AND (m, ds), V_ANDNOT (m, hi));
+}
+
+// Maps the 255 alpha factor to 256, see Mix16()
+static inline int
+BLEND_(MixFactor) (int factor)
+{
+	return factor == 255 ? 256 : factor;
+}
+
+#define BLEND_LOOP_BEGIN \
+	int i; \
+	const VEC solid = V_SET1_32 ((int)*src); \
+	for (i = 0; i + VEC_PIXELS <= count; i += VEC_PIXELS) \
+	{ \
+		const VEC d = V_LOAD (dst + i); \
+		const VEC s = srcinc ? V_LOAD (src + i) : solid; \
+		VEC r; \
+		(void) s;
+
+#define BLEND_LOOP_END \
+		V_STORE (dst + i, V_AND (r, rgbmask)); \
+	} \
+	return i;
+
+
+BLEND_FN static int
+BLEND_(Additive) (Uint32 *dst, const Uint32 *src, int srcinc, int factor,
+		int count, const SDL_PixelFormat *fmt)
+{
+	const VEC rgbmask = BLEND_RGBMASK (fmt);
+	const VEC f = V_SET1_16 (factor < 0 ? -factor : factor);
+	// rounds the negative modulation towards -inf like '>>' does
+	const VEC round = V_SET1_16 (factor < 0 ? 255 : 0);
+
+	if (factor < -255 || factor > 255 || !BLEND_(FormatOk) (fmt))
+		return 0;
+
+	{
+		BLEND_LOOP_BEGIN
+		if (factor == 255)
+		{
+			r = V_ADDS_U8 (d, s);
+		}
+		else
+		{
+			VEC lo = V_UNPACKLO_8 (s, V_ZERO ());
+			VEC hi = V_UNPACKHI_8 (s, V_ZERO ());
+			VEC t;
+			lo = V_SRLI_16 (V_ADD_16 (V_MULLO_16 (lo, f), round), 8);
+			hi = V_SRLI_16 (V_ADD_16 (V_MULLO_16 (hi, f), round), 8);
+			t = V_PACKUS_16 (lo, hi);
+			r = factor < 0 ? V_SUBS_U8 (d, t) : V_ADDS_U8 (d, t);
+		}
+		BLEND_LOOP_END
+	}
+}
+
+BLEND_FN static int
+BLEND_(Alpha) (Uint32 *dst, const Uint32 *src, int srcinc, int factor,
+		int count, const SDL_PixelFormat *fmt)
+{
+	const VEC rgbmask = BLEND_RGBMASK (fmt);
+	const VEC a = V_SET1_16 (factor);
+	const VEC na = V_SET1_16 (256 - factor);
+
+	// 255 is a straight copy, which the plain C code does best
+	if (factor < 0 || factor >= 255 || !BLEND_(FormatOk) (fmt))
+		return 0;
+
+	{
+		BLEND_LOOP_BEGIN
+		r = V_PACKUS_16 (
+				BLEND_(Mix16) (V_UNPACKLO_8 (d, V_ZERO ()),
+					V_UNPACKLO_8 (s, V_ZERO ()), a, na),
+				BLEND_(Mix16) (V_UNPACKHI_8 (d, V_ZERO ()),
+					V_UNPACKHI_8 (s, V_ZERO ()), a, na));
+		BLEND_LOOP_END
+	}
+}
+
+BLEND_FN static int
+BLEND_(Multiply) (Uint32 *dst, const Uint32 *src, int srcinc, int factor,
+		int count, const SDL_PixelFormat *fmt)
+{
+	const VEC rgbmask = BLEND_RGBMASK (fmt);
+
+	(void) factor; // Doesn't support alpha
+
+	if (!BLEND_(FormatOk) (fmt))
+		return 0;
+
+	{
+		BLEND_LOOP_BEGIN
+		r = V_PACKUS_16 (
+				V_SRLI_16 (V_MULLO_16 (V_UNPACKLO_8 (d, V_ZERO ()),
+					V_UNPACKLO_8 (s, V_ZERO ())), 8),
+				V_SRLI_16 (V_MULLO_16 (V_UNPACKHI_8 (d, V_ZERO ()),
+					V_UNPACKHI_8 (s, V_ZERO ())), 8));
+		BLEND_LOOP_END
+	}
+}
+
+BLEND_FN static int
+BLEND_(Overlay) (Uint32 *dst, const Uint32 *src, int srcinc, int factor,
+		int count, const SDL_PixelFormat *fmt)
+{
+	const VEC rgbmask = BLEND_RGBMASK (fmt);
+	const VEC a = V_SET1_16 (BLEND_(MixFactor) (factor));
+	const VEC na = V_SET1_16 (256 - BLEND_(MixFactor) (factor));
+
+	if (factor < 0 || factor > 255 || !BLEND_(FormatOk) (fmt))
+		return 0;
+
+	{
+		BLEND_LOOP_BEGIN
+		VEC dlo = V_UNPACKLO_8 (d, V_ZERO ());
+		VEC dhi = V_UNPACKHI_8 (d, V_ZERO ());
+		r = V_PACKUS_16 (
+				BLEND_(Mix16) (dlo, BLEND_(Overlay16) (dlo,
+					V_UNPACKLO_8 (s, V_ZERO ())), a, na),
+				BLEND_(Mix16) (dhi, BLEND_(Overlay16) (dhi,
+					V_UNPACKHI_8 (s, V_ZERO ())), a, na));
+		BLEND_LOOP_END
+	}
+}
+
+BLEND_FN static int
+BLEND_(Screen) (Uint32 *dst, const Uint32 *src, int srcinc, int factor,
+		int count, const SDL_PixelFormat *fmt)
+{
+	const VEC rgbmask = BLEND_RGBMASK (fmt);
+	const VEC ones = V_SET1_32 (-1);
+
+	(void) factor; // Doesn't support alpha
+
+	if (!BLEND_(FormatOk) (fmt))
+		return 0;
+
+	{
+		BLEND_LOOP_BEGIN
+		// 255 - x is ~x for bytes
+		VEC nd = V_XOR (d, ones);
+		VEC ns = V_XOR (s, ones);
+		r = V_XOR (ones, V_PACKUS_16 (
+				V_SRLI_16 (V_MULLO_16 (V_UNPACKLO_8 (nd, V_ZERO ()),
+					V_UNPACKLO_8 (ns, V_ZERO ())), 8),
+				V_SRLI_16 (V_MULLO_16 (V_UNPACKHI_8 (nd, V_ZERO ()),
+					V_UNPACKHI_8 (ns, V_ZERO ())), 8)));
+		BLEND_LOOP_END
+	}
+}
+
+BLEND_FN static int
+BLEND_(Grayscale) (Uint32 *dst, const Uint32 *src, int srcinc, int factor,
+		int count, const SDL_PixelFormat *fmt)
+{
+	const VEC rgbmask = BLEND_RGBMASK (fmt);
+	const VEC w = BLEND_WEIGHTS (fmt, 341, 341, 341);
+	// the scalar code passes factor as an 8-bit channel
+	const VEC sc = V_SET1_16 (factor & 0xff);
+
+	if (!BLEND_(FormatOk) (fmt))
+		return 0;
+
+	{
+		BLEND_LOOP_BEGIN
+		VEC lo = BLEND_PIXSUM (V_UNPACKLO_8 (d, V_ZERO ()), w, 10);
+		VEC hi = BLEND_PIXSUM (V_UNPACKHI_8 (d, V_ZERO ()), w, 10);
+		r = V_PACKUS_16 (BLEND_(Overlay16) (lo, sc),
+				BLEND_(Overlay16) (hi, sc));
+		BLEND_LOOP_END
+	}
+}
+
+BLEND_FN static int
+BLEND_(LinearBurn) (Uint32 *dst, const Uint32 *src, int srcinc, int factor,
+		int count, const SDL_PixelFormat *fmt)
+{
+	const VEC rgbmask = BLEND_RGBMASK (fmt);
+	const VEC a = V_SET1_16 (BLEND_(MixFactor) (factor));
+	const VEC na = V_SET1_16 (256 - BLEND_(MixFactor) (factor));
+	const VEC ones = V_SET1_32 (-1);
+
+	if (factor < 0 || factor > 255 || !BLEND_(FormatOk) (fmt))
+		return 0;
+
+	{
+		BLEND_LOOP_BEGIN
+		// max (dc + sc - 255, 0) is dc - (255 - sc) with saturation
+		VEC b = V_SUBS_U8 (d, V_XOR (s, ones));
+		r = V_PACKUS_16 (
+				BLEND_(Mix16) (V_UNPACKLO_8 (d, V_ZERO ()),
+					V_UNPACKLO_8 (b, V_ZERO ()), a, na),
+				BLEND_(Mix16) (V_UNPACKHI_8 (d, V_ZERO ()),
+					V_UNPACKHI_8 (b, V_ZERO ()), a, na));
+		BLEND_LOOP_END
+	}
+}
+
+BLEND_FN static int
+BLEND_(HyperToQuasi) (Uint32 *dst, const Uint32 *src, int srcinc,
+		int factor, int count, const SDL_PixelFormat *fmt)
+{
+	const VEC rgbmask = BLEND_RGBMASK (fmt);
+	const VEC w = BLEND_WEIGHTS (fmt, 341, 341, 341);
+	const VEC gonly = BLEND_WEIGHTS (fmt, 0, -1, 0);
+	const VEC c255 = V_SET1_32 (255);
+	const VEC c78 = V_SET1_32 (0x78);
+	const VEC a = V_SET1_16 (BLEND_(MixFactor) (factor));
+	const VEC na = V_SET1_16 (256 - BLEND_(MixFactor) (factor));
+
+	if (factor < 0 || factor > 255 || !BLEND_(FormatOk) (fmt))
+		return 0;
+
+	{
+		BLEND_LOOP_BEGIN
+		VEC lo = V_MADD_16 (V_UNPACKLO_8 (s, V_ZERO ()), w);
+		VEC hi = V_MADD_16 (V_UNPACKHI_8 (s, V_ZERO ()), w);
+		// ((255 - ((r + g + b) * 341 >> 10)) * 0x78) >> 8 as the G channel,
+		// R and B blend towards 0
+		lo = V_SUB_32 (c255, V_SRLI_32 (BLEND_(PairSum) (lo), 10));
+		hi = V_SUB_32 (c255, V_SRLI_32 (BLEND_(PairSum) (hi), 10));
+		lo = V_AND (BLEND_(Broadcast) (
+				V_SRLI_32 (V_MULLO_16 (lo, c78), 8)), gonly);
+		hi = V_AND (BLEND_(Broadcast) (
+				V_SRLI_32 (V_MULLO_16 (hi, c78), 8)), gonly);
+		r = V_PACKUS_16 (
+				BLEND_(Mix16) (V_UNPACKLO_8 (d, V_ZERO ()), lo, a, na),
+				BLEND_(Mix16) (V_UNPACKHI_8 (d, V_ZERO ()), hi, a, na));
+		BLEND_LOOP_END
+	}
+}
+
+BLEND_FN static int
+BLEND_(Desaturate) (Uint32 *dst, const Uint32 *src, int srcinc, int factor,
+		int count, const SDL_PixelFormat *fmt)
+{
+	const VEC rgbmask = BLEND_RGBMASK (fmt);
+	// ((3 * r + 6 * g + b) * 205) >> 11
+	const VEC w = BLEND_WEIGHTS (fmt, 3 * 205, 6 * 205, 205);
+	const VEC f = V_SET1_16 (factor);
+
+	if (factor < 0 || factor > 255 || !BLEND_(FormatOk) (fmt))
+		return 0;
+
+	{
+		BLEND_LOOP_BEGIN
+		VEC half[2];
+		int h;
+
+		half[0] = V_UNPACKLO_8 (d, V_ZERO ());
+		half[1] = V_UNPACKHI_8 (d, V_ZERO ());
+		for (h = 0; h < 2; ++h)
+		{
+			VEC c = half[h];
+			VEC diff = V_SUB_16 (BLEND_PIXSUM (c, w, 11), c);
+			// factor * (luma - c) needs 32 bits
+			VEC pl = V_MULLO_16 (diff, f);
+			VEC ph = V_MULHI_16 (diff, f);
+			VEC p = V_PACKS_32 (
+					V_SRAI_32 (V_UNPACKLO_16 (pl, ph), 8),
+					V_SRAI_32 (V_UNPACKHI_16 (pl, ph), 8));
+			half[h] = V_ADD_16 (c, p);
+		}
+		r = V_PACKUS_16 (half[0], half[1]);
+		BLEND_LOOP_END
+	}
+}
+
+#undef BLEND_LOOP_BEGIN
+#undef BLEND_LOOP_END
+#undef BLEND_PIXSUM
+#undef BLEND_WEIGHTS
+#undef BLEND_RGBMASK
+
+
+const Blend_Funcs_t
+BLEND_(Functions) =
+{
+	BLEND_(Additive),
+	BLEND_(Alpha),
+	BLEND_(Multiply),
+	BLEND_(Overlay),
+	BLEND_(Screen),
+	BLEND_(Grayscale),
+	BLEND_(LinearBurn),
+	BLEND_(HyperToQuasi),
+	BLEND_(Desaturate),
+	BLEND_(RescaleBilinear),
+	BLEND_(RescaleTrilinear),
+	BLEND_(SphereLight),
+};
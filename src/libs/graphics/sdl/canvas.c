@@ -25,7 +25,9 @@
 #include "libs/graphics/cmap.h"
 #include "libs/log.h"
 #include "libs/memlib.h"
+#include "libs/threadlib.h"
 #include "primitives.h"
+#include "blendspan.h"
 #include "palette.h"
 #include "sdluio.h"
 #include "rotozoom.h"
@@ -45,6 +47,8 @@ TFB_DrawCanvas_Initialize (void)
 		for (j = 0; j < 256; ++j)
 			btable[j][i] = (j * i + 0x80) >> 8;
 				// need error correction here
+
+	Blend_PrepPlatform ();
 }
 
 const char *
@@ -81,27 +85,34 @@ TFB_DrawCanvas_Line (int x1, int y1, int x2, int y2, Color color,
 	SDL_Surface *dst = target;
 	SDL_PixelFormat *fmt = dst->format;
 	Uint32 sdlColor;
-	RenderPixelFn plotFn;
 
 	checkPrimitiveMode (dst, &color, &mode);
 	sdlColor = SDL_MapRGBA (fmt, color.r, color.g, color.b, color.a);
 
-	plotFn = renderpixel_for (target, mode.kind, FALSE);
-	if (!plotFn)
-	{
-		log_add (log_Warning, "ERROR: TFB_DrawCanvas_Line "
-				"unsupported draw mode (%d)", (int)mode.kind);
-		return;
-	}
-
 	if (thickness < 2)
 	{// Ususal SD line
+		RenderPixelFn plotFn = renderpixel_for (target, mode.kind, FALSE);
+		if (!plotFn)
+		{
+			log_add (log_Warning, "ERROR: TFB_DrawCanvas_Line "
+					"unsupported draw mode (%d)", (int)mode.kind);
+			return;
+		}
+
 		SDL_LockSurface (dst);
 		line_prim (x1, y1, x2, y2, sdlColor, plotFn, mode.factor, dst);
 		SDL_UnlockSurface (dst);
 	}
 	else
 	{// Lines for HD with Anti-aliasing (WIP)
+		RenderSpanFn spanFn = renderspan_for (target, mode.kind, FALSE);
+		if (!spanFn)
+		{
+			log_add (log_Warning, "ERROR: TFB_DrawCanvas_Line "
+					"unsupported draw mode (%d)", (int)mode.kind);
+			return;
+		}
+
 		if (x1 == x2 || y1 == y2)
 		{// Vertical/horizontal
 			SDL_Rect sr;
@@ -110,13 +121,13 @@ TFB_DrawCanvas_Line (int x1, int y1, int x2, int y2, Color color,
 			sr.w = abs (x1 - x2) + thickness;
 			sr.h = abs (y1 - y2) + thickness;
 			SDL_LockSurface (dst);
-			fillrect_prim (sr, sdlColor, plotFn, mode.factor, dst);
+			fillrect_prim (sr, sdlColor, spanFn, mode.factor, dst);
 			SDL_UnlockSurface (dst);
 		}
 		else
 		{
 			SDL_LockSurface (dst);
-			line_aa_prim (x1, y1, x2, y2, sdlColor, plotFn, mode.factor, dst, thickness);
+			line_aa_prim (x1, y1, x2, y2, sdlColor, spanFn, mode.factor, dst, thickness);
 			SDL_UnlockSurface (dst);
 		}
 	}
@@ -150,8 +161,8 @@ TFB_DrawCanvas_Rect (RECT *rect, Color color, DrawMode mode, TFB_Canvas target)
 	}
 	else
 	{	// Custom fillrect rendering
-		RenderPixelFn plotFn = renderpixel_for (target, mode.kind, FALSE);
-		if (!plotFn)
+		RenderSpanFn spanFn = renderspan_for (target, mode.kind, FALSE);
+		if (!spanFn)
 		{
 			log_add (log_Warning, "ERROR: TFB_DrawCanvas_Rect "
 					"unsupported draw mode (%d)", (int)mode.kind);
@@ -159,7 +170,7 @@ TFB_DrawCanvas_Rect (RECT *rect, Color color, DrawMode mode, TFB_Canvas target)
 		}
 
 		SDL_LockSurface (dst);
-		fillrect_prim (sr, sdlColor, plotFn, mode.factor, dst);
+		fillrect_prim (sr, sdlColor, spanFn, mode.factor, dst);
 		SDL_UnlockSurface (dst);
 	}
 }
@@ -188,8 +199,8 @@ TFB_DrawCanvas_Blit (SDL_Surface *src, SDL_Rect *src_r,
 	else
 	{	// Custom blit
 		SDL_Rect loc_src_r, loc_dst_r;
-		RenderPixelFn plotFn = renderpixel_for (dst, mode.kind, FALSE);
-		if (!plotFn)
+		RenderSpanFn spanFn = renderspan_for (dst, mode.kind, FALSE);
+		if (!spanFn)
 		{
 			log_add (log_Warning, "ERROR: TFB_DrawCanvas_Blit "
 					"unsupported draw mode (%d)", (int)mode.kind);
@@ -214,7 +225,7 @@ TFB_DrawCanvas_Blit (SDL_Surface *src, SDL_Rect *src_r,
 			dst_r = &loc_dst_r;
 		}
 		SDL_LockSurface (dst);
-		blt_prim (src, *src_r, plotFn, mode.factor, dst, *dst_r);
+		blt_prim (src, *src_r, spanFn, mode.factor, dst, *dst_r);
 		SDL_UnlockSurface (dst);
 	}
 }
@@ -257,6 +268,10 @@ TFB_DrawCanvas_Image (TFB_Image *img, int x, int y, int scale,
 			scaleMode = TFB_SCALE_BILINEAR;
 		}
 
+		if (cmap)
+		{	// Scaled variants are cached per palette
+			img->colormap_version = cmap->version;
+		}
 		TFB_DrawImage_FixScaling (img, scale, scaleMode);
 		surf = img->ScaledImg;
 		if (TFB_DrawCanvas_IsPaletted (surf))
@@ -711,9 +726,9 @@ TFB_DrawCanvas_FillMask (SDL_Surface *base, DrawMode mode, Color *fill)
 	}
 	else
 	{// Applying blit
-		RenderPixelFn plotFn = renderpixel_for (base, mode.kind, TRUE);
+		RenderSpanFn spanFn = renderspan_for (base, mode.kind, TRUE);
 		
-		if (!plotFn)
+		if (!spanFn)
 		{
 			log_add (log_Warning, "ERROR: TFB_DrawCanvas_Mask "
 					"unsupported draw mode (%d)", (int)mode.kind);
@@ -724,7 +739,7 @@ TFB_DrawCanvas_FillMask (SDL_Surface *base, DrawMode mode, Color *fill)
 			mode.factor = 0xFF;
 
 		SDL_LockSurface (base);
-		blt_filtered_fill (base, plotFn, mode.factor, fill);
+		blt_filtered_fill (base, spanFn, mode.factor, fill);
 		SDL_UnlockSurface (base);
 	}
 }
@@ -740,8 +755,8 @@ TFB_DrawCanvas_Mask (SDL_Surface *layer, SDL_Surface *base, DrawMode mode, Color
 	}
 	else
 	{// Applying blit
-		RenderPixelFn plotFn = renderpixel_for (base, mode.kind, TRUE);
-		if (!plotFn)
+		RenderSpanFn spanFn = renderspan_for (base, mode.kind, TRUE);
+		if (!spanFn)
 		{
 			log_add (log_Warning, "ERROR: TFB_DrawCanvas_Mask "
 					"unsupported draw mode (%d)", (int)mode.kind);
@@ -767,7 +782,7 @@ TFB_DrawCanvas_Mask (SDL_Surface *layer, SDL_Surface *base, DrawMode mode, Color
 		else
 		{
 			SDL_LockSurface (base);
-			blt_filtered_prim (layer, plotFn, mode.factor, base, fill);
+			blt_filtered_prim (layer, spanFn, mode.factor, base, fill);
 			SDL_UnlockSurface (base);
 		}
 	}
@@ -1467,6 +1482,368 @@ scale_get_pixel (SDL_Surface *src, Uint32 mask, Uint32 key, int x, int y)
 			x * src->format->BytesPerPixel, src->format, pal, mask, key);
 }
 
+// Destination pixels per band of rows; smaller images are not worth
+// waking up the worker pool for
+#define RESCALE_BAND_PIXELS 16384
+
+// Everything the bilinear and trilinear row loops need; index 0 is the
+// image and index 1 the mipmap
+typedef struct
+{
+	SDL_Surface *src[2];
+	SDL_Surface *dst;
+	SDL_Color *srcpal;
+	// source masks and keys
+	Uint32 mk[2], ck[2];
+	// source fractional x and y starting points
+	int ssx[2], ssy[2];
+	// source fractional dx and dy increments
+	int fsx[2], fsy[2];
+	int w;
+	// src v. mipmap importance factor
+	int ratio;
+	Uint32 transparent;
+	// vector kernel for the inside columns [kx_begin, kx_end), or NULL
+	Blend_RescaleFunc kernel;
+	int kx_begin;
+	int kx_end;
+	Blend_RescaleRow krow;
+} rescale_job_t;
+
+// Sets up the vector kernel of the job when the formats allow it, see
+// Blend_RescaleRow. Paletted sources always take the plain C path.
+static void
+rescale_prep_kernel (rescale_job_t *job, Blend_RescaleFunc kernel,
+		int images)
+{
+	SDL_PixelFormat *dstfmt = job->dst->format;
+	Blend_RescaleRow *krow = &job->krow;
+	Uint32 amask;
+	int ashift;
+	int i, x;
+
+	job->kernel = NULL;
+	if (!kernel || job->srcpal || job->w <= 0)
+		return;
+
+	if (dstfmt->BytesPerPixel != 4
+			|| (dstfmt->Rshift & 7) || dstfmt->Rmask != (0xffu << dstfmt->Rshift)
+			|| (dstfmt->Gshift & 7) || dstfmt->Gmask != (0xffu << dstfmt->Gshift)
+			|| (dstfmt->Bshift & 7) || dstfmt->Bmask != (0xffu << dstfmt->Bshift))
+		return;
+	// alpha (or nothing) lives in the one byte left over
+	ashift = 48 - dstfmt->Rshift - dstfmt->Gshift - dstfmt->Bshift;
+	if (ashift < 0 || ashift > 24 || (ashift & 7))
+		return;
+	amask = 0xffu << ashift;
+	if ((dstfmt->Rmask | dstfmt->Gmask | dstfmt->Bmask | amask) != 0xffffffff
+			|| (dstfmt->Amask && dstfmt->Amask != amask))
+		return;
+
+	for (i = 0; i < images; ++i)
+	{
+		SDL_PixelFormat *fmt = job->src[i]->format;
+
+		if (fmt->BytesPerPixel != 4 || fmt->Rmask != dstfmt->Rmask
+				|| fmt->Gmask != dstfmt->Gmask || fmt->Bmask != dstfmt->Bmask
+				|| (fmt->Amask && fmt->Amask != amask))
+			return;
+
+		krow->pitch[i] = job->src[i]->pitch;
+		krow->fsx[i] = job->fsx[i];
+		krow->mk[i] = job->mk[i];
+		krow->ck[i] = job->ck[i];
+		krow->solid[i] = fmt->Amask ? 0 : amask;
+	}
+
+	// Find the columns with all source pixels inside the images;
+	// the source x only ever grows, so they are one run
+	job->kx_begin = job->w;
+	job->kx_end = job->w;
+	for (x = 0; x < job->w; ++x)
+	{
+		BOOLEAN inside = TRUE;
+
+		for (i = 0; i < images; ++i)
+		{
+			const int px = (job->ssx[i] + x * job->fsx[i]) >> 16;
+			if (px < 0 || px + 1 >= job->src[i]->w)
+				inside = FALSE;
+		}
+
+		if (inside && job->kx_begin == job->w)
+			job->kx_begin = x;
+		else if (!inside && job->kx_begin != job->w)
+		{
+			job->kx_end = x;
+			break;
+		}
+	}
+	if (job->kx_begin == job->kx_end)
+		return;
+
+	krow->count = job->kx_end - job->kx_begin;
+	krow->rgbmask = dstfmt->Rmask | dstfmt->Gmask | dstfmt->Bmask;
+	krow->ashift = ashift;
+	krow->dst_has_alpha = (dstfmt->Amask != 0);
+	krow->transparent = job->transparent;
+	krow->ratio = job->ratio;
+	job->kernel = kernel;
+}
+
+static int
+rescale_band_rows (int w, int h)
+{
+	if (w <= 0)
+		return h;
+	return (RESCALE_BAND_PIXELS + w - 1) / w;
+}
+
+// Rows [begin, end) of TFB_DrawCanvas_Rescale_Trilinear()
+static void
+rescale_trilinear_rows (void *data, int begin, int end)
+{
+	const rescale_job_t *job = data;
+	SDL_Surface *src = job->src[0];
+	SDL_Surface *mm = job->src[1];
+	SDL_Surface *dst = job->dst;
+	SDL_PixelFormat *srcfmt = src->format;
+	SDL_PixelFormat *mmfmt = mm->format;
+	SDL_PixelFormat *dstfmt = dst->format;
+	SDL_Color *srcpal = job->srcpal;
+	const int sbpp = srcfmt->BytesPerPixel;
+	const int mmbpp = mmfmt->BytesPerPixel;
+	const int slen = src->pitch;
+	const int mmlen = mm->pitch;
+	const int dst_has_alpha = (dstfmt->Amask != 0);
+	const Uint32 transparent = job->transparent;
+	const int alpha_threshold = dst_has_alpha ? 0 : 127;
+	const int ratio = job->ratio;
+	const Uint32 mk0 = job->mk[0], ck0 = job->ck[0];
+	const Uint32 mk1 = job->mk[1], ck1 = job->ck[1];
+	const int fsx0 = job->fsx[0], fsy0 = job->fsy[0];
+	const int fsx1 = job->fsx[1], fsy1 = job->fsy[1];
+	const int ssx0 = job->ssx[0], ssx1 = job->ssx[1];
+	const int w = job->w;
+	Blend_RescaleRow krow = job->krow;
+	// source fractional x and y positions
+	int sx0, sy0, sx1, sy1;
+	int x, y;
+
+	for (y = begin, sy0 = job->ssy[0] + begin * fsy0,
+				sy1 = job->ssy[1] + begin * fsy1;
+			y < end;
+			++y, sy0 += fsy0, sy1 += fsy1)
+	{
+		Uint32 *dst_p = (Uint32 *) ((Uint8*)dst->pixels + y * dst->pitch);
+		const int py0 = (sy0 >> 16);
+		const int py1 = (sy1 >> 16);
+		Uint8 *src_a0 = (Uint8*)src->pixels + py0 * slen;
+		Uint8 *src_a1 = (Uint8*)mm->pixels + py1 * mmlen;
+		// retrieve the fractional portions of y
+		const Uint8 v0 = (sy0 >> 8) & 0xff;
+		const Uint8 v1 = (sy1 >> 8) & 0xff;
+		Uint8 w0[4], w1[4]; // pixel weight vectors
+		int xend = w;
+
+		if (job->kernel && py0 >= 0 && py0 + 1 < src->h
+				&& py1 >= 0 && py1 + 1 < mm->h)
+		{	// the vector kernel can do the inside columns
+			xend = job->kx_begin;
+			krow.row[0] = src_a0;
+			krow.row[1] = src_a1;
+			krow.v[0] = v0;
+			krow.v[1] = v1;
+		}
+
+		x = 0;
+		sx0 = ssx0;
+		sx1 = ssx1;
+		for (;;)
+		{
+			for (; x < xend; ++x, ++dst_p, sx0 += fsx0, sx1 += fsx1)
+			{
+				const int px0 = (sx0 >> 16);
+				const int px1 = (sx1 >> 16);
+				// retrieve the fractional portions of x
+				const Uint8 u0 = (sx0 >> 8) & 0xff;
+				const Uint8 u1 = (sx1 >> 8) & 0xff;
+				// pixels are examined and numbered in pattern
+				//  0  1
+				//  2  3
+				// the ideal pixel (4) is somewhere between these four
+				// and is calculated from these using weight vector (w)
+				// with a dot product
+				pixel_t p0[5], p1[5];
+				Uint8 res_a;
+
+				w0[0] = btable[255 - u0][255 - v0];
+				w0[1] = btable[u0][255 - v0];
+				w0[2] = btable[255 - u0][v0];
+				w0[3] = btable[u0][v0];
+
+				w1[0] = btable[255 - u1][255 - v1];
+				w1[1] = btable[u1][255 - v1];
+				w1[2] = btable[255 - u1][v1];
+				w1[3] = btable[u1][v1];
+
+				// Collect interesting pixels from src image
+				// Optimization: speed is criticial on larger images;
+				// most pixel reads fall completely inside the image
+				if (px0 >= 0 && px0 + 1 < src->w
+						&& py0 >= 0 && py0 + 1 < src->h)
+				{
+					Uint8 *src_p = src_a0 + px0 * sbpp;
+
+					p0[0].value = scale_read_pixel (src_p, srcfmt,
+							srcpal, mk0, ck0);
+					p0[1].value = scale_read_pixel (src_p + sbpp, srcfmt,
+							srcpal, mk0, ck0);
+					p0[2].value = scale_read_pixel (src_p + slen, srcfmt,
+							srcpal, mk0, ck0);
+					p0[3].value = scale_read_pixel (src_p + sbpp + slen,
+							srcfmt, srcpal, mk0, ck0);
+				}
+				else
+				{
+					p0[0].value = scale_get_pixel (src, mk0, ck0, px0, py0);
+					p0[1].value = scale_get_pixel (src, mk0, ck0,
+							px0 + 1, py0);
+					p0[2].value = scale_get_pixel (src, mk0, ck0,
+							px0, py0 + 1);
+					p0[3].value = scale_get_pixel (src, mk0, ck0,
+							px0 + 1, py0 + 1);
+				}
+
+				// Collect interesting pixels from mipmap image
+				if (px1 >= 0 && px1 + 1 < mm->w
+						&& py1 >= 0 && py1 + 1 < mm->h)
+				{
+					Uint8 *mm_p = src_a1 + px1 * mmbpp;
+
+					p1[0].value = scale_read_pixel (mm_p, mmfmt,
+							srcpal, mk1, ck1);
+					p1[1].value = scale_read_pixel (mm_p + mmbpp, mmfmt,
+							srcpal, mk1, ck1);
+					p1[2].value = scale_read_pixel (mm_p + mmlen, mmfmt,
+							srcpal, mk1, ck1);
+					p1[3].value = scale_read_pixel (mm_p + mmbpp + mmlen,
+							mmfmt, srcpal, mk1, ck1);
+				}
+				else
+				{
+					p1[0].value = scale_get_pixel (mm, mk1, ck1, px1, py1);
+					p1[1].value = scale_get_pixel (mm, mk1, ck1,
+							px1 + 1, py1);
+					p1[2].value = scale_get_pixel (mm, mk1, ck1,
+							px1, py1 + 1);
+					p1[3].value = scale_get_pixel (mm, mk1, ck1,
+							px1 + 1, py1 + 1);
+				}
+
+				p0[4].c.a = dot_product_8_4 (p0, 3, w0);
+				p1[4].c.a = dot_product_8_4 (p1, 3, w1);
+
+				res_a = blend_ratio_2 (p0[4].c.a, p1[4].c.a, ratio);
+
+				if (res_a <= alpha_threshold)
+				{
+					*dst_p = transparent;
+				}
+				else if (!dst_has_alpha)
+				{	// RGB surface handling
+					p0[4].c.r = dot_product_8_4 (p0, 0, w0);
+					p0[4].c.g = dot_product_8_4 (p0, 1, w0);
+					p0[4].c.b = dot_product_8_4 (p0, 2, w0);
+
+					p1[4].c.r = dot_product_8_4 (p1, 0, w1);
+					p1[4].c.g = dot_product_8_4 (p1, 1, w1);
+					p1[4].c.b = dot_product_8_4 (p1, 2, w1);
+
+					p0[4].c.r = blend_ratio_2 (p0[4].c.r, p1[4].c.r, ratio);
+					p0[4].c.g = blend_ratio_2 (p0[4].c.g, p1[4].c.g, ratio);
+					p0[4].c.b = blend_ratio_2 (p0[4].c.b, p1[4].c.b, ratio);
+
+					// TODO: we should handle alpha-blending here, but we do
+					//   not know the destination color for blending!
+
+					*dst_p =
+						(p0[4].c.r << dstfmt->Rshift) |
+						(p0[4].c.g << dstfmt->Gshift) |
+						(p0[4].c.b << dstfmt->Bshift);
+				}
+				else
+				{	// RGBA surface handling
+
+					// we do not want to blend with non-present pixels
+					// (pixels that have alpha == 0) as these will
+					// skew the result and make resulting alpha useless
+					if (p0[4].c.a != 0)
+					{
+						int i;
+						for (i = 0; i < 4; ++i)
+							if (p0[i].c.a == 0)
+								w0[i] = 0;
+
+						p0[4].c.r = weight_product_8_4 (p0, 0, w0);
+						p0[4].c.g = weight_product_8_4 (p0, 1, w0);
+						p0[4].c.b = weight_product_8_4 (p0, 2, w0);
+					}
+					if (p1[4].c.a != 0)
+					{
+						int i;
+						for (i = 0; i < 4; ++i)
+							if (p1[i].c.a == 0)
+								w1[i] = 0;
+
+						p1[4].c.r = weight_product_8_4 (p1, 0, w1);
+						p1[4].c.g = weight_product_8_4 (p1, 1, w1);
+						p1[4].c.b = weight_product_8_4 (p1, 2, w1);
+					}
+
+					if (p0[4].c.a != 0 && p1[4].c.a != 0)
+					{	// blend if both present
+						p0[4].c.r = blend_ratio_2 (p0[4].c.r, p1[4].c.r, ratio);
+						p0[4].c.g = blend_ratio_2 (p0[4].c.g, p1[4].c.g, ratio);
+						p0[4].c.b = blend_ratio_2 (p0[4].c.b, p1[4].c.b, ratio);
+					}
+					else if (p1[4].c.a != 0)
+					{	// other pixel is present
+						p0[4].value = p1[4].value;
+					}
+
+					// error-correct alpha to fully opaque to remove
+					// the often unwanted and unnecessary blending
+					if (res_a > 0xf8)
+						res_a = 0xff;
+
+					*dst_p =
+						(p0[4].c.r << dstfmt->Rshift) |
+						(p0[4].c.g << dstfmt->Gshift) |
+						(p0[4].c.b << dstfmt->Bshift) |
+						(res_a << dstfmt->Ashift);
+				}
+			}
+
+			if (xend == w)
+				break;
+
+			// the kernel leaves the odd pixels at the end to the loop
+			krow.dst = dst_p;
+			krow.sx[0] = sx0;
+			krow.sx[1] = sx1;
+			{
+				const int done = job->kernel (&krow);
+				x += done;
+				dst_p += done;
+				sx0 += done * fsx0;
+				sx1 += done * fsx1;
+			}
+			xend = w;
+		}
+	}
+}
+
 void
 TFB_DrawCanvas_Rescale_Trilinear (TFB_Canvas src_canvas, TFB_Canvas src_mipmap,
 		TFB_Canvas dst_canvas, int scale, HOT_SPOT* src_hs, HOT_SPOT* mm_hs,
@@ -1477,26 +1854,18 @@ TFB_DrawCanvas_Rescale_Trilinear (TFB_Canvas src_canvas, TFB_Canvas src_mipmap,
 	SDL_Surface *mm = src_mipmap;
 	SDL_PixelFormat *srcfmt = src->format;
 	SDL_PixelFormat *mmfmt = mm->format;
-	SDL_PixelFormat *dstfmt = dst->format;
 	SDL_Color *srcpal = srcfmt->palette? srcfmt->palette->colors : 0;
-	const int sbpp = srcfmt->BytesPerPixel;
-	const int mmbpp = mmfmt->BytesPerPixel;
-	const int slen = src->pitch;
-	const int mmlen = mm->pitch;
-	const int dst_has_alpha = (dstfmt->Amask != 0);
 	Uint32 transparent = 0;
-	const int alpha_threshold = dst_has_alpha ? 0 : 127;
 	// src v. mipmap importance factor
 	int ratio = scale * 2 - GSCALE_IDENTITY;
 	// source masks and keys
 	Uint32 mk0 = 0, ck0 = ~0, mk1 = 0, ck1 = ~0;
-	// source fractional x and y positions
-	int sx0, sy0, sx1, sy1;
 	// source fractional dx and dy increments
 	int fsx0 = 0, fsy0 = 0, fsx1 = 0, fsy1 = 0;
 	// source fractional x and y starting points
 	int ssx0 = 0, ssy0 = 0, ssx1 = 0, ssy1 = 0;
-	int x, y, w, h;
+	int w, h;
+	rescale_job_t job;
 
 	TFB_GetColorKey (dst, &transparent);
 
@@ -1603,188 +1972,189 @@ TFB_DrawCanvas_Rescale_Trilinear (TFB_Canvas src_canvas, TFB_Canvas src_mipmap,
 		ck1 &= mk1;
 	}
 
+	job.src[0] = src;
+	job.src[1] = mm;
+	job.dst = dst;
+	job.srcpal = srcpal;
+	job.mk[0] = mk0;
+	job.ck[0] = ck0;
+	job.mk[1] = mk1;
+	job.ck[1] = ck1;
+	job.ssx[0] = ssx0;
+	job.ssy[0] = ssy0;
+	job.ssx[1] = ssx1;
+	job.ssy[1] = ssy1;
+	job.fsx[0] = fsx0;
+	job.fsy[0] = fsy0;
+	job.fsx[1] = fsx1;
+	job.fsy[1] = fsy1;
+	job.w = w;
+	job.ratio = ratio;
+	job.transparent = transparent;
+	rescale_prep_kernel (&job, Blend_Funcs->rescale_trilinear, 2);
+
 	SDL_LockSurface(src);
 	SDL_LockSurface(dst);
 	SDL_LockSurface(mm);
 
-	for (y = 0, sy0 = ssy0, sy1 = ssy1;
-			y < h;
-			++y, sy0 += fsy0, sy1 += fsy1)
-	{
-		Uint32 *dst_p = (Uint32 *) ((Uint8*)dst->pixels + y * dst->pitch);
-		const int py0 = (sy0 >> 16);
-		const int py1 = (sy1 >> 16);
-		Uint8 *src_a0 = (Uint8*)src->pixels + py0 * slen;
-		Uint8 *src_a1 = (Uint8*)mm->pixels + py1 * mmlen;
-		// retrieve the fractional portions of y
-		const Uint8 v0 = (sy0 >> 8) & 0xff;
-		const Uint8 v1 = (sy1 >> 8) & 0xff;
-		Uint8 w0[4], w1[4]; // pixel weight vectors
+	RunParallel (rescale_trilinear_rows, &job, h, rescale_band_rows (w, h));
 
-		for (x = 0, sx0 = ssx0, sx1 = ssx1;
-				x < w;
-				++x, ++dst_p, sx0 += fsx0, sx1 += fsx1)
-		{
-			const int px0 = (sx0 >> 16);
-			const int px1 = (sx1 >> 16);
-			// retrieve the fractional portions of x
-			const Uint8 u0 = (sx0 >> 8) & 0xff;
-			const Uint8 u1 = (sx1 >> 8) & 0xff;
-			// pixels are examined and numbered in pattern
-			//  0  1
-			//  2  3
-			// the ideal pixel (4) is somewhere between these four
-			// and is calculated from these using weight vector (w)
-			// with a dot product
-			pixel_t p0[5], p1[5];
-			Uint8 res_a;
-
-			w0[0] = btable[255 - u0][255 - v0];
-			w0[1] = btable[u0][255 - v0];
-			w0[2] = btable[255 - u0][v0];
-			w0[3] = btable[u0][v0];
-
-			w1[0] = btable[255 - u1][255 - v1];
-			w1[1] = btable[u1][255 - v1];
-			w1[2] = btable[255 - u1][v1];
-			w1[3] = btable[u1][v1];
-
-			// Collect interesting pixels from src image
-			// Optimization: speed is criticial on larger images;
-			// most pixel reads fall completely inside the image
-			if (px0 >= 0 && px0 + 1 < src->w && py0 >= 0 && py0 + 1 < src->h)
-			{
-				Uint8 *src_p = src_a0 + px0 * sbpp;
-
-				p0[0].value = scale_read_pixel (src_p, srcfmt,
-						srcpal, mk0, ck0);
-				p0[1].value = scale_read_pixel (src_p + sbpp, srcfmt,
-						srcpal, mk0, ck0);
-				p0[2].value = scale_read_pixel (src_p + slen, srcfmt,
-						srcpal, mk0, ck0);
-				p0[3].value = scale_read_pixel (src_p + sbpp + slen, srcfmt,
-						srcpal, mk0, ck0);
-			}
-			else
-			{
-				p0[0].value = scale_get_pixel (src, mk0, ck0, px0, py0);
-				p0[1].value = scale_get_pixel (src, mk0, ck0, px0 + 1, py0);
-				p0[2].value = scale_get_pixel (src, mk0, ck0, px0, py0 + 1);
-				p0[3].value = scale_get_pixel (src, mk0, ck0,
-						px0 + 1, py0 + 1);
-			}
+	SDL_UnlockSurface(mm);
+	SDL_UnlockSurface(dst);
+	SDL_UnlockSurface(src);
+}
 
-			// Collect interesting pixels from mipmap image
-			if (px1 >= 0 && px1 + 1 < mm->w && py1 >= 0 && py1 + 1 < mm->h)
-			{
-				Uint8 *mm_p = src_a1 + px1 * mmbpp;
-
-				p1[0].value = scale_read_pixel (mm_p, mmfmt,
-						srcpal, mk1, ck1);
-				p1[1].value = scale_read_pixel (mm_p + mmbpp, mmfmt,
-						srcpal, mk1, ck1);
-				p1[2].value = scale_read_pixel (mm_p + mmlen, mmfmt,
-						srcpal, mk1, ck1);
-				p1[3].value = scale_read_pixel (mm_p + mmbpp + mmlen, mmfmt,
-						srcpal, mk1, ck1);
-			}
-			else
-			{
-				p1[0].value = scale_get_pixel (mm, mk1, ck1, px1, py1);
-				p1[1].value = scale_get_pixel (mm, mk1, ck1, px1 + 1, py1);
-				p1[2].value = scale_get_pixel (mm, mk1, ck1, px1, py1 + 1);
-				p1[3].value = scale_get_pixel (mm, mk1, ck1,
-						px1 + 1, py1 + 1);
-			}
+// Rows [begin, end) of TFB_DrawCanvas_Rescale_Bilinear()
+static void
+rescale_bilinear_rows (void *data, int begin, int end)
+{
+	const rescale_job_t *job = data;
+	SDL_Surface *src = job->src[0];
+	SDL_Surface *dst = job->dst;
+	SDL_PixelFormat *srcfmt = src->format;
+	SDL_PixelFormat *dstfmt = dst->format;
+	SDL_Color *srcpal = job->srcpal;
+	const int sbpp = srcfmt->BytesPerPixel;
+	const int slen = src->pitch;
+	const int dst_has_alpha = (dstfmt->Amask != 0);
+	const Uint32 transparent = job->transparent;
+	const int alpha_threshold = dst_has_alpha ? 0 : 127;
+	const Uint32 mk = job->mk[0], ck = job->ck[0];
+	const int fsx = job->fsx[0], fsy = job->fsy[0];
+	const int ssx = job->ssx[0];
+	const int w = job->w;
+	Blend_RescaleRow krow = job->krow;
+	// source fractional x and y positions
+	int sx, sy;
+	int x, y;
 
-			p0[4].c.a = dot_product_8_4 (p0, 3, w0);
-			p1[4].c.a = dot_product_8_4 (p1, 3, w1);
+	for (y = begin, sy = job->ssy[0] + begin * fsy; y < end; ++y, sy += fsy)
+	{
+		Uint32 *dst_p = (Uint32 *) ((Uint8*)dst->pixels + y * dst->pitch);
+		const int py = (sy >> 16);
+		Uint8 *src_a = (Uint8*)src->pixels + py * slen;
+		// retrieve the fractional portions of y
+		const Uint8 v = (sy >> 8) & 0xff;
+		Uint8 weight[4]; // pixel weight vectors
+		int xend = w;
 
-			res_a = blend_ratio_2 (p0[4].c.a, p1[4].c.a, ratio);
+		if (job->kernel && py >= 0 && py + 1 < src->h)
+		{	// the vector kernel can do the inside columns
+			xend = job->kx_begin;
+			krow.row[0] = src_a;
+			krow.v[0] = v;
+		}
 
-			if (res_a <= alpha_threshold)
+		x = 0;
+		sx = ssx;
+		for (;;)
+		{
+			for (; x < xend; ++x, ++dst_p, sx += fsx)
 			{
-				*dst_p = transparent;
-			}
-			else if (!dst_has_alpha)
-			{	// RGB surface handling
-				p0[4].c.r = dot_product_8_4 (p0, 0, w0);
-				p0[4].c.g = dot_product_8_4 (p0, 1, w0);
-				p0[4].c.b = dot_product_8_4 (p0, 2, w0);
-
-				p1[4].c.r = dot_product_8_4 (p1, 0, w1);
-				p1[4].c.g = dot_product_8_4 (p1, 1, w1);
-				p1[4].c.b = dot_product_8_4 (p1, 2, w1);
-
-				p0[4].c.r = blend_ratio_2 (p0[4].c.r, p1[4].c.r, ratio);
-				p0[4].c.g = blend_ratio_2 (p0[4].c.g, p1[4].c.g, ratio);
-				p0[4].c.b = blend_ratio_2 (p0[4].c.b, p1[4].c.b, ratio);
-
-				// TODO: we should handle alpha-blending here, but we do
-				//   not know the destination color for blending!
-
-				*dst_p =
-					(p0[4].c.r << dstfmt->Rshift) |
-					(p0[4].c.g << dstfmt->Gshift) |
-					(p0[4].c.b << dstfmt->Bshift);
-			}
-			else
-			{	// RGBA surface handling
-
-				// we do not want to blend with non-present pixels
-				// (pixels that have alpha == 0) as these will
-				// skew the result and make resulting alpha useless
-				if (p0[4].c.a != 0)
+				const int px = (sx >> 16);
+				// retrieve the fractional portions of x
+				const Uint8 u = (sx >> 8) & 0xff;
+				// pixels are examined and numbered in pattern
+				//  0  1
+				//  2  3
+				// the ideal pixel (4) is somewhere between these four
+				// and is calculated from these using weight vector (weight)
+				// with a dot product
+				pixel_t p[5];
+
+				weight[0] = btable[255 - u][255 - v];
+				weight[1] = btable[u][255 - v];
+				weight[2] = btable[255 - u][v];
+				weight[3] = btable[u][v];
+
+				// Collect interesting pixels from src image
+				// Optimization: speed is criticial on larger images;
+				// most pixel reads fall completely inside the image
+				if (px >= 0 && px + 1 < src->w && py >= 0 && py + 1 < src->h)
 				{
-					int i;
-					for (i = 0; i < 4; ++i)
-						if (p0[i].c.a == 0)
-							w0[i] = 0;
-
-					p0[4].c.r = weight_product_8_4 (p0, 0, w0);
-					p0[4].c.g = weight_product_8_4 (p0, 1, w0);
-					p0[4].c.b = weight_product_8_4 (p0, 2, w0);
+					Uint8 *src_p = src_a + px * sbpp;
+
+					p[0].value = scale_read_pixel (src_p, srcfmt, srcpal,
+							mk, ck);
+					p[1].value = scale_read_pixel (src_p + sbpp, srcfmt,
+							srcpal, mk, ck);
+					p[2].value = scale_read_pixel (src_p + slen, srcfmt,
+							srcpal, mk, ck);
+					p[3].value = scale_read_pixel (src_p + sbpp + slen, srcfmt,
+							srcpal, mk, ck);
 				}
-				if (p1[4].c.a != 0)
+				else
 				{
-					int i;
-					for (i = 0; i < 4; ++i)
-						if (p1[i].c.a == 0)
-							w1[i] = 0;
-
-					p1[4].c.r = weight_product_8_4 (p1, 0, w1);
-					p1[4].c.g = weight_product_8_4 (p1, 1, w1);
-					p1[4].c.b = weight_product_8_4 (p1, 2, w1);
+					p[0].value = scale_get_pixel (src, mk, ck, px, py);
+					p[1].value = scale_get_pixel (src, mk, ck, px + 1, py);
+					p[2].value = scale_get_pixel (src, mk, ck, px, py + 1);
+					p[3].value = scale_get_pixel (src, mk, ck,
+							px + 1, py + 1);
 				}
 
-				if (p0[4].c.a != 0 && p1[4].c.a != 0)
-				{	// blend if both present
-					p0[4].c.r = blend_ratio_2 (p0[4].c.r, p1[4].c.r, ratio);
-					p0[4].c.g = blend_ratio_2 (p0[4].c.g, p1[4].c.g, ratio);
-					p0[4].c.b = blend_ratio_2 (p0[4].c.b, p1[4].c.b, ratio);
+				p[4].c.a = dot_product_8_4 (p, 3, weight);
+
+				if (p[4].c.a <= alpha_threshold)
+				{
+					*dst_p = transparent;
 				}
-				else if (p1[4].c.a != 0)
-				{	// other pixel is present
-					p0[4].value = p1[4].value;
+				else if (!dst_has_alpha)
+				{	// RGB surface handling
+					p[4].c.r = dot_product_8_4 (p, 0, weight);
+					p[4].c.g = dot_product_8_4 (p, 1, weight);
+					p[4].c.b = dot_product_8_4 (p, 2, weight);
+
+					// TODO: we should handle alpha-blending here, but we do
+					//   not know the destination color for blending!
+
+					*dst_p =
+						(p[4].c.r << dstfmt->Rshift) |
+						(p[4].c.g << dstfmt->Gshift) |
+						(p[4].c.b << dstfmt->Bshift);
 				}
+				else
+				{	// RGBA surface handling
 
-				// error-correct alpha to fully opaque to remove
-				// the often unwanted and unnecessary blending
-				if (res_a > 0xf8)
-					res_a = 0xff;
+					// we do not want to blend with non-present pixels
+					// (pixels that have alpha == 0) as these will
+					// skew the result and make resulting alpha useless
+					int i;
+					for (i = 0; i < 4; ++i)
+						if (p[i].c.a == 0)
+							weight[i] = 0;
+
+					p[4].c.r = weight_product_8_4 (p, 0, weight);
+					p[4].c.g = weight_product_8_4 (p, 1, weight);
+					p[4].c.b = weight_product_8_4 (p, 2, weight);
+
+					// error-correct alpha to fully opaque to remove
+					// the often unwanted and unnecessary blending
+					if (p[4].c.a > 0xf8)
+						p[4].c.a = 0xff;
+
+					*dst_p =
+						(p[4].c.r << dstfmt->Rshift) |
+						(p[4].c.g << dstfmt->Gshift) |
+						(p[4].c.b << dstfmt->Bshift) |
+						(p[4].c.a << dstfmt->Ashift);
+				}
+			}
+
+			if (xend == w)
+				break;
 
-				*dst_p =
-					(p0[4].c.r << dstfmt->Rshift) |
-					(p0[4].c.g << dstfmt->Gshift) |
-					(p0[4].c.b << dstfmt->Bshift) |
-					(res_a << dstfmt->Ashift);
+			// the kernel leaves the odd pixels at the end to the loop
+			krow.dst = dst_p;
+			krow.sx[0] = sx;
+			{
+				const int done = job->kernel (&krow);
+				x += done;
+				dst_p += done;
+				sx += done * fsx;
 			}
+			xend = w;
 		}
 	}
-
-	SDL_UnlockSurface(mm);
-	SDL_UnlockSurface(dst);
-	SDL_UnlockSurface(src);
 }
 
 void
@@ -1794,22 +2164,16 @@ TFB_DrawCanvas_Rescale_Bilinear (TFB_Canvas src_canvas, TFB_Canvas dst_canvas,
 	SDL_Surface *src = src_canvas;
 	SDL_Surface *dst = dst_canvas;
 	SDL_PixelFormat *srcfmt = src->format;
-	SDL_PixelFormat *dstfmt = dst->format;
 	SDL_Color *srcpal = srcfmt->palette? srcfmt->palette->colors : 0;
-	const int sbpp = srcfmt->BytesPerPixel;
-	const int slen = src->pitch;
-	const int dst_has_alpha = (dstfmt->Amask != 0);
 	Uint32 srckey = 0, transparent = 0;
-	const int alpha_threshold = dst_has_alpha ? 0 : 127;
 	// source masks and keys
 	Uint32 mk = 0, ck = ~0;
-	// source fractional x and y positions
-	int sx, sy;
 	// source fractional dx and dy increments
 	int fsx = 0, fsy = 0;
 	// source fractional x and y starting points
 	int ssx = 0, ssy = 0;
-	int x, y, w, h;
+	int w, h;
+	rescale_job_t job;
 
 	// Get destination transparent color if it exists
 	TFB_GetColorKey (dst, &transparent);
@@ -1872,107 +2236,25 @@ TFB_DrawCanvas_Rescale_Bilinear (TFB_Canvas src_canvas, TFB_Canvas dst_canvas,
 		ck = srckey & mk;
 	}
 
+	job.src[0] = src;
+	job.src[1] = NULL;
+	job.dst = dst;
+	job.srcpal = srcpal;
+	job.mk[0] = mk;
+	job.ck[0] = ck;
+	job.ssx[0] = ssx;
+	job.ssy[0] = ssy;
+	job.fsx[0] = fsx;
+	job.fsy[0] = fsy;
+	job.w = w;
+	job.ratio = 0;
+	job.transparent = transparent;
+	rescale_prep_kernel (&job, Blend_Funcs->rescale_bilinear, 1);
+
 	SDL_LockSurface(src);
 	SDL_LockSurface(dst);
 
-	for (y = 0, sy = ssy; y < h; ++y, sy += fsy)
-	{
-		Uint32 *dst_p = (Uint32 *) ((Uint8*)dst->pixels + y * dst->pitch);
-		const int py = (sy >> 16);
-		Uint8 *src_a = (Uint8*)src->pixels + py * slen;
-		// retrieve the fractional portions of y
-		const Uint8 v = (sy >> 8) & 0xff;
-		Uint8 weight[4]; // pixel weight vectors
-
-		for (x = 0, sx = ssx; x < w; ++x, ++dst_p, sx += fsx)
-		{
-			const int px = (sx >> 16);
-			// retrieve the fractional portions of x
-			const Uint8 u = (sx >> 8) & 0xff;
-			// pixels are examined and numbered in pattern
-			//  0  1
-			//  2  3
-			// the ideal pixel (4) is somewhere between these four
-			// and is calculated from these using weight vector (weight)
-			// with a dot product
-			pixel_t p[5];
-
-			weight[0] = btable[255 - u][255 - v];
-			weight[1] = btable[u][255 - v];
-			weight[2] = btable[255 - u][v];
-			weight[3] = btable[u][v];
-
-			// Collect interesting pixels from src image
-			// Optimization: speed is criticial on larger images;
-			// most pixel reads fall completely inside the image
-			if (px >= 0 && px + 1 < src->w && py >= 0 && py + 1 < src->h)
-			{
-				Uint8 *src_p = src_a + px * sbpp;
-
-				p[0].value = scale_read_pixel (src_p, srcfmt, srcpal, mk, ck);
-				p[1].value = scale_read_pixel (src_p + sbpp, srcfmt,
-						srcpal, mk, ck);
-				p[2].value = scale_read_pixel (src_p + slen, srcfmt,
-						srcpal, mk, ck);
-				p[3].value = scale_read_pixel (src_p + sbpp + slen, srcfmt,
-						srcpal, mk, ck);
-			}
-			else
-			{
-				p[0].value = scale_get_pixel (src, mk, ck, px, py);
-				p[1].value = scale_get_pixel (src, mk, ck, px + 1, py);
-				p[2].value = scale_get_pixel (src, mk, ck, px, py + 1);
-				p[3].value = scale_get_pixel (src, mk, ck, px + 1, py + 1);
-			}
-
-			p[4].c.a = dot_product_8_4 (p, 3, weight);
-
-			if (p[4].c.a <= alpha_threshold)
-			{
-				*dst_p = transparent;
-			}
-			else if (!dst_has_alpha)
-			{	// RGB surface handling
-				p[4].c.r = dot_product_8_4 (p, 0, weight);
-				p[4].c.g = dot_product_8_4 (p, 1, weight);
-				p[4].c.b = dot_product_8_4 (p, 2, weight);
-
-				// TODO: we should handle alpha-blending here, but we do
-				//   not know the destination color for blending!
-
-				*dst_p =
-					(p[4].c.r << dstfmt->Rshift) |
-					(p[4].c.g << dstfmt->Gshift) |
-					(p[4].c.b << dstfmt->Bshift);
-			}
-			else
-			{	// RGBA surface handling
-
-				// we do not want to blend with non-present pixels
-				// (pixels that have alpha == 0) as these will
-				// skew the result and make resulting alpha useless
-				int i;
-				for (i = 0; i < 4; ++i)
-					if (p[i].c.a == 0)
-						weight[i] = 0;
-
-				p[4].c.r = weight_product_8_4 (p, 0, weight);
-				p[4].c.g = weight_product_8_4 (p, 1, weight);
-				p[4].c.b = weight_product_8_4 (p, 2, weight);
-
-				// error-correct alpha to fully opaque to remove
-				// the often unwanted and unnecessary blending
-				if (p[4].c.a > 0xf8)
-					p[4].c.a = 0xff;
-
-				*dst_p =
-					(p[4].c.r << dstfmt->Rshift) |
-					(p[4].c.g << dstfmt->Gshift) |
-					(p[4].c.b << dstfmt->Bshift) |
-					(p[4].c.a << dstfmt->Ashift);
-			}
-		}
-	}
+	RunParallel (rescale_bilinear_rows, &job, h, rescale_band_rows (w, h));
 
 	SDL_UnlockSurface(dst);
 	SDL_UnlockSurface(src);
@@ -2154,77 +2436,60 @@ TFB_DrawCanvas_SetClipRect (TFB_Canvas canvas, const RECT *clipRect)
 	}
 }
 
+// Fills in the solidity mask of a canvas: any not fully transparent
+// pixel of a canvas with alpha, and any pixel that does not match the
+// colorkey otherwise. mask->bits must be zeroed and sized for
+// mask->height rows of mask->pitch words.
 BOOLEAN
-TFB_DrawCanvas_Intersect (TFB_Canvas canvas1, POINT c1org,
-		TFB_Canvas canvas2, POINT c2org, const RECT *interRect)
+TFB_DrawCanvas_GetCollisionMask (TFB_Canvas canvas, TFB_CollisionMask *mask)
 {
-	BOOLEAN ret = FALSE;
-	SDL_Surface *surf1 = canvas1;
-	SDL_Surface *surf2 = canvas2;
-	int x, y;
-	Uint32 s1key, s2key;
-	Uint32 s1mask, s2mask;
-	GetPixelFn getpixel1, getpixel2;
-
-	SDL_LockSurface (surf1);
-	SDL_LockSurface (surf2);
-
-	getpixel1 = getpixel_for (surf1);
-	getpixel2 = getpixel_for (surf2);
+	SDL_Surface *surf = canvas;
+	int x, y, w, h;
+	Uint32 key;
+	Uint32 keymask;
+	GetPixelFn getpixel;
 
-	if (surf1->format->Amask)
-	{	// use alpha transparency info
-		s1mask = surf1->format->Amask;
-		// consider any not fully transparent pixel collidable
-		s1key = 0;
-	}
-	else
-	{	// colorkey transparency
-		Uint32 colorkey = 0;
-		TFB_GetColorKey(surf1, &colorkey);
-		s1mask = ~surf1->format->Amask;
-		s1key = colorkey & s1mask;
+	if (canvas == 0)
+	{
+		log_add (log_Warning, "ERROR: TFB_DrawCanvas_GetCollisionMask "
+				"passed null canvas");
+		return FALSE;
 	}
 
-	if (surf2->format->Amask)
+	if (surf->format->Amask)
 	{	// use alpha transparency info
-		s2mask = surf2->format->Amask;
+		keymask = surf->format->Amask;
 		// consider any not fully transparent pixel collidable
-		s2key = 0;
+		key = 0;
 	}
 	else
 	{	// colorkey transparency
 		Uint32 colorkey = 0;
-		TFB_GetColorKey(surf2, &colorkey);
-		s2mask = ~surf2->format->Amask;
-		s2key = colorkey & s2mask;
+		TFB_GetColorKey (surf, &colorkey);
+		keymask = ~surf->format->Amask;
+		key = colorkey & keymask;
 	}
 
-	// convert surface origins to pixel offsets within
-	c1org.x = interRect->corner.x - c1org.x;
-	c1org.y = interRect->corner.y - c1org.y;
-	c2org.x = interRect->corner.x - c2org.x;
-	c2org.y = interRect->corner.y - c2org.y;
+	w = mask->width < surf->w ? mask->width : surf->w;
+	h = mask->height < surf->h ? mask->height : surf->h;
 
-	for (y = 0; y < interRect->extent.height; ++y)
+	SDL_LockSurface (surf);
+	getpixel = getpixel_for (surf);
+
+	for (y = 0; y < h; ++y)
 	{
-		for (x = 0; x < interRect->extent.width; ++x)
-		{
-			Uint32 p1 = getpixel1 (surf1, x + c1org.x, y + c1org.y) & s1mask;
-			Uint32 p2 = getpixel2 (surf2, x + c2org.x, y + c2org.y) & s2mask;
+		QWORD *row = mask->bits + y * mask->pitch;
 
-			if (p1 != s1key && p2 != s2key)
-			{	// pixel collision
-				ret = TRUE;
-				break;
-			}
+		for (x = 0; x < w; ++x)
+		{
+			if ((getpixel (surf, x, y) & keymask) != key)
+				row[x >> 6] |= (QWORD)1 << (x & 63);
 		}
 	}
 
-	SDL_UnlockSurface (surf2);
-	SDL_UnlockSurface (surf1);
+	SDL_UnlockSurface (surf);
 
-	return ret;
+	return TRUE;
 }
 
 // Read/write the canvas pixels in a Color format understood by the core.
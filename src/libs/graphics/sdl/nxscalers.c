@@ -0,0 +1,511 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+// Screen scalers to 3x and 4x
+//  Plain C only. The core routines take the scale factor as a parameter
+//  and the exported functions just fix it.
+//  The updated region is cut into bands of rows which are scaled on the
+//  parallel loop pool. A source row only writes its own 'factor' rows of
+//  the destination, so the bands never touch each other's pixels.
+
+#include <string.h>
+#include "libs/graphics/sdl/sdl_common.h"
+#include "libs/threadlib.h"
+#include "types.h"
+#include "scalers.h"
+#include "scaleint.h"
+#include "nxscalers.h"
+
+#define SCALE_NX_MAX 4
+#define SCALE_BAND_PIXELS 4096
+		// source pixels in the smallest band worth a thread
+
+typedef struct scale_nx_job scale_nx_job_t;
+typedef void (* Scale_NxRowFunc) (const scale_nx_job_t *job, int y);
+
+struct scale_nx_job
+{
+	SDL_Surface *src;
+	SDL_Surface *dst;
+	const SDL_PixelFormat *fmt;
+	int factor;
+	SDL_Rect region;
+	Scale_NxRowFunc row;
+	// Bilinear weights (adding up to 256) of the pixel itself and of its
+	// horizontal, vertical and diagonal neighbours, for the destination
+	// pixels of the lower right quarter; other quarters are mirrored
+	int weights[SCALE_NX_MAX][SCALE_NX_MAX][4];
+	// How much (in quarters) of a destination pixel is covered by
+	// a diagonal edge cutting off the lower right corner
+	int cover[SCALE_NX_MAX][SCALE_NX_MAX];
+};
+
+
+// Scaler function lookup tables
+//  biadapt, biadv and triscan have no versions of their own above 2x
+//  and use the xBR-style filter, the closest in spirit
+const Scale_FuncDef_t
+Scale_3x_Functions[] =
+{
+	{TFB_GFXFLAGS_SCALE_BIADAPT,    Scale_Xbr3xFilter},
+	{TFB_GFXFLAGS_SCALE_BIADAPTADV, Scale_Xbr3xFilter},
+	{TFB_GFXFLAGS_SCALE_TRISCAN,    Scale_Xbr3xFilter},
+	{TFB_GFXFLAGS_SCALE_HQXX,       Scale_Hq3xFilter},
+	// Default
+	{0,                             Scale_Nearest3x}
+};
+
+const Scale_FuncDef_t
+Scale_4x_Functions[] =
+{
+	{TFB_GFXFLAGS_SCALE_BIADAPT,    Scale_Xbr4xFilter},
+	{TFB_GFXFLAGS_SCALE_BIADAPTADV, Scale_Xbr4xFilter},
+	{TFB_GFXFLAGS_SCALE_TRISCAN,    Scale_Xbr4xFilter},
+	{TFB_GFXFLAGS_SCALE_HQXX,       Scale_Hq4xFilter},
+	// Default
+	{0,                             Scale_Nearest4x}
+};
+
+
+static inline const Uint32 *
+Scale_NxSrcRow (const scale_nx_job_t *job, int y)
+{
+	// rows past the edges repeat the edge
+	if (y < 0)
+		y = 0;
+	else if (y >= job->src->h)
+		y = job->src->h - 1;
+	return (const Uint32 *) ((const Uint8 *)job->src->pixels
+			+ y * job->src->pitch);
+}
+
+static inline int
+Scale_NxClampX (const scale_nx_job_t *job, int x)
+{
+	if (x < 0)
+		return 0;
+	else if (x >= job->src->w)
+		return job->src->w - 1;
+	return x;
+}
+
+static inline Uint32 *
+Scale_NxDstPixel (const scale_nx_job_t *job, int x, int y)
+{
+	return (Uint32 *) ((Uint8 *)job->dst->pixels
+			+ y * job->factor * job->dst->pitch)
+			+ x * job->factor;
+}
+
+// blends pixels with (4 - quarters):quarters ratio
+static inline Uint32
+Scale_BlendQuarters (Uint32 pix1, Uint32 pix2, int quarters)
+{
+	switch (quarters)
+	{
+		case 0:
+			return pix1;
+		case 1:
+			return Scale_Blend_31 (pix1, pix2);
+		case 2:
+			return Scale_Blend_11 (pix1, pix2);
+		case 3:
+			return Scale_Blend_31 (pix2, pix1);
+		default:
+			return pix2;
+	}
+}
+
+// weighted blend of four pixels; the weights add up to 256
+static inline Uint32
+Scale_Blend_Weighted4 (Uint32 pix1, Uint32 pix2, Uint32 pix3, Uint32 pix4,
+		const int *w)
+{
+	// two channels at a time; 255 * 256 still fits in 16 bits
+	Uint32 rb = (pix1 & 0x00ff00ff) * w[0] + (pix2 & 0x00ff00ff) * w[1]
+			+ (pix3 & 0x00ff00ff) * w[2] + (pix4 & 0x00ff00ff) * w[3];
+	Uint32 ag = ((pix1 >> 8) & 0x00ff00ff) * w[0]
+			+ ((pix2 >> 8) & 0x00ff00ff) * w[1]
+			+ ((pix3 >> 8) & 0x00ff00ff) * w[2]
+			+ ((pix4 >> 8) & 0x00ff00ff) * w[3];
+
+	return ((rb >> 8) & 0x00ff00ff) | (ag & 0xff00ff00);
+}
+
+// weighted YUV distance, as used by the xBR family
+static inline int
+Scale_DistYUV (YUV_VECTOR yuv1, YUV_VECTOR yuv2)
+{
+	return 48 * abs ((int)(yuv1 >> 16) - (int)(yuv2 >> 16))
+			+ 7 * abs ((int)((yuv1 >> 8) & 0xff) - (int)((yuv2 >> 8) & 0xff))
+			+ 6 * abs ((int)(yuv1 & 0xff) - (int)(yuv2 & 0xff));
+}
+
+static void
+Scale_NxPrepTables (scale_nx_job_t *job)
+{
+	const int n = job->factor;
+	const int den = 4 * n * n;
+	int i, j;
+
+	for (j = 0; j < n; ++j)
+	{
+		for (i = 0; i < n; ++i)
+		{
+			// offsets from the source pixel center, in 1/(2n) units;
+			// negative only on the mirrored side, never looked up
+			int a = 2 * i + 1 - n;
+			int b = 2 * j + 1 - n;
+			int *w = job->weights[j][i];
+			int c;
+
+			if (a < 0)
+				a = 0;
+			if (b < 0)
+				b = 0;
+			w[1] = (a * (2 * n - b) * 256 + den / 2) / den;
+			w[2] = (b * (2 * n - a) * 256 + den / 2) / den;
+			w[3] = (a * b * 256 + den / 2) / den;
+			w[0] = 256 - w[1] - w[2] - w[3];
+
+			// the edge runs from the middle of the right side to
+			// the middle of the bottom side of the source pixel
+			c = 2 * (2 * i + 2 * j + 3 - 3 * n);
+			if (c < 0)
+				c = 0;
+			else if (c > 4)
+				c = 4;
+			job->cover[j][i] = c;
+		}
+	}
+}
+
+
+// Nearest neighbor
+
+static void
+Scale_NearestNxRow (const scale_nx_job_t *job, int y)
+{
+	const int n = job->factor;
+	const int rw = job->region.w;
+	const int dp = job->dst->pitch;
+	const Uint32 *src_p = Scale_NxSrcRow (job, y) + job->region.x;
+	Uint32 *first = Scale_NxDstPixel (job, job->region.x, y);
+	Uint32 *dst_p = first;
+	int x, i;
+
+	for (x = 0; x < rw; ++x, dst_p += n)
+	{
+		Uint32 pix = src_p[x];
+		for (i = 0; i < n; ++i)
+			dst_p[i] = pix;
+	}
+	// the other lines are all the same
+	for (i = 1; i < n; ++i)
+		memcpy ((Uint8 *)first + i * dp, first, rw * n * sizeof (Uint32));
+}
+
+
+// HQ-style
+//  Each destination pixel is a bilinear blend of the source pixel and its
+//  neighbours in that direction, but neighbours which differ from the
+//  source pixel (by the hq2x YUV thresholds) do not take part, so edges
+//  stay sharp. Where both orthogonal neighbours differ from the pixel but
+//  not from each other, a diagonal edge cuts off the corner.
+
+static void
+Scale_HqNxRow (const scale_nx_job_t *job, int y)
+{
+	const SDL_PixelFormat *fmt = job->fmt;
+	const int n = job->factor;
+	const int dlen = job->dst->pitch / sizeof (Uint32);
+	const int xend = job->region.x + job->region.w;
+	const Uint32 *rows[3];
+	Uint32 *dst_p = Scale_NxDstPixel (job, job->region.x, y);
+	int x;
+
+	rows[0] = Scale_NxSrcRow (job, y - 1);
+	rows[1] = Scale_NxSrcRow (job, y);
+	rows[2] = Scale_NxSrcRow (job, y + 1);
+
+	for (x = job->region.x; x < xend; ++x, dst_p += n)
+	{
+		Uint32 pix[3][3];
+		YUV_VECTOR yuv[3][3];
+		// per quarter (by [below][right]): the blend inputs
+		Uint32 quad[2][2][3];
+		Uint32 edge[2][2];
+		int cols[3];
+		bool flat = true;
+		int i, j;
+
+		cols[0] = Scale_NxClampX (job, x - 1);
+		cols[1] = x;
+		cols[2] = Scale_NxClampX (job, x + 1);
+		for (j = 0; j < 3; ++j)
+			for (i = 0; i < 3; ++i)
+				pix[j][i] = rows[j][cols[i]];
+		for (j = 0; j < 3; ++j)
+			for (i = 0; i < 3; ++i)
+				if (pix[j][i] != pix[1][1])
+					flat = false;
+
+		if (flat)
+		{
+			for (j = 0; j < n; ++j)
+				for (i = 0; i < n; ++i)
+					dst_p[j * dlen + i] = pix[1][1];
+			continue;
+		}
+
+		for (j = 0; j < 3; ++j)
+			for (i = 0; i < 3; ++i)
+				yuv[j][i] = SCALE_TOYUV (pix[j][i]);
+
+		for (j = 0; j < 2; ++j)
+		{
+			for (i = 0; i < 2; ++i)
+			{
+				const int sx = i ? 2 : 0;
+				const int sy = j ? 2 : 0;
+				const bool sameH = !SCALE_DIFFYUV (yuv[1][1], yuv[1][sx]);
+				const bool sameV = !SCALE_DIFFYUV (yuv[1][1], yuv[sy][1]);
+				const bool sameD = !SCALE_DIFFYUV (yuv[1][1], yuv[sy][sx]);
+
+				quad[j][i][0] = sameH ? pix[1][sx] : pix[1][1];
+				quad[j][i][1] = sameV ? pix[sy][1] : pix[1][1];
+				// the diagonal only joins along a similar side
+				quad[j][i][2] = (sameD && (sameH || sameV)) ?
+						pix[sy][sx] : pix[1][1];
+
+				if (!sameH && !sameV
+						&& !SCALE_DIFFYUV (yuv[1][sx], yuv[sy][1]))
+					edge[j][i] = Scale_Blend_11 (pix[1][sx], pix[sy][1]);
+				else
+					edge[j][i] = pix[1][1];
+			}
+		}
+
+		for (j = 0; j < n; ++j)
+		{
+			const int below = (2 * j + 1 >= n);
+			const int lj = below ? j : n - 1 - j;
+
+			for (i = 0; i < n; ++i)
+			{
+				const int right = (2 * i + 1 >= n);
+				const int li = right ? i : n - 1 - i;
+				const Uint32 *q = quad[below][right];
+				Uint32 out;
+
+				if (job->cover[lj][li]
+						&& edge[below][right] != pix[1][1])
+					out = Scale_BlendQuarters (pix[1][1],
+							edge[below][right], job->cover[lj][li]);
+				else
+					out = Scale_Blend_Weighted4 (pix[1][1], q[0], q[1],
+							q[2], job->weights[lj][li]);
+				dst_p[j * dlen + i] = out;
+			}
+		}
+	}
+}
+
+
+// xBR-style
+//  The level 1 xBR rule: for each corner, weigh the edge running across
+//  it against the edge running along it over a 5x5 window, and where the
+//  former wins, cut the corner off with the closer of the two neighbours.
+
+// window access, relative to the center pixel
+#define WIN_PIX(dx, dy)  (pix[2 + (dy)][2 + (dx)])
+#define WIN_YUV(dx, dy)  (yuv[2 + (dy)][2 + (dx)])
+#define WIN_DIST(x1, y1, x2, y2) \
+		Scale_DistYUV (WIN_YUV (x1, y1), WIN_YUV (x2, y2))
+
+static void
+Scale_XbrNxRow (const scale_nx_job_t *job, int y)
+{
+	const SDL_PixelFormat *fmt = job->fmt;
+	const int n = job->factor;
+	const int dlen = job->dst->pitch / sizeof (Uint32);
+	const int xend = job->region.x + job->region.w;
+	const Uint32 *rows[5];
+	Uint32 pix[5][5];
+	YUV_VECTOR yuv[5][5];
+	Uint32 *dst_p = Scale_NxDstPixel (job, job->region.x, y);
+	int x, i, j;
+
+	for (j = 0; j < 5; ++j)
+		rows[j] = Scale_NxSrcRow (job, y + j - 2);
+
+	// prime the window so that the first slide centers it on region.x
+	for (i = 1; i < 5; ++i)
+	{
+		int cx = Scale_NxClampX (job, job->region.x + i - 3);
+		for (j = 0; j < 5; ++j)
+		{
+			pix[j][i] = rows[j][cx];
+			yuv[j][i] = SCALE_TOYUV (pix[j][i]);
+		}
+	}
+
+	for (x = job->region.x; x < xend; ++x, dst_p += n)
+	{
+		const int cx = Scale_NxClampX (job, x + 2);
+		int sx, sy;
+
+		for (j = 0; j < 5; ++j)
+		{
+			memmove (pix[j], pix[j] + 1, 4 * sizeof (pix[j][0]));
+			memmove (yuv[j], yuv[j] + 1, 4 * sizeof (yuv[j][0]));
+			pix[j][4] = rows[j][cx];
+			yuv[j][4] = SCALE_TOYUV (pix[j][4]);
+		}
+
+		for (j = 0; j < n; ++j)
+			for (i = 0; i < n; ++i)
+				dst_p[j * dlen + i] = WIN_PIX (0, 0);
+
+		for (sy = -1; sy <= 1; sy += 2)
+		{
+			for (sx = -1; sx <= 1; sx += 2)
+			{
+				int across, along;
+				Uint32 with;
+				int li, lj;
+
+				if (WIN_YUV (0, 0) == WIN_YUV (sx, 0)
+						|| WIN_YUV (0, 0) == WIN_YUV (0, sy))
+					continue;
+
+				across = WIN_DIST (0, 0, sx, -sy) + WIN_DIST (0, 0, -sx, sy)
+						+ WIN_DIST (sx, sy, 0, 2 * sy)
+						+ WIN_DIST (sx, sy, 2 * sx, 0)
+						+ 4 * WIN_DIST (0, sy, sx, 0);
+				along = WIN_DIST (0, sy, -sx, 0) + WIN_DIST (0, sy, sx, 2 * sy)
+						+ WIN_DIST (sx, 0, 2 * sx, sy)
+						+ WIN_DIST (sx, 0, 0, -sy)
+						+ 4 * WIN_DIST (0, 0, sx, sy);
+				if (across >= along)
+					continue;
+
+				if (WIN_DIST (0, 0, sx, 0) <= WIN_DIST (0, 0, 0, sy))
+					with = WIN_PIX (sx, 0);
+				else
+					with = WIN_PIX (0, sy);
+
+				// only the corner quarter can be covered
+				for (lj = n / 2; lj < n; ++lj)
+				{
+					const int dy = sy > 0 ? lj : n - 1 - lj;
+					for (li = n / 2; li < n; ++li)
+					{
+						const int dx = sx > 0 ? li : n - 1 - li;
+						if (job->cover[lj][li])
+							dst_p[dy * dlen + dx] = Scale_BlendQuarters (
+									WIN_PIX (0, 0), with,
+									job->cover[lj][li]);
+					}
+				}
+			}
+		}
+	}
+}
+
+#undef WIN_PIX
+#undef WIN_YUV
+#undef WIN_DIST
+
+
+static void
+Scale_NxBand (void *data, int begin, int end)
+{
+	const scale_nx_job_t *job = data;
+	int y;
+
+	for (y = begin; y < end; ++y)
+		job->row (job, job->region.y + y);
+}
+
+static void
+Scale_NxFilter (SDL_Surface *src, SDL_Surface *dst, SDL_Rect *r,
+		int factor, int expansion, Scale_NxRowFunc row)
+{
+	scale_nx_job_t job;
+
+	if (expansion)
+	{
+		// pixels neighbooring the updated region may
+		// change as a result of updates
+		SDL_Rect limits;
+
+		limits.x = 0;
+		limits.y = 0;
+		limits.w = src->w;
+		limits.h = src->h;
+		Scale_ExpandRect (r, expansion, &limits);
+	}
+	if (r->w <= 0 || r->h <= 0)
+		return;
+
+	job.src = src;
+	job.dst = dst;
+	job.fmt = dst->format;
+	job.factor = factor;
+	job.region = *r;
+	job.row = row;
+	Scale_NxPrepTables (&job);
+
+	RunParallel (Scale_NxBand, &job, r->h,
+			(SCALE_BAND_PIXELS + r->w - 1) / r->w);
+}
+
+void
+Scale_Nearest3x (SDL_Surface *src, SDL_Surface *dst, SDL_Rect *r)
+{
+	Scale_NxFilter (src, dst, r, 3, 0, Scale_NearestNxRow);
+}
+
+void
+Scale_Nearest4x (SDL_Surface *src, SDL_Surface *dst, SDL_Rect *r)
+{
+	Scale_NxFilter (src, dst, r, 4, 0, Scale_NearestNxRow);
+}
+
+void
+Scale_Hq3xFilter (SDL_Surface *src, SDL_Surface *dst, SDL_Rect *r)
+{
+	Scale_NxFilter (src, dst, r, 3, 1, Scale_HqNxRow);
+}
+
+void
+Scale_Hq4xFilter (SDL_Surface *src, SDL_Surface *dst, SDL_Rect *r)
+{
+	Scale_NxFilter (src, dst, r, 4, 1, Scale_HqNxRow);
+}
+
+void
+Scale_Xbr3xFilter (SDL_Surface *src, SDL_Surface *dst, SDL_Rect *r)
+{
+	Scale_NxFilter (src, dst, r, 3, 2, Scale_XbrNxRow);
+}
+
+void
+Scale_Xbr4xFilter (SDL_Surface *src, SDL_Surface *dst, SDL_Rect *r)
+{
+	Scale_NxFilter (src, dst, r, 4, 2, Scale_XbrNxRow);
+}
@@ -19,6 +19,7 @@
 #include "port.h"
 #include "sdl_common.h"
 #include "primitives.h"
+#include "blendspan.h"
 #include "uqm/units.h"
 
 
@@ -150,14 +151,6 @@ putpixel_for (SDL_Surface *surface)
 	return NULL;
 }
 
-static void
-renderpixel_replace (SDL_Surface *surface, int x, int y, Uint32 pixel,
-		int factor)
-{
-	(void) factor; // ignored
-	putpixel_32 (surface, x, y, pixel);
-}
-
 static inline Uint8
 clip_channel (int c)
 {
@@ -261,19 +254,29 @@ PACK_PIXEL_RGBA (const SDL_PixelFormat *fmt,
 			| ((Uint32)b << fmt->Bshift) | ((Uint32)a << fmt->Ashift);
 }
 
-static void
-renderpixel_additive (SDL_Surface *surface, int x, int y, Uint32 pixel,
-		int factor)
+// Per-pixel blend operations. 'dp' is the current destination pixel,
+// 'pixel' is the incoming pixel, both in destination surface format.
+// These are shared by the RenderPixelFn and RenderSpanFn families so
+// that both produce identical results.
+
+static inline Uint32
+blendpixel_replace (Uint32 dp, Uint32 pixel, int factor,
+		const SDL_PixelFormat *fmt)
+{
+	(void) dp;
+	(void) factor; // ignored
+	(void) fmt;
+	return pixel;
+}
+
+static inline Uint32
+blendpixel_additive (Uint32 dp, Uint32 pixel, int factor,
+		const SDL_PixelFormat *fmt)
 {
-	const SDL_PixelFormat *fmt = surface->format;
-	Uint32 *p;
-	Uint32 sp;
 	Uint8 sr, sg, sb;
 	int r, g, b;
-	
-	p = (Uint32 *) ((Uint8 *)surface->pixels + y * surface->pitch + x * 4);
-	sp = *p;
-	UNPACK_PIXEL_RGB (sp, fmt, sr, sg, sb);
+
+	UNPACK_PIXEL_RGB (dp, fmt, sr, sg, sb);
 	UNPACK_PIXEL_RGB (pixel, fmt, r, g, b);
 	
 	// TODO: We may need a special case for factor == -ADDITIVE_FACTOR_1 too,
@@ -292,198 +295,278 @@ renderpixel_additive (SDL_Surface *surface, int x, int y, Uint32 pixel,
 		sb = modulated_sum (sb, b, factor);
 	}
 
-	*p = PACK_PIXEL_RGB (fmt, sr, sg, sb);
+	return PACK_PIXEL_RGB (fmt, sr, sg, sb);
 }
 
-static void
-renderpixel_alpha (SDL_Surface *surface, int x, int y, Uint32 pixel,
-		int factor)
+static inline Uint32
+blendpixel_alpha (Uint32 dp, Uint32 pixel, int factor,
+		const SDL_PixelFormat *fmt)
 {
-	const SDL_PixelFormat *fmt = surface->format;
-	Uint32 *p;
-	Uint32 sp;
 	Uint8 sr, sg, sb;
 	int r, g, b;
 	
 	if (factor == FULLY_OPAQUE_ALPHA)
 	{	// alpha == 255 is equivalent to 'replace' and blending does not
 		// work correctly anyway because we use >> 8 instead of / 255
-		putpixel_32 (surface, x, y, pixel);
-		return;
+		return pixel;
 	}
 
-	p = (Uint32 *) ((Uint8 *)surface->pixels + y * surface->pitch + x * 4);
-	sp = *p;
-	UNPACK_PIXEL_RGB (sp, fmt, sr, sg, sb);
+	UNPACK_PIXEL_RGB (dp, fmt, sr, sg, sb);
 	UNPACK_PIXEL_RGB (pixel, fmt, r, g, b);
 	sr = alpha_blend (sr, r, factor);
 	sg = alpha_blend (sg, g, factor);
 	sb = alpha_blend (sb, b, factor);
-	*p = PACK_PIXEL_RGB (fmt, sr, sg, sb);
+	return PACK_PIXEL_RGB (fmt, sr, sg, sb);
 }
 
-static void
-renderpixel_multiply (SDL_Surface *surface, int x, int y, Uint32 pixel,
-		int factor)
+static inline Uint32
+blendpixel_multiply (Uint32 dp, Uint32 pixel, int factor,
+		const SDL_PixelFormat *fmt)
 {
-	const SDL_PixelFormat* fmt = surface->format;
-	Uint32* p;
-	Uint32 sp;
 	Uint8 sr, sg, sb;
 	int r, g, b;
 
 	(void) factor;// Doesn't support alpha
 
-	p = (Uint32 *) ((Uint8 *)surface->pixels + y * surface->pitch + x * 4);
-	sp = *p;
-	UNPACK_PIXEL_RGB (sp, fmt, sr, sg, sb);
+	UNPACK_PIXEL_RGB (dp, fmt, sr, sg, sb);
 	UNPACK_PIXEL_RGB (pixel, fmt, r, g, b);
 	sr = multiply_blend (sr, r);
 	sg = multiply_blend (sg, g);
 	sb = multiply_blend (sb, b);
-	*p = PACK_PIXEL_RGB (fmt, sr, sg, sb);
+	return PACK_PIXEL_RGB (fmt, sr, sg, sb);
 }
 
-static void
-renderpixel_overlay (SDL_Surface *surface, int x, int y, Uint32 pixel,
-		int factor)
+static inline Uint32
+blendpixel_overlay (Uint32 dp, Uint32 pixel, int factor,
+		const SDL_PixelFormat *fmt)
 {
-	const SDL_PixelFormat* fmt = surface->format;
-	Uint32* p;
-	Uint32 sp;
 	Uint8 sr, sg, sb;
 	int r, g, b, a;
 
-	p = (Uint32 *) ((Uint8 *)surface->pixels + y * surface->pitch + x * 4);
-	sp = *p;
-	UNPACK_PIXEL_RGB (sp, fmt, sr, sg, sb);
+	UNPACK_PIXEL_RGB (dp, fmt, sr, sg, sb);
 	UNPACK_PIXEL_RGBA (pixel, fmt, r, g, b, a);
+	(void) a;
 	r = alpha_blend (sr, overlay_blend (sr, r), factor);
 	g = alpha_blend (sg, overlay_blend (sg, g), factor);
 	b = alpha_blend (sb, overlay_blend (sb, b), factor);
-	*p = PACK_PIXEL_RGB (fmt, r, g, b);
+	return PACK_PIXEL_RGB (fmt, r, g, b);
 }
 
-static void
-renderpixel_screen (SDL_Surface *surface, int x, int y, Uint32 pixel,
-		int factor)
+static inline Uint32
+blendpixel_screen (Uint32 dp, Uint32 pixel, int factor,
+		const SDL_PixelFormat *fmt)
 {
-	const SDL_PixelFormat* fmt = surface->format;
-	Uint32* p;
-	Uint32 sp;
 	Uint8 sr, sg, sb;
 	int r, g, b;
 
 	(void) factor;// Doesn't support alpha
 
-	p = (Uint32 *) ((Uint8 *)surface->pixels + y * surface->pitch + x * 4);
-	sp = *p;
-	UNPACK_PIXEL_RGB (sp, fmt, sr, sg, sb);
+	UNPACK_PIXEL_RGB (dp, fmt, sr, sg, sb);
 	UNPACK_PIXEL_RGB (pixel, fmt, r, g, b);
 	sr = screen_blend (sr, r);
 	sg = screen_blend (sg, g);
 	sb = screen_blend (sb, b);
-	*p = PACK_PIXEL_RGB (fmt, sr, sg, sb);
+	return PACK_PIXEL_RGB (fmt, sr, sg, sb);
 }
 
-static void
-renderpixel_grayscale (SDL_Surface *surface, int x, int y, Uint32 pixel,
-		int factor)
+static inline Uint32
+blendpixel_grayscale (Uint32 dp, Uint32 pixel, int factor,
+		const SDL_PixelFormat *fmt)
 {
-	const SDL_PixelFormat* fmt = surface->format;
-	Uint32* p;
-	Uint32 sp;
 	Uint8 avr;
 	Uint8 sr, sg, sb;
 
 	(void) pixel;
 
-	p = (Uint32 *) ((Uint8 *)surface->pixels + y * surface->pitch + x * 4);
-	sp = *p;
-	UNPACK_PIXEL_RGB (sp, fmt, sr, sg, sb);
+	UNPACK_PIXEL_RGB (dp, fmt, sr, sg, sb);
 
 	avr = overlay_blend ((((sr + sg + sb) * 341) >> 10), factor);
-	*p = PACK_PIXEL_RGB (fmt, avr, avr, avr);
+	return PACK_PIXEL_RGB (fmt, avr, avr, avr);
 }
 
-static void
-renderpixel_linearburn (SDL_Surface* surface, int x, int y, Uint32 pixel,
-		int factor)
+static inline Uint32
+blendpixel_linearburn (Uint32 dp, Uint32 pixel, int factor,
+		const SDL_PixelFormat *fmt)
 {
-	const SDL_PixelFormat* fmt = surface->format;
-	Uint32* p;
-	Uint32 sp;
 	Uint8 sr, sg, sb;
 	int r, g, b;
 
-	p = (Uint32 *) ((Uint8 *)surface->pixels + y * surface->pitch + x * 4);
-	sp = *p;
-	UNPACK_PIXEL_RGB (sp, fmt, sr, sg, sb);
+	UNPACK_PIXEL_RGB (dp, fmt, sr, sg, sb);
 	UNPACK_PIXEL_RGB (pixel, fmt, r, g, b);
 	r = alpha_blend (sr, linburn_blend (sr, r), factor);
 	g = alpha_blend (sg, linburn_blend (sg, g), factor);
 	b = alpha_blend (sb, linburn_blend (sb, b), factor);
-	*p = PACK_PIXEL_RGB (fmt, r, g, b);
+	return PACK_PIXEL_RGB (fmt, r, g, b);
 }
 
-static void
-renderpixel_desaturate (SDL_Surface *surface, int x, int y, Uint32 pixel,
-		int factor)
+static inline Uint32
+blendpixel_desaturate (Uint32 dp, Uint32 pixel, int factor,
+		const SDL_PixelFormat *fmt)
 {
-	const SDL_PixelFormat* fmt = surface->format;
-	Uint32* p;
-	Uint32 sp;
 	Uint8 sr, sg, sb;
 	int r, g, b;
 	int luma;
 
 	(void) pixel;
 
-	p = (Uint32 *) ((Uint8 *)surface->pixels + y * surface->pitch + x * 4);
-	sp = *p;
-	UNPACK_PIXEL_RGB (sp, fmt, sr, sg, sb);
+	UNPACK_PIXEL_RGB (dp, fmt, sr, sg, sb);
 
 	luma = ((3 * sr + 6 * sg + sb) * 205) >> 11;
 	r = clip_channel(sr + ((factor * (luma - sr)) >> 8));
 	g = clip_channel(sg + ((factor * (luma - sg)) >> 8));
 	b = clip_channel(sb + ((factor * (luma - sb)) >> 8));
 	
-	*p = PACK_PIXEL_RGB (fmt, r, g, b);
+	return PACK_PIXEL_RGB (fmt, r, g, b);
 }
 
 /* Kruzen: special instant blend to transform HD hyperspace ambience to quasispace one */
-static void
-renderpixel_hypertoquasi (SDL_Surface* surface, int x, int y, Uint32 pixel,
-		int factor)
+static inline Uint32
+blendpixel_hypertoquasi (Uint32 dp, Uint32 pixel, int factor,
+		const SDL_PixelFormat *fmt)
 {
-	const SDL_PixelFormat* fmt = surface->format;
-	Uint32* p;
-	Uint32 sp;
 	Uint8 sr, sg, sb;
 	int r, g, b;
 
-	p = (Uint32 *) ((Uint8 *)surface->pixels + y * surface->pitch + x * 4);
-	sp = *p;
-	UNPACK_PIXEL_RGB (sp, fmt, sr, sg, sb);
+	UNPACK_PIXEL_RGB (dp, fmt, sr, sg, sb);
 	UNPACK_PIXEL_RGB (pixel, fmt, r, g, b);
 	g = alpha_blend (sg, ((255 - (((r + g + b) * 341) >> 10)) * 0x78) >> 8, factor);
 	r = alpha_blend (sr, 0, factor);
 	b = alpha_blend (sb, 0, factor);
-	*p = PACK_PIXEL_RGB (fmt, r, g, b);
+	return PACK_PIXEL_RGB (fmt, r, g, b);
 }
 
-RenderPixelFn
-renderpixel_for (SDL_Surface *surface, RenderKind kind, BOOLEAN forMask)
+// Single pixel renderers, used by the line primitives
+
+#define DEFINE_RENDERPIXEL(kind) \
+static void \
+renderpixel_##kind (SDL_Surface *surface, int x, int y, Uint32 pixel, \
+		int factor) \
+{ \
+	Uint32 *p = (Uint32 *) ((Uint8 *)surface->pixels \
+			+ y * surface->pitch + x * 4); \
+	*p = blendpixel_##kind (*p, pixel, factor, surface->format); \
+}
+
+DEFINE_RENDERPIXEL (replace)
+DEFINE_RENDERPIXEL (additive)
+DEFINE_RENDERPIXEL (alpha)
+DEFINE_RENDERPIXEL (multiply)
+DEFINE_RENDERPIXEL (overlay)
+DEFINE_RENDERPIXEL (screen)
+DEFINE_RENDERPIXEL (grayscale)
+DEFINE_RENDERPIXEL (linearburn)
+DEFINE_RENDERPIXEL (desaturate)
+DEFINE_RENDERPIXEL (hypertoquasi)
+
+// Span renderers. Each one is a tight loop over a run of 32bpp
+// destination pixels, specialized for the three source shapes:
+// per-pixel factor (TRANSFER_ALPHA), source row and solid color.
+// With a uniform factor the vector kernel selected by
+// Blend_PrepPlatform() does what it can first.
+
+#define DEFINE_RENDERSPAN(name, kind) \
+static void \
+renderspan_##name (Uint32 *dst, const Uint32 *src, int srcinc, \
+		const Uint8 *factors, int factor, int count, \
+		const SDL_PixelFormat *fmt) \
+{ \
+	int i; \
+	if (factors) \
+	{ \
+		for (i = 0; i < count; ++i, src += srcinc) \
+			dst[i] = blendpixel_##kind (dst[i], *src, factors[i], fmt); \
+	} \
+	else \
+	{ \
+		if (Blend_Funcs->kind) \
+		{ \
+			int done = Blend_Funcs->kind (dst, src, srcinc, factor, count, \
+					fmt); \
+			dst += done; \
+			src += done * srcinc; \
+			count -= done; \
+		} \
+		if (srcinc) \
+		{ \
+			for (i = 0; i < count; ++i) \
+				dst[i] = blendpixel_##kind (dst[i], src[i], factor, fmt); \
+		} \
+		else \
+		{ \
+			const Uint32 color = *src; \
+			for (i = 0; i < count; ++i) \
+				dst[i] = blendpixel_##kind (dst[i], color, factor, fmt); \
+		} \
+	} \
+}
+
+static void
+renderspan_replace (Uint32 *dst, const Uint32 *src, int srcinc,
+		const Uint8 *factors, int factor, int count,
+		const SDL_PixelFormat *fmt)
+{
+	(void) factors; // ignored
+	(void) factor; // ignored
+	(void) fmt;
+
+	if (srcinc)
+	{
+		memcpy (dst, src, count * sizeof (Uint32));
+	}
+	else
+	{
+		const Uint32 color = *src;
+		int i;
+		for (i = 0; i < count; ++i)
+			dst[i] = color;
+	}
+}
+
+DEFINE_RENDERSPAN (alphablend, alpha)
+
+static void
+renderspan_alpha (Uint32 *dst, const Uint32 *src, int srcinc,
+		const Uint8 *factors, int factor, int count,
+		const SDL_PixelFormat *fmt)
+{
+	if (!factors && factor == FULLY_OPAQUE_ALPHA)
+	{	// same as 'replace'
+		renderspan_replace (dst, src, srcinc, NULL, factor, count, fmt);
+		return;
+	}
+	renderspan_alphablend (dst, src, srcinc, factors, factor, count, fmt);
+}
+
+DEFINE_RENDERSPAN (additive, additive)
+DEFINE_RENDERSPAN (multiply, multiply)
+DEFINE_RENDERSPAN (overlay, overlay)
+DEFINE_RENDERSPAN (screen, screen)
+DEFINE_RENDERSPAN (grayscale, grayscale)
+DEFINE_RENDERSPAN (linearburn, linearburn)
+DEFINE_RENDERSPAN (desaturate, desaturate)
+DEFINE_RENDERSPAN (hypertoquasi, hypertoquasi)
+
+static BOOLEAN
+render_supported (SDL_Surface *surface, RenderKind kind, BOOLEAN forMask)
 {
 	const SDL_PixelFormat *fmt = surface->format;
 	// forMask ignores some older conditions
 
 	// The only supported rendering is to 32bpp surfaces
 	if (fmt->BytesPerPixel != 4 && !forMask)
-		return NULL;
+		return FALSE;
 
 	// Rendering other than REPLACE is not supported on RGBA surfaces
 	if (fmt->Amask != 0 && kind != renderReplace && !forMask)
+		return FALSE;
+
+	return TRUE;
+}
+
+RenderPixelFn
+renderpixel_for (SDL_Surface *surface, RenderKind kind, BOOLEAN forMask)
+{
+	if (!render_supported (surface, kind, forMask))
 		return NULL;
 
 	switch (kind)
@@ -513,6 +596,39 @@ renderpixel_for (SDL_Surface *surface, RenderKind kind, BOOLEAN forMask)
 	return NULL;
 }
 
+RenderSpanFn
+renderspan_for (SDL_Surface *surface, RenderKind kind, BOOLEAN forMask)
+{
+	if (!render_supported (surface, kind, forMask))
+		return NULL;
+
+	switch (kind)
+	{
+	case renderReplace:
+		return &renderspan_replace;
+	case renderAdditive:
+		return &renderspan_additive;
+	case renderAlpha:
+		return &renderspan_alpha;
+	case renderMultiply:
+		return &renderspan_multiply;
+	case renderOverlay:
+		return &renderspan_overlay;
+	case renderScreen:
+		return &renderspan_screen;
+	case renderGrayscale:
+		return &renderspan_grayscale;
+	case renderLinearburn:
+		return &renderspan_linearburn;
+	case renderHypToQuas:
+		return &renderspan_hypertoquasi;
+	case renderDesatur:
+		return &renderspan_desaturate;
+	}
+	// should not ever get here
+	return NULL;
+}
+
 /* Line drawing routine
  * Adapted from Paul Heckbert's implementation of Bresenham's algorithm,
  * 3 Sep 85; taken from Graphics Gems I */
@@ -571,7 +687,7 @@ line_prim (int x1, int y1, int x2, int y2, Uint32 color, RenderPixelFn plot,
 }
 
 void
-line_aa_prim (int x1, int y1, int x2, int y2, Uint32 color, RenderPixelFn plot,
+line_aa_prim (int x1, int y1, int x2, int y2, Uint32 color, RenderSpanFn span,
 	int factor, SDL_Surface *dst, BYTE thickness)
 {
 	int d, x, y, ax, ay, sx, sy, dx, dy;
@@ -600,7 +716,7 @@ line_aa_prim (int x1, int y1, int x2, int y2, Uint32 color, RenderPixelFn plot,
 			clip_r.x = x;
 			clip_r.y = y;
 
-			fillrect_prim (clip_r, color, plot, factor, dst);
+			fillrect_prim (clip_r, color, span, factor, dst);
 			
 			if (x == x2)
 				return;
@@ -620,7 +736,7 @@ line_aa_prim (int x1, int y1, int x2, int y2, Uint32 color, RenderPixelFn plot,
 			clip_r.x = x;
 			clip_r.y = y;
 
-			fillrect_prim (clip_r, color, plot, factor, dst);
+			fillrect_prim (clip_r, color, span, factor, dst);
 			
 			if (y == y2)
 				return;
@@ -726,26 +842,20 @@ clip_line (int *lx1, int *ly1, int *lx2, int *ly2, const SDL_Rect *r)
 }
 
 void
-fillrect_prim(SDL_Rect r, Uint32 color, RenderPixelFn plot, int factor,
+fillrect_prim(SDL_Rect r, Uint32 color, RenderSpanFn span, int factor,
 		SDL_Surface *dst)
 {
-	int x, y;
-	int x1, y1;
+	int y;
+	Uint8 *dstrow;
 	SDL_Rect clip_r;
 
 	SDL_GetClipRect (dst, &clip_r);
 	if (!clip_rect (&r, &clip_r))
 		return; // rect is completely outside clipping rectangle
 
-	// TODO: calculate destination pointer directly instead of
-	//   using the plot(x,y) version
-	x1 = r.x + r.w;
-	y1 = r.y + r.h;
-	for (y = r.y; y < y1; ++y)
-	{
-		for (x = r.x; x < x1; ++x)
-			plot(dst, x, y, color, factor);
-	}
+	dstrow = (Uint8 *)dst->pixels + r.y * dst->pitch + r.x * 4;
+	for (y = 0; y < r.h; ++y, dstrow += dst->pitch)
+		span ((Uint32 *)dstrow, &color, 0, NULL, factor, r.w, dst->format);
 }
 
 // clip the rectangle against the clip rectangle
@@ -791,8 +901,185 @@ clip_rect(SDL_Rect *r, const SDL_Rect *clip_r)
 	return 1;
 }
 
+// Custom blits are processed in runs of non-transparent pixels. Runs
+// are at most this long, so that the source pixels converted to the
+// destination format fit in a stack buffer.
+#define BLT_SPAN_MAX 256
+
+// 8bpp paletted source; 'lut' holds the palette in destination format
+static void
+blt_row_pal8 (const Uint8 *src, Uint32 *dst, int w, Uint32 key,
+		const Uint32 *lut, const Uint8 *alut, RenderSpanFn span, int factor,
+		const SDL_PixelFormat *dstfmt)
+{
+	Uint32 buf[BLT_SPAN_MAX];
+	Uint8 alphas[BLT_SPAN_MAX];
+	const BOOLEAN transfer = (factor == TRANSFER_ALPHA);
+	int x = 0;
+	int i, n;
+
+	while (x < w)
+	{
+		const Uint8 *run;
+		
+		// paletted colorkey does not use mask
+		while (x < w && src[x] == key)
+			++x; // transparent pixels
+
+		run = src + x;
+		for (n = 0; x < w && n < BLT_SPAN_MAX && src[x] != key; ++x, ++n)
+			;
+		if (n == 0)
+			continue;
+
+		for (i = 0; i < n; ++i)
+			buf[i] = lut[run[i]];
+		if (transfer)
+		{
+			for (i = 0; i < n; ++i)
+				alphas[i] = alut[run[i]];
+		}
+
+		span (dst + x - n, buf, 1, transfer ? alphas : NULL, factor, n,
+				dstfmt);
+	}
+}
+
+// 32bpp RGB(A) source
+static void
+blt_row_rgb32 (const Uint32 *src, Uint32 *dst, int w, Uint32 mask,
+		Uint32 key, const SDL_PixelFormat *srcfmt, RenderSpanFn span,
+		int factor, const SDL_PixelFormat *dstfmt)
+{
+	Uint32 buf[BLT_SPAN_MAX];
+	Uint8 alphas[BLT_SPAN_MAX];
+	const BOOLEAN transfer = (factor == TRANSFER_ALPHA);
+	const BOOLEAN sameRGB = srcfmt->Rmask == dstfmt->Rmask
+			&& srcfmt->Gmask == dstfmt->Gmask
+			&& srcfmt->Bmask == dstfmt->Bmask;
+	const Uint32 rgbmask = dstfmt->Rmask | dstfmt->Gmask | dstfmt->Bmask;
+	// Unused bits are not guaranteed to be clear in the source, so it
+	// can only be used as-is when every bit belongs to a channel
+	const BOOLEAN sameFormat = sameRGB && srcfmt->Amask == dstfmt->Amask
+			&& (rgbmask | dstfmt->Amask) == 0xffffffff;
+	int x = 0;
+	int i, n;
+
+	while (x < w)
+	{
+		const Uint32 *run;
+
+		// RGB(A) colorkey uses mask
+		while (x < w && (src[x] & mask) == key)
+			++x; // transparent pixels
+
+		run = src + x;
+		for (n = 0; x < w && n < BLT_SPAN_MAX && (src[x] & mask) != key;
+				++x, ++n)
+			;
+		if (n == 0)
+			continue;
+
+		if (transfer)
+		{
+			if (srcfmt->Amask)
+			{
+				for (i = 0; i < n; ++i)
+					alphas[i] = (run[i] >> srcfmt->Ashift) & 0xff;
+			}
+			else
+			{
+				memset (alphas, FULLY_OPAQUE_ALPHA, n);
+			}
+		}
+
+		// convert pixel format to destination
+		if (sameFormat)
+		{	// nothing to convert, blend straight from the source
+		}
+		else if (sameRGB)
+		{
+			if (dstfmt->Amask && srcfmt->Amask)
+			{
+				for (i = 0; i < n; ++i)
+					buf[i] = (run[i] & rgbmask) | (((run[i] >> srcfmt->Ashift)
+							& 0xff) << dstfmt->Ashift);
+			}
+			else if (dstfmt->Amask)
+			{
+				for (i = 0; i < n; ++i)
+					buf[i] = (run[i] & rgbmask) | dstfmt->Amask;
+			}
+			else
+			{
+				for (i = 0; i < n; ++i)
+					buf[i] = run[i] & rgbmask;
+			}
+			run = buf;
+		}
+		else
+		{
+			for (i = 0; i < n; ++i)
+			{
+				Uint8 r, g, b, a;
+				SDL_GetRGBA (run[i], srcfmt, &r, &g, &b, &a);
+				buf[i] = SDL_MapRGBA (dstfmt, r, g, b, a);
+			}
+			run = buf;
+		}
+
+		span (dst + x - n, run, 1, transfer ? alphas : NULL, factor, n,
+				dstfmt);
+	}
+}
+
+// Any other source format; pixels are fetched one at a time
+static void
+blt_row_generic (SDL_Surface *src, int sx, int sy, Uint32 *dst, int w,
+		Uint32 mask, Uint32 key, RenderSpanFn span, int factor,
+		const SDL_PixelFormat *dstfmt)
+{
+	Uint32 buf[BLT_SPAN_MAX];
+	Uint8 alphas[BLT_SPAN_MAX];
+	const SDL_PixelFormat *srcfmt = src->format;
+	const BOOLEAN transfer = (factor == TRANSFER_ALPHA);
+	GetPixelFn getpix = getpixel_for (src);
+	int x, n = 0;
+
+	for (x = 0; x <= w; ++x)
+	{
+		Uint8 r, g, b, a;
+		Uint32 p = 0;
+		BOOLEAN transparent = TRUE;
+
+		if (x < w)
+		{
+			p = getpix (src, sx + x, sy);
+			if (srcfmt->palette)
+				transparent = (p == key);
+			else
+				transparent = ((p & mask) == key);
+		}
+
+		if (transparent || n == BLT_SPAN_MAX)
+		{	// flush the pending run
+			if (n)
+				span (dst + x - n, buf, 1, transfer ? alphas : NULL,
+						factor, n, dstfmt);
+			n = 0;
+		}
+		if (transparent)
+			continue;
+
+		SDL_GetRGBA (p, srcfmt, &r, &g, &b, &a);
+		buf[n] = SDL_MapRGBA (dstfmt, r, g, b, a);
+		alphas[n] = a;
+		++n;
+	}
+}
+
 void
-blt_prim (SDL_Surface *src, SDL_Rect src_r, RenderPixelFn plot, int factor,
+blt_prim (SDL_Surface *src, SDL_Rect src_r, RenderSpanFn span, int factor,
 			SDL_Surface *dst, SDL_Rect dst_r)
 {
 	SDL_PixelFormat *srcfmt = src->format;
@@ -800,9 +1087,10 @@ blt_prim (SDL_Surface *src, SDL_Rect src_r, RenderPixelFn plot, int factor,
 	SDL_PixelFormat *dstfmt = dst->format;
 	Uint32 mask = 0;
 	Uint32 key = ~0;
-	GetPixelFn getpix = getpixel_for(src);
 	SDL_Rect clip_r;
-	int x, y;
+	Uint8 *srcrow;
+	Uint8 *dstrow;
+	int y;
 
 	SDL_GetClipRect (dst, &clip_r);
 	if (!clip_blt_rects (&src_r, &dst_r, &clip_r))
@@ -826,55 +1114,72 @@ blt_prim (SDL_Surface *src, SDL_Rect src_r, RenderPixelFn plot, int factor,
 	{
 		mask = ~0;
 	}
-	// TODO: calculate the source and destination pointers directly
-	//   instead of using the plot(x,y) version
-	for (y = 0; y < src_r.h; ++y)
+
+	// Kruzen: source pixel alpha is handled via TRANSFER_ALPHA flag;
+	//   the row loops pass it to span() as the per-pixel factor
+	srcrow = (Uint8 *)src->pixels + src_r.y * src->pitch
+			+ src_r.x * srcfmt->BytesPerPixel;
+	dstrow = (Uint8 *)dst->pixels + dst_r.y * dst->pitch + dst_r.x * 4;
+
+	if (srcpal && srcfmt->BytesPerPixel == 1)
 	{
-		for (x = 0; x < src_r.w; ++x)
-		{
-			Uint8 r, g, b, a;
-			Uint32 p;
-			
-			p = getpix(src, src_r.x + x, src_r.y + y);
-			if (srcpal)
-			{	// source is paletted, colorkey does not use mask
-				if (p == key)
-					continue; // transparent pixel
-			}
-			else
-			{	// source is RGB(A), colorkey uses mask
-				if ((p & mask) == key)
-					continue; // transparent pixel
-			}
+		Uint32 lut[256];
+		Uint8 alut[256];
+		int i;
 
-			// convert pixel format to destination
-			SDL_GetRGBA (p, srcfmt, &r, &g, &b, &a);
-			// TODO: handle source pixel alpha; plot() should probably
-			//   get a source alpha parameter
-			// Kruzen: Done via TRANSFER_ALPHA flag, although a bit ugly
-			p = SDL_MapRGBA (dstfmt, r, g, b, a);
+		// Palette entries past ncolors read as transparent black,
+		// same as SDL_GetRGBA() does
+		for (i = 0; i < 256; ++i)
+		{
+			SDL_Color c = {0, 0, 0, 0};
+			if (i < srcpal->ncolors)
+				c = srcpal->colors[i];
+			lut[i] = SDL_MapRGBA (dstfmt, c.r, c.g, c.b, c.a);
+			alut[i] = c.a;
+		}
 
-			plot(dst, dst_r.x + x, dst_r.y + y, p, factor == TRANSFER_ALPHA ? a : factor);
+		for (y = 0; y < src_r.h; ++y)
+		{
+			blt_row_pal8 (srcrow, (Uint32 *)dstrow, src_r.w, key, lut, alut,
+					span, factor, dstfmt);
+			srcrow += src->pitch;
+			dstrow += dst->pitch;
+		}
+	}
+	else if (!srcpal && srcfmt->BytesPerPixel == 4)
+	{
+		for (y = 0; y < src_r.h; ++y)
+		{
+			blt_row_rgb32 ((Uint32 *)srcrow, (Uint32 *)dstrow, src_r.w,
+					mask, key, srcfmt, span, factor, dstfmt);
+			srcrow += src->pitch;
+			dstrow += dst->pitch;
+		}
+	}
+	else
+	{
+		for (y = 0; y < src_r.h; ++y)
+		{
+			blt_row_generic (src, src_r.x, src_r.y + y, (Uint32 *)dstrow,
+					src_r.w, mask, key, span, factor, dstfmt);
+			dstrow += dst->pitch;
 		}
 	}
 }
 
 // Kruzen: Special blits to permanently transform base image. To restore it - unload it from RAM and load again
 void
-blt_filtered_prim (SDL_Surface *layer, RenderPixelFn plot, int factor,
+blt_filtered_prim (SDL_Surface *layer, RenderSpanFn span, int factor,
 			SDL_Surface *base, Color *fill)
 {
 	SDL_PixelFormat *lrfmt = layer->format;
 	SDL_PixelFormat *bsfmt = base->format;
-	GetPixelFn getpix;
 	Uint32 color = 0;
 	int x, y;
 
 	// Cannot process surfaces of different formats
 	if (lrfmt->BytesPerPixel != bsfmt->BytesPerPixel)
 		return;
-	else
-		getpix = getpixel_for (layer);// For both layer and base
 
 	// For paletted
 	if (lrfmt->palette)
@@ -886,59 +1191,80 @@ blt_filtered_prim (SDL_Surface *layer, RenderPixelFn plot, int factor,
 
 		for (y = 0; y < base->h; ++y)
 		{
+			const Uint8 *lp = (Uint8 *)layer->pixels + y * layer->pitch;
+			Uint8 *bp = (Uint8 *)base->pixels + y * base->pitch;
+
 			for (x = 0; x < base->w; ++x)
 			{
-				Uint32 lp;
-				Uint8 *bp;
-
-				lp = getpix (layer, x, y);
-				bp = ((Uint8*)base->pixels + y * base->pitch + x);
-
-				if (lp == lkey || *bp == bkey)
+				if (lp[x] == lkey || bp[x] == bkey)
 					continue;
 
-				*bp = lp;
+				bp[x] = lp[x];
 			}
 		}
 	}
 	else
 	{// For truecolor
+		const BOOLEAN transfer = (factor == TRANSFER_ALPHA);
+		Uint32 saved[BLT_SPAN_MAX];
+		Uint8 alphas[BLT_SPAN_MAX];
+
 		if (fill)
 			color = SDL_MapRGB (bsfmt, fill->r, fill->g, fill->b);
 
 		for (y = 0; y < base->h; ++y)
 		{
-			for (x = 0; x < base->w; ++x)
-			{
-				Uint8 al, ab;
-				Uint32 lp;
-				Uint32 *bp;
-			
-				lp = getpix (layer, x, y);
-				bp = (Uint32 *) ((Uint8 *)base->pixels + y * base->pitch + x * 4);
-			
-				if ((lp & lrfmt->Amask) == 0 || (*bp & bsfmt->Amask) == 0)
-					continue; // transparent pixel
-
-				al = (lp >> (lrfmt->Ashift)) & 0xFF;
-				ab = (*bp >> (bsfmt->Ashift)) & 0xFF;
+			const Uint32 *lp = (Uint32 *) ((Uint8 *)layer->pixels
+					+ y * layer->pitch);
+			Uint32 *bp = (Uint32 *) ((Uint8 *)base->pixels
+					+ y * base->pitch);
 
-				plot (base, x, y, fill ? color : lp, 
-						factor == TRANSFER_ALPHA ? al : factor);
+			x = 0;
+			while (x < base->w)
+			{
+				int i, n, start;
+
+				while (x < base->w && ((lp[x] & lrfmt->Amask) == 0
+						|| (bp[x] & bsfmt->Amask) == 0))
+					++x; // transparent pixels
+
+				start = x;
+				for (n = 0; x < base->w && n < BLT_SPAN_MAX
+						&& (lp[x] & lrfmt->Amask) != 0
+						&& (bp[x] & bsfmt->Amask) != 0; ++x, ++n)
+					;
+				if (n == 0)
+					continue;
 
-				// Reapply alpha to pixel since every plot function nukes it
-				*bp &= ~(bsfmt->Amask);
-				*bp |= ((Uint32)ab << (bsfmt->Ashift));
+				for (i = 0; i < n; ++i)
+					saved[i] = bp[start + i] & bsfmt->Amask;
+				if (transfer)
+				{
+					for (i = 0; i < n; ++i)
+						alphas[i] = (lp[start + i] >> lrfmt->Ashift) & 0xFF;
+				}
+
+				if (fill)
+					span (bp + start, &color, 0, transfer ? alphas : NULL,
+							factor, n, bsfmt);
+				else
+					span (bp + start, lp + start, 1,
+							transfer ? alphas : NULL, factor, n, bsfmt);
+
+				// Reapply alpha to pixels since every span function nukes it
+				for (i = 0; i < n; ++i)
+					bp[start + i] = (bp[start + i] & ~bsfmt->Amask) | saved[i];
 			}
 		}
 	}
 }
 
 void
-blt_filtered_fill (SDL_Surface *base, RenderPixelFn plot, int factor,
+blt_filtered_fill (SDL_Surface *base, RenderSpanFn span, int factor,
 			Color *fill)
 {
 	SDL_PixelFormat *fmt = base->format;
+	Uint32 saved[BLT_SPAN_MAX];
 	int x, y;
 	Uint32 color;
 
@@ -950,23 +1276,31 @@ blt_filtered_fill (SDL_Surface *base, RenderPixelFn plot, int factor,
 
 	for (y = 0; y < base->h; ++y)
 	{
-		for (x = 0; x < base->w; ++x)
+		Uint32 *p = (Uint32 *) ((Uint8 *)base->pixels + y * base->pitch);
+
+		x = 0;
+		while (x < base->w)
 		{
-			Uint8 a;
-			Uint32 *p;
-			
-			p = (Uint32 *) ((Uint8 *)base->pixels + y * base->pitch + x * 4);
-			
-			if ((*p & fmt->Amask) == 0)
-				continue; // transparent pixel
+			int i, n, start;
+
+			while (x < base->w && (p[x] & fmt->Amask) == 0)
+				++x; // transparent pixels
+
+			start = x;
+			for (n = 0; x < base->w && n < BLT_SPAN_MAX
+					&& (p[x] & fmt->Amask) != 0; ++x, ++n)
+				;
+			if (n == 0)
+				continue;
 
-			a = (*p >> (fmt->Ashift)) & 0xFF;			
+			for (i = 0; i < n; ++i)
+				saved[i] = p[start + i] & fmt->Amask;
 
-			plot (base, x, y, color, factor);
+			span (p + start, &color, 0, NULL, factor, n, fmt);
 
-			// Reapply alpha to pixel since every plot function nukes it
-			*p &= ~(fmt->Amask);
-			*p |= ((Uint32)a << (fmt->Ashift));
+			// Reapply alpha to pixels since every span function nukes it
+			for (i = 0; i < n; ++i)
+				p[start + i] = (p[start + i] & ~fmt->Amask) | saved[i];
 		}
 	}
 }
@@ -53,19 +53,30 @@ typedef void (*RenderPixelFn)(SDL_Surface *, int x, int y, Uint32 pixel,
 
 RenderPixelFn renderpixel_for(SDL_Surface *surface, RenderKind kind, BOOLEAN forMask);
 
+// Renders a horizontal run of 'count' 32bpp pixels starting at 'dst'.
+// 'src' is in destination surface format; 'srcinc' is 1 to read a row
+// of source pixels or 0 to repeat the single pixel *src (solid fill).
+// When 'factors' is not NULL it supplies a per-pixel factor which is
+// used instead of 'factor' (see TRANSFER_ALPHA).
+typedef void (*RenderSpanFn)(Uint32 *dst, const Uint32 *src, int srcinc,
+		const Uint8 *factors, int factor, int count,
+		const SDL_PixelFormat *fmt);
+
+RenderSpanFn renderspan_for(SDL_Surface *surface, RenderKind kind, BOOLEAN forMask);
+
 void line_prim(int x1, int y1, int x2, int y2, Uint32 color,
 		RenderPixelFn plot, int factor, SDL_Surface *dst);
 void line_aa_prim(int x1, int y1, int x2, int y2, Uint32 color,
-		RenderPixelFn plot,	int factor, SDL_Surface* dst,
+		RenderSpanFn span, int factor, SDL_Surface* dst,
 		BYTE thickness);
 void fillrect_prim(SDL_Rect r, Uint32 color,
-		RenderPixelFn plot, int factor, SDL_Surface *dst);
+		RenderSpanFn span, int factor, SDL_Surface *dst);
 void blt_prim(SDL_Surface *src, SDL_Rect src_r,
-		RenderPixelFn plot, int factor,
+		RenderSpanFn span, int factor,
 		SDL_Surface *dst, SDL_Rect dst_r);
-void blt_filtered_prim(SDL_Surface *layer, RenderPixelFn plot, int factor,
+void blt_filtered_prim(SDL_Surface *layer, RenderSpanFn span, int factor,
 		SDL_Surface *base, Color *fill);
-void blt_filtered_fill(SDL_Surface *base, RenderPixelFn plot, int factor,
+void blt_filtered_fill(SDL_Surface *base, RenderSpanFn span, int factor,
 		Color *fill);
 void blt_filtered_pal(SDL_Surface *layer, SDL_Surface *base, Color *fill);
 
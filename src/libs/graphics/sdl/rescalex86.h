@@ -0,0 +1,298 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+// x86 bilinear and trilinear rescale kernels
+//  Template
+//    #included by blend_sse2.c and blend_avx2.c before blendx86.h,
+//    with the same V_xxx operations plus the few listed below.
+//
+//  Every 128-bit lane holds the 2x2 source pixels ("quad") of one
+//  destination pixel: the top pair in the low half and the bottom pair
+//  in the high half. The math follows the plain C code in canvas.c
+//  step by step so the results are identical:
+//    dot_product_8_4()    -> QuadDot: rounded 8-bit products of words
+//    weight_product_8_4() -> QuadWeighted: 32-bit sums and a float
+//        division; the quotient is never closer than 1/(255 * 1020)
+//        to the next integer, so truncating it is exact
+//    blend_ratio_2()      -> QuadMix: c1 * r + c2 * (256 - r) fits in
+//        unsigned 16 bits for 0 <= r <= 256
+//
+//  Extra operations:
+//    V_LOAD_QUADS(p0, p1, pitch), V_SET_LANES_32(l0, l1), V_UNPACKLO_32,
+//    V_BSRLI_8 (shift each lane right by 8 bytes), V_CMPEQ_32,
+//    V_MOVEMASK_32, and the float VECF, VF_FROM_I32, VF_TO_I32, VF_DIV.
+
+#ifndef BLEND_
+#	error "rescalex86.h is a template and must be #included"
+#endif
+
+#define RESCALE_QUADS (VEC_PIXELS / 4)
+
+// The pixel of every lane, left in its low dword
+BLEND_FN static inline VEC
+BLEND_(QuadDot) (VEC q, VEC wtop, VEC wbot)
+{
+	const VEC zero = V_ZERO ();
+	const VEC c128 = V_SET1_16 (0x80);
+	VEC t, b;
+
+	// word pairs w0 w1 -> w0 w0 w0 w0 w1 w1 w1 w1
+	wtop = V_UNPACKLO_16 (wtop, wtop);
+	wtop = V_UNPACKLO_32 (wtop, wtop);
+	wbot = V_UNPACKLO_16 (wbot, wbot);
+	wbot = V_UNPACKLO_32 (wbot, wbot);
+
+	t = V_SRLI_16 (V_ADD_16 (V_MULLO_16 (V_UNPACKLO_8 (q, zero), wtop),
+			c128), 8);
+	b = V_SRLI_16 (V_ADD_16 (V_MULLO_16 (V_UNPACKHI_8 (q, zero), wbot),
+			c128), 8);
+	t = V_ADD_16 (t, b);
+	t = V_ADD_16 (t, V_BSRLI_8 (t));
+	// the sum is stored as a Uint8
+	t = V_AND (t, V_SET1_16 (0xff));
+	return V_PACKUS_16 (t, t);
+}
+
+BLEND_FN static inline VEC
+BLEND_(QuadWeighted) (VEC q, VEC wtop, VEC wbot, VECF wsum)
+{
+	const VEC zero = V_ZERO ();
+	VEC t = V_UNPACKLO_8 (q, zero);
+	VEC b = V_UNPACKHI_8 (q, zero);
+	VEC s;
+
+	// words c(p0) c(p1) for every channel
+	t = V_UNPACKLO_16 (t, V_BSRLI_8 (t));
+	b = V_UNPACKLO_16 (b, V_BSRLI_8 (b));
+	s = V_ADD_32 (V_MADD_16 (t, wtop), V_MADD_16 (b, wbot));
+	s = VF_TO_I32 (VF_DIV (VF_FROM_I32 (s), wsum));
+	s = V_PACKS_32 (s, s);
+	return V_PACKUS_16 (s, s);
+}
+
+BLEND_FN static inline VEC
+BLEND_(QuadMix) (VEC c1, VEC c2, VEC ratio, VEC nratio)
+{
+	const VEC zero = V_ZERO ();
+	VEC m;
+
+	c1 = V_UNPACKLO_8 (c1, zero);
+	c2 = V_UNPACKLO_8 (c2, zero);
+	m = V_SRLI_16 (V_ADD_16 (V_MULLO_16 (c1, ratio),
+			V_MULLO_16 (c2, nratio)), 8);
+	return V_PACKUS_16 (m, m);
+}
+
+// Weights of the quad as in canvas.c: btable[a][b] = (a * b + 128) >> 8
+#define RESCALE_WEIGHTS(u, v, w) \
+	do { \
+		(w)[0] = ((255 - (u)) * (255 - (v)) + 0x80) >> 8; \
+		(w)[1] = ((u) * (255 - (v)) + 0x80) >> 8; \
+		(w)[2] = ((255 - (u)) * (v) + 0x80) >> 8; \
+		(w)[3] = ((u) * (v) + 0x80) >> 8; \
+	} while (0)
+
+// Loads the quads of the next RESCALE_QUADS pixels of image 'i' and
+// drops the non-present pixels. The weights go into word pairs,
+// w0 | w1 << 16 for the top and w2 | w3 << 16 for the bottom; 'zwt',
+// 'zwb' and 'zsum' have the non-present pixels weighted 0.
+#define RESCALE_LOAD(i, q, wt, wb, zwt, zwb, zsum) \
+	do { \
+		const Uint8 *p[RESCALE_QUADS]; \
+		int w[4]; \
+		Uint32 pt[RESCALE_QUADS], pb[RESCALE_QUADS]; \
+		Uint32 zpt[RESCALE_QUADS], zpb[RESCALE_QUADS]; \
+		VEC keyed; \
+		int absent; \
+		int g; \
+		for (g = 0; g < RESCALE_QUADS; ++g) \
+		{ \
+			const int sx = sx##i + g * row->fsx[i]; \
+			p[g] = row->row[i] + (sx >> 16) * 4; \
+		} \
+		q = V_LOAD_QUADS (p[0], p[RESCALE_QUADS - 1], row->pitch[i]); \
+		keyed = V_CMPEQ_32 (V_AND (q, mk##i), ck##i); \
+		absent = V_MOVEMASK_32 (keyed); \
+		q = V_ANDNOT (keyed, V_OR (q, solid##i)); \
+		for (g = 0; g < RESCALE_QUADS; ++g, absent >>= 4) \
+		{ \
+			const int sx = sx##i + g * row->fsx[i]; \
+			const int u = (sx >> 8) & 0xff; \
+			int sum; \
+			RESCALE_WEIGHTS (u, row->v[i], w); \
+			pt[g] = w[0] | (w[1] << 16); \
+			pb[g] = w[2] | (w[3] << 16); \
+			/* no blending with non-present pixels */ \
+			if (absent & 1) w[0] = 0; \
+			if (absent & 2) w[1] = 0; \
+			if (absent & 4) w[2] = 0; \
+			if (absent & 8) w[3] = 0; \
+			zpt[g] = w[0] | (w[1] << 16); \
+			zpb[g] = w[2] | (w[3] << 16); \
+			sum = w[0] + w[1] + w[2] + w[3]; \
+			/* the weighted result is unused with no weight */ \
+			zsum[g] = sum ? sum : 1; \
+		} \
+		wt = V_SET_LANES_32 ((int)pt[0], (int)pt[RESCALE_QUADS - 1]); \
+		wb = V_SET_LANES_32 ((int)pb[0], (int)pb[RESCALE_QUADS - 1]); \
+		zwt = V_SET_LANES_32 ((int)zpt[0], (int)zpt[RESCALE_QUADS - 1]); \
+		zwb = V_SET_LANES_32 ((int)zpb[0], (int)zpb[RESCALE_QUADS - 1]); \
+		sx##i += RESCALE_QUADS * row->fsx[i]; \
+	} while (0)
+
+#define RESCALE_SETUP(i) \
+	const VEC mk##i = V_SET1_32 ((int)row->mk[i]); \
+	const VEC ck##i = V_SET1_32 ((int)row->ck[i]); \
+	const VEC solid##i = V_SET1_32 ((int)row->solid[i]); \
+	int sx##i = row->sx[i]
+
+BLEND_FN static int
+BLEND_(RescaleBilinear) (const Blend_RescaleRow *row)
+{
+	const int alpha_threshold = row->dst_has_alpha ? 0 : 127;
+	const int ashift = row->ashift;
+	Uint32 *dst = row->dst;
+	RESCALE_SETUP (0);
+	int x;
+
+	for (x = 0; x + RESCALE_QUADS <= row->count; x += RESCALE_QUADS)
+	{
+		VEC q, wt, wb, zwt, zwb;
+		int zsum[RESCALE_QUADS];
+		Uint32 dot[VEC_PIXELS];
+		Uint32 wgt[VEC_PIXELS];
+		int g;
+
+		RESCALE_LOAD (0, q, wt, wb, zwt, zwb, zsum);
+
+		V_STORE (dot, BLEND_(QuadDot) (q, wt, wb));
+		if (row->dst_has_alpha)
+		{
+			const VECF sums = VF_FROM_I32 (V_SET_LANES_32 (
+					zsum[0], zsum[RESCALE_QUADS - 1]));
+			V_STORE (wgt, BLEND_(QuadWeighted) (q, zwt, zwb, sums));
+		}
+
+		for (g = 0; g < RESCALE_QUADS; ++g, ++dst)
+		{
+			const Uint32 d = dot[g * 4];
+			Uint32 a = (d >> ashift) & 0xff;
+
+			if ((int)a <= alpha_threshold)
+				*dst = row->transparent;
+			else if (!row->dst_has_alpha)
+				*dst = d & row->rgbmask;
+			else
+			{
+				if (a > 0xf8)
+					a = 0xff;
+				*dst = (wgt[g * 4] & row->rgbmask) | (a << ashift);
+			}
+		}
+	}
+
+	return x;
+}
+
+BLEND_FN static int
+BLEND_(RescaleTrilinear) (const Blend_RescaleRow *row)
+{
+	const int alpha_threshold = row->dst_has_alpha ? 0 : 127;
+	const int ashift = row->ashift;
+	const VEC ratio = V_SET1_16 (row->ratio);
+	const VEC nratio = V_SET1_16 (256 - row->ratio);
+	Uint32 *dst = row->dst;
+	RESCALE_SETUP (0);
+	RESCALE_SETUP (1);
+	int x;
+
+	if (row->ratio < 0 || row->ratio > 256)
+		return 0;
+
+	for (x = 0; x + RESCALE_QUADS <= row->count; x += RESCALE_QUADS)
+	{
+		VEC q0, wt0, wb0, zwt0, zwb0;
+		VEC q1, wt1, wb1, zwt1, zwb1;
+		VEC d0, d1;
+		int zsum0[RESCALE_QUADS];
+		int zsum1[RESCALE_QUADS];
+		Uint32 dot0[VEC_PIXELS];
+		Uint32 dot1[VEC_PIXELS];
+		Uint32 mix[VEC_PIXELS];
+		Uint32 wgt0[VEC_PIXELS];
+		Uint32 wgt1[VEC_PIXELS];
+		Uint32 wmix[VEC_PIXELS];
+		int g;
+
+		RESCALE_LOAD (0, q0, wt0, wb0, zwt0, zwb0, zsum0);
+		RESCALE_LOAD (1, q1, wt1, wb1, zwt1, zwb1, zsum1);
+
+		d0 = BLEND_(QuadDot) (q0, wt0, wb0);
+		d1 = BLEND_(QuadDot) (q1, wt1, wb1);
+		V_STORE (dot0, d0);
+		V_STORE (dot1, d1);
+		V_STORE (mix, BLEND_(QuadMix) (d0, d1, ratio, nratio));
+		if (row->dst_has_alpha)
+		{
+			const VECF sums0 = VF_FROM_I32 (V_SET_LANES_32 (
+					zsum0[0], zsum0[RESCALE_QUADS - 1]));
+			const VECF sums1 = VF_FROM_I32 (V_SET_LANES_32 (
+					zsum1[0], zsum1[RESCALE_QUADS - 1]));
+			VEC w0 = BLEND_(QuadWeighted) (q0, zwt0, zwb0, sums0);
+			VEC w1 = BLEND_(QuadWeighted) (q1, zwt1, zwb1, sums1);
+			V_STORE (wgt0, w0);
+			V_STORE (wgt1, w1);
+			V_STORE (wmix, BLEND_(QuadMix) (w0, w1, ratio, nratio));
+		}
+
+		for (g = 0; g < RESCALE_QUADS; ++g, ++dst)
+		{
+			const Uint32 a0 = (dot0[g * 4] >> ashift) & 0xff;
+			const Uint32 a1 = (dot1[g * 4] >> ashift) & 0xff;
+			Uint32 res_a = (mix[g * 4] >> ashift) & 0xff;
+			Uint32 c;
+
+			if ((int)res_a <= alpha_threshold)
+			{
+				*dst = row->transparent;
+				continue;
+			}
+			else if (!row->dst_has_alpha)
+			{
+				*dst = mix[g * 4] & row->rgbmask;
+				continue;
+			}
+
+			if (a0 != 0 && a1 != 0)
+				c = wmix[g * 4];
+			else if (a1 != 0)
+				c = wgt1[g * 4];
+			else
+				c = wgt0[g * 4];
+
+			if (res_a > 0xf8)
+				res_a = 0xff;
+			*dst = (c & row->rgbmask) | (res_a << ashift);
+		}
+	}
+
+	return x;
+}
+
+#undef RESCALE_SETUP
+#undef RESCALE_LOAD
+#undef RESCALE_WEIGHTS
+#undef RESCALE_QUADS
@@ -21,6 +21,7 @@
 #include "scalers.h"
 #include "scaleint.h"
 #include "2xscalers.h"
+#include "nxscalers.h"
 #ifdef USE_PLATFORM_ACCEL
 #	ifndef __APPLE__
 	// MacOS X framework has no SDL_cpuinfo.h for some reason
@@ -196,6 +197,17 @@ Scale_PlatDefs[] =
 };
 
 
+// the enlargement done by the software scalers
+int
+Scale_GetFactor (int flags)
+{
+	if (flags & TFB_GFXFLAGS_SCALE_4X)
+		return 4;
+	else if (flags & TFB_GFXFLAGS_SCALE_3X)
+		return 3;
+	return 2;
+}
+
 TFB_ScaleFunc
 Scale_PrepPlatform (int flags, const SDL_PixelFormat* fmt)
 {
@@ -274,10 +286,19 @@ Scale_PrepPlatform (int flags, const SDL_PixelFormat* fmt)
 			pdef->platform != Scale_Platform && pdef->platform != SCALEPLAT_NULL;
 			++pdef)
 		;
+	fdef = pdef->funcdefs;
+	// The 3x and 4x scalers only come in plain C
+	switch (Scale_GetFactor (flags))
+	{
+		case 3:
+			fdef = Scale_3x_Functions;
+			break;
+		case 4:
+			fdef = Scale_4x_Functions;
+			break;
+	}
 	// Next find the right function
-	for (fdef = pdef->funcdefs;
-			(flags & fdef->flag) != fdef->flag;
-			++fdef)
+	for (; (flags & fdef->flag) != fdef->flag; ++fdef)
 		;
 
 	return fdef->func;
@@ -22,6 +22,7 @@ void Scale_Init (void);
 typedef void (* TFB_ScaleFunc) (SDL_Surface *src, SDL_Surface *dst,
 				SDL_Rect *r);
 
+int Scale_GetFactor (int flags);
 TFB_ScaleFunc Scale_PrepPlatform (int flags, const SDL_PixelFormat* fmt);
 
 #endif /* SCALERS_H_ */
@@ -22,12 +22,14 @@
 #include "uqmversion.h"
 #include "png2sdl.h"
 #include "options.h"
+#include "libs/timelib.h"
 
 typedef struct tfb_sdl2_screeninfo_s {
 	SDL_Surface *scaled;
 	SDL_Texture *texture;
 	BOOLEAN dirty, active;
-	SDL_Rect updated;
+	int num_updated;
+	SDL_Rect updated[TFB_BBOX_MAX_RECTS];
 } TFB_SDL2_SCREENINFO;
 
 static TFB_SDL2_SCREENINFO SDL2_Screens[TFB_GFX_NUMSCREENS];
@@ -37,6 +39,15 @@ static SDL_Renderer *renderer = NULL;
 static const char* rendererBackend = NULL;
 
 static TFB_ScaleFunc scaler = NULL;
+static int scaleFactor = 2;
+
+// Texture upload statistics, logged with the FPS
+#define UPLOAD_STATS_PERIOD ONE_SECOND
+static Uint32 uploadFrameBytes;
+static Uint32 uploadFrameRects;
+static Uint32 uploadPeriodBytes;
+static Uint32 uploadPeriodFrames;
+static TimeCount uploadPeriodStart;
 
 #if SDL_BYTEORDER == SDL_BIG_ENDIAN
 #define A_MASK 0xff000000
@@ -282,6 +293,7 @@ TFB_Pure_ConfigureVideo (int driver, int flags, int width, int height,
 
 	if (GfxFlags & TFB_GFXFLAGS_SCALE_SOFT_ONLY)
 	{
+		scaleFactor = Scale_GetFactor (flags);
 		for (i = 0; i < TFB_GFX_NUMSCREENS; i++)
 		{
 			if (!SDL2_Screens[i].active)
@@ -289,7 +301,8 @@ TFB_Pure_ConfigureVideo (int driver, int flags, int width, int height,
 				continue;
 			}
 			if (0 != ReInit_Screen(&SDL2_Screens[i].scaled,
-					CanvasWidth * 2, CanvasHeight * 2))
+					CanvasWidth * scaleFactor,
+					CanvasHeight * scaleFactor))
 			{
 				return -1;
 			}
@@ -300,7 +313,8 @@ TFB_Pure_ConfigureVideo (int driver, int flags, int width, int height,
 			}
 			SDL2_Screens[i].texture = SDL_CreateTexture (renderer,
 					SDL_PIXELFORMAT_RGBX8888, SDL_TEXTUREACCESS_STREAMING,
-					CanvasWidth * 2, CanvasHeight * 2);
+					CanvasWidth * scaleFactor,
+					CanvasHeight * scaleFactor);
 			SDL_LockSurface (SDL2_Screens[i].scaled);
 			SDL_UpdateTexture (SDL2_Screens[i].texture, NULL,
 					SDL2_Screens[i].scaled->pixels,
@@ -309,8 +323,8 @@ TFB_Pure_ConfigureVideo (int driver, int flags, int width, int height,
 		}
 		if (flags & TFB_GFXFLAGS_SHOWFPS)
 		{
-			if (0 != ReInit_FPS_Screen (&SDL_Screen_fps, CanvasWidth * 2,
-					CanvasHeight * 2))
+			if (0 != ReInit_FPS_Screen (&SDL_Screen_fps,
+					CanvasWidth * scaleFactor, CanvasHeight * scaleFactor))
 				return -1;
 		}
 		else
@@ -389,27 +403,40 @@ TFB_Pure_UninitGraphics (void)
 	}
 }
 
+static void
+TFB_SDL2_SetFullyUpdated (SCREEN screen)
+{
+	SDL_Rect *r = &SDL2_Screens[screen].updated[0];
+	r->x = 0;
+	r->y = 0;
+	r->w = CanvasWidth;
+	r->h = CanvasHeight;
+	SDL2_Screens[screen].num_updated = 1;
+	SDL2_Screens[screen].dirty = TRUE;
+}
+
 static void
 TFB_SDL2_UploadTransitionScreen (void)
 {
-	SDL2_Screens[TFB_SCREEN_TRANSITION].updated.x = 0;
-	SDL2_Screens[TFB_SCREEN_TRANSITION].updated.y = 0;
-	SDL2_Screens[TFB_SCREEN_TRANSITION].updated.w = CanvasWidth;
-	SDL2_Screens[TFB_SCREEN_TRANSITION].updated.h = CanvasHeight;
-	SDL2_Screens[TFB_SCREEN_TRANSITION].dirty = TRUE;
+	TFB_SDL2_SetFullyUpdated (TFB_SCREEN_TRANSITION);
 }
 
 static void
 TFB_SDL2_UpdateTexture (SDL_Texture *dest, SDL_Surface *src, SDL_Rect *rect)
 {
 	char *srcBytes;
+	QWORD start = GetPerfCounter ();
 	SDL_LockSurface (src);
 	srcBytes = src->pixels;
 	if (rect)
 	{
 		/* SDL2 screen surfaces are always 32bpp */
 		srcBytes += (src->pitch * rect->y) + (rect->x * 4);
+		uploadFrameBytes += rect->w * rect->h * 4;
 	}
+	else
+		uploadFrameBytes += src->w * src->h * 4;
+	++uploadFrameRects;
 	/* 2020-08-02: At time of writing, the documentation for
 	 * SDL_UpdateTexture states this: "If the texture is intended to be
 	 * updated often, it is preferred to create the texture as streaming
@@ -428,6 +455,7 @@ TFB_SDL2_UpdateTexture (SDL_Texture *dest, SDL_Surface *src, SDL_Rect *rect)
 	 * function. */
 	SDL_UpdateTexture (dest, rect, srcBytes, src->pitch);
 	SDL_UnlockSurface (src);
+	TFB_FrameStageTimes.upload += GetPerfCounter () - start;
 }
 
 static void
@@ -470,21 +498,23 @@ TFB_SDL2_Preprocess (int force_full_redraw, int transition_amount,
 
 	if (force_full_redraw == TFB_REDRAW_YES)
 	{
-		SDL2_Screens[TFB_SCREEN_MAIN].updated.x = 0;
-		SDL2_Screens[TFB_SCREEN_MAIN].updated.y = 0;
-		SDL2_Screens[TFB_SCREEN_MAIN].updated.w = CanvasWidth;
-		SDL2_Screens[TFB_SCREEN_MAIN].updated.h = CanvasHeight;
-		SDL2_Screens[TFB_SCREEN_MAIN].dirty = TRUE;
+		TFB_SDL2_SetFullyUpdated (TFB_SCREEN_MAIN);
 	}
 	else if (TFB_BBox.valid)
 	{
-		SDL2_Screens[TFB_SCREEN_MAIN].updated.x = TFB_BBox.region.corner.x;
-		SDL2_Screens[TFB_SCREEN_MAIN].updated.y = TFB_BBox.region.corner.y;
-		SDL2_Screens[TFB_SCREEN_MAIN].updated.w =
-				TFB_BBox.region.extent.width;
-		SDL2_Screens[TFB_SCREEN_MAIN].updated.h =
-				TFB_BBox.region.extent.height;
-		SDL2_Screens[TFB_SCREEN_MAIN].dirty = TRUE;
+		TFB_SDL2_SCREENINFO *info = &SDL2_Screens[TFB_SCREEN_MAIN];
+		int i;
+
+		for (i = 0; i < TFB_BBox.numRects; ++i)
+		{
+			const RECT *r = &TFB_BBox.rects[i];
+			info->updated[i].x = r->corner.x;
+			info->updated[i].y = r->corner.y;
+			info->updated[i].w = r->extent.width;
+			info->updated[i].h = r->extent.height;
+		}
+		info->num_updated = TFB_BBox.numRects;
+		info->dirty = TRUE;
 	}
 
 	SDL_SetRenderDrawBlendMode (renderer, SDL_BLENDMODE_NONE);
@@ -495,11 +525,17 @@ TFB_SDL2_Preprocess (int force_full_redraw, int transition_amount,
 static void
 TFB_SDL2_Unscaled_ScreenLayer (SCREEN screen, Uint8 a, SDL_Rect *rect)
 {
-	SDL_Texture *texture = SDL2_Screens[screen].texture;
-	if (SDL2_Screens[screen].dirty)
+	TFB_SDL2_SCREENINFO *info = &SDL2_Screens[screen];
+	SDL_Texture *texture = info->texture;
+	if (info->dirty)
 	{
-		TFB_SDL2_UpdateTexture (texture, SDL_Screens[screen],
-				&SDL2_Screens[screen].updated);
+		int i;
+		for (i = 0; i < info->num_updated; ++i)
+		{
+			TFB_SDL2_UpdateTexture (texture, SDL_Screens[screen],
+					&info->updated[i]);
+		}
+		info->dirty = FALSE;
 	}
 	if (a == 255)
 	{
@@ -517,18 +553,30 @@ TFB_SDL2_Unscaled_ScreenLayer (SCREEN screen, Uint8 a, SDL_Rect *rect)
 static void
 TFB_SDL2_Scaled_ScreenLayer (SCREEN screen, Uint8 a, SDL_Rect *rect)
 {
-	SDL_Texture *texture = SDL2_Screens[screen].texture;
+	TFB_SDL2_SCREENINFO *info = &SDL2_Screens[screen];
+	SDL_Texture *texture = info->texture;
 	SDL_Rect srcRect, *pSrcRect = NULL;
-	if (SDL2_Screens[screen].dirty)
+	if (info->dirty)
 	{
-		SDL_Surface *src = SDL2_Screens[screen].scaled;
-		SDL_Rect scaled_update = SDL2_Screens[screen].updated;
-		scaler (SDL_Screens[screen], src, &SDL2_Screens[screen].updated);
-		scaled_update.x *= 2;
-		scaled_update.y *= 2;
-		scaled_update.w *= 2;
-		scaled_update.h *= 2;
-		TFB_SDL2_UpdateTexture (texture, src, &scaled_update);
+		SDL_Surface *src = info->scaled;
+		int i;
+		for (i = 0; i < info->num_updated; ++i)
+		{
+			SDL_Rect scaled_update;
+			QWORD start = GetPerfCounter ();
+			/* The scaler may grow the rectangle to take in the
+			 * neighbours its filter reads from; upload everything
+			 * it rescaled. */
+			scaler (SDL_Screens[screen], src, &info->updated[i]);
+			TFB_FrameStageTimes.scale += GetPerfCounter () - start;
+			scaled_update = info->updated[i];
+			scaled_update.x *= scaleFactor;
+			scaled_update.y *= scaleFactor;
+			scaled_update.w *= scaleFactor;
+			scaled_update.h *= scaleFactor;
+			TFB_SDL2_UpdateTexture (texture, src, &scaled_update);
+		}
+		info->dirty = FALSE;
 	}
 	if (a == 255)
 	{
@@ -539,17 +587,17 @@ TFB_SDL2_Scaled_ScreenLayer (SCREEN screen, Uint8 a, SDL_Rect *rect)
 		SDL_SetTextureBlendMode (texture, SDL_BLENDMODE_BLEND);
 		SDL_SetTextureAlphaMod (texture, a);
 	}
-	/* The texture has twice the resolution when scaled, but the
+	/* The texture has a multiple of the resolution when scaled, but the
 	 * screen's logical resolution has not changed, so the clip
 	 * rectangle does not need to be scaled. The *source* clip
 	 * rect, however, must be scaled to match. */
 	if (rect)
 	{
 		srcRect = *rect;
-		srcRect.x *= 2;
-		srcRect.y *= 2;
-		srcRect.w *= 2;
-		srcRect.h *= 2;
+		srcRect.x *= scaleFactor;
+		srcRect.y *= scaleFactor;
+		srcRect.w *= scaleFactor;
+		srcRect.h *= scaleFactor;
 		pSrcRect = &srcRect;
 	}
 	SDL_RenderCopy (renderer, texture, pSrcRect, rect);
@@ -602,6 +650,25 @@ TFB_SDL2_ColorLayer (Uint8 r, Uint8 g, Uint8 b, Uint8 a, SDL_Rect *rect)
 	}
 }
 
+static void
+TFB_SDL2_UploadStats (void)
+{
+	TimeCount now = GetTimeCounter ();
+
+	uploadPeriodBytes += uploadFrameBytes;
+	++uploadPeriodFrames;
+
+	if (now - uploadPeriodStart >= UPLOAD_STATS_PERIOD)
+	{
+		log_add (log_User, "texture upload %u bytes in %u rects, "
+				"average %u bytes/frame", uploadFrameBytes,
+				uploadFrameRects, uploadPeriodBytes / uploadPeriodFrames);
+		uploadPeriodStart = now;
+		uploadPeriodBytes = 0;
+		uploadPeriodFrames = 0;
+	}
+}
+
 static void
 TFB_SDL2_Postprocess (bool hd)
 {
@@ -609,7 +676,12 @@ TFB_SDL2_Postprocess (bool hd)
 		TFB_SDL2_ScanLines (hd);
 
 	if (GfxFlags & TFB_GFXFLAGS_SHOWFPS)
+	{
 		TFB_SDL2_FPS ();
+		TFB_SDL2_UploadStats ();
+	}
+	uploadFrameBytes = 0;
+	uploadFrameRects = 0;
 
 	SDL_RenderPresent (renderer);
 }
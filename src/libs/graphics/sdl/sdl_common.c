@@ -32,6 +32,7 @@
 #include "libs/log.h"
 #include "libs/memlib.h"
 #include "libs/vidlib.h"
+#include "libs/timelib.h"
 #include "uqm/units.h"
 #include "uqm/globdata.h"
 
@@ -117,9 +118,16 @@ void
 TFB_UninitGraphics (void)
 {
 	int i;
+	TFB_ScaleCacheStats stats;
 
 	Uninit_DrawCommandQueue ();
 
+	TFB_DrawImage_GetScaleCacheStats (&stats);
+	log_add (log_Info, "Scaled image cache: %lu hits, %lu misses, "
+			"%lu evictions, %lu bytes in use",
+			(unsigned long)stats.hits, (unsigned long)stats.misses,
+			(unsigned long)stats.evictions, (unsigned long)stats.bytes);
+
 	for (i = 0; i < TFB_GFX_NUMSCREENS; i++)
 		UnInit_Screen (&SDL_Screens[i]);
 
@@ -200,6 +208,7 @@ TFB_SwapBuffers (int force_full_redraw)
 	static int last_fade_amount = 255, last_transition_amount = 255;
 	static int fade_amount = 255, transition_amount = 255;
 	Uint8 sfx;
+	QWORD swapStart;
 
 	fade_amount = GetFadeAmount ();
 	transition_amount = TransitionAmount;
@@ -219,6 +228,7 @@ TFB_SwapBuffers (int force_full_redraw)
 	last_fade_amount = fade_amount;
 	last_transition_amount = transition_amount;
 
+	swapStart = GetPerfCounter ();
 	graphics_backend->preprocess (force_full_redraw, transition_amount,
 			fade_amount);
 	graphics_backend->screen (TFB_SCREEN_MAIN, 255, NULL);
@@ -278,6 +288,7 @@ TFB_SwapBuffers (int force_full_redraw)
 	}*/
 
 	graphics_backend->postprocess (IS_HD);
+	TFB_FrameStageTimes.swap += GetPerfCounter () - swapStart;
 }
 
 /* Probably ought to clean this away at some point. */
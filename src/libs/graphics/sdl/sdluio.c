@@ -34,6 +34,8 @@ sdluio_loadImage (uio_DirHandle *dir, const char *fileName) {
 	uio_Stream *stream;
 	SDL_RWops *rwops;
 	SDL_Surface *result = NULL;
+	const char *data;
+	size_t size;
 
 	stream = uio_fopen (dir, fileName, "rb");
 	if (stream == NULL)
@@ -42,6 +44,21 @@ sdluio_loadImage (uio_DirHandle *dir, const char *fileName) {
 				strerror(errno));
 		return NULL;
 	}
+
+	data = uio_getMappedData (uio_streamHandle (stream), &size);
+	if (data != NULL)
+	{
+		// Decode straight from the file data, without going through
+		// the stream buffer.
+		rwops = SDL_RWFromConstMem (data, (int) size);
+		if (rwops) {
+			result = TFB_png_to_sdl (rwops);
+			SDL_RWclose (rwops);
+		}
+		uio_fclose (stream);
+		return result;
+	}
+
 	rwops = sdluio_makeRWops (stream);
 	if (rwops) {
 		result = TFB_png_to_sdl (rwops);
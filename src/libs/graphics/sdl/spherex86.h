@@ -0,0 +1,165 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+// x86 orbit sphere kernel
+//  Template
+//    #included by blend_sse2.c and blend_avx2.c before blendx86.h,
+//    with the same V_xxx operations plus the few listed below.
+//
+//  The 4 topo pixels and the weights of every sphere pixel are gathered
+//  one by one; the weighting and the lighting are then done on words,
+//  half the pixels of a vector at a time. The math follows the plain C
+//  code in plangen.c step by step so the results are identical:
+//    get_avg_color()  -> the 32-bit sum of the 4 products of 8-bit
+//        channels and 16-bit weights is kept as its high word plus the
+//        carries out of its low word; the exact pixels (m[0] == 0) take
+//        the (x0,y0) channels instead
+//    the light variance -> (elevation * weight sum) >> 16 is done in
+//        the gather loop, as it only changes once per pixel
+//    calc_map_light() -> (dif * c) >> 16 is split into the high and
+//        the low word of dif: dh * c + mulhi(dl, c); the kernel stops
+//        at lights of 1 << 23 and up so that the sum stays within
+//        signed 16 bits. lvf * c always fits signed 16 bits.
+//
+//  Extra operations:
+//    V_MULHI_U16, V_SRAI_16, V_UNPACKLO_32, V_UNPACKHI_32, V_CMPEQ_32,
+//    V_MOVEMASK_32.
+
+#ifndef BLEND_
+#	error "spherex86.h is a template and must be #included"
+#endif
+
+// Word 'n' of the 4 words of every pixel, to all of the pixel's words;
+// n is 0x00, 0x55, 0xaa or 0xff for words 0..3
+#define SPHERE_BCAST(v, n) \
+		V_SHUFHI_16 (V_SHUFLO_16 (v, n), n)
+
+// Adds the product of tap p and weight word n to the sum in hi:lo;
+// lo is biased by 0x8000, so that a signed compare finds its carry
+#define SPHERE_ADD_TAP(p, n) \
+		do { \
+			const VEC wn = SPHERE_BCAST (w, n); \
+			const VEC sum = V_ADD_16 (lo, V_MULLO_16 (p, wn)); \
+			hi = V_ADD_16 (hi, V_MULHI_U16 (p, wn)); \
+			hi = V_SUB_16 (hi, V_CMPGT_16 (lo, sum)); \
+			lo = sum; \
+		} while (0)
+
+// The lit channels of half the pixels: p0..p3 are the taps and w the
+// weights as words, ex all ones on the exact pixels, dl and dh the low
+// and high light words and lvf the light variance of every pixel, in
+// all of the pixel's words
+BLEND_FN static inline VEC
+BLEND_(SphereHalf) (VEC p0, VEC p1, VEC p2, VEC p3, VEC w, VEC ex, VEC dl,
+		VEC dh, VEC lvf)
+{
+	VEC hi, lo, c, l;
+
+	hi = V_MULHI_U16 (p0, SPHERE_BCAST (w, 0x00));
+	lo = V_XOR (V_MULLO_16 (p0, SPHERE_BCAST (w, 0x00)),
+			V_SET1_16 (0x8000));
+	SPHERE_ADD_TAP (p1, 0x55);
+	SPHERE_ADD_TAP (p2, 0xaa);
+	SPHERE_ADD_TAP (p3, 0xff);
+	c = V_MIN_16 (hi, V_SET1_16 (0xff));
+	c = V_OR (V_AND (ex, p0), V_ANDNOT (ex, c));
+
+	l = V_ADD_16 (V_MULLO_16 (c, dh), V_MULHI_U16 (c, dl));
+	l = V_ADD_16 (l, V_SRAI_16 (V_MULLO_16 (c, lvf), 7));
+	return V_MIN_16 (V_MAX_16 (l, V_ZERO ()), V_SET1_16 (0xff));
+}
+
+BLEND_FN static int
+BLEND_(SphereLight) (const Blend_SphereRow *row)
+{
+	const VEC zero = V_ZERO ();
+	const VEC wlow = V_SET1_32 (0xffff);
+	const VEC alpha = V_SET1_32 (row->alpha);
+	const int all = (1 << VEC_PIXELS) - 1;
+	int x;
+
+	for (x = 0; x + VEC_PIXELS <= row->count; x += VEC_PIXELS)
+	{
+		Uint32 tap[4][VEC_PIXELS];
+		Uint32 w01[VEC_PIXELS], w23[VEC_PIXELS];
+		Sint32 lvfs[VEC_PIXELS];
+		VEC light, dif, difh, lvf, lvfh, wa, wb, ex, lo, hi, r;
+		VEC p[4];
+		int k;
+
+		light = V_LOAD (row->light + x);
+		if (V_MOVEMASK_32 (V_CMPEQ_32 (V_SRLI_32 (light, 23), zero)) != all)
+			break;
+
+		for (k = 0; k < VEC_PIXELS; ++k)
+		{
+			const int x0 = row->x0[x + k];
+			const int y0 = row->y0[x + k];
+			const int x1 = row->x1[x + k];
+			const int y1 = row->y1[x + k];
+			const Uint16 *m = row->m[x + k];
+			const int elev = row->elevs[y0 * row->width
+					+ (row->offset + x0) % row->width];
+
+			tap[0][k] = row->pixels[y0 * row->pitch + x0];
+			tap[1][k] = row->pixels[y0 * row->pitch + x1];
+			tap[2][k] = row->pixels[y1 * row->pitch + x0];
+			tap[3][k] = row->pixels[y1 * row->pitch + x1];
+			w01[k] = m[0] | ((Uint32) m[1] << 16);
+			w23[k] = m[2] | ((Uint32) m[3] << 16);
+			lvfs[k] = m[0] == 0 ? elev
+					: (elev * (int) (m[0] + m[1] + m[2] + m[3])) >> 16;
+		}
+		for (k = 0; k < 4; ++k)
+			p[k] = V_LOAD (tap[k]);
+
+		// the weights and the exact mask of every pixel to a quad of
+		// words, in the pixel order of the 8-bit unpacks
+		wa = V_LOAD (w01);
+		wb = V_LOAD (w23);
+		ex = V_CMPEQ_32 (V_AND (wa, wlow), zero);
+
+		// the light and the variance of every pixel to a quad of words
+		dif = V_UNPACKLO_32 (light, light);
+		difh = V_UNPACKHI_32 (light, light);
+		lvf = V_LOAD (lvfs);
+		lvfh = V_UNPACKHI_32 (lvf, lvf);
+		lvf = V_UNPACKLO_32 (lvf, lvf);
+
+		lo = BLEND_(SphereHalf) (
+				V_UNPACKLO_8 (p[0], zero), V_UNPACKLO_8 (p[1], zero),
+				V_UNPACKLO_8 (p[2], zero), V_UNPACKLO_8 (p[3], zero),
+				V_UNPACKLO_32 (wa, wb), V_UNPACKLO_32 (ex, ex),
+				SPHERE_BCAST (dif, 0x00), SPHERE_BCAST (dif, 0x55),
+				SPHERE_BCAST (lvf, 0x00));
+		hi = BLEND_(SphereHalf) (
+				V_UNPACKHI_8 (p[0], zero), V_UNPACKHI_8 (p[1], zero),
+				V_UNPACKHI_8 (p[2], zero), V_UNPACKHI_8 (p[3], zero),
+				V_UNPACKHI_32 (wa, wb), V_UNPACKHI_32 (ex, ex),
+				SPHERE_BCAST (difh, 0x00), SPHERE_BCAST (difh, 0x55),
+				SPHERE_BCAST (lvfh, 0x00));
+
+		r = V_OR (V_PACKUS_16 (lo, hi), alpha);
+		// no light is a clear pixel
+		r = V_ANDNOT (V_CMPEQ_32 (light, zero), r);
+		V_STORE (row->dst + x, r);
+	}
+
+	return x;
+}
+
+#undef SPHERE_ADD_TAP
+#undef SPHERE_BCAST
@@ -14,11 +14,13 @@
  *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  */
 
+#include <string.h>
 #include "gfx_common.h"
 #include "tfb_draw.h"
 #include "drawcmd.h"
 #include "libs/log.h"
 #include "libs/memlib.h"
+#include SDL_INCLUDE(SDL_atomic.h)
 
 
 static const HOT_SPOT NullHs = {0, 0};
@@ -206,10 +208,8 @@ TFB_DrawScreen_WaitForSignal (void)
 	s = GetMyThreadLocal ()->flushSem;
 	DrawCommand.Type = TFB_DRAWCOMMANDTYPE_SENDSIGNAL;
 	DrawCommand.data.sendsignal.sem = s;
-	Lock_DCQ (1);
 	TFB_BatchReset ();
 	TFB_EnqueueDrawCommand (&DrawCommand);
-	Unlock_DCQ();
 	SetSemaphore (s);	
 }
 
@@ -242,6 +242,7 @@ TFB_DrawImage_Line (int x1, int y1, int x2, int y2, Color color,
 	LockMutex (target->mutex);
 	TFB_DrawCanvas_Line (x1, y1, x2, y2, color, mode, target->NormalImg, thickness);
 	target->dirty = TRUE;
+	TFB_DrawImage_DiscardCollisionMask (target);
 	UnlockMutex (target->mutex);
 }
 
@@ -251,6 +252,7 @@ TFB_DrawImage_Rect (RECT *rect, Color color, DrawMode mode, TFB_Image *target)
 	LockMutex (target->mutex);
 	TFB_DrawCanvas_Rect (rect, color, mode, target->NormalImg);
 	target->dirty = TRUE;
+	TFB_DrawImage_DiscardCollisionMask (target);
 	UnlockMutex (target->mutex);
 }
 
@@ -262,6 +264,7 @@ TFB_DrawImage_Image (TFB_Image *img, int x, int y, int scale,
 	TFB_DrawCanvas_Image (img, x, y, scale, scaleMode, cmap,
 			mode, target->NormalImg);
 	target->dirty = TRUE;
+	TFB_DrawImage_DiscardCollisionMask (target);
 	UnlockMutex (target->mutex);
 }
 
@@ -273,6 +276,7 @@ TFB_DrawImage_FilledImage (TFB_Image *img, int x, int y, int scale,
 	TFB_DrawCanvas_FilledImage (img, x, y, scale, scaleMode, color,
 			mode, target->NormalImg);
 	target->dirty = TRUE;
+	TFB_DrawImage_DiscardCollisionMask (target);
 	UnlockMutex (target->mutex);
 }
 
@@ -283,6 +287,7 @@ TFB_DrawImage_FontChar (TFB_Char *fontChar, TFB_Image *backing,
 	LockMutex (target->mutex);
 	TFB_DrawCanvas_FontChar (fontChar, backing, x, y, mode, target->NormalImg);
 	target->dirty = TRUE;
+	TFB_DrawImage_DiscardCollisionMask (target);
 	UnlockMutex (target->mutex);
 }
 
@@ -292,10 +297,76 @@ TFB_DrawImage_MaskImage (TFB_Image *img, DrawMode mode, TFB_Image *target, Color
 	LockMutex (target->mutex);
 	TFB_DrawCanvas_MaskImage (img, mode, target->NormalImg, fill);
 	target->dirty = TRUE;
+	TFB_DrawImage_DiscardCollisionMask (target);
 	UnlockMutex (target->mutex);
 }
 
 
+// Scaled variant cache statistics, shared by all images
+static SDL_atomic_t ScaleCacheHits;
+static SDL_atomic_t ScaleCacheMisses;
+static SDL_atomic_t ScaleCacheEvictions;
+static SDL_atomic_t ScaleCacheBytes;
+
+static void
+releaseScaledVariant (TFB_ScaledVariant *v)
+{
+	if (!v->canvas)
+		return;
+
+	TFB_DrawCanvas_Delete (v->canvas);
+	SDL_AtomicAdd (&ScaleCacheBytes, -(int)v->bytes);
+	v->canvas = NULL;
+	v->bytes = 0;
+	v->scale = 0;
+}
+
+// Returns the slot to scale a new variant into: an empty one while we
+// are within budget, otherwise the least recently used one. When over
+// budget, the image also gives up its other variants.
+static TFB_ScaledVariant *
+pickScaledVariant (TFB_Image *image)
+{
+	TFB_ScaledVariant *empty = NULL;
+	TFB_ScaledVariant *lru = NULL;
+	BOOLEAN overBudget;
+	int i;
+
+	overBudget = SDL_AtomicGet (&ScaleCacheBytes) >= TFB_SCALED_BUDGET;
+
+	for (i = 0; i < TFB_SCALED_SLOTS; ++i)
+	{
+		TFB_ScaledVariant *v = &image->scaled[i];
+		if (!v->canvas)
+		{
+			if (!empty)
+				empty = v;
+		}
+		else if (!lru || v->last_used < lru->last_used)
+		{
+			lru = v;
+		}
+	}
+
+	if (empty && (!overBudget || !lru))
+		return empty;
+
+	if (overBudget)
+	{
+		for (i = 0; i < TFB_SCALED_SLOTS; ++i)
+		{
+			if (&image->scaled[i] != lru && image->scaled[i].canvas)
+			{
+				releaseScaledVariant (&image->scaled[i]);
+				SDL_AtomicIncRef (&ScaleCacheEvictions);
+			}
+		}
+	}
+	if (lru->scale)
+		SDL_AtomicIncRef (&ScaleCacheEvictions);
+	return lru;
+}
+
 TFB_Image *
 TFB_DrawImage_New (TFB_Canvas canvas)
 {
@@ -312,6 +383,9 @@ TFB_DrawImage_New (TFB_Canvas canvas)
 	img->last_scale_type = -1;
 	img->last_scale = 0;
 	img->dirty = FALSE;
+	memset (img->scaled, 0, sizeof img->scaled);
+	img->scale_tick = 0;
+	img->collision_mask = NULL;
 	TFB_DrawCanvas_GetExtent (canvas, &img->extent);
 
 	if (TFB_DrawCanvas_IsPaletted (canvas))
@@ -341,6 +415,10 @@ TFB_DrawImage_CreateForScreen (int w, int h, BOOLEAN withalpha)
 	img->last_scale_hs = NullHs;
 	img->last_scale_type = -1;
 	img->last_scale = 0;
+	img->dirty = FALSE;
+	memset (img->scaled, 0, sizeof img->scaled);
+	img->scale_tick = 0;
+	img->collision_mask = NULL;
 	img->extent.width = w;
 	img->extent.height = h;
 
@@ -415,6 +493,8 @@ TFB_DrawImage_SetMipmap (TFB_Image *img, TFB_Image *mmimg, int hotx, int hoty)
 void 
 TFB_DrawImage_Delete (TFB_Image *image)
 {
+	int i;
+
 	if (image == 0)
 	{
 		log_add (log_Warning, "INTERNAL ERROR: Tried to delete a null image!");
@@ -425,11 +505,9 @@ TFB_DrawImage_Delete (TFB_Image *image)
 
 	TFB_DrawCanvas_Delete (image->NormalImg);
 			
-	if (image->ScaledImg)
-	{
-		TFB_DrawCanvas_Delete (image->ScaledImg);
-		image->ScaledImg = 0;
-	}
+	for (i = 0; i < TFB_SCALED_SLOTS; ++i)
+		releaseScaledVariant (&image->scaled[i]);
+	image->ScaledImg = 0;
 
 	if (image->FilledImg)
 	{
@@ -437,6 +515,8 @@ TFB_DrawImage_Delete (TFB_Image *image)
 		image->FilledImg = 0;
 	}
 
+	TFB_DrawImage_DiscardCollisionMask (image);
+
 	UnlockMutex (image->mutex);
 	DestroyMutex (image->mutex);
 			
@@ -446,43 +526,200 @@ TFB_DrawImage_Delete (TFB_Image *image)
 void
 TFB_DrawImage_FixScaling (TFB_Image *image, int target, int type)
 {
-	if (image->dirty || !image->ScaledImg ||
-			target != image->last_scale ||
-			type != image->last_scale_type)
-	{
+	TFB_ScaledVariant *v = NULL;
+	EXTENT size;
+	int i;
+
+	if (image->dirty)
+	{	// The image changed; none of the variants are any good
 		image->dirty = FALSE;
-		image->ScaledImg = TFB_DrawCanvas_New_ScaleTarget (image->NormalImg,
-			image->ScaledImg, type, image->last_scale_type);
+		for (i = 0; i < TFB_SCALED_SLOTS; ++i)
+			image->scaled[i].scale = 0;
+	}
+
+	for (i = 0; i < TFB_SCALED_SLOTS; ++i)
+	{
+		TFB_ScaledVariant *slot = &image->scaled[i];
+		if (slot->canvas && slot->scale == target && slot->type == type
+				&& slot->colormap_version == image->colormap_version)
+		{
+			v = slot;
+			break;
+		}
+	}
+
+	if (v)
+	{
+		SDL_AtomicIncRef (&ScaleCacheHits);
+	}
+	else
+	{
+		SDL_AtomicIncRef (&ScaleCacheMisses);
+		v = pickScaledVariant (image);
+
+		SDL_AtomicAdd (&ScaleCacheBytes, -(int)v->bytes);
+		v->canvas = TFB_DrawCanvas_New_ScaleTarget (image->NormalImg,
+				v->canvas, type, v->type);
+		TFB_DrawCanvas_GetExtent (v->canvas, &size);
+		v->bytes = TFB_DrawCanvas_GetStride (v->canvas) * size.height;
+		SDL_AtomicAdd (&ScaleCacheBytes, (int)v->bytes);
 		
 		if (type == TFB_SCALE_NEAREST)
 			TFB_DrawCanvas_Rescale_Nearest (image->NormalImg,
-					image->ScaledImg, target, &image->NormalHs,
-					&image->extent, &image->last_scale_hs);
+					v->canvas, target, &image->NormalHs,
+					&v->extent, &v->hs);
 		else if (type == TFB_SCALE_BILINEAR)
 			TFB_DrawCanvas_Rescale_Bilinear (image->NormalImg,
-					image->ScaledImg, target, &image->NormalHs,
-					&image->extent, &image->last_scale_hs);
+					v->canvas, target, &image->NormalHs,
+					&v->extent, &v->hs);
 		else
 			TFB_DrawCanvas_Rescale_Trilinear (image->NormalImg,
-					image->MipmapImg, image->ScaledImg, target,
+					image->MipmapImg, v->canvas, target,
 					&image->NormalHs, &image->MipmapHs,
-					&image->extent, &image->last_scale_hs);
+					&v->extent, &v->hs);
+
+		v->scale = target;
+		v->type = type;
+		v->colormap_version = image->colormap_version;
+	}
+
+	v->last_used = ++image->scale_tick;
+	image->ScaledImg = v->canvas;
+	image->last_scale_hs = v->hs;
+	image->extent = v->extent;
+	image->last_scale_type = type;
+	image->last_scale = target;
+}
+
+void
+TFB_DrawImage_GetScaleCacheStats (TFB_ScaleCacheStats *stats)
+{
+	stats->hits = SDL_AtomicGet (&ScaleCacheHits);
+	stats->misses = SDL_AtomicGet (&ScaleCacheMisses);
+	stats->evictions = SDL_AtomicGet (&ScaleCacheEvictions);
+	stats->bytes = SDL_AtomicGet (&ScaleCacheBytes);
+}
+
+// Call with image->mutex held
+void
+TFB_DrawImage_DiscardCollisionMask (TFB_Image *image)
+{
+	if (image->collision_mask)
+	{
+		HFree (image->collision_mask->bits);
+		HFree (image->collision_mask);
+		image->collision_mask = NULL;
+	}
+}
 
-		image->last_scale_type = type;
-		image->last_scale = target;
+// Call with image->mutex held
+static TFB_CollisionMask *
+getCollisionMask (TFB_Image *image)
+{
+	TFB_CollisionMask *mask = image->collision_mask;
+	EXTENT size;
+
+	if (mask)
+		return mask;
+
+	TFB_DrawCanvas_GetExtent (image->NormalImg, &size);
+	mask = HMalloc (sizeof (*mask));
+	mask->width = size.width;
+	mask->height = size.height;
+	mask->pitch = ((size.width + 63) >> 6) + 1;
+	mask->bits = HCalloc (sizeof (QWORD) * mask->pitch
+			* (size.height ? size.height : 1));
+	if (!TFB_DrawCanvas_GetCollisionMask (image->NormalImg, mask))
+	{
+		HFree (mask->bits);
+		HFree (mask);
+		return NULL;
+	}
+
+	image->collision_mask = mask;
+	return mask;
+}
+
+// 64 mask bits of a row, starting at pixel x
+static inline QWORD
+getMaskBits (const QWORD *row, int x)
+{
+	const QWORD *p = row + (x >> 6);
+	int shift = x & 63;
+
+	if (shift == 0)
+		return p[0];
+	return (p[0] >> shift) | (p[1] << (64 - shift));
+}
+
+// Tests whether any pixel of interRect is solid in both masks. The
+// origins are the positions of the masks' upper left corners.
+// Pixels outside of a mask are never solid.
+static BOOLEAN
+masksIntersect (const TFB_CollisionMask *mask1, POINT m1org,
+		const TFB_CollisionMask *mask2, POINT m2org, const RECT *interRect)
+{
+	int x0, y0, x1, y1;
+	int y;
+
+	// Clip the rect to both masks
+	x0 = interRect->corner.x;
+	y0 = interRect->corner.y;
+	x1 = x0 + interRect->extent.width;
+	y1 = y0 + interRect->extent.height;
+	if (x0 < m1org.x)
+		x0 = m1org.x;
+	if (x0 < m2org.x)
+		x0 = m2org.x;
+	if (y0 < m1org.y)
+		y0 = m1org.y;
+	if (y0 < m2org.y)
+		y0 = m2org.y;
+	if (x1 > m1org.x + mask1->width)
+		x1 = m1org.x + mask1->width;
+	if (x1 > m2org.x + mask2->width)
+		x1 = m2org.x + mask2->width;
+	if (y1 > m1org.y + mask1->height)
+		y1 = m1org.y + mask1->height;
+	if (y1 > m2org.y + mask2->height)
+		y1 = m2org.y + mask2->height;
+	if (x0 >= x1 || y0 >= y1)
+		return FALSE;
+
+	for (y = y0; y < y1; ++y)
+	{
+		const QWORD *row1 = mask1->bits + (y - m1org.y) * mask1->pitch;
+		const QWORD *row2 = mask2->bits + (y - m2org.y) * mask2->pitch;
+		int x;
+
+		for (x = x0; x < x1; x += 64)
+		{
+			QWORD bits = getMaskBits (row1, x - m1org.x)
+					& getMaskBits (row2, x - m2org.x);
+
+			if (x1 - x < 64)
+				bits &= ((QWORD)1 << (x1 - x)) - 1;
+			if (bits)
+				return TRUE;
+		}
 	}
+
+	return FALSE;
 }
 
 BOOLEAN
 TFB_DrawImage_Intersect (TFB_Image *img1, POINT img1org,
 		TFB_Image *img2, POINT img2org, const RECT *interRect)
 {
-	BOOLEAN ret;
+	BOOLEAN ret = FALSE;
+	TFB_CollisionMask *mask1, *mask2;
 
 	LockMutex (img1->mutex);
 	LockMutex (img2->mutex);
-	ret = TFB_DrawCanvas_Intersect (img1->NormalImg, img1org,
-			img2->NormalImg, img2org, interRect);
+	mask1 = getCollisionMask (img1);
+	mask2 = getCollisionMask (img2);
+	if (mask1 && mask2)
+		ret = masksIntersect (mask1, img1org, mask2, img2org, interRect);
 	UnlockMutex (img2->mutex);
 	UnlockMutex (img1->mutex);
 
@@ -498,6 +735,7 @@ TFB_DrawImage_CopyRect (TFB_Image *source, const RECT *srcRect,
 	TFB_DrawCanvas_CopyRect (source->NormalImg, srcRect,
 			target->NormalImg, dstPt);
 	target->dirty = TRUE;
+	TFB_DrawImage_DiscardCollisionMask (target);
 	UnlockMutex (target->mutex);
 	UnlockMutex (source->mutex);
 }
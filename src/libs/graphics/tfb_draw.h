@@ -35,10 +35,43 @@ typedef enum {
 #include "libs/graphics/gfx_common.h"
 #include "libs/graphics/cmap.h"
 
+// Number of scaled variants of an image kept around
+#define TFB_SCALED_SLOTS 4
+// Once all scaled variants together take this many bytes, images
+// stop keeping more than one variant each
+#define TFB_SCALED_BUDGET (32 * 1024 * 1024)
+
+typedef struct tfb_scaledvariant
+{
+	TFB_Canvas canvas;
+	HOT_SPOT hs;
+	EXTENT extent;
+	int scale;
+	int type;
+	int colormap_version;
+			// palette the variant was scaled with, for paletted images
+	DWORD last_used;
+	DWORD bytes;
+} TFB_ScaledVariant;
+
+// Packed solidity mask of an image, for pixel-precise collision tests.
+// Pixel x of a row is bit (x & 63) of word (x >> 6). Each row is
+// followed by a zero word so that shifted reads never need a bounds
+// check.
+typedef struct tfb_collisionmask
+{
+	int width;
+	int height;
+	int pitch;
+			// QWORDs per row, padding word included
+	QWORD *bits;
+} TFB_CollisionMask;
+
 typedef struct tfb_image
 {
 	TFB_Canvas NormalImg;
 	TFB_Canvas ScaledImg;
+			// The variant picked by the last TFB_DrawImage_FixScaling()
 	TFB_Canvas MipmapImg;
 	TFB_Canvas FilledImg;
 	int colormap_index;
@@ -52,8 +85,22 @@ typedef struct tfb_image
 	EXTENT extent;
 	Mutex mutex;
 	BOOLEAN dirty;
+	TFB_ScaledVariant scaled[TFB_SCALED_SLOTS];
+			// LRU cache of scaled versions of NormalImg
+	DWORD scale_tick;
+	TFB_CollisionMask *collision_mask;
+			// Built by the first TFB_DrawImage_Intersect() after the
+			// image pixels last changed
 } TFB_Image;
 
+typedef struct tfb_scalecachestats
+{
+	DWORD hits;
+	DWORD misses;
+	DWORD evictions;
+	DWORD bytes;
+} TFB_ScaleCacheStats;
+
 typedef struct tfb_char
 {
 	EXTENT extent;
@@ -105,8 +152,10 @@ void TFB_DrawImage_SetMipmap (TFB_Image *img, TFB_Image *mmimg, int hotx,
 		int hoty);
 void TFB_DrawImage_Delete (TFB_Image *image);
 void TFB_DrawImage_FixScaling (TFB_Image *image, int target, int type);
+void TFB_DrawImage_GetScaleCacheStats (TFB_ScaleCacheStats *stats);
 BOOLEAN TFB_DrawImage_Intersect (TFB_Image *img1, POINT img1org,
 		TFB_Image *img2, POINT img2org, const RECT *interRect);
+void TFB_DrawImage_DiscardCollisionMask (TFB_Image *image);
 void TFB_DrawImage_CopyRect (TFB_Image *source, const RECT *srcRect,
 		TFB_Image *target, POINT dstPt);
 
@@ -181,8 +230,8 @@ void TFB_DrawCanvas_GetScreenFormat (TFB_PixelFormat *fmt);
 int TFB_DrawCanvas_GetStride (TFB_Canvas canvas);
 void *TFB_DrawCanvas_GetLine (TFB_Canvas canvas, int line);
 Color TFB_DrawCanvas_GetPixel (TFB_Canvas canvas, int x, int y);
-BOOLEAN TFB_DrawCanvas_Intersect (TFB_Canvas canvas1, POINT c1org,
-		TFB_Canvas canvas2, POINT c2org, const RECT *interRect);
+BOOLEAN TFB_DrawCanvas_GetCollisionMask (TFB_Canvas canvas,
+		TFB_CollisionMask *mask);
 
 BOOLEAN TFB_DrawCanvas_GetPixelColors (TFB_Canvas, Color *pixels,
 		int width, int height);
@@ -43,8 +43,10 @@ typedef enum
 	PLATFORM_SSE,
 	PLATFORM_3DNOW,
 	PLATFORM_ALTIVEC,
+	PLATFORM_SSE2,
+	PLATFORM_AVX2,
 
-	PLATFORM_LAST = PLATFORM_ALTIVEC
+	PLATFORM_LAST = PLATFORM_AVX2
 
 } PLATFORM_TYPE;
 
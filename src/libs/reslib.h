@@ -75,7 +75,24 @@ DWORD res_GetIntResource (RESOURCE res);
 BOOLEAN res_GetBooleanResource (RESOURCE res);
 const char *res_GetResourceType (RESOURCE res);
 
+enum
+{
+	RES_PREFETCH_LOW = 0,
+	RES_PREFETCH_NORMAL,
+	RES_PREFETCH_HIGH,
+	RES_PREFETCH_PRIORITIES
+};
+
+/* Load resources in the background ahead of the res_GetResource() call
+ * that will need them. Higher priorities are loaded first. */
+void res_PrefetchResource (RESOURCE res, int priority);
+void res_PrefetchGroup (const RESOURCE *res, COUNT count, int priority);
+void res_CancelPrefetch (RESOURCE res);
+void res_CancelPrefetchGroup (const RESOURCE *res, COUNT count);
+void res_CancelAllPrefetches (void);
+
 void LoadResourceIndex (uio_DirHandle *dir, const char *filename, const char *prefix);
+void LoadCompiledResourceIndex (uio_DirHandle *dir, const char *filename, const char *prefix);
 void SaveResourceIndex (uio_DirHandle *dir, const char *rmpfile, const char *root, BOOLEAN strip_root);
 
 void *GetResourceData (uio_Stream *fp, DWORD length);
@@ -36,7 +36,10 @@ lookupResourceDesc (RESOURCE_INDEX idx, RESOURCE res)
 void
 loadResourceDesc (ResourceDesc *desc)
 {
+	BOOLEAN locked = lockResourceLoads ();
 	desc->vtable->loadFun (desc->fname, &desc->resdata);
+	if (locked)
+		unlockResourceLoads ();
 }
 
 void *
@@ -122,6 +125,7 @@ res_GetResource (RESOURCE res)
 		return NULL;
 	}
 
+	claimPrefetchedDesc (desc);
 	if (desc->resdata.ptr == NULL)
 		loadResourceDesc (desc);
 	if (desc->resdata.ptr != NULL)
@@ -176,6 +180,7 @@ res_FreeResource (RESOURCE res)
 				"resource.");
 		return;
 	}
+	claimPrefetchedDesc (desc);
 
 	if (desc->refcount > 0)
 		--desc->refcount;
@@ -220,6 +225,7 @@ res_DetachResource (RESOURCE res)
 				"resource.");
 		return NULL;
 	}
+	claimPrefetchedDesc (desc);
 	
 	freeFun = desc->vtable->freeFun;
 	if (freeFun == NULL)
@@ -42,6 +42,20 @@ struct resource_desc
 	RESOURCE_DATA resdata;
 	// refcount is rudimentary as nothing really frees the descriptors
 	unsigned refcount;
+	// Prefetch state, protected by the prefetch mutex; see prefetch.c
+	int prefetch_state;
+	int prefetch_pri;
+	BOOLEAN prefetch_cancelled;
+	ResourceDesc *prefetch_next;
+};
+
+enum
+{
+	PREFETCH_NONE = 0,
+	PREFETCH_QUEUED,
+	PREFETCH_LOADING,
+	PREFETCH_DONE,
+			// Loaded by the prefetch task and not claimed yet
 };
 
 struct resource_index_desc
@@ -0,0 +1,487 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/* Background loading of resources that are known to be needed soon.
+ *
+ * A prefetched resource is loaded into its descriptor on the prefetch
+ * task, exactly as res_GetResource() would have loaded it. The next
+ * res_GetResource() then finds it loaded, or waits for the load that is
+ * in flight. Requests that have not been started can be cancelled; a
+ * resource that was prefetched but never claimed is freed on cancel.
+ * Freeing a resource may queue draw commands, and only the game thread
+ * may do that, so a load that is cancelled while in flight is not freed
+ * by the task. It is put on the discard list instead, which the game
+ * thread empties the next time it prefetches or cancels.
+ *
+ * Loaders share state that is not thread safe (uio handles, the loader
+ * globals), so only one resource is loaded at a time, by whichever
+ * thread holds the load mutex. That is also why there is only one task.
+ */
+
+#include "resintrn.h"
+#include "libs/log.h"
+#include "libs/tasklib.h"
+#include "libs/threadlib.h"
+#include "libs/timelib.h"
+
+
+static ResourceDesc *queue_head[RES_PREFETCH_PRIORITIES];
+static ResourceDesc *queue_tail[RES_PREFETCH_PRIORITIES];
+static ResourceDesc *discard_head;
+		// Loaded after being cancelled; freed by the game thread
+
+static Mutex prefetch_mutex;
+		// Protects the queues and the prefetch fields of the descriptors
+static RecursiveMutex load_mutex;
+		// Held while a resource is being loaded
+static Semaphore prefetch_wake;
+		// Posted for each queued request
+static Semaphore prefetch_done;
+		// Posted once per waiter whenever a load finishes
+static int num_waiters;
+static Task prefetch_task;
+static BOOLEAN prefetch_disabled;
+
+static struct
+{
+	DWORD requests;
+	DWORD loaded;
+	DWORD claimed;
+	DWORD waited;
+	DWORD cancelled;
+	DWORD discarded;
+} prefetch_stats;
+
+
+// Returns TRUE if the lock was taken, in which case the caller must
+// call unlockResourceLoads() when done. Before the first prefetch there
+// is no other thread that loads resources, and no lock.
+BOOLEAN
+lockResourceLoads (void)
+{
+	if (!load_mutex)
+		return FALSE;
+	LockRecursiveMutex (load_mutex);
+	return TRUE;
+}
+
+void
+unlockResourceLoads (void)
+{
+	UnlockRecursiveMutex (load_mutex);
+}
+
+// Caller holds prefetch_mutex
+static void
+enqueueDesc (ResourceDesc *desc, int priority)
+{
+	desc->prefetch_state = PREFETCH_QUEUED;
+	desc->prefetch_pri = priority;
+	desc->prefetch_next = NULL;
+	if (queue_tail[priority])
+		queue_tail[priority]->prefetch_next = desc;
+	else
+		queue_head[priority] = desc;
+	queue_tail[priority] = desc;
+}
+
+// Caller holds prefetch_mutex
+static void
+unqueueDesc (ResourceDesc *desc)
+{
+	int priority = desc->prefetch_pri;
+	ResourceDesc *prev = NULL;
+	ResourceDesc *cur;
+
+	for (cur = queue_head[priority]; cur != desc; cur = cur->prefetch_next)
+		prev = cur;
+
+	if (prev)
+		prev->prefetch_next = desc->prefetch_next;
+	else
+		queue_head[priority] = desc->prefetch_next;
+	if (queue_tail[priority] == desc)
+		queue_tail[priority] = prev;
+	desc->prefetch_next = NULL;
+	desc->prefetch_state = PREFETCH_NONE;
+}
+
+// Caller holds prefetch_mutex
+static ResourceDesc *
+dequeueDesc (void)
+{
+	int priority;
+
+	for (priority = RES_PREFETCH_PRIORITIES - 1; priority >= 0; --priority)
+	{
+		ResourceDesc *desc = queue_head[priority];
+		if (desc)
+		{
+			unqueueDesc (desc);
+			return desc;
+		}
+	}
+	return NULL;
+}
+
+// Caller holds prefetch_mutex
+static void
+unlinkDiscard (ResourceDesc *desc)
+{
+	ResourceDesc **link;
+
+	for (link = &discard_head; *link; link = &(*link)->prefetch_next)
+	{
+		if (*link == desc)
+		{
+			*link = desc->prefetch_next;
+			break;
+		}
+	}
+	desc->prefetch_next = NULL;
+	desc->prefetch_cancelled = FALSE;
+}
+
+// Caller holds prefetch_mutex, on the game thread
+static void
+drainDiscards (void)
+{
+	while (discard_head)
+	{
+		ResourceDesc *desc = discard_head;
+
+		unlinkDiscard (desc);
+		desc->prefetch_state = PREFETCH_NONE;
+		if (desc->refcount == 0 && desc->resdata.ptr != NULL)
+		{
+			desc->vtable->freeFun (desc->resdata.ptr);
+			desc->resdata.ptr = NULL;
+			prefetch_stats.discarded++;
+		}
+	}
+}
+
+// Caller holds prefetch_mutex
+static void
+wakeWaiters (void)
+{
+	for (; num_waiters > 0; --num_waiters)
+		ClearSemaphore (prefetch_done);
+}
+
+// Caller holds prefetch_mutex; it is released while waiting
+static void
+waitLoadDone (ResourceDesc *desc)
+{
+	prefetch_stats.waited++;
+	while (desc->prefetch_state == PREFETCH_LOADING)
+	{
+		num_waiters++;
+		UnlockMutex (prefetch_mutex);
+		SetSemaphore (prefetch_done);
+		LockMutex (prefetch_mutex);
+	}
+}
+
+static int
+PrefetchTaskFunc (void *data)
+{
+	Task task = (Task)data;
+
+	while (!Task_ReadState (task, TASK_EXIT))
+	{
+		ResourceDesc *desc;
+
+		// The timeout only serves to notice TASK_EXIT
+		if (!SetSemaphoreTimeout (prefetch_wake, ONE_SECOND / 10))
+			continue;
+
+		LockMutex (prefetch_mutex);
+		desc = dequeueDesc ();
+		if (desc)
+			desc->prefetch_state = PREFETCH_LOADING;
+		UnlockMutex (prefetch_mutex);
+
+		if (!desc)
+			continue; // cancelled, or claimed before we got to it
+
+		if (desc->resdata.ptr == NULL)
+			loadResourceDesc (desc);
+
+		LockMutex (prefetch_mutex);
+		if (desc->resdata.ptr == NULL)
+		{
+			desc->prefetch_cancelled = FALSE;
+			desc->prefetch_state = PREFETCH_NONE;
+		}
+		else if (desc->prefetch_cancelled && desc->refcount == 0)
+		{	// Stays cancelled until the game thread frees it
+			desc->prefetch_next = discard_head;
+			discard_head = desc;
+			desc->prefetch_state = PREFETCH_DONE;
+		}
+		else
+		{
+			desc->prefetch_cancelled = FALSE;
+			desc->prefetch_state = PREFETCH_DONE;
+			prefetch_stats.loaded++;
+		}
+		wakeWaiters ();
+		UnlockMutex (prefetch_mutex);
+	}
+
+	FinishTask (task);
+	return 0;
+}
+
+static BOOLEAN
+startPrefetchTask (void)
+{
+	if (prefetch_task)
+		return TRUE;
+	if (prefetch_disabled)
+		return FALSE;
+
+	// Everything is created here, on first use, by the game thread,
+	// before any other thread can load resources.
+	prefetch_mutex = CreateMutex ("Resource prefetch mutex",
+			SYNC_CLASS_RESOURCE);
+	load_mutex = CreateRecursiveMutex ("Resource load mutex",
+			SYNC_CLASS_RESOURCE);
+	prefetch_wake = CreateSemaphore (0, "Resource prefetch wake",
+			SYNC_CLASS_RESOURCE);
+	prefetch_done = CreateSemaphore (0, "Resource prefetch done",
+			SYNC_CLASS_RESOURCE);
+	prefetch_task = AssignTask (PrefetchTaskFunc, 1024,
+			"resource prefetch");
+	if (!prefetch_task)
+	{
+		log_add (log_Warning, "Could not start the resource prefetch task; "
+				"resources will be loaded on demand.");
+		prefetch_disabled = TRUE;
+		return FALSE;
+	}
+	return TRUE;
+}
+
+// Makes sure 'desc' is not queued or being loaded by the prefetch task,
+// so that the caller may use its resdata. A resource that was
+// prefetched becomes an ordinary loaded resource.
+void
+claimPrefetchedDesc (ResourceDesc *desc)
+{
+	if (!prefetch_mutex)
+		return;
+
+	LockMutex (prefetch_mutex);
+	switch (desc->prefetch_state)
+	{
+		case PREFETCH_QUEUED:
+			// Not started yet; the caller may just as well load it
+			unqueueDesc (desc);
+			break;
+		case PREFETCH_LOADING:
+			desc->prefetch_cancelled = FALSE;
+			waitLoadDone (desc);
+			if (desc->prefetch_state == PREFETCH_DONE)
+				prefetch_stats.claimed++;
+			desc->prefetch_state = PREFETCH_NONE;
+			break;
+		case PREFETCH_DONE:
+			if (desc->prefetch_cancelled)
+				unlinkDiscard (desc);
+			prefetch_stats.claimed++;
+			desc->prefetch_state = PREFETCH_NONE;
+			break;
+	}
+	UnlockMutex (prefetch_mutex);
+}
+
+void
+res_PrefetchResource (RESOURCE res, int priority)
+{
+	ResourceDesc *desc;
+
+	if (res == NULL_RESOURCE)
+		return;
+
+	desc = lookupResourceDesc (_get_current_index_header (), res);
+	if (desc == NULL || desc->vtable == NULL || desc->vtable->freeFun == NULL)
+	{
+		// Undefined, or a value resource that is never loaded
+		return;
+	}
+
+	if (priority < 0)
+		priority = 0;
+	else if (priority >= RES_PREFETCH_PRIORITIES)
+		priority = RES_PREFETCH_PRIORITIES - 1;
+
+	if (!startPrefetchTask ())
+		return;
+
+	LockMutex (prefetch_mutex);
+	drainDiscards ();
+	switch (desc->prefetch_state)
+	{
+		case PREFETCH_NONE:
+			if (desc->resdata.ptr != NULL)
+				break; // already loaded
+			enqueueDesc (desc, priority);
+			prefetch_stats.requests++;
+			ClearSemaphore (prefetch_wake);
+			break;
+		case PREFETCH_QUEUED:
+			if (priority > desc->prefetch_pri)
+			{
+				unqueueDesc (desc);
+				enqueueDesc (desc, priority);
+			}
+			break;
+		case PREFETCH_LOADING:
+			desc->prefetch_cancelled = FALSE;
+			break;
+		case PREFETCH_DONE:
+			// Wanted again before the discarded result got freed
+			if (desc->prefetch_cancelled)
+				unlinkDiscard (desc);
+			break;
+	}
+	UnlockMutex (prefetch_mutex);
+}
+
+void
+res_PrefetchGroup (const RESOURCE *res, COUNT count, int priority)
+{
+	COUNT i;
+
+	for (i = 0; i < count; ++i)
+		res_PrefetchResource (res[i], priority);
+}
+
+// Caller holds prefetch_mutex
+static void
+cancelDesc (ResourceDesc *desc)
+{
+	switch (desc->prefetch_state)
+	{
+		case PREFETCH_QUEUED:
+			unqueueDesc (desc);
+			prefetch_stats.cancelled++;
+			break;
+		case PREFETCH_LOADING:
+			// Can't interrupt a loader; the task drops the result
+			desc->prefetch_cancelled = TRUE;
+			prefetch_stats.cancelled++;
+			break;
+		case PREFETCH_DONE:
+			if (desc->prefetch_cancelled)
+				unlinkDiscard (desc);
+			desc->prefetch_state = PREFETCH_NONE;
+			if (desc->refcount == 0 && desc->resdata.ptr != NULL)
+			{
+				desc->vtable->freeFun (desc->resdata.ptr);
+				desc->resdata.ptr = NULL;
+				prefetch_stats.discarded++;
+			}
+			break;
+	}
+}
+
+void
+res_CancelPrefetch (RESOURCE res)
+{
+	ResourceDesc *desc;
+
+	if (res == NULL_RESOURCE || !prefetch_mutex)
+		return;
+
+	desc = lookupResourceDesc (_get_current_index_header (), res);
+	if (desc == NULL)
+		return;
+
+	LockMutex (prefetch_mutex);
+	drainDiscards ();
+	cancelDesc (desc);
+	UnlockMutex (prefetch_mutex);
+}
+
+void
+res_CancelPrefetchGroup (const RESOURCE *res, COUNT count)
+{
+	COUNT i;
+
+	for (i = 0; i < count; ++i)
+		res_CancelPrefetch (res[i]);
+}
+
+// Drops all requests that have not been started yet. Results that are
+// already loaded stay until they are claimed or cancelled individually.
+void
+res_CancelAllPrefetches (void)
+{
+	int priority;
+
+	if (!prefetch_mutex)
+		return;
+
+	LockMutex (prefetch_mutex);
+	drainDiscards ();
+	for (priority = 0; priority < RES_PREFETCH_PRIORITIES; ++priority)
+	{
+		while (queue_head[priority])
+			cancelDesc (queue_head[priority]);
+	}
+	UnlockMutex (prefetch_mutex);
+}
+
+void
+UninitResourcePrefetch (void)
+{
+	if (!prefetch_mutex)
+		return;
+
+	res_CancelAllPrefetches ();
+	if (prefetch_task)
+	{
+		ConcludeTask (prefetch_task);
+		prefetch_task = NULL;
+	}
+	// The task may have finished a cancelled load meanwhile
+	LockMutex (prefetch_mutex);
+	drainDiscards ();
+	UnlockMutex (prefetch_mutex);
+	prefetch_disabled = FALSE;
+
+	if (prefetch_stats.requests > 0)
+	{
+		log_add (log_Info, "Resource prefetch: %u requests, %u loaded "
+				"ahead, %u claimed (%u waited on), %u cancelled, "
+				"%u discarded", prefetch_stats.requests,
+				prefetch_stats.loaded, prefetch_stats.claimed,
+				prefetch_stats.waited, prefetch_stats.cancelled,
+				prefetch_stats.discarded);
+	}
+
+	DestroySemaphore (prefetch_done);
+	prefetch_done = NULL;
+	DestroySemaphore (prefetch_wake);
+	prefetch_wake = NULL;
+	DestroyRecursiveMutex (load_mutex);
+	load_mutex = NULL;
+	DestroyMutex (prefetch_mutex);
+	prefetch_mutex = NULL;
+}
@@ -0,0 +1,419 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/* Compiled property files.
+ *
+ * The first time a property file is parsed, its key/value pairs are
+ * also written to a binary file in the cache dir. Later loads map that
+ * file (or read it in one go where uio can't map it) and hand the pairs
+ * straight to the handler, skipping the text parser (and, for content
+ * in .zip files, the inflating).
+ *
+ * A compiled file is used only when the location, size and
+ * modification time of its source all match; otherwise it is rebuilt. It is native
+ * endian and only meant for the machine that wrote it.
+ *
+ * Layout: header, then numEntries (key, value) offset pairs into the
+ * string pool, then the pool itself. Identical strings are stored once.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "port.h"
+#include "propfile.h"
+#include "libs/reslib.h"
+#include "libs/memlib.h"
+#include "libs/log.h"
+#include "types.h"
+
+#define PROPCACHE_MAGIC "UQMPROP"
+#define PROPCACHE_VERSION 1
+
+typedef struct
+{
+	char magic[8];
+	uint32 version;
+	uint32 numEntries;
+	uint32 poolSize;
+	uint32 nameOffset;
+			// of the source file location, in the pool
+	uint32 srcSize;
+	uint32 srcMtimeLow;
+	uint32 srcMtimeHigh;
+	uint32 reserved;
+} PropCacheHeader;
+
+typedef struct
+{
+	uint32 key;
+	uint32 value;
+} PropCacheEntry;
+
+typedef struct
+{
+	PropCacheEntry *entries;
+	uint32 numEntries;
+	uint32 maxEntries;
+
+	char *pool;
+	uint32 poolSize;
+	uint32 maxPool;
+
+	uint32 *intern;
+			// open addressing table of pool offsets + 1; 0 is empty
+	uint32 internSize;
+	uint32 numInterned;
+} PropCacheBuilder;
+
+// Where the pairs of the file being compiled are collected, and where
+// they go after that. PropFile_from_string() has no context argument.
+static PropCacheBuilder *curBuilder;
+static PROPERTY_HANDLER curHandler;
+static const char *curPrefix;
+
+
+static uint32
+hashString (const char *str)
+{
+	// FNV-1a
+	uint32 hash = 2166136261U;
+
+	for (; *str; ++str)
+	{
+		hash ^= (unsigned char) *str;
+		hash *= 16777619U;
+	}
+	return hash;
+}
+
+static void
+callHandler (PROPERTY_HANDLER handler, const char *prefix,
+		const char *key, const char *value)
+{
+	// Same as PropFile_from_string()
+	if (prefix)
+	{
+		char buf[256];
+		snprintf (buf, 255, "%s%s", prefix, key);
+		buf[255] = 0;
+		handler (buf, value);
+	}
+	else
+	{
+		handler (key, value);
+	}
+}
+
+static BOOLEAN
+growIntern (PropCacheBuilder *b)
+{
+	uint32 newSize = b->internSize ? b->internSize * 2 : 256;
+	uint32 *newTable = HCalloc (newSize * sizeof (uint32));
+	uint32 i;
+
+	if (!newTable)
+		return FALSE;
+
+	for (i = 0; i < b->internSize; ++i)
+	{
+		uint32 slot;
+
+		if (b->intern[i] == 0)
+			continue;
+		slot = hashString (b->pool + b->intern[i] - 1) & (newSize - 1);
+		while (newTable[slot] != 0)
+			slot = (slot + 1) & (newSize - 1);
+		newTable[slot] = b->intern[i];
+	}
+
+	HFree (b->intern);
+	b->intern = newTable;
+	b->internSize = newSize;
+	return TRUE;
+}
+
+// Returns the pool offset of 'str', adding it if it is not there yet,
+// or (uint32)~0 when out of memory.
+static uint32
+internString (PropCacheBuilder *b, const char *str)
+{
+	uint32 len = strlen (str) + 1;
+	uint32 slot;
+
+	if ((b->numInterned + 1) * 2 > b->internSize && !growIntern (b))
+		return ~(uint32)0;
+
+	slot = hashString (str) & (b->internSize - 1);
+	while (b->intern[slot] != 0)
+	{
+		if (strcmp (b->pool + b->intern[slot] - 1, str) == 0)
+			return b->intern[slot] - 1;
+		slot = (slot + 1) & (b->internSize - 1);
+	}
+
+	if (b->poolSize + len > b->maxPool)
+	{
+		uint32 newMax = b->maxPool ? b->maxPool * 2 : 4096;
+		char *newPool;
+
+		while (newMax < b->poolSize + len)
+			newMax *= 2;
+		newPool = HRealloc (b->pool, newMax);
+		if (!newPool)
+			return ~(uint32)0;
+		b->pool = newPool;
+		b->maxPool = newMax;
+	}
+
+	memcpy (b->pool + b->poolSize, str, len);
+	b->intern[slot] = b->poolSize + 1;
+	b->numInterned++;
+	b->poolSize += len;
+	return b->poolSize - len;
+}
+
+static BOOLEAN
+addEntry (PropCacheBuilder *b, const char *key, const char *value)
+{
+	PropCacheEntry *entry;
+
+	if (b->numEntries == b->maxEntries)
+	{
+		uint32 newMax = b->maxEntries ? b->maxEntries * 2 : 256;
+		PropCacheEntry *newEntries = HRealloc (b->entries,
+				newMax * sizeof (PropCacheEntry));
+		if (!newEntries)
+			return FALSE;
+		b->entries = newEntries;
+		b->maxEntries = newMax;
+	}
+
+	entry = &b->entries[b->numEntries];
+	entry->key = internString (b, key);
+	entry->value = internString (b, value);
+	if (entry->key == ~(uint32)0 || entry->value == ~(uint32)0)
+		return FALSE;
+	b->numEntries++;
+	return TRUE;
+}
+
+static void
+freeBuilder (PropCacheBuilder *b)
+{
+	HFree (b->entries);
+	HFree (b->pool);
+	HFree (b->intern);
+}
+
+static void
+recordingHandler (const char *key, const char *value)
+{
+	if (curBuilder && !addEntry (curBuilder, key, value))
+	{
+		// Out of memory; stop recording but keep loading
+		freeBuilder (curBuilder);
+		curBuilder = NULL;
+	}
+	callHandler (curHandler, curPrefix, key, value);
+}
+
+// 'location' is the path of the source inside the file system it is
+// mounted from, so index files with the same name in different addons
+// get different cache files.
+static void
+cacheFileName (char *buf, size_t size, const char *location)
+{
+	const char *base = strrchr (location, '/');
+
+	base = base ? base + 1 : location;
+	snprintf (buf, size, "%.40s-%08x.bin", base, hashString (location));
+}
+
+static BOOLEAN
+loadCacheFile (uio_DirHandle *cacheDir, const char *cacheName,
+		const char *location, const struct stat *sb, PROPERTY_HANDLER handler,
+		const char *prefix)
+{
+	uio_Stream *f;
+	size_t len;
+	const char *data;
+	char *buf = NULL;
+	const PropCacheHeader *header;
+	const PropCacheEntry *entries;
+	const char *pool;
+	uint32 i;
+	uint64 mtime = (uint64) sb->st_mtime;
+	BOOLEAN ok = FALSE;
+
+	f = uio_fopen (cacheDir, cacheName, "rb");
+	if (!f)
+		return FALSE;
+
+	// The mapping stays valid until the stream is closed
+	data = uio_getMappedData (uio_streamHandle (f), &len);
+	if (!data)
+	{	// No mapping here; read the file in one go
+		if (uio_fseek (f, 0, SEEK_END) != 0)
+			goto out;
+		len = uio_ftell (f);
+		if (uio_fseek (f, 0, SEEK_SET) != 0
+				|| len < sizeof (PropCacheHeader))
+			goto out;
+		buf = HMalloc (len);
+		if (!buf || uio_fread (buf, 1, len, f) != len)
+			goto out;
+		data = buf;
+	}
+	if (len < sizeof (PropCacheHeader))
+		goto out;
+
+	header = (const PropCacheHeader *) data;
+	entries = (const PropCacheEntry *) (header + 1);
+	pool = (const char *) (entries + header->numEntries);
+	if (memcmp (header->magic, PROPCACHE_MAGIC, sizeof header->magic) != 0
+			|| header->version != PROPCACHE_VERSION
+			|| header->numEntries > (len - sizeof (PropCacheHeader))
+				/ sizeof (PropCacheEntry)
+			|| len != sizeof (PropCacheHeader) + header->numEntries
+				* sizeof (PropCacheEntry) + header->poolSize
+			|| header->poolSize == 0 || pool[header->poolSize - 1] != '\0'
+			|| header->nameOffset >= header->poolSize
+			|| strcmp (pool + header->nameOffset, location) != 0
+			|| header->srcSize != (uint32) sb->st_size
+			|| header->srcMtimeLow != (uint32) mtime
+			|| header->srcMtimeHigh != (uint32) (mtime >> 32))
+		goto out;  // Stale or damaged; rebuild it
+
+	for (i = 0; i < header->numEntries; ++i)
+	{
+		if (entries[i].key >= header->poolSize
+				|| entries[i].value >= header->poolSize)
+			goto out;
+	}
+
+	for (i = 0; i < header->numEntries; ++i)
+	{
+		callHandler (handler, prefix, pool + entries[i].key,
+				pool + entries[i].value);
+	}
+	ok = TRUE;
+
+out:
+	uio_fclose (f);
+	HFree (buf);
+	return ok;
+}
+
+static void
+saveCacheFile (uio_DirHandle *cacheDir, const char *cacheName,
+		const char *location, const struct stat *sb, PropCacheBuilder *b)
+{
+	char tmpName[64];
+	uio_Stream *f;
+	PropCacheHeader header;
+	uint64 mtime = (uint64) sb->st_mtime;
+	BOOLEAN ok;
+
+	memset (&header, 0, sizeof header);
+	memcpy (header.magic, PROPCACHE_MAGIC, sizeof header.magic);
+	header.version = PROPCACHE_VERSION;
+	header.nameOffset = internString (b, location);
+	if (header.nameOffset == ~(uint32)0)
+		return;
+	header.numEntries = b->numEntries;
+	header.poolSize = b->poolSize;
+	header.srcSize = (uint32) sb->st_size;
+	header.srcMtimeLow = (uint32) mtime;
+	header.srcMtimeHigh = (uint32) (mtime >> 32);
+
+	// Write to a temporary file first, so that an interrupted write
+	// doesn't leave a truncated cache file behind.
+	snprintf (tmpName, sizeof tmpName, "%s.tmp", cacheName);
+	f = uio_fopen (cacheDir, tmpName, "wb");
+	if (!f)
+		return;
+	ok = uio_fwrite (&header, sizeof header, 1, f) == 1
+			&& (b->numEntries == 0 || uio_fwrite (b->entries,
+				sizeof (PropCacheEntry), b->numEntries, f)
+				== b->numEntries)
+			&& uio_fwrite (b->pool, 1, b->poolSize, f) == b->poolSize;
+	uio_fclose (f);
+
+	uio_unlink (cacheDir, cacheName);
+	if (!ok || uio_rename (cacheDir, tmpName, cacheDir, cacheName) != 0)
+	{
+		log_add (log_Debug, "Could not write property cache '%s'.",
+				cacheName);
+		uio_unlink (cacheDir, tmpName);
+	}
+}
+
+void
+PropFile_from_filename_cached (uio_DirHandle *path, const char *fname,
+		PROPERTY_HANDLER handler, const char *prefix,
+		uio_DirHandle *cacheDir)
+{
+	struct stat sb;
+	uio_MountHandle *mountHandle;
+	char *location;
+	char cacheName[64];
+	PropCacheBuilder builder;
+	uio_Stream *f;
+
+	if (!cacheDir || uio_stat (path, fname, &sb) != 0 || S_ISDIR (sb.st_mode)
+			|| uio_getFileLocation (path, fname, O_RDONLY, &mountHandle,
+				&location) != 0)
+	{
+		PropFile_from_filename (path, fname, handler, prefix);
+		return;
+	}
+
+	cacheFileName (cacheName, sizeof cacheName, location);
+	if (loadCacheFile (cacheDir, cacheName, location, &sb, handler, prefix))
+	{
+		free (location);
+				// allocated by uio with plain malloc()
+		return;
+	}
+
+	f = res_OpenResFile (path, fname, "rt");
+	if (!f)
+	{
+		free (location);
+		return;
+	}
+
+	memset (&builder, 0, sizeof builder);
+	curBuilder = &builder;
+	curHandler = handler;
+	curPrefix = prefix;
+	PropFile_from_file (f, recordingHandler, NULL);
+	res_CloseResFile (f);
+
+	if (curBuilder)
+	{
+		saveCacheFile (cacheDir, cacheName, location, &sb, &builder);
+		freeBuilder (&builder);
+	}
+	curBuilder = NULL;
+	curHandler = NULL;
+	curPrefix = NULL;
+	free (location);
+}
@@ -26,5 +26,6 @@ typedef void (*PROPERTY_HANDLER) (const char *, const char *);
 void PropFile_from_string (char *d, PROPERTY_HANDLER handler, const char *prefix);
 void PropFile_from_file (uio_Stream *f, PROPERTY_HANDLER handler, const char *prefix);
 void PropFile_from_filename (uio_DirHandle *path, const char *fname, PROPERTY_HANDLER handler, const char *prefix);
+void PropFile_from_filename_cached (uio_DirHandle *path, const char *fname, PROPERTY_HANDLER handler, const char *prefix, uio_DirHandle *cacheDir);
 
 #endif
@@ -108,6 +108,9 @@ newResourceDesc (const char *res_id, const char *resval)
 	result->fname[pathlen] = '\0';
 	result->vtable = vtable;
 	result->refcount = 0;
+	result->prefetch_state = PREFETCH_NONE;
+	result->prefetch_cancelled = FALSE;
+	result->prefetch_next = NULL;
 	
 	if (vtable->freeFun == NULL)
 	{
@@ -370,6 +373,17 @@ LoadResourceIndex (uio_DirHandle *dir, const char *rmpfile, const char *prefix)
 	PropFile_from_filename (dir, rmpfile, process_resource_desc, prefix);
 }
 
+// As LoadResourceIndex(), but goes through a compiled copy of the file
+// in the cache dir. For content indices, which rarely change; not for
+// config files.
+void
+LoadCompiledResourceIndex (uio_DirHandle *dir, const char *rmpfile,
+		const char *prefix)
+{
+	PropFile_from_filename_cached (dir, rmpfile, process_resource_desc,
+			prefix, cacheDir);
+}
+
 static int strptrcmp (const void *a, const void *b)
 {
 	const char *str_a = *(const char **)a;
@@ -448,6 +462,7 @@ SaveResourceIndex (uio_DirHandle *dir, const char *rmpfile, const char *root, BO
 void
 UninitResourceSystem (void)
 {
+	UninitResourcePrefetch ();
 	freeResourceIndex (_get_current_index_header ());
 	_set_current_index_header (NULL);
 }
@@ -485,6 +500,10 @@ InstallResTypeVectors (const char *resType, ResourceLoadFun *loadFun,
 	result->fname[typelen] = '\0';
 	result->vtable = NULL;
 	result->resdata.ptr = handlers;
+	result->refcount = 0;
+	result->prefetch_state = PREFETCH_NONE;
+	result->prefetch_cancelled = FALSE;
+	result->prefetch_next = NULL;
 
 	map = _get_current_index_header ()->map;
 	return CharHashTable_add (map, key, result) != 0;
@@ -664,6 +683,7 @@ res_Remove (const char *key)
 	ResourceDesc *oldDesc = (ResourceDesc *)CharHashTable_find (map, key);
 	if (oldDesc != NULL)
 	{
+		claimPrefetchedDesc (oldDesc);
 		if (oldDesc->resdata.ptr != NULL)
 		{
 			if (oldDesc->refcount > 0)
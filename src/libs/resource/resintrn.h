@@ -29,6 +29,11 @@ void loadResourceDesc (ResourceDesc *desc);
 void _set_current_index_header (RESOURCE_INDEX newResourceIndex);
 RESOURCE_INDEX _get_current_index_header (void);
 
+BOOLEAN lockResourceLoads (void);
+void unlockResourceLoads (void);
+void claimPrefetchedDesc (ResourceDesc *desc);
+void UninitResourcePrefetch (void);
+
 
 #endif /* LIBS_RESOURCE_RESINTRN_H_ */
 
@@ -36,6 +36,7 @@ enum
 #define audio_QUALITY_HIGH   (1 << 0)
 #define audio_QUALITY_MEDIUM (1 << 1)
 #define audio_QUALITY_LOW    (1 << 2)
+#define audio_QUALITY_BEST   (1 << 3)
 
 
 /* Interface Types */
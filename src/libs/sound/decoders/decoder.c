@@ -32,6 +32,7 @@
 #	include "oggaud.h"
 #endif  /* OVCODEC_NONE */
 #include "aiffaud.h"
+#include "soundcache.h"
 
 
 #define MAX_REG_DECODERS 31
@@ -79,8 +80,6 @@ typedef struct tfb_bufsounddecoder
 
 } TFB_BufSoundDecoder;
 
-#define SD_MIN_SIZE   (sizeof (TFB_BufSoundDecoder))
-
 static const char* nula_GetName (void);
 static bool nula_InitModule (int flags, const TFB_DecoderFormats*);
 static void nula_TermModule (void);
@@ -120,8 +119,62 @@ typedef struct tfb_nullsounddecoder
 
 } TFB_NullSoundDecoder;
 
+static const char* pcma_GetName (void);
+static bool pcma_InitModule (int flags, const TFB_DecoderFormats*);
+static void pcma_TermModule (void);
+static uint32 pcma_GetStructSize (void);
+static int pcma_GetError (THIS_PTR);
+static bool pcma_Init (THIS_PTR);
+static void pcma_Term (THIS_PTR);
+static bool pcma_Open (THIS_PTR, uio_DirHandle *dir, const char *filename);
+static void pcma_Close (THIS_PTR);
+static int pcma_Decode (THIS_PTR, void* buf, sint32 bufsize);
+static uint32 pcma_Seek (THIS_PTR, uint32 pcm_pos);
+static uint32 pcma_GetFrame (THIS_PTR);
+static void pcma_Attach (THIS_PTR, TFB_SoundCacheEntry *entry);
+
+TFB_SoundDecoderFuncs pcma_DecoderVtbl = 
+{
+	pcma_GetName,
+	pcma_InitModule,
+	pcma_TermModule,
+	pcma_GetStructSize,
+	pcma_GetError,
+	pcma_Init,
+	pcma_Term,
+	pcma_Open,
+	pcma_Close,
+	pcma_Decode,
+	pcma_Seek,
+	pcma_GetFrame,
+};
+
+// Plays back a decoded-PCM cache entry
+typedef struct tfb_cachesounddecoder
+{
+	// always the first member
+	TFB_SoundDecoder decoder;
+
+	// private
+	TFB_SoundCacheEntry *entry;
+	uint32 cur_pcm;
+
+} TFB_CacheSoundDecoder;
+
 #undef THIS_PTR
 
+// Decoders switch to the Buffer or Cached decoder in place
+#define SD_MIN_SIZE   ((sizeof (TFB_BufSoundDecoder) \
+		> sizeof (TFB_CacheSoundDecoder)) ? sizeof (TFB_BufSoundDecoder) \
+		: sizeof (TFB_CacheSoundDecoder))
+
+struct tfb_soundcapture
+{
+	uint8 *data;
+	uint32 size;
+	uint32 alloc;
+};
+
 
 struct TFB_RegSoundDecoder
 {
@@ -203,6 +256,8 @@ SoundDecoder_Init (int flags, TFB_DecoderFormats *formats)
 
 	sd_flags = flags;
 
+	SoundCache_Init ();
+
 	return ret;
 }
 
@@ -211,6 +266,8 @@ SoundDecoder_Uninit (void)
 {
 	TFB_RegSoundDecoder* info;
 
+	SoundCache_Uninit ();
+
 	// uninit all decoders
 	// and unregister loaded decoders
 	for (info = sd_decoders; info->used; info++)
@@ -318,6 +375,204 @@ SoundDecoder_Lookup (const char* fileext)
 	return info->ext ? info->funcs : NULL;
 }
 
+static uint32
+sd_GetBytesPerSample (uint32 format)
+{
+	if (format == decoder_formats.mono8)
+		return 1;
+	else if (format == decoder_formats.mono16)
+		return 2;
+	else if (format == decoder_formats.stereo8)
+		return 2;
+	else if (format == decoder_formats.stereo16)
+		return 4;
+	return 0;
+}
+
+static TFB_SoundDecoder*
+sd_OpenDecoder (const TFB_SoundDecoderFuncs *funcs, uio_DirHandle *dir,
+		const char *filename)
+{
+	TFB_SoundDecoder* decoder;
+	uint32 struct_size;
+
+	struct_size = funcs->GetStructSize ();
+	if (struct_size < SD_MIN_SIZE)
+		struct_size = SD_MIN_SIZE;
+
+	decoder = (TFB_SoundDecoder*) HCalloc (struct_size);
+	decoder->funcs = funcs;
+	if (!decoder->funcs->Init (decoder))
+	{
+		log_add (log_Warning, "SoundDecoder_Load(): "
+				"%s decoder instance failed init",
+				decoder->funcs->GetName ());
+		HFree (decoder);
+		return NULL;
+	}
+
+	if (!decoder->funcs->Open (decoder, dir, filename))
+	{
+		log_add (log_Warning, "SoundDecoder_Load(): "
+				"%s decoder could not load %s",
+				decoder->funcs->GetName (), filename);
+		decoder->funcs->Term (decoder);
+		HFree (decoder);
+		return NULL;
+	}
+
+	return decoder;
+}
+
+// Whether a freshly opened decoder's output may go into the cache.
+// Tracker modules are left out: they are long, loop internally and
+// seek by time rather than by sample. Video audio (.duk) is left out
+// too, as the video player syncs to the decoder's frame numbers.
+static bool
+sd_IsCacheable (TFB_SoundDecoder *decoder)
+{
+	double bytes;
+
+	if (decoder->is_null || decoder->bytes_per_samp == 0
+			|| decoder->funcs == &moda_DecoderVtbl
+			|| decoder->funcs == &duka_DecoderVtbl
+			|| decoder->funcs == &pcma_DecoderVtbl)
+		return false;
+
+	bytes = (double)decoder->length * decoder->frequency
+			* decoder->bytes_per_samp;
+	return bytes > 0 && bytes <= SoundCache_GetMaxEntrySize ();
+}
+
+static void
+sd_SwapDecoded (TFB_SoundDecoder *decoder, void *data, uint32 size)
+{
+	if (decoder->need_swap && size > 0 &&
+			(decoder->format == decoder_formats.stereo16 ||
+			decoder->format == decoder_formats.mono16))
+	{
+		SoundDecoder_SwapWords (data, size);
+	}
+}
+
+// Decodes a whole freshly opened file into a new cache entry and
+// switches the decoder over to playing it back
+static void
+sd_DecodeToCache (TFB_SoundDecoder *decoder, uio_DirHandle *dir,
+		const char *filename)
+{
+	uint32 max_size = SoundCache_GetMaxEntrySize ();
+	uint32 alloc = 0;
+	uint32 size = 0;
+	uint8 *data = NULL;
+	TFB_SoundCacheEntry *entry;
+	long rc;
+
+	do
+	{
+		if (size == alloc)
+		{
+			if (alloc >= max_size)
+			{	// Longer than it claimed; stream it instead
+				rc = -1;
+				break;
+			}
+			alloc = alloc ? alloc * 2 : 65536;
+			if (alloc > max_size)
+				alloc = max_size;
+			data = HRealloc (data, alloc);
+		}
+
+		rc = decoder->funcs->Decode (decoder, data + size, alloc - size);
+		if (rc > 0)
+			size += rc;
+	} while (rc > 0);
+
+	if (rc < 0 || size == 0)
+	{
+		HFree (data);
+		decoder->funcs->Seek (decoder, 0);
+		return;
+	}
+
+	sd_SwapDecoded (decoder, data, size);
+	data = HRealloc (data, size);
+	entry = SoundCache_Insert (dir, filename, data, size, decoder->format,
+			decoder->frequency, decoder->length);
+	if (!entry)
+	{
+		decoder->funcs->Seek (decoder, 0);
+		return;
+	}
+
+	// switch to Cached decoder
+	decoder->funcs->Close (decoder);
+	decoder->funcs->Term (decoder);
+
+	decoder->funcs = &pcma_DecoderVtbl;
+	decoder->funcs->Init (decoder);
+	pcma_Attach (decoder, entry);
+}
+
+static void
+sd_AbortCapture (TFB_SoundDecoder *decoder)
+{
+	if (!decoder->capture)
+		return;
+
+	HFree (decoder->capture->data);
+	HFree (decoder->capture);
+	decoder->capture = NULL;
+}
+
+static void
+sd_CaptureData (TFB_SoundDecoder *decoder, const void *data, uint32 size)
+{
+	TFB_SoundCapture *capture = decoder->capture;
+
+	if (size > capture->alloc - capture->size)
+	{
+		uint32 max_size = SoundCache_GetMaxEntrySize ();
+		uint32 alloc = capture->alloc ? capture->alloc : 65536;
+
+		while (alloc < capture->size + size && alloc < max_size)
+			alloc *= 2;
+		if (alloc > max_size)
+			alloc = max_size;
+		if (capture->size + size > alloc)
+		{	// Longer than it claimed
+			sd_AbortCapture (decoder);
+			return;
+		}
+
+		capture->data = HRealloc (capture->data, alloc);
+		capture->alloc = alloc;
+	}
+
+	memcpy (capture->data + capture->size, data, size);
+	capture->size += size;
+}
+
+// The decoder played through from the start, so the capture now holds
+// the whole file
+static void
+sd_FinishCapture (TFB_SoundDecoder *decoder)
+{
+	TFB_SoundCapture *capture = decoder->capture;
+	TFB_SoundCacheEntry *entry;
+
+	decoder->capture = NULL;
+
+	sd_SwapDecoded (decoder, capture->data, capture->size);
+	capture->data = HRealloc (capture->data, capture->size);
+	entry = SoundCache_Insert (decoder->dir, decoder->filename,
+			capture->data, capture->size, decoder->format,
+			decoder->frequency, decoder->length);
+	// This decoder keeps streaming from the file
+	SoundCache_Release (entry);
+	HFree (capture);
+}
+
 TFB_SoundDecoder*
 SoundDecoder_Load (uio_DirHandle *dir, char *filename,
 		uint32 buffer_size, uint32 startTime, sint32 runTime)
@@ -327,7 +582,7 @@ SoundDecoder_Load (uio_DirHandle *dir, char *filename,
 	TFB_RegSoundDecoder* info;
 	const TFB_SoundDecoderFuncs* funcs;
 	TFB_SoundDecoder* decoder;
-	uint32 struct_size;
+	TFB_SoundCacheEntry* entry;
 
 	pext = strrchr (filename, '.');
 	if (!pext)
@@ -379,29 +634,32 @@ SoundDecoder_Load (uio_DirHandle *dir, char *filename,
 		}
 	}
 
-	struct_size = funcs->GetStructSize ();
-	if (struct_size < SD_MIN_SIZE)
-		struct_size = SD_MIN_SIZE;
-
-	decoder = (TFB_SoundDecoder*) HCalloc (struct_size);
-	decoder->funcs = funcs;
-	if (!decoder->funcs->Init (decoder))
+	entry = NULL;
+	if (funcs != &nula_DecoderVtbl && funcs != &moda_DecoderVtbl
+			&& funcs != &duka_DecoderVtbl)
+		entry = SoundCache_Lookup (dir, filename);
+
+	if (entry)
+	{	// Already decoded; no need to touch the file at all
+		decoder = (TFB_SoundDecoder*) HCalloc (SD_MIN_SIZE);
+		decoder->funcs = &pcma_DecoderVtbl;
+		decoder->funcs->Init (decoder);
+		pcma_Attach (decoder, entry);
+	}
+	else
 	{
-		log_add (log_Warning, "SoundDecoder_Load(): "
-				"%s decoder instance failed init",
-				decoder->funcs->GetName ());
-		HFree (decoder);
-		return NULL;
+		decoder = sd_OpenDecoder (funcs, dir, filename);
+		if (!decoder)
+			return NULL;
 	}
 
-	if (!decoder->funcs->Open (decoder, dir, filename))
-	{
-		log_add (log_Warning, "SoundDecoder_Load(): "
-				"%s decoder could not load %s",
-				decoder->funcs->GetName (), filename);
-		decoder->funcs->Term (decoder);
-		HFree (decoder);
-		return NULL;
+	decoder->bytes_per_samp = sd_GetBytesPerSample (decoder->format);
+
+	if (!entry && runTime != 0 && sd_IsCacheable (decoder))
+	{	// Ranged loads come in series, one for each subtitle page of
+		// a speech track, so decode the whole file once and serve all
+		// of the ranges from the cache
+		sd_DecodeToCache (decoder, dir, filename);
 	}
 
 	decoder->buffer = HMalloc (buffer_size);
@@ -429,17 +687,14 @@ SoundDecoder_Load (uio_DirHandle *dir, char *filename,
 	if (decoder->start_sample != 0)
 		decoder->funcs->Seek (decoder, decoder->start_sample);
 
-	if (decoder->format == decoder_formats.mono8)
-		decoder->bytes_per_samp = 1;
-	else if (decoder->format == decoder_formats.mono16)
-		decoder->bytes_per_samp = 2;
-	else if (decoder->format == decoder_formats.stereo8)
-		decoder->bytes_per_samp = 2;
-	else if (decoder->format == decoder_formats.stereo16)
-		decoder->bytes_per_samp = 4;
-
 	decoder->pos = decoder->start_sample * decoder->bytes_per_samp;
 
+	if (startTime == 0 && runTime == 0 && decoder->funcs == funcs
+			&& sd_IsCacheable (decoder))
+	{	// Whole-file load; collect what gets decoded for the cache
+		decoder->capture = HCalloc (sizeof (TFB_SoundCapture));
+	}
+
 	return decoder;
 }
 
@@ -482,9 +737,13 @@ SoundDecoder_Decode (TFB_SoundDecoder *decoder)
 			log_add (log_Warning, "SoundDecoder_Decode(): "
 					"error decoding %s, code %ld",
 					decoder->filename, rc);
+			sd_AbortCapture (decoder);
 		}
 		else if (rc == 0)
 		{	// probably EOF
+			if (decoder->capture)
+				sd_FinishCapture (decoder);
+
 			if (decoder->looping)
 			{
 				SoundDecoder_Rewind (decoder);
@@ -510,10 +769,14 @@ SoundDecoder_Decode (TFB_SoundDecoder *decoder)
 		}
 		else
 		{	// some bytes decoded
+			if (decoder->capture)
+				sd_CaptureData (decoder, buffer + decoded_bytes, rc);
 			decoded_bytes += rc;
 		}
 	}
 	decoder->pos += decoded_bytes;
+	if (decoder->capture && decoder->pos >= max_bytes)
+		sd_FinishCapture (decoder);
 	if (rc < 0)
 		decoder->error = SOUNDDECODER_ERROR;
 	else if (rc == 0 || decoder->pos >= max_bytes)
@@ -578,13 +841,7 @@ SoundDecoder_DecodeAll (TFB_SoundDecoder *decoder)
 	// Free up some unused memory
 	decoder->buffer = HRealloc (decoder->buffer, decoded_bytes);
 
-	if (decoder->need_swap && decoded_bytes > 0 &&
-			(decoder->format == decoder_formats.stereo16 ||
-			decoder->format == decoder_formats.mono16))
-	{
-		SoundDecoder_SwapWords (
-				decoder->buffer, decoded_bytes);
-	}
+	sd_SwapDecoded (decoder, decoder->buffer, decoded_bytes);
 
 	if (rc < 0)
 	{
@@ -592,9 +849,22 @@ SoundDecoder_DecodeAll (TFB_SoundDecoder *decoder)
 		log_add (log_Warning, "SoundDecoder_DecodeAll(): "
 				"error decoding %s, code %ld",
 				decoder->filename, rc);
+		sd_AbortCapture (decoder);
 		return decoded_bytes;
 	}
 
+	if (decoder->capture && decoder->capture->size == 0
+			&& decoded_bytes <= SoundCache_GetMaxEntrySize ())
+	{	// Decoded from the very start; keep a copy for next time
+		uint8 *data = HMalloc (decoded_bytes);
+
+		memcpy (data, decoder->buffer, decoded_bytes);
+		SoundCache_Release (SoundCache_Insert (decoder->dir,
+				decoder->filename, data, decoded_bytes,
+				decoder->format, decoder->frequency, decoder->length));
+	}
+	sd_AbortCapture (decoder);
+
 	// switch to Buffer decoder
 	decoder->funcs->Close (decoder);
 	decoder->funcs->Term (decoder);
@@ -608,6 +878,69 @@ SoundDecoder_DecodeAll (TFB_SoundDecoder *decoder)
 	return decoded_bytes;
 }
 
+// Decodes the sound files listed in 'listfile', one per line, into the
+// cache ahead of their first use. Returns the number of files cached.
+int
+SoundDecoder_PrewarmCache (uio_DirHandle *dir, const char *listfile)
+{
+	uio_Stream *fp;
+	char line[1024];
+	char filename[1024];
+	int count = 0;
+
+	fp = uio_fopen (dir, listfile, "r");
+	if (!fp)
+	{
+		log_add (log_Warning, "SoundDecoder_PrewarmCache(): "
+				"could not open %s", listfile);
+		return 0;
+	}
+
+	while (uio_fgets (line, sizeof (line), fp))
+	{
+		const char *pext;
+		const TFB_SoundDecoderFuncs *funcs;
+		TFB_SoundDecoder *decoder;
+
+		if (sscanf (line, "%1023s", filename) != 1 || filename[0] == '#')
+			continue;
+
+		pext = strrchr (filename, '.');
+		funcs = pext ? SoundDecoder_Lookup (pext + 1) : NULL;
+		if (!funcs || !fileExists2 (dir, filename))
+		{
+			log_add (log_Warning, "SoundDecoder_PrewarmCache(): "
+					"cannot load %s", filename);
+			continue;
+		}
+
+		decoder = sd_OpenDecoder (funcs, dir, filename);
+		if (!decoder)
+			continue;
+		decoder->bytes_per_samp = sd_GetBytesPerSample (decoder->format);
+
+		if (sd_IsCacheable (decoder))
+		{
+			sd_DecodeToCache (decoder, dir, filename);
+			if (decoder->funcs == &pcma_DecoderVtbl)
+				++count;
+		}
+		else
+		{
+			log_add (log_Info, "SoundDecoder_PrewarmCache(): "
+					"%s is not cacheable", filename);
+		}
+
+		SoundDecoder_Free (decoder);
+	}
+
+	uio_fclose (fp);
+
+	log_add (log_Info, "SoundDecoder_PrewarmCache(): cached %d sounds "
+			"from %s", count, listfile);
+	return count;
+}
+
 void
 SoundDecoder_Rewind (TFB_SoundDecoder *decoder)
 {
@@ -628,6 +961,10 @@ SoundDecoder_Seek (TFB_SoundDecoder *decoder, uint32 seekTime)
 		return;
 	}
 
+	// Anything but a rewind before the first decode leaves a gap
+	if (decoder->capture && (seekTime != 0 || decoder->capture->size != 0))
+		sd_AbortCapture (decoder);
+
 	if (strcmp (SoundDecoder_GetName (decoder), "MikMod") != 0)
 	{
 		pcm_pos = (uint32)(seekTime / 1000.0f * decoder->frequency);
@@ -655,6 +992,7 @@ SoundDecoder_Free (TFB_SoundDecoder *decoder)
 	decoder->funcs->Close (decoder);
 	decoder->funcs->Term (decoder);
 
+	sd_AbortCapture (decoder);
 	HFree (decoder->buffer);
 	HFree (decoder->filename);
 	HFree (decoder);
@@ -939,3 +1277,146 @@ nula_GetFrame (THIS_PTR)
 
 	(void)This; // laugh at compiler warning
 }
+
+
+static const char*
+pcma_GetName (void)
+{
+	return "Cached";
+}
+
+static bool
+pcma_InitModule (int flags, const TFB_DecoderFormats* fmts)
+{
+	// this should never be called
+	log_add (log_Debug, "pcma_InitModule(): dead function called");
+	return false;
+	
+	(void)flags; (void)fmts; // laugh at compiler warning
+}
+
+static void
+pcma_TermModule (void)
+{
+	// this should never be called
+	log_add (log_Debug, "pcma_TermModule(): dead function called");
+}
+
+static uint32
+pcma_GetStructSize (void)
+{
+	return sizeof (TFB_CacheSoundDecoder);
+}
+
+static int
+pcma_GetError (THIS_PTR)
+{
+	return 0; // error? what error?!
+
+	(void)This;	// laugh at compiler warning
+}
+
+static bool
+pcma_Init (THIS_PTR)
+{
+	TFB_CacheSoundDecoder* pcma = (TFB_CacheSoundDecoder*) This;
+	
+	This->need_swap = false;
+	pcma->entry = NULL;
+	pcma->cur_pcm = 0;
+	return true;
+}
+
+static void
+pcma_Attach (THIS_PTR, TFB_SoundCacheEntry *entry)
+{
+	TFB_CacheSoundDecoder* pcma = (TFB_CacheSoundDecoder*) This;
+
+	// the entry reference passes to the decoder
+	pcma->entry = entry;
+	pcma->cur_pcm = 0;
+	This->format = entry->format;
+	This->frequency = entry->frequency;
+	This->length = entry->length;
+	This->is_null = false;
+}
+
+static void
+pcma_Term (THIS_PTR)
+{
+	//TFB_CacheSoundDecoder* pcma = (TFB_CacheSoundDecoder*) This;
+	pcma_Close (This); // ensure cleanup
+}
+
+static bool
+pcma_Open (THIS_PTR, uio_DirHandle *dir, const char *filename)
+{
+	// this should never be called
+	log_add (log_Debug, "pcma_Open(): dead function called");
+	return false;
+
+	// laugh at compiler warnings
+	(void)This; (void)dir; (void)filename;
+}
+
+static void
+pcma_Close (THIS_PTR)
+{
+	TFB_CacheSoundDecoder* pcma = (TFB_CacheSoundDecoder*) This;
+
+	SoundCache_Release (pcma->entry);
+	pcma->entry = NULL;
+	pcma->cur_pcm = 0;
+}
+
+static int
+pcma_Decode (THIS_PTR, void* buf, sint32 bufsize)
+{
+	TFB_CacheSoundDecoder* pcma = (TFB_CacheSoundDecoder*) This;
+	uint32 max_pcm;
+	uint32 dec_pcm;
+	uint32 dec_bytes;
+
+	if (!pcma->entry)
+		return 0;
+
+	max_pcm = pcma->entry->size / This->bytes_per_samp;
+	dec_pcm = bufsize / This->bytes_per_samp;
+	if (dec_pcm > max_pcm - pcma->cur_pcm)
+		dec_pcm = max_pcm - pcma->cur_pcm;
+	dec_bytes = dec_pcm * This->bytes_per_samp;
+
+	if (dec_pcm > 0)
+	{
+		memcpy (buf, (uint8*) pcma->entry->data
+				+ pcma->cur_pcm * This->bytes_per_samp, dec_bytes);
+		pcma->cur_pcm += dec_pcm;
+	}
+
+	return dec_bytes;
+}
+
+static uint32
+pcma_Seek (THIS_PTR, uint32 pcm_pos)
+{
+	TFB_CacheSoundDecoder* pcma = (TFB_CacheSoundDecoder*) This;
+	uint32 max_pcm;
+
+	if (!pcma->entry)
+		return 0;
+
+	max_pcm = pcma->entry->size / This->bytes_per_samp;
+	if (pcm_pos > max_pcm)
+		pcm_pos = max_pcm;
+	pcma->cur_pcm = pcm_pos;
+
+	return pcm_pos;
+}
+
+static uint32
+pcma_GetFrame (THIS_PTR)
+{
+	return 0; // only 1 frame
+
+	(void)This; // laugh at compiler warning
+}
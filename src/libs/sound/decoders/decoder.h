@@ -53,6 +53,7 @@ typedef enum
 
 // forward-declare
 typedef struct tfb_sounddecoder TFB_SoundDecoder;
+typedef struct tfb_soundcapture TFB_SoundCapture;
 
 #define THIS_PTR TFB_SoundDecoder*
 
@@ -109,6 +110,8 @@ struct tfb_sounddecoder
 		// for tracker modules
 	uint32 filename_hash;
 		// for music resume
+	TFB_SoundCapture *capture;
+		// PCM collected for the cache while streaming from the start
 };
 
 // return values
@@ -121,6 +124,18 @@ enum
 
 typedef struct TFB_RegSoundDecoder TFB_RegSoundDecoder;
 
+typedef struct tfb_soundcachestats
+{
+	uint32 hits;
+	uint32 misses;
+	uint32 inserts;
+	uint32 evictions;
+	uint32 entries;
+	uint32 bytes;
+	uint32 peak_bytes;
+	uint32 limit;
+} TFB_SoundCacheStats;
+
 TFB_RegSoundDecoder* SoundDecoder_Register (const char* fileext,
 		TFB_SoundDecoderFuncs* decvtbl);
 void SoundDecoder_Unregister (TFB_RegSoundDecoder* regdec);
@@ -140,6 +155,12 @@ void SoundDecoder_Rewind (TFB_SoundDecoder *decoder);
 void SoundDecoder_Free (TFB_SoundDecoder *decoder);
 const char* SoundDecoder_GetName (TFB_SoundDecoder *decoder);
 
+// Decoded-PCM cache shared by all decoders; a limit of 0 disables it
+#define SOUND_CACHE_DEFAULT_KB 16384
+void SoundDecoder_SetCacheLimit (uint32 bytes);
+void SoundDecoder_GetCacheStats (TFB_SoundCacheStats *stats);
+int SoundDecoder_PrewarmCache (uio_DirHandle *dir, const char *listfile);
+
 extern uint32_t crc32b (const char *str);
 
 #endif
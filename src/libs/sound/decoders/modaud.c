@@ -257,7 +257,7 @@ moda_InitModule (int flags, const TFB_DecoderFormats* fmts)
     MikMod_RegisterDriver (&moda_mmout_drv);
     MikMod_RegisterAllLoaders ();
 
-	if (flags & audio_QUALITY_HIGH)
+	if (flags & (audio_QUALITY_HIGH | audio_QUALITY_BEST))
 	{
 		md_mode = DMODE_HQMIXER|DMODE_STEREO|DMODE_16BITS|DMODE_INTERP|DMODE_SURROUND;
 		md_mixfreq = 44100;
@@ -75,6 +75,13 @@ typedef struct tfb_oggsounddecoder
 	sint32 last_error;
 	OggVorbis_File vf;
 
+	// Used instead of reading through the stream, when the file
+	// data can be accessed directly
+	uio_Stream *stream;
+	const char *data;
+	size_t size;
+	size_t pos;
+
 } TFB_OggSoundDecoder;
 
 static const TFB_DecoderFormats* ova_formats = NULL;
@@ -112,6 +119,67 @@ static const ov_callbacks ogg_callbacks =
 	ogg_tell,
 };
 
+static size_t
+ogg_readMapped (void *ptr, size_t size, size_t nmemb, void *datasource)
+{
+	TFB_OggSoundDecoder* ova = (TFB_OggSoundDecoder*) datasource;
+	size_t left = ova->size - ova->pos;
+
+	if (size == 0)
+		return 0;
+	if (nmemb > left / size)
+		nmemb = left / size;
+	memcpy (ptr, ova->data + ova->pos, nmemb * size);
+	ova->pos += nmemb * size;
+	return nmemb;
+}
+
+static int
+ogg_seekMapped (void *datasource, ogg_int64_t offset, int whence)
+{
+	TFB_OggSoundDecoder* ova = (TFB_OggSoundDecoder*) datasource;
+
+	switch (whence)
+	{
+		case SEEK_CUR:
+			offset += ova->pos;
+			break;
+		case SEEK_END:
+			offset += ova->size;
+			break;
+	}
+	if (offset < 0 || (ogg_int64_t) ova->size < offset)
+		return -1;
+	ova->pos = (size_t) offset;
+	return 0;
+}
+
+static int
+ogg_closeMapped (void *datasource)
+{
+	TFB_OggSoundDecoder* ova = (TFB_OggSoundDecoder*) datasource;
+	int ret = uio_fclose (ova->stream);
+
+	ova->stream = NULL;
+	ova->data = NULL;
+	return ret;
+}
+
+static long
+ogg_tellMapped (void *datasource)
+{
+	TFB_OggSoundDecoder* ova = (TFB_OggSoundDecoder*) datasource;
+	return (long) ova->pos;
+}
+
+static const ov_callbacks ogg_mappedCallbacks =
+{
+	ogg_readMapped,
+	ogg_seekMapped,
+	ogg_closeMapped,
+	ogg_tellMapped,
+};
+
 static const char*
 ova_GetName (void)
 {
@@ -178,13 +246,25 @@ ova_Open (THIS_PTR, uio_DirHandle *dir, const char *filename)
 		return false;
 	}
 
-	rc = ov_open_callbacks (fp, &ova->vf, NULL, 0, ogg_callbacks);
+	ova->data = uio_getMappedData (uio_streamHandle (fp), &ova->size);
+	if (ova->data)
+	{
+		ova->stream = fp;
+		ova->pos = 0;
+		rc = ov_open_callbacks (ova, &ova->vf, NULL, 0, ogg_mappedCallbacks);
+	}
+	else
+	{
+		rc = ov_open_callbacks (fp, &ova->vf, NULL, 0, ogg_callbacks);
+	}
 	if (rc != 0)
 	{
 		log_add (log_Warning, "ova_Open(): "
 				"ov_open_callbacks failed for %s, error code %d",
 				filename, rc);
 		uio_fclose (fp);
+		ova->stream = NULL;
+		ova->data = NULL;
 		return false;
 	}
 
@@ -0,0 +1,315 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/* Size-bounded LRU cache of fully decoded PCM.
+ *
+ * Entries are keyed by directory and file name. The output format is
+ * fixed between SoundDecoder_Init() and SoundDecoder_Uninit(), which
+ * flushes the cache, so it does not need to be part of the key.
+ * Entries are reference counted: an evicted entry that a decoder is
+ * still reading from stays alive until that decoder lets go of it.
+ */
+
+#include <string.h>
+#include "soundcache.h"
+#include "libs/memlib.h"
+#include "libs/log.h"
+#include "libs/threadlib.h"
+
+
+#define CACHE_HASH_SIZE 64
+#define CACHE_DEFAULT_LIMIT (SOUND_CACHE_DEFAULT_KB * 1024)
+
+static TFB_SoundCacheEntry *cache_hash[CACHE_HASH_SIZE];
+static TFB_SoundCacheEntry *cache_head;
+		// most recently used
+static TFB_SoundCacheEntry *cache_tail;
+		// least recently used, evicted first
+static uint32 cache_limit = CACHE_DEFAULT_LIMIT;
+static TFB_SoundCacheStats cache_stats;
+static Mutex cache_mutex;
+
+
+static uint32
+hashName (uio_DirHandle *dir, const char *filename)
+{
+	// FNV-1a
+	uint32 hash = 2166136261U ^ (uint32)(uintptr_t)dir;
+
+	for (; *filename; ++filename)
+	{
+		hash ^= (unsigned char) *filename;
+		hash *= 16777619U;
+	}
+	return hash;
+}
+
+static void
+lockCache (void)
+{
+	if (cache_mutex)
+		LockMutex (cache_mutex);
+}
+
+static void
+unlockCache (void)
+{
+	if (cache_mutex)
+		UnlockMutex (cache_mutex);
+}
+
+static void
+freeEntry (TFB_SoundCacheEntry *entry)
+{
+	HFree (entry->data);
+	HFree (entry->filename);
+	HFree (entry);
+}
+
+static void
+unlinkLRU (TFB_SoundCacheEntry *entry)
+{
+	if (entry->prev_lru)
+		entry->prev_lru->next_lru = entry->next_lru;
+	else
+		cache_head = entry->next_lru;
+	if (entry->next_lru)
+		entry->next_lru->prev_lru = entry->prev_lru;
+	else
+		cache_tail = entry->prev_lru;
+	entry->prev_lru = NULL;
+	entry->next_lru = NULL;
+}
+
+static void
+linkLRUHead (TFB_SoundCacheEntry *entry)
+{
+	entry->prev_lru = NULL;
+	entry->next_lru = cache_head;
+	if (cache_head)
+		cache_head->prev_lru = entry;
+	else
+		cache_tail = entry;
+	cache_head = entry;
+}
+
+// Caller holds the cache mutex
+static void
+evictEntry (TFB_SoundCacheEntry *entry)
+{
+	TFB_SoundCacheEntry **link;
+
+	for (link = &cache_hash[entry->hash % CACHE_HASH_SIZE];
+			*link != entry; link = &(*link)->next_hash)
+		;
+	*link = entry->next_hash;
+	entry->next_hash = NULL;
+	unlinkLRU (entry);
+
+	entry->cached = false;
+	cache_stats.entries--;
+	cache_stats.bytes -= entry->size;
+
+	if (entry->refcount == 0)
+		freeEntry (entry);
+}
+
+// Caller holds the cache mutex
+static void
+trimCache (uint32 limit)
+{
+	while (cache_tail && cache_stats.bytes > limit)
+	{
+		evictEntry (cache_tail);
+		cache_stats.evictions++;
+	}
+}
+
+void
+SoundCache_Init (void)
+{
+	if (!cache_mutex)
+		cache_mutex = CreateMutex ("Sound cache mutex", SYNC_CLASS_AUDIO);
+	cache_stats.limit = cache_limit;
+}
+
+void
+SoundCache_Uninit (void)
+{
+	uint32 lookups = cache_stats.hits + cache_stats.misses;
+
+	if (lookups > 0)
+	{
+		log_add (log_Info, "Sound cache: %u hits, %u misses (%.1f%% hit "
+				"rate), %u inserts, %u evictions, peak %u KB",
+				cache_stats.hits, cache_stats.misses,
+				cache_stats.hits * 100.0 / lookups,
+				cache_stats.inserts, cache_stats.evictions,
+				cache_stats.peak_bytes / 1024);
+	}
+
+	lockCache ();
+	trimCache (0);
+	unlockCache ();
+
+	if (cache_mutex)
+	{
+		DestroyMutex (cache_mutex);
+		cache_mutex = 0;
+	}
+}
+
+void
+SoundDecoder_SetCacheLimit (uint32 bytes)
+{
+	lockCache ();
+	cache_limit = bytes;
+	cache_stats.limit = bytes;
+	trimCache (bytes);
+	unlockCache ();
+}
+
+void
+SoundDecoder_GetCacheStats (TFB_SoundCacheStats *stats)
+{
+	lockCache ();
+	*stats = cache_stats;
+	unlockCache ();
+}
+
+uint32
+SoundCache_GetMaxEntrySize (void)
+{
+	// Keep one long clip from flushing everything else
+	return cache_limit / 4;
+}
+
+TFB_SoundCacheEntry*
+SoundCache_Lookup (uio_DirHandle *dir, const char *filename)
+{
+	TFB_SoundCacheEntry *entry;
+	uint32 hash;
+
+	if (cache_limit == 0)
+		return NULL;
+
+	hash = hashName (dir, filename);
+
+	lockCache ();
+	for (entry = cache_hash[hash % CACHE_HASH_SIZE]; entry;
+			entry = entry->next_hash)
+	{
+		if (entry->hash == hash && entry->dir == dir
+				&& strcmp (entry->filename, filename) == 0)
+			break;
+	}
+
+	if (entry)
+	{
+		unlinkLRU (entry);
+		linkLRUHead (entry);
+		entry->refcount++;
+		cache_stats.hits++;
+	}
+	else
+	{
+		cache_stats.misses++;
+	}
+	unlockCache ();
+
+	return entry;
+}
+
+// Takes ownership of 'data'. Returns a referenced entry, or NULL if
+// the data was not cached (and has been freed).
+TFB_SoundCacheEntry*
+SoundCache_Insert (uio_DirHandle *dir, const char *filename, void *data,
+		uint32 size, uint32 format, uint32 frequency, float length)
+{
+	TFB_SoundCacheEntry *entry;
+	uint32 hash;
+
+	if (size == 0 || size > SoundCache_GetMaxEntrySize ())
+	{
+		HFree (data);
+		return NULL;
+	}
+
+	hash = hashName (dir, filename);
+
+	lockCache ();
+	for (entry = cache_hash[hash % CACHE_HASH_SIZE]; entry;
+			entry = entry->next_hash)
+	{
+		if (entry->hash == hash && entry->dir == dir
+				&& strcmp (entry->filename, filename) == 0)
+			break;
+	}
+
+	if (entry)
+	{	// Someone else got here first; share theirs
+		entry->refcount++;
+		unlockCache ();
+		HFree (data);
+		return entry;
+	}
+
+	entry = HCalloc (sizeof (*entry));
+	entry->data = data;
+	entry->size = size;
+	entry->format = format;
+	entry->frequency = frequency;
+	entry->length = length;
+	entry->dir = dir;
+	entry->filename = HMalloc (strlen (filename) + 1);
+	strcpy (entry->filename, filename);
+	entry->hash = hash;
+	entry->refcount = 1;
+	entry->cached = true;
+
+	entry->next_hash = cache_hash[hash % CACHE_HASH_SIZE];
+	cache_hash[hash % CACHE_HASH_SIZE] = entry;
+	linkLRUHead (entry);
+
+	cache_stats.inserts++;
+	cache_stats.entries++;
+	cache_stats.bytes += size;
+	if (cache_stats.bytes > cache_stats.peak_bytes)
+		cache_stats.peak_bytes = cache_stats.bytes;
+
+	// The new entry is at the head, so it goes last
+	trimCache (cache_limit);
+	unlockCache ();
+
+	return entry;
+}
+
+void
+SoundCache_Release (TFB_SoundCacheEntry *entry)
+{
+	bool dead;
+
+	if (!entry)
+		return;
+
+	lockCache ();
+	entry->refcount--;
+	dead = entry->refcount == 0 && !entry->cached;
+	unlockCache ();
+
+	if (dead)
+		freeEntry (entry);
+}
@@ -0,0 +1,63 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/* Process-wide cache of fully decoded PCM, used by the sound decoders.
+ * Internal to the decoders; the public interface is in decoder.h.
+ */
+
+#ifndef LIBS_SOUND_DECODERS_SOUNDCACHE_H_
+#define LIBS_SOUND_DECODERS_SOUNDCACHE_H_
+
+#include "port.h"
+#include "types.h"
+#include "libs/uio.h"
+#include "decoder.h"
+
+typedef struct tfb_soundcacheentry TFB_SoundCacheEntry;
+
+struct tfb_soundcacheentry
+{
+	// public R/O
+	void *data;
+			// PCM in the decoder output format, already byte-swapped
+	uint32 size;
+	uint32 format;
+	uint32 frequency;
+	float length;
+
+	// private
+	uio_DirHandle *dir;
+	char *filename;
+	uint32 hash;
+	int refcount;
+	bool cached;
+			// false once evicted; freed on the last release
+	TFB_SoundCacheEntry *next_hash;
+	TFB_SoundCacheEntry *prev_lru;
+	TFB_SoundCacheEntry *next_lru;
+};
+
+void SoundCache_Init (void);
+void SoundCache_Uninit (void);
+uint32 SoundCache_GetMaxEntrySize (void);
+TFB_SoundCacheEntry* SoundCache_Lookup (uio_DirHandle *dir,
+		const char *filename);
+TFB_SoundCacheEntry* SoundCache_Insert (uio_DirHandle *dir,
+		const char *filename, void *data, uint32 size, uint32 format,
+		uint32 frequency, float length);
+void SoundCache_Release (TFB_SoundCacheEntry *entry);
+
+#endif  /* LIBS_SOUND_DECODERS_SOUNDCACHE_H_ */
@@ -27,6 +27,16 @@
 #include "libs/log.h"
 #include "libs/memlib.h"
 
+#ifndef M_PI
+#	define M_PI 3.14159265358979323846
+#endif
+
+#if defined(USE_PLATFORM_ACCEL) && (defined(__SSE2__) || defined(_M_X64) \
+		|| (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#	define MIX_SSE2
+#	include <emmintrin.h>
+#endif
+
 static uint32 mixer_initialized = 0;
 static uint32 mixer_format;
 static uint32 mixer_chansize;
@@ -46,7 +56,24 @@ static RecursiveMutex buf_mutex;
 static RecursiveMutex act_mutex;
 
 #define MAX_SOURCES 8
-mixer_Source *active_sources[MAX_SOURCES];
+/* sources that are playing, packed at the front in activation order */
+static mixer_Source *active_sources[MAX_SOURCES];
+static uint32 active_count;
+
+/* number of channel samples mixed in one go; must be even */
+#define MIX_BLOCK_SAMPLES 1024
+/* only touched by the mixer callback, under the mutexes */
+static float mix_accum[MIX_BLOCK_SAMPLES];
+static float mix_scratch[MIX_BLOCK_SAMPLES];
+
+/* filter tables for sinc resampling, by source rate */
+static mixer_SincFilter sinc_filters[MIX_SINC_FILTERS];
+
+/* buffer processed notification; the flag is only touched
+ * by the mixer callback, under src_mutex
+ */
+static mixer_ProcessedCallback processed_callback;
+static bool processed_pending;
 
 
 /*************************************************
@@ -82,6 +109,7 @@ mixer_Init (uint32 frequency, uint32 format, mixer_Quality quality,
 
 	last_error = MIX_NO_ERROR;
 	memset (active_sources, 0, sizeof(mixer_Source*) * MAX_SOURCES);
+	active_count = 0;
 	
 	mixer_chansize = MIX_FORMAT_BPC (format);
 	mixer_channels = MIX_FORMAT_CHANS (format);
@@ -97,6 +125,11 @@ mixer_Init (uint32 frequency, uint32 format, mixer_Quality quality,
 		mixer_resampling.Upsample = mixer_UpsampleLinear;
 	else if (mixer_quality == MIX_QUALITY_HIGH)
 		mixer_resampling.Upsample = mixer_UpsampleCubic;
+	else if (mixer_quality == MIX_QUALITY_BEST)
+	{	/* band-limited both ways */
+		mixer_resampling.Upsample = mixer_ResampleSinc;
+		mixer_resampling.Downsample = mixer_ResampleSinc;
+	}
 	else
 		mixer_resampling.Upsample = mixer_ResampleNearest;
 
@@ -118,78 +151,326 @@ mixer_Uninit (void)
 		DestroyRecursiveMutex (src_mutex);
 		DestroyRecursiveMutex (buf_mutex);
 		DestroyRecursiveMutex (act_mutex);
+		mixer_FreeSincFilters ();
+		processed_callback = NULL;
 		mixer_initialized = 0;
 	}
 }
 
+/* Set the function to call when sources are done with buffers */
+void
+mixer_SetProcessedCallback (mixer_ProcessedCallback callback)
+{
+	if (mixer_initialized)
+		LockRecursiveMutex (src_mutex);
+	processed_callback = callback;
+	if (mixer_initialized)
+		UnlockRecursiveMutex (src_mutex);
+}
+
 
 /**********************************************************
  * THE mixer
  *
  */
 
-void
-mixer_MixChannels (void *userdata, uint8 *stream, sint32 len)
+/* resample a run of the current buffer of a source, for as long as
+ * the filter stays inside the buffer; the samples near the buffer
+ * edges are left to mixer_ResampleSinc()
+ */
+static uint32
+mixer_SincRender (mixer_Source *src, float *out, uint32 count, bool left)
 {
-	uint8 *end_stream = stream + len;
-	bool left = true;
+	mixer_Buffer *buf = src->nextqueued;
+	const uint32 taps = buf->filtertaps;
+	const sint32 ss = buf->sampsize;
+	const sint32 back = (sint32)(taps / 2 - 1) * ss;
+	const sint32 ahead = (sint32)(taps / 2) * ss;
+	const bool interleaved = buf->orgchannels == 2 && mixer_channels == 2;
+	uint32 pos = src->pos;
+	uint32 cnt = src->count;
+	float samp[MIX_SINC_MAX_TAPS];
+	uint32 i;
 
-	/* keep this order or die */
-	LockRecursiveMutex (src_mutex);
-	LockRecursiveMutex (buf_mutex);
-	LockRecursiveMutex (act_mutex);
+	for (i = 0; i < count; i++)
+	{
+		if (!left && buf->orgchannels == 1)
+		{	/* mono source, right channel is a copy of the left;
+			 * the long way moves on when the buffer is done
+			 */
+			if (pos >= buf->size)
+				break;
+			out[i] = src->samplecache;
+		}
+		else
+		{
+			const float *coefs = buf->filter
+					+ (cnt >> (16 - MIX_SINC_PHASE_BITS)) * taps;
+			sint32 off = pos;
+			uint32 npos = pos;
+			uint32 ncnt = cnt;
+			const uint8 *d;
+			uint32 j;
+
+			/* same stepping as mixer_SourceAdvance() */
+			if (interleaved && !left)
+				off += mixer_chansize;
+			if (!interleaved || !left)
+			{
+				npos += buf->high;
+				ncnt += buf->low;
+				if (ncnt > UINT16_MAX)
+				{
+					ncnt -= UINT16_MAX;
+					npos += ss;
+				}
+			}
+			if (off < back || off + ahead >= (sint32)buf->size
+					|| npos >= buf->size)
+				break;
+
+			d = buf->data + off - back;
+			if (mixer_chansize == 2)
+			{
+				for (j = 0; j < taps; j++, d += ss)
+					samp[j] = *(const sint16 *)d;
+			}
+			else
+			{
+				for (j = 0; j < taps; j++, d += ss)
+					samp[j] = *(const sint8 *)d;
+			}
+			out[i] = src->samplecache = mixer_SincDot (samp, coefs, taps);
+			pos = npos;
+			cnt = ncnt;
+		}
+
+		if (mixer_channels == 2)
+			left = !left;
+	}
+
+	src->pos = pos;
+	src->count = cnt;
+	if (i > 0)
+		buf->state = MIX_BUF_PLAYING;
+
+	return i;
+}
+
+/* render up to count channel samples of a source into out,
+ * before the source gain is applied; returns the number rendered,
+ * which is less than count only if the source ran out of data
+ */
+static uint32
+mixer_SourceRender (mixer_Source *src, float *out, uint32 count)
+{
+	uint32 i = 0;
+	bool left = true;
 
-	for (; stream < end_stream; stream += mixer_chansize)
+	while (i < count)
 	{
-		uint32 i;
-		float fullsamp = 0;
-		
-		for (i = 0; i < MAX_SOURCES; i++)
+		mixer_Buffer *buf = src->nextqueued;
+
+		if (buf && buf->Resample == mixer_ResampleNone
+				&& buf->sampsize == mixer_sampsize && buf->data
+				&& !(mixer_flags & MIX_FAKE_DATA)
+				&& src->pos + mixer_chansize < buf->size)
 		{
-			mixer_Source *src;
-			float samp = 0;
-			
-			/* find next source */
-			for (; i < MAX_SOURCES && (
-					(src = active_sources[i]) == 0
-					|| src->state != MIX_PLAYING
-					|| !mixer_SourceGetNextSample (src, &samp, left));
-					i++)
-				;
-
-			if (i < MAX_SOURCES)
+			/* straight copy of everything but the last sample of
+			 * the buffer, which takes the long way below to move
+			 * on to the next buffer
+			 */
+			uint32 n = (buf->size - src->pos) / mixer_chansize - 1;
+			uint32 j;
+
+			if (n > count - i)
+				n = count - i;
+			if (mixer_chansize == 2)
+			{
+				const sint16 *d = (const sint16 *) (buf->data + src->pos);
+				for (j = 0; j < n; j++)
+					out[i + j] = d[j];
+			}
+			else
 			{
-				/* sample acquired */
-				fullsamp += samp;
+				const sint8 *d = (const sint8 *) (buf->data + src->pos);
+				for (j = 0; j < n; j++)
+					out[i + j] = d[j];
 			}
+			src->pos += n * mixer_chansize;
+			buf->state = MIX_BUF_PLAYING;
+			i += n;
+			if (mixer_channels == 2 && (n & 1))
+				left = !left;
+			continue;
 		}
 
-		/* clip the sample */
-		if (mixer_chansize == 2)
+		if (buf && buf->Resample == mixer_ResampleSinc && buf->data
+				&& !(mixer_flags & MIX_FAKE_DATA))
 		{
+			uint32 n = mixer_SincRender (src, out + i, count - i, left);
+
+			if (n > 0)
+			{
+				i += n;
+				if (mixer_channels == 2 && (n & 1))
+					left = !left;
+				continue;
+			}
+		}
+
+		if (!mixer_SourceGetNextSample (src, out + i, left))
+			break;
+		i++;
+		if (mixer_channels == 2)
+			left = !left;
+	}
+
+	return i;
+}
+
+/* apply the source gain and panning to count rendered channel samples
+ * and add them to the mix
+ */
+static void
+mixer_AddSamples (float *accum, const float *samp, uint32 count,
+		const mixer_Source *src)
+{
+	float gain = src->gain;
+	float lgain = src->leftGain;
+	float rgain = mixer_channels == 2 ? src->rightGain : src->leftGain;
+	uint32 i = 0;
+
+#ifdef MIX_SSE2
+	{
+		__m128 g = _mm_set1_ps (gain);
+		__m128 pan = _mm_setr_ps (lgain, rgain, lgain, rgain);
+
+		for (; i + 4 <= count; i += 4)
+		{
+			__m128 s = _mm_mul_ps (_mm_mul_ps (_mm_loadu_ps (samp + i), g),
+					pan);
+			_mm_storeu_ps (accum + i, _mm_add_ps (_mm_loadu_ps (accum + i),
+					s));
+		}
+	}
+#endif
+
+	for (; i + 2 <= count; i += 2)
+	{
+		accum[i] += samp[i] * gain * lgain;
+		accum[i + 1] += samp[i + 1] * gain * rgain;
+	}
+	if (i < count)
+		accum[i] += samp[i] * gain * lgain;
+}
+
+/* clip the mix and write it out in the output format */
+static void
+mixer_StoreSamples (uint8 *stream, const float *accum, uint32 count)
+{
+	uint32 i = 0;
+
+	if (mixer_chansize == 2)
+	{
+		sint16 *dst = (sint16 *) stream;
+
+#ifdef MIX_SSE2
+		__m128 smax = _mm_set1_ps (MIX_S16_MAX);
+		__m128 smin = _mm_set1_ps (MIX_S16_MIN);
+
+		for (; i + 8 <= count; i += 8)
+		{
+			__m128 a = _mm_loadu_ps (accum + i);
+			__m128 b = _mm_loadu_ps (accum + i + 4);
+			a = _mm_max_ps (_mm_min_ps (a, smax), smin);
+			b = _mm_max_ps (_mm_min_ps (b, smax), smin);
+			_mm_storeu_si128 ((__m128i *) (dst + i), _mm_packs_epi32 (
+					_mm_cvttps_epi32 (a), _mm_cvttps_epi32 (b)));
+		}
+#endif
+
+		for (; i < count; i++)
+		{
+			float samp = accum[i];
+
 			/* check S16 clipping */
-			if (fullsamp > SINT16_MAX)
-				fullsamp = SINT16_MAX;
-			else if (fullsamp < SINT16_MIN)
-				fullsamp = SINT16_MIN;
+			if (samp > MIX_S16_MAX)
+				samp = MIX_S16_MAX;
+			else if (samp < MIX_S16_MIN)
+				samp = MIX_S16_MIN;
+			dst[i] = (sint16) samp;
 		}
-		else
+	}
+	else
+	{
+		for (; i < count; i++)
 		{
+			float samp = accum[i];
+
 			/* check S8 clipping */
-			if (fullsamp > SINT8_MAX)
-				fullsamp = SINT8_MAX;
-			else if (fullsamp < SINT8_MIN)
-				fullsamp = SINT8_MIN;
+			if (samp > MIX_S8_MAX)
+				samp = MIX_S8_MAX;
+			else if (samp < MIX_S8_MIN)
+				samp = MIX_S8_MIN;
+			mixer_PutSampleExt (stream + i, 1, (sint32) samp);
 		}
+	}
+}
 
-		mixer_PutSampleExt (stream, mixer_chansize, (sint32)fullsamp);
-		if (mixer_channels == 2)
-			left = !left;
+/* The mixer goes through the callback buffer in blocks. Each playing
+ * source renders a whole block at a time into the scratch buffer,
+ * which then gets its gain applied and is added to the mix.
+ * Sources are summed in activation order, and every source only
+ * touches its own buffers, so this mixes exactly what going
+ * through the sources one sample at a time would.
+ */
+void
+mixer_MixChannels (void *userdata, uint8 *stream, sint32 len)
+{
+	uint32 total = len / mixer_chansize;
+
+	/* keep this order or die */
+	LockRecursiveMutex (src_mutex);
+	LockRecursiveMutex (buf_mutex);
+	LockRecursiveMutex (act_mutex);
+
+	while (total > 0)
+	{
+		uint32 count = total < MIX_BLOCK_SAMPLES ?
+				total : MIX_BLOCK_SAMPLES;
+		mixer_Source *sources[MAX_SOURCES];
+		uint32 nsources = active_count;
+		uint32 i;
+
+		/* sources deactivate themselves when they run out */
+		memcpy (sources, active_sources, sizeof (sources[0]) * nsources);
+		memset (mix_accum, 0, sizeof (mix_accum[0]) * count);
+
+		for (i = 0; i < nsources; i++)
+		{
+			mixer_Source *src = sources[i];
+			uint32 n;
+
+			if (src->state != MIX_PLAYING)
+				continue;
+
+			n = mixer_SourceRender (src, mix_scratch, count);
+			mixer_AddSamples (mix_accum, mix_scratch, n, src);
+		}
+
+		mixer_StoreSamples (stream, mix_accum, count);
+		stream += count * mixer_chansize;
+		total -= count;
 	}
 
 	/* keep this order or die */
 	UnlockRecursiveMutex (act_mutex);
 	UnlockRecursiveMutex (buf_mutex);
+	/* still under src_mutex, so the callback cannot be unset under us */
+	if (processed_pending && processed_callback)
+		processed_callback ();
+	processed_pending = false;
 	UnlockRecursiveMutex (src_mutex);
 
 	(void) userdata; // satisfying compiler - unused arg
@@ -199,40 +480,48 @@ mixer_MixChannels (void *userdata, uint8 *stream, sint32 len)
 void
 mixer_MixFake (void *userdata, uint8 *stream, sint32 len)
 {
-	uint8 *end_stream = stream + len;
-	bool left = true;
+	uint32 total = len / mixer_chansize;
+	mixer_Source *sources[MAX_SOURCES];
+	uint32 nsources;
+	uint32 i;
 
 	/* keep this order or die */
 	LockRecursiveMutex (src_mutex);
 	LockRecursiveMutex (buf_mutex);
 	LockRecursiveMutex (act_mutex);
 
-	for (; stream < end_stream; stream += mixer_chansize)
+	/* sources deactivate themselves when they run out */
+	nsources = active_count;
+	memcpy (sources, active_sources, sizeof (sources[0]) * nsources);
+
+	for (i = 0; i < nsources; i++)
 	{
-		uint32 i;
+		mixer_Source *src = sources[i];
+		bool left = true;
+		uint32 j;
+		float samp;
 
-		for (i = 0; i < MAX_SOURCES; i++)
+		if (src->state != MIX_PLAYING)
+			continue;
+
+		for (j = 0; j < total
+				&& mixer_SourceGetFakeSample (src, &samp, left); j++)
 		{
-			mixer_Source *src;
-			float samp;
-			
-			/* find next source */
-			for (; i < MAX_SOURCES && (
-					(src = active_sources[i]) == 0
-					|| src->state != MIX_PLAYING
-					|| !mixer_SourceGetFakeSample (src, &samp, left));
-					i++)
-				;
+			if (mixer_channels == 2)
+				left = !left;
 		}
-		if (mixer_channels == 2)
-			left = !left;
 	}
 
 	/* keep this order or die */
 	UnlockRecursiveMutex (act_mutex);
 	UnlockRecursiveMutex (buf_mutex);
+	/* still under src_mutex, so the callback cannot be unset under us */
+	if (processed_pending && processed_callback)
+		processed_callback ();
+	processed_pending = false;
 	UnlockRecursiveMutex (src_mutex);
 
+	(void) stream; // satisfying compiler - unused arg
 	(void) userdata; // satisfying compiler - unused arg
 }
 
@@ -920,9 +1209,9 @@ mixer_SourceActivate (mixer_Source* src)
 	LockRecursiveMutex (act_mutex);
 
 	/* check active sources, see if this source is there already */
-	for (i = 0; i < MAX_SOURCES && active_sources[i] != src; i++)
+	for (i = 0; i < active_count && active_sources[i] != src; i++)
 		;
-	if (i < MAX_SOURCES)
+	if (i < active_count)
 	{	/* source found */
 		log_add (log_Debug, "mixer_SourceActivate(): "
 				"source already active in slot %u", i);
@@ -930,12 +1219,10 @@ mixer_SourceActivate (mixer_Source* src)
 		return;
 	}
 
-	/* find an empty slot */
-	for (i = 0; i < MAX_SOURCES && active_sources[i] != 0; i++)
-		;
-	if (i < MAX_SOURCES)
+	if (active_count < MAX_SOURCES)
 	{	/* slot found */
-		active_sources[i] = src;
+		active_sources[active_count] = src;
+		active_count++;
 	}
 	else
 	{
@@ -955,11 +1242,14 @@ mixer_SourceDeactivate (mixer_Source* src)
 	LockRecursiveMutex (act_mutex);
 
 	/* check active sources, see if this source is there */
-	for (i = 0; i < MAX_SOURCES && active_sources[i] != src; i++)
+	for (i = 0; i < active_count && active_sources[i] != src; i++)
 		;
-	if (i < MAX_SOURCES)
-	{	/* source found */
-		active_sources[i] = 0;
+	if (i < active_count)
+	{	/* source found; keep the rest packed and in order */
+		active_count--;
+		memmove (active_sources + i, active_sources + i + 1,
+				sizeof (active_sources[0]) * (active_count - i));
+		active_sources[active_count] = 0;
 	}
 	else
 	{	/* source not found */
@@ -1049,7 +1339,9 @@ mixer_SourceRewind_internal (mixer_Source *src)
 	src->state = MIX_INITIAL;
 }
 
-/* get the sample next in queue in internal format */
+/* get the sample next in queue in internal format,
+ * before the source gain is applied
+ */
 static inline bool
 mixer_SourceGetNextSample (mixer_Source *src, float *psamp, bool left)
 {
@@ -1068,6 +1360,7 @@ mixer_SourceGetNextSample (mixer_Source *src, float *psamp, bool left)
 			src->pos = 0;
 			src->nextqueued = src->nextqueued->next;
 			src->cprocessed++;
+			processed_pending = true;
 			continue;
 		}
 
@@ -1078,9 +1371,8 @@ mixer_SourceGetNextSample (mixer_Source *src, float *psamp, bool left)
 		}
 		else
 		{
-			*psamp = src->samplecache = buf->Resample(src, left) * src->gain;
+			*psamp = src->samplecache = buf->Resample(src, left);
 		}
-		*psamp *= left ? src->leftGain : src->rightGain;
 
 		if (src->pos < buf->size ||
 				(left && buf->sampsize != mixer_sampsize))
@@ -1095,6 +1387,7 @@ mixer_SourceGetNextSample (mixer_Source *src, float *psamp, bool left)
 			src->prevqueued = src->nextqueued;
 			src->nextqueued = src->nextqueued->next;
 			src->cprocessed++;
+			processed_pending = true;
 		}
 		
 		return true;
@@ -1102,7 +1395,10 @@ mixer_SourceGetNextSample (mixer_Source *src, float *psamp, bool left)
 	
 	/* no more playable buffers */
 	if (src->state >= MIX_PLAYING)
+	{
 		mixer_SourceDeactivate (src);
+		processed_pending = true;
+	}
 
 	src->state = MIX_STOPPED;
 
@@ -1139,6 +1435,7 @@ mixer_SourceGetFakeSample (mixer_Source *src, float *psamp, bool left)
 			src->prevqueued = src->nextqueued;
 			src->nextqueued = src->nextqueued->next;
 			src->cprocessed++;
+			processed_pending = true;
 		}
 		
 		return true;
@@ -1146,7 +1443,10 @@ mixer_SourceGetFakeSample (mixer_Source *src, float *psamp, bool left)
 	
 	/* no more playable buffers */
 	if (src->state >= MIX_PLAYING)
+	{
 		mixer_SourceDeactivate (src);
+		processed_pending = true;
+	}
 
 	src->state = MIX_STOPPED;
 
@@ -1219,6 +1519,8 @@ mixer_GenBuffers (uint32 n, mixer_Object *pbufobj)
 		buf->orgsize = 0;
 		buf->orgchannels = 0;
 		buf->orgchansize = 0;
+		buf->filter = 0;
+		buf->filtertaps = 0;
 
 		*pbufobj = (mixer_Object) buf;
 	}
@@ -1496,6 +1798,16 @@ mixer_BufferData (mixer_Object bufobj, uint32 format, void* data,
 				buf->Resample = mixer_resampling.Upsample;
 			else
 				buf->Resample = mixer_resampling.Downsample;
+
+			buf->filter = 0;
+			buf->filtertaps = 0;
+			if (buf->Resample == mixer_ResampleSinc)
+			{
+				buf->filter = mixer_GetSincFilter (buf->orgfreq,
+						&buf->filtertaps);
+				if (!buf->filter)
+					buf->Resample = mixer_UpsampleCubic;
+			}
 		}
 	}
 
@@ -1729,6 +2041,174 @@ mixer_UpsampleCubic (mixer_Source *src, bool left)
 	return a * t2 * t + b * t2 + c * t + s1;
 }
 
+/* dot product of the samples under a sinc filter row; taps is a
+ * multiple of 4, and the vector and plain versions add up in the
+ * same order
+ */
+static inline float
+mixer_SincDot (const float *samp, const float *coefs, uint32 taps)
+{
+	uint32 j;
+#ifdef MIX_SSE2
+	__m128 sum = _mm_setzero_ps ();
+	float part[4];
+
+	for (j = 0; j < taps; j += 4)
+		sum = _mm_add_ps (sum, _mm_mul_ps (_mm_loadu_ps (samp + j),
+				_mm_loadu_ps (coefs + j)));
+	_mm_storeu_ps (part, sum);
+#else
+	float part[4] = {0, 0, 0, 0};
+
+	for (j = 0; j < taps; j += 4)
+	{
+		part[0] += samp[j] * coefs[j];
+		part[1] += samp[j + 1] * coefs[j + 1];
+		part[2] += samp[j + 2] * coefs[j + 2];
+		part[3] += samp[j + 3] * coefs[j + 3];
+	}
+#endif
+	return (part[0] + part[1]) + (part[2] + part[3]);
+}
+
+/* get the sample 'off' bytes from the start of the current buffer,
+ * reaching into the neighbouring buffers when needed; past the ends
+ * of the queue the edge sample is repeated
+ */
+static inline float
+mixer_GetSincTap (mixer_Buffer *prev, mixer_Buffer *curr,
+		mixer_Buffer *next, sint32 off)
+{
+	sint32 ss = curr->sampsize;
+	sint32 size = curr->size;
+
+	if (off >= 0 && off < size)
+		return mixer_GetSampleInt (curr->data + off, mixer_chansize);
+
+	if (off < 0)
+	{
+		if (prev && prev->data && (sint32)prev->size + off >= 0)
+			return mixer_GetSampleInt (prev->data + prev->size + off,
+					mixer_chansize);
+		return mixer_GetSampleInt (curr->data + (off % ss + ss) % ss,
+				mixer_chansize);
+	}
+
+	if (next && next->data && off - size < (sint32)next->size)
+		return mixer_GetSampleInt (next->data + off - size, mixer_chansize);
+	return mixer_GetSampleInt (curr->data + size - ss + off % ss,
+			mixer_chansize);
+}
+
+/* get a resampled (up/down) sample from source (windowed sinc) */
+static float
+mixer_ResampleSinc (mixer_Source *src, bool left)
+{
+	mixer_Buffer *prev = src->prevqueued;
+	mixer_Buffer *curr = src->nextqueued;
+	mixer_Buffer *next = src->nextqueued->next;
+	const uint32 taps = curr->filtertaps;
+	const float *coefs = curr->filter
+			+ (src->count >> (16 - MIX_SINC_PHASE_BITS)) * taps;
+	float samp[MIX_SINC_MAX_TAPS];
+	sint32 off;
+	uint32 j;
+
+	off = src->pos;
+	off += mixer_SourceAdvance (src, left);
+	off -= (sint32)(taps / 2 - 1) * (sint32)curr->sampsize;
+
+	for (j = 0; j < taps; j++, off += curr->sampsize)
+		samp[j] = mixer_GetSincTap (prev, curr, next, off);
+
+	return mixer_SincDot (samp, coefs, taps);
+}
+
+/* get (building it if needed) the sinc filter table for resampling
+ * from srcfreq to the mixer rate; called with buf_mutex held
+ */
+static const float *
+mixer_GetSincFilter (uint32 srcfreq, uint32 *ptaps)
+{
+	mixer_SincFilter *filt = 0;
+	double fc, t;
+	uint32 i, p, taps, half;
+	float *row;
+
+	for (i = 0; i < MIX_SINC_FILTERS; i++)
+	{
+		if (!sinc_filters[i].coefs)
+		{
+			if (!filt)
+				filt = &sinc_filters[i];
+		}
+		else if (sinc_filters[i].srcfreq == srcfreq)
+		{
+			*ptaps = sinc_filters[i].taps;
+			return sinc_filters[i].coefs;
+		}
+	}
+	if (!filt)
+	{
+		log_add (log_Debug, "mixer_GetSincFilter(): no more filter "
+				"slots (max=%d)", MIX_SINC_FILTERS);
+		return 0;
+	}
+
+	/* when downsampling, cut off at the new Nyquist frequency and
+	 * widen the filter to keep its quality
+	 */
+	fc = srcfreq > mixer_freq ? (double) mixer_freq / srcfreq : 1.0;
+	taps = (uint32) ceil (MIX_SINC_TAPS / fc);
+	taps = (taps + 3) & ~3;
+	if (taps > MIX_SINC_MAX_TAPS)
+		taps = MIX_SINC_MAX_TAPS;
+	half = taps / 2;
+
+	filt->coefs = HMalloc (sizeof (float) * taps * MIX_SINC_PHASES);
+	filt->srcfreq = srcfreq;
+	filt->taps = taps;
+
+	for (p = 0, row = filt->coefs; p < MIX_SINC_PHASES; p++, row += taps)
+	{
+		double h[MIX_SINC_MAX_TAPS];
+		double sum = 0;
+
+		t = (double) p / MIX_SINC_PHASES;
+		for (i = 0; i < taps; i++)
+		{
+			/* distance from the output point, in source samples */
+			double x = (double)i - (half - 1) - t;
+			double w, y;
+
+			/* Blackman window */
+			w = 0.42 + 0.5 * cos (M_PI * x / half)
+					+ 0.08 * cos (2 * M_PI * x / half);
+			y = fc * x;
+			h[i] = (y == 0 ? fc : fc * sin (M_PI * y) / (M_PI * y)) * w;
+			sum += h[i];
+		}
+		/* unity gain at DC for every phase */
+		for (i = 0; i < taps; i++)
+			row[i] = (float) (h[i] / sum);
+	}
+
+	*ptaps = taps;
+	return filt->coefs;
+}
+
+static void
+mixer_FreeSincFilters (void)
+{
+	uint32 i;
+
+	for (i = 0; i < MIX_SINC_FILTERS; i++)
+	{
+		HFree (sinc_filters[i].coefs);
+		sinc_filters[i].coefs = 0;
+	}
+}
+
 /* get next sample from external buffer
  * in internal format, while performing
  * convertion if necessary
@@ -141,6 +141,8 @@ typedef enum
 	MIX_QUALITY_LOW = 0,
 	MIX_QUALITY_MEDIUM,
 	MIX_QUALITY_HIGH,
+	MIX_QUALITY_BEST,
+			/* band-limited windowed-sinc resampling */
 	MIX_QUALITY_DEFAULT = MIX_QUALITY_MEDIUM,
 	MIX_QUALITY_COUNT
 
@@ -172,6 +174,9 @@ typedef struct _mixer_Buffer
 	uint32 high;
 	uint32 low;
 	float (* Resample) (mixer_Source *src, bool left);
+	/* polyphase filter table for sinc resampling, or 0 */
+	const float *filter;
+	uint32 filtertaps;
 	/* original buffer values for OpenAL compat */
 	void* orgdata;
 	uint32 orgfreq;
@@ -220,6 +225,12 @@ void mixer_Uninit (void);
 void mixer_MixChannels (void *userdata, uint8 *stream, sint32 len);
 void mixer_MixFake (void *userdata, uint8 *stream, sint32 len);
 
+/* called from the mixing thread after a mixing pass in which some
+ * source finished a buffer or ran dry; it must not block
+ */
+typedef void (* mixer_ProcessedCallback) (void);
+void mixer_SetProcessedCallback (mixer_ProcessedCallback callback);
+
 /*************************************************
  *  Sources
  */
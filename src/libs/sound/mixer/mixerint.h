@@ -80,6 +80,31 @@ static float mixer_ResampleNone (mixer_Source *src, bool left);
 static float mixer_ResampleNearest (mixer_Source *src, bool left);
 static float mixer_UpsampleLinear (mixer_Source *src, bool left);
 static float mixer_UpsampleCubic (mixer_Source *src, bool left);
+static float mixer_ResampleSinc (mixer_Source *src, bool left);
+
+/* Windowed-sinc resampling
+ * Each filter table holds MIX_SINC_PHASES rows of 'taps' coefficients,
+ * one row per fractional position between two source samples.
+ * Tables depend only on the source rate, and are shared by all
+ * buffers of that rate.
+ */
+#define MIX_SINC_PHASE_BITS 9
+#define MIX_SINC_PHASES     (1 << MIX_SINC_PHASE_BITS)
+#define MIX_SINC_TAPS       16 /* taps at unity ratio and when upsampling */
+#define MIX_SINC_MAX_TAPS   64
+#define MIX_SINC_FILTERS    8  /* distinct source rates kept */
+
+typedef struct
+{
+	uint32 srcfreq;
+	uint32 taps;
+	float *coefs;
+} mixer_SincFilter;
+
+static inline float mixer_SincDot (const float *samp,
+		const float *coefs, uint32 taps);
+static const float *mixer_GetSincFilter (uint32 srcfreq, uint32 *ptaps);
+static void mixer_FreeSincFilters (void);
 
 /* Source manipulation */
 static void mixer_SourceUnqueueAll (mixer_Source *src);
@@ -175,7 +175,7 @@ noSound_Init (audio_Driver *driver, sint32 flags)
 		soundSource[i].stream_mutex = CreateMutex ("Nosound stream mutex", SYNC_CLASS_AUDIO);
 	}
 
-	if (InitStreamDecoder ())
+	if (InitStreamDecoder (true))
 	{
 		log_add (log_Error, "Stream decoder initialization failed.");
 		// TODO: cleanup source mutexes [or is it "muti"? :) ]
@@ -183,6 +183,7 @@ noSound_Init (audio_Driver *driver, sint32 flags)
 		mixer_Uninit ();
 		return -1;
 	}
+	mixer_SetProcessedCallback (StreamBuffersProcessed);
 
 	PlaybackTask = AssignTask (PlaybackTaskFunc, 1024, 
 		"nosound audio playback");
@@ -195,6 +196,7 @@ noSound_Uninit (void)
 {
 	int i;
 
+	mixer_SetProcessedCallback (NULL);
 	UninitStreamDecoder ();
 
 	for (i = 0; i < NUM_SOUNDSOURCES; ++i)
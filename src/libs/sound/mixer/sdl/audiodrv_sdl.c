@@ -157,7 +157,13 @@ mixSDL_Init (audio_Driver *driver, sint32 flags)
 	}
 	log_add (log_Info, "SDL audio subsystem initialized.");
 		
-	if (flags & audio_QUALITY_HIGH)
+	if (flags & audio_QUALITY_BEST)
+	{
+		quality = MIX_QUALITY_BEST;
+		desired.freq = 44100;
+		desired.samples = 4096;
+	}
+	else if (flags & audio_QUALITY_HIGH)
 	{
 		quality = MIX_QUALITY_HIGH;
 		desired.freq = 44100;
@@ -261,7 +267,7 @@ mixSDL_Init (audio_Driver *driver, sint32 flags)
 		soundSource[i].stream_mutex = CreateMutex ("MixSDL stream mutex", SYNC_CLASS_AUDIO);
 	}
 
-	if (InitStreamDecoder ())
+	if (InitStreamDecoder (true))
 	{
 		log_add (log_Error, "Stream decoder initialization failed.");
 		// TODO: cleanup source mutexes [or is it "muti"? :) ]
@@ -272,6 +278,7 @@ mixSDL_Init (audio_Driver *driver, sint32 flags)
 		SDL_QuitSubSystem (SDL_INIT_AUDIO);
 		return -1;
 	}
+	mixer_SetProcessedCallback (StreamBuffersProcessed);
 
 	SDL_PauseAudioDevice (dev, 0);
 		
@@ -283,6 +290,7 @@ mixSDL_Uninit (void)
 {
 	int i;
 
+	mixer_SetProcessedCallback (NULL);
 	UninitStreamDecoder ();
 
 	for (i = 0; i < NUM_SOUNDSOURCES; ++i)
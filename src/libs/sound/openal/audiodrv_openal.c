@@ -217,7 +217,7 @@ openAL_Init (audio_Driver *driver, sint32 flags)
 		soundSource[i].stream_mutex = CreateMutex ("OpenAL stream mutex", SYNC_CLASS_AUDIO);
 	}
 
-	if (InitStreamDecoder ())
+	if (InitStreamDecoder (false))
 	{
 		log_add (log_Error, "Stream decoder initialization failed.");
 		// TODO: cleanup source mutexes [or is it "muti"? :) ]
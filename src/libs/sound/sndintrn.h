@@ -46,6 +46,7 @@ struct tfb_soundsample
 	uint32 num_buffers;
 	TFB_SoundTag *buffer_tag;
 	sint32 offset; // initial offset
+	int stream_type; // STREAM_TYPE_*
 	void* data; // user-defined data
 	TFB_SoundCallbacks callbacks; // user-defined callbacks
 };
@@ -62,6 +63,9 @@ typedef struct tfb_soundsource
 	void *positional_object;
 
 	audio_Object last_q_buf; // for callbacks processing
+	int stream_type;         // STREAM_TYPE_* of the playing stream
+	uint32 bufs_used;        // sample buffers handed to the source so far;
+	                         // the rest have not been filled yet
 
 	// Cyclic waveform buffer for oscilloscope
 	void *sbuffer; 
@@ -71,6 +71,7 @@ void* TFB_GetSoundSampleData (TFB_SoundSample*);
 void TFB_SetSoundSampleCallbacks (TFB_SoundSample*,
 		const TFB_SoundCallbacks* /* can be NULL */);
 TFB_SoundDecoder* TFB_GetSoundSampleDecoder (TFB_SoundSample*);
+void TFB_SetSoundSampleStreamType (TFB_SoundSample*, int type);
 
 TFB_SoundTag* TFB_FindTaggedBuffer (TFB_SoundSample*, audio_Object buffer);
 void TFB_ClearBufferTag (TFB_SoundTag*);
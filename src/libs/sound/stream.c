@@ -28,6 +28,26 @@
 
 
 static Task decoderTask;
+// Posted when the decoder task has work to do
+static Semaphore decoderWake;
+// When the driver does not tell us about processed buffers,
+// active streams are polled instead
+static bool driverNotifies;
+
+// Buffers PlayStream() decodes before it starts playback; the decoder
+// task decodes the rest of the look-ahead right after
+static const uint32 streamStartDepth[NUM_STREAM_TYPES] =
+{
+	8, // music, 4 KB buffers
+	1, // speech, 32 KB buffers
+	8, // video
+};
+static uint32 streamLookAhead[NUM_STREAM_TYPES] =
+{
+	64, 8, 64,
+};
+
+static TFB_StreamStats streamStats;
 
 static TimeCount musicFadeStartTime;
 static sint32 musicFadeInterval;
@@ -38,6 +58,13 @@ static Mutex fade_mutex;
 
 static void add_scope_data (TFB_SoundSource *source, uint32 bytes);
 
+static void
+wake_decoder (void)
+{
+	if (decoderWake)
+		ClearSemaphore (decoderWake);
+}
+
 
 void
 PlayStream (TFB_SoundSample *sample, uint32 source, bool looping, bool scope,
@@ -46,10 +73,16 @@ PlayStream (TFB_SoundSample *sample, uint32 source, bool looping, bool scope,
 	uint32 i;
 	sint32 offset;
 	TFB_SoundDecoder *decoder;
+	TimeCount startTime;
+	TFB_StreamTypeStats *stats;
+	uint32 latency;
+	uint32 depth;
+	int type;
 
 	if (!sample)
 		return;
 
+	startTime = GetTimeCounter ();
 	StopStream (source);
 	if (sample->callbacks.OnStartStream &&
 		!sample->callbacks.OnStartStream (sample))
@@ -69,6 +102,15 @@ PlayStream (TFB_SoundSample *sample, uint32 source, bool looping, bool scope,
 	if (source == MUSIC_SOURCE)
 		soundSource[source].start_time = 0;
 
+	type = sample->stream_type;
+	if (type == STREAM_TYPE_AUTO)
+	{
+		type = (source == SPEECH_SOURCE) ?
+				STREAM_TYPE_SPEECH : STREAM_TYPE_MUSIC;
+	}
+	soundSource[source].stream_type = type;
+	soundSource[source].bufs_used = 0;
+
 	soundSource[source].sample = sample;
 	decoder->looping = looping;
 	audio_Sourcei (soundSource[source].handle, audio_LOOPING, false);
@@ -81,7 +123,14 @@ PlayStream (TFB_SoundSample *sample, uint32 source, bool looping, bool scope,
 		soundSource[source].sbuffer = HCalloc (soundSource[source].sbuf_size);
 	}
 
-	for (i = 0; i < sample->num_buffers; ++i)
+	// Only decode enough to get going; the decoder task fills the rest
+	depth = streamStartDepth[type];
+	if (depth > streamLookAhead[type])
+		depth = streamLookAhead[type];
+	if (depth > sample->num_buffers)
+		depth = sample->num_buffers;
+
+	for (i = 0; i < depth; ++i)
 	{
 		uint32 decoded_bytes;
 
@@ -99,6 +148,8 @@ PlayStream (TFB_SoundSample *sample, uint32 source, bool looping, bool scope,
 				decoder->buffer, decoded_bytes, decoder->frequency);
 		audio_SourceQueueBuffers (soundSource[source].handle, 1,
 				&sample->buffer[i]);
+		soundSource[source].bufs_used = i + 1;
+		soundSource[source].last_q_buf = sample->buffer[i];
 		if (sample->callbacks.OnQueueBuffer)
 			sample->callbacks.OnQueueBuffer (sample, sample->buffer[i]);
 
@@ -128,6 +179,16 @@ PlayStream (TFB_SoundSample *sample, uint32 source, bool looping, bool scope,
 	soundSource[source].pause_time = 0;
 	soundSource[source].stream_should_be_playing = TRUE;
 	audio_SourcePlay (soundSource[source].handle);
+
+	latency = (GetTimeCounter () - startTime) * 1000 / ONE_SECOND;
+	stats = &streamStats.type[type];
+	stats->starts++;
+	stats->buffers += soundSource[source].bufs_used;
+	stats->start_latency_total += latency;
+	if (latency > stats->start_latency_max)
+		stats->start_latency_max = latency;
+
+	wake_decoder ();
 }
 
 void
@@ -171,6 +232,7 @@ ResumeStream (uint32 source)
 	soundSource[source].pause_time = 0;
 	soundSource[source].stream_should_be_playing = TRUE;
 	audio_SourcePlay (soundSource[source].handle);
+	wake_decoder ();
 }
 
 void
@@ -263,6 +325,7 @@ TFB_CreateSoundSample (TFB_SoundDecoder *decoder, uint32 num_buffers,
 
 	sample = HCalloc (sizeof (*sample));
 	sample->decoder = decoder;
+	sample->stream_type = STREAM_TYPE_AUTO;
 	sample->num_buffers = num_buffers;
 	sample->buffer = HCalloc (sizeof (audio_Object) * num_buffers);
 	audio_GenBuffers (num_buffers, sample->buffer);
@@ -313,6 +376,14 @@ TFB_GetSoundSampleDecoder (TFB_SoundSample *sample)
 	return sample->decoder;
 }
 
+// Takes effect the next time the sample is played
+void
+TFB_SetSoundSampleStreamType (TFB_SoundSample *sample, int type)
+{
+	assert (type >= STREAM_TYPE_AUTO && type < NUM_STREAM_TYPES);
+	sample->stream_type = type;
+}
+
 TFB_SoundTag*
 TFB_FindTaggedBuffer (TFB_SoundSample *sample, audio_Object buffer)
 {
@@ -420,6 +491,106 @@ add_scope_data (TFB_SoundSource *source, uint32 bytes)
 	}
 }
 
+// Decodes the next piece of the stream into the buffer and queues it.
+// Returns false if the buffer was not queued.
+static bool
+queue_stream_buffer (TFB_SoundSource *source, audio_Object buffer,
+		bool *end_chunk_failed)
+{
+	TFB_SoundSample *sample = source->sample;
+	TFB_SoundDecoder *decoder = sample->decoder;
+	uint32 error;
+	uint32 decoded_bytes;
+
+	// See what state the decoder was left in last time around
+	if (decoder->error != SOUNDDECODER_OK)
+	{
+		if (decoder->error == SOUNDDECODER_EOF)
+		{
+			if (*end_chunk_failed)
+				return false; // should not do it again
+
+			if (!sample->callbacks.OnEndChunk ||
+					!sample->callbacks.OnEndChunk (sample, source->last_q_buf))
+			{	// Reached the end of the current stream and we did not
+				// get another sample to play (relevant for Trackplayer)
+				*end_chunk_failed = true;
+				return false;
+			}
+			else
+			{	// OnEndChunk succeeded, so someone (read: Trackplayer)
+				// wants to keep going, probably with a new decoder.
+				// Get the new decoder
+				decoder = sample->decoder;
+			}
+		}
+		else
+		{	// Decoder returned a real error, keep going
+#if 0
+			log_add (log_Debug, "StreamDecoderTaskFunc(): "
+					"decoder->error is %d for %s", decoder->error,
+					decoder->filename);
+#endif
+			return false;
+		}
+	}
+
+	audio_GetError (); // clear error state
+
+	// Now fill the buffer
+	decoded_bytes = SoundDecoder_Decode (decoder);
+	if (decoder->error == SOUNDDECODER_ERROR)
+	{
+		log_add (log_Warning, "StreamDecoderTaskFunc(): "
+				"SoundDecoder_Decode error %d, file %s",
+				decoder->error, decoder->filename);
+		source->stream_should_be_playing = FALSE;
+		return false;
+	}
+
+	if (decoded_bytes == 0)
+	{	// Nothing was decoded, keep going
+		return false;
+		// This loses a stream buffer, which we cannot get back
+		// w/o restarting the stream, but we should never get here.
+	}
+
+	// And a new buffer is born
+	audio_BufferData (buffer, decoder->format, decoder->buffer,
+			decoded_bytes, decoder->frequency);
+	error = audio_GetError();
+	if (error != audio_NO_ERROR)
+	{
+		log_add (log_Warning, "StreamDecoderTaskFunc(): "
+				"error after audio_BufferData: %x, file %s, decoded %d",
+				error, decoder->filename, decoded_bytes);
+		return false;
+	}
+
+	// Now queue the buffer
+	audio_SourceQueueBuffers (source->handle, 1, &buffer);
+	error = audio_GetError();
+	if (error != audio_NO_ERROR)
+	{
+		log_add (log_Warning, "StreamDecoderTaskFunc(): "
+				"error after audio_SourceQueueBuffers: %x, file %s, "
+				"decoded %d", error, decoder->filename, decoded_bytes);
+		return false;
+	}
+
+	// Remember the last queued buffer so we can pass it to callbacks
+	source->last_q_buf = buffer;
+	if (sample->callbacks.OnQueueBuffer)
+		sample->callbacks.OnQueueBuffer (sample, buffer);
+
+	if (source->sbuffer)
+		add_scope_data (source, decoded_bytes);
+
+	streamStats.type[source->stream_type].buffers++;
+
+	return true;
+}
+
 static void
 process_stream (TFB_SoundSource *source)
 {
@@ -428,41 +599,16 @@ process_stream (TFB_SoundSource *source)
 	bool end_chunk_failed = false;
 	audio_IntVal processed;
 	audio_IntVal queued;
+	audio_IntVal state;
+	uint32 depth;
 
 	audio_GetSourcei (source->handle, audio_BUFFERS_PROCESSED, &processed);
-	audio_GetSourcei (source->handle, audio_BUFFERS_QUEUED, &queued);
 
-	if (processed == 0)
-	{	// Nothing was played
-		audio_IntVal state;
-
-		audio_GetSourcei (source->handle, audio_SOURCE_STATE, &state);
-		if (state != audio_PLAYING)
-		{
-			if (queued == 0 && decoder->error == SOUNDDECODER_EOF)
-			{	// The stream has reached the end
-				log_add (log_Info, "StreamDecoderTaskFunc(): "
-						"finished playing %s", decoder->filename);
-				source->stream_should_be_playing = FALSE;
-				
-				if (sample->callbacks.OnEndStream)
-					sample->callbacks.OnEndStream (sample);
- 			}
-			else
- 			{
-				log_add (log_Warning, "StreamDecoderTaskFunc(): "
-						"buffer underrun playing %s", decoder->filename);
-				audio_SourcePlay (source->handle);
-			}
-		}
-	}
-    
 	// Unqueue processed buffers and replace them with new ones
 	for (; processed > 0; --processed)
 	{
 		uint32 error;
 		audio_Object buffer;
-		uint32 decoded_bytes;
 
 		audio_GetError (); // clear error state
 
@@ -488,87 +634,50 @@ process_stream (TFB_SoundSource *source)
 		if (source->sbuffer)
 			remove_scope_data (source, buffer);
 
-		// See what state the decoder was left in last time around
-		if (decoder->error != SOUNDDECODER_OK)
-		{
-			if (decoder->error == SOUNDDECODER_EOF)
-			{
-				if (end_chunk_failed)
-					continue; // should not do it again
-
-				if (!sample->callbacks.OnEndChunk ||
-						!sample->callbacks.OnEndChunk (sample, source->last_q_buf))
-				{	// Reached the end of the current stream and we did not
-					// get another sample to play (relevant for Trackplayer)
-					end_chunk_failed = true;
-					continue;
-				}
-				else
-				{	// OnEndChunk succeeded, so someone (read: Trackplayer)
-					// wants to keep going, probably with a new decoder.
-					// Get the new decoder
-					decoder = sample->decoder;
-				}
-			}
-			else
-			{	// Decoder returned a real error, keep going
-#if 0
-				log_add (log_Debug, "StreamDecoderTaskFunc(): "
-						"decoder->error is %d for %s", decoder->error,
-						decoder->filename);
-#endif
-				continue;
-			}
-		}
+		queue_stream_buffer (source, buffer, &end_chunk_failed);
+	}
 
-		// Now replace the unqueued buffer with a new one
-		decoded_bytes = SoundDecoder_Decode (decoder);
-		if (decoder->error == SOUNDDECODER_ERROR)
-		{
-			log_add (log_Warning, "StreamDecoderTaskFunc(): "
-					"SoundDecoder_Decode error %d, file %s",
-					decoder->error, decoder->filename);
-			source->stream_should_be_playing = FALSE;
-			continue;
-		}
+	// Decode further ahead into the buffers we have not used yet
+	depth = streamLookAhead[source->stream_type];
+	if (depth > sample->num_buffers)
+		depth = sample->num_buffers;
+	while (source->bufs_used < depth && source->stream_should_be_playing
+			&& queue_stream_buffer (source,
+				sample->buffer[source->bufs_used], &end_chunk_failed))
+	{
+		source->bufs_used++;
+	}
 
-		if (decoded_bytes == 0)
-		{	// Nothing was decoded, keep going
-			continue;
-			// This loses a stream buffer, which we cannot get back
-			// w/o restarting the stream, but we should never get here.
-		}
+	if (!source->stream_should_be_playing)
+		return;
 
-		// And a new buffer is born
-		audio_BufferData (buffer, decoder->format, decoder->buffer,
-				decoded_bytes, decoder->frequency);
-		error = audio_GetError();
-		if (error != audio_NO_ERROR)
-		{
-			log_add (log_Warning, "StreamDecoderTaskFunc(): "
-					"error after audio_BufferData: %x, file %s, decoded %d",
-					error, decoder->filename, decoded_bytes);
-			continue;
-		}
+	audio_GetSourcei (source->handle, audio_SOURCE_STATE, &state);
+	if (state == audio_PLAYING)
+		return;
 
-		// Now queue the buffer
-		audio_SourceQueueBuffers (source->handle, 1, &buffer);
-		error = audio_GetError();
-		if (error != audio_NO_ERROR)
-		{
-			log_add (log_Warning, "StreamDecoderTaskFunc(): "
-					"error after audio_SourceQueueBuffers: %x, file %s, "
-					"decoded %d", error, decoder->filename, decoded_bytes);
-			continue;
-		}
-		
-		// Remember the last queued buffer so we can pass it to callbacks
-		source->last_q_buf = buffer;
-		if (sample->callbacks.OnQueueBuffer)
-			sample->callbacks.OnQueueBuffer (sample, buffer);
-		
-		if (source->sbuffer)
-			add_scope_data (source, decoded_bytes);
+	// Buffers the source finished with since the top get handled on
+	// the next pass, or they would be played again on restart
+	audio_GetSourcei (source->handle, audio_BUFFERS_PROCESSED, &processed);
+	if (processed != 0)
+		return;
+
+	decoder = sample->decoder;
+	audio_GetSourcei (source->handle, audio_BUFFERS_QUEUED, &queued);
+	if (queued == 0 && decoder->error == SOUNDDECODER_EOF)
+	{	// The stream has reached the end
+		log_add (log_Info, "StreamDecoderTaskFunc(): "
+				"finished playing %s", decoder->filename);
+		source->stream_should_be_playing = FALSE;
+
+		if (sample->callbacks.OnEndStream)
+			sample->callbacks.OnEndStream (sample);
+	}
+	else
+	{
+		log_add (log_Warning, "StreamDecoderTaskFunc(): "
+				"buffer underrun playing %s", decoder->filename);
+		streamStats.type[source->stream_type].underruns++;
+		audio_SourcePlay (source->handle);
 	}
 }
 
@@ -606,11 +715,30 @@ static int
 StreamDecoderTaskFunc (void *data)
 {
 	Task task = (Task)data;
-	int active_streams;
+	int active_streams = 0;
 	int i;
 	
 	while (!Task_ReadState (task, TASK_EXIT))
 	{
+		TimePeriod timeout;
+
+		// The driver wakes us up whenever a source is done with
+		// a buffer; the timeout only keeps music fades going
+		if (active_streams != 0 && !driverNotifies)
+			timeout = ONE_SECOND / 100;
+		else
+			timeout = ONE_SECOND / 10;
+
+		if (SetSemaphoreTimeout (decoderWake, timeout))
+		{
+			streamStats.wakeups++;
+			// One pass handles everything, so collapse the backlog
+			while (SetSemaphoreTimeout (decoderWake, 0))
+				;
+		}
+		else
+			streamStats.timeouts++;
+
 		active_streams = 0;
 
 		processMusicFade ();
@@ -635,13 +763,6 @@ StreamDecoderTaskFunc (void *data)
 
 			UnlockMutex (source->stream_mutex);
 		}
-
-		if (active_streams == 0) 
-		{	// Throttle down the thread when there are no active streams
-			HibernateThread (ONE_SECOND / 10);
-		}
-		else
-			TaskSwitch ();
 	}
 
 	FinishTask (task);
@@ -852,13 +973,76 @@ SetMusicStreamFade (sint32 howLong, int endVolume)
 	return ret;
 }
 
+void
+SetStreamLookAhead (int type, uint32 buffers)
+{
+	assert (type >= 0 && type < NUM_STREAM_TYPES);
+	if (buffers < 1)
+		buffers = 1;
+	streamLookAhead[type] = buffers;
+}
+
+uint32
+GetStreamLookAhead (int type)
+{
+	assert (type >= 0 && type < NUM_STREAM_TYPES);
+	return streamLookAhead[type];
+}
+
+void
+GetStreamStats (TFB_StreamStats *stats)
+{
+	*stats = streamStats;
+}
+
+// Called by the audio driver, possibly on its mixing thread,
+// when a source is done with a buffer or has run dry
+void
+StreamBuffersProcessed (void)
+{
+	wake_decoder ();
+}
+
+static void
+logStreamStats (void)
+{
+	static const char *typeNames[NUM_STREAM_TYPES] =
+	{
+		"music", "speech", "video",
+	};
+	int i;
+
+	log_add (log_Info, "Stream decoder: %u wakeups, %u timeouts",
+			streamStats.wakeups, streamStats.timeouts);
+	for (i = 0; i < NUM_STREAM_TYPES; ++i)
+	{
+		const TFB_StreamTypeStats *stats = &streamStats.type[i];
+
+		if (stats->starts == 0)
+			continue;
+		log_add (log_Info, "Stream decoder: %s: %u starts, %u buffers, "
+				"%u underruns, start latency avg %u ms, max %u ms",
+				typeNames[i], stats->starts, stats->buffers,
+				stats->underruns,
+				stats->start_latency_total / stats->starts,
+				stats->start_latency_max);
+	}
+}
+
 int
-InitStreamDecoder (void)
+InitStreamDecoder (bool notifies)
 {
 	fade_mutex = CreateMutex ("Stream fade mutex", SYNC_CLASS_AUDIO);
 	if (!fade_mutex)
 		return -1;
 
+	decoderWake = CreateSemaphore (0, "Stream decoder wake",
+			SYNC_CLASS_AUDIO);
+	if (!decoderWake)
+		return -1;
+	driverNotifies = notifies;
+	memset (&streamStats, 0, sizeof (streamStats));
+
 	decoderTask = AssignTask (StreamDecoderTaskFunc, 1024, 
 		"audio stream decoder");
 	if (!decoderTask)
@@ -874,6 +1058,13 @@ UninitStreamDecoder (void)
 	{
 		ConcludeTask (decoderTask);
 		decoderTask = NULL;
+		logStreamStats ();
+	}
+
+	if (decoderWake)
+	{
+		DestroySemaphore (decoderWake);
+		decoderWake = NULL;
 	}
 
 	if (fade_mutex)
@@ -17,8 +17,43 @@
 #ifndef STREAM_H
 #define STREAM_H
 
-int InitStreamDecoder (void);
+// Kinds of streams, for decode-ahead depth and statistics
+enum
+{
+	STREAM_TYPE_AUTO = -1,
+			// decided by the source the stream is played on
+	STREAM_TYPE_MUSIC = 0,
+	STREAM_TYPE_SPEECH,
+	STREAM_TYPE_VIDEO,
+
+	NUM_STREAM_TYPES
+};
+
+typedef struct
+{
+	uint32 starts;
+	uint32 underruns;
+	uint32 buffers;
+			// buffers decoded and queued
+	uint32 start_latency_total;
+	uint32 start_latency_max;
+			// time from PlayStream() to playback, in ms
+} TFB_StreamTypeStats;
+
+typedef struct
+{
+	uint32 wakeups;
+			// decoder passes made on driver notification
+	uint32 timeouts;
+			// decoder passes made when the wait timed out
+	TFB_StreamTypeStats type[NUM_STREAM_TYPES];
+} TFB_StreamStats;
+
+// notifies is true when the audio driver calls
+// StreamBuffersProcessed(); otherwise active streams are polled
+int InitStreamDecoder (bool notifies);
 void UninitStreamDecoder (void);
+void StreamBuffersProcessed (void);
 
 void PlayStream (TFB_SoundSample *sample, uint32 source, bool looping, 
 				 bool scope, bool rewind);
@@ -39,4 +74,11 @@ int GraphForegroundStream (uint8 *data, sint32 width, sint32 height,
 // returns TRUE if the fade was accepted by stream decoder
 bool SetMusicStreamFade (sint32 howLong, int endVolume);
 
+// Number of buffers the decoder keeps queued ahead of playback,
+// limited by the number of buffers in the sample
+void SetStreamLookAhead (int type, uint32 buffers);
+uint32 GetStreamLookAhead (int type);
+// The counters are not locked; the snapshot can be slightly off
+void GetStreamStats (TFB_StreamStats *stats);
+
 #endif
@@ -164,6 +164,8 @@ void PrintThreadsStats (void);
 void DestroySemaphore (Semaphore sem);
 void SetSemaphore (Semaphore sem);
 void ClearSemaphore (Semaphore sem);
+// Returns TRUE if the semaphore was acquired before the timeout expired
+BOOLEAN SetSemaphoreTimeout (Semaphore sem, TimePeriod timeout);
 
 void DestroyMutex (Mutex sem);
 void LockMutex (Mutex sem);
@@ -179,6 +181,16 @@ void WaitCondVar (CondVar);
 void SignalCondVar (CondVar);
 void BroadcastCondVar (CondVar);
 
+/* Data-parallel loops on the worker pool.  RunParallel() splits
+   [0, count) into chunks of at least 'grain' items and calls func on
+   each from the caller and the pool threads; it returns when all
+   chunks are done.  func must be safe to run concurrently on disjoint
+   ranges. */
+typedef void (*ParallelFunction) (void *data, int begin, int end);
+
+void RunParallel (ParallelFunction func, void *data, int count, int grain);
+int GetParallelThreadCount (void);
+
 #if defined(__cplusplus)
 }
 #endif
@@ -0,0 +1,193 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+// Worker pool for data-parallel loops
+//  A fixed set of helper threads is started with the thread system.
+//  RunParallel() cuts a loop into chunks which the calling thread and
+//  the helpers take in turn until none are left. Only one loop runs on
+//  the pool at a time; a loop started while the pool is busy (from
+//  another thread, or from inside a chunk) simply runs on its caller.
+
+#include "port.h"
+#include SDL_INCLUDE(SDL_atomic.h)
+#include SDL_INCLUDE(SDL_cpuinfo.h)
+#include "libs/threadlib.h"
+#include "libs/log.h"
+#include "thrcommon.h"
+
+#define PARALLEL_MAX_HELPERS 7
+		// the caller makes 8 threads
+#define PARALLEL_CHUNKS_PER_THREAD 4
+		// smaller chunks even out the load between threads
+
+typedef struct
+{
+	ParallelFunction func;
+	void *data;
+	int count;
+	int chunk;
+	int chunks;
+	SDL_atomic_t next;
+} ParallelJob;
+
+static Thread helpers[PARALLEL_MAX_HELPERS];
+static int numHelpers;
+static Semaphore wakeSem;
+static Semaphore doneSem;
+static SDL_atomic_t poolBusy;
+static volatile BOOLEAN poolQuit;
+static ParallelJob *curJob;
+
+static void
+RunChunks (ParallelJob *job)
+{
+	int i;
+
+	while ((i = SDL_AtomicAdd (&job->next, 1)) < job->chunks)
+	{
+		int begin = i * job->chunk;
+		int end = begin + job->chunk;
+		if (end > job->count)
+			end = job->count;
+		job->func (job->data, begin, end);
+	}
+}
+
+static int
+ParallelHelper (void *data)
+{
+	for (;;)
+	{
+		SetSemaphore (wakeSem);
+		if (poolQuit)
+			break;
+		RunChunks (curJob);
+		ClearSemaphore (doneSem);
+	}
+	ClearSemaphore (doneSem);
+	(void) data;
+	return 0;
+}
+
+/* Only call from main thread! (from InitThreadSystem) */
+void
+InitParallel (void)
+{
+	int cpus = SDL_GetCPUCount ();
+	int i;
+
+	numHelpers = 0;
+	poolQuit = FALSE;
+	curJob = NULL;
+	SDL_AtomicSet (&poolBusy, 0);
+	wakeSem = CreateSemaphore (0, "Parallel wake", SYNC_CLASS_RESOURCE);
+	doneSem = CreateSemaphore (0, "Parallel done", SYNC_CLASS_RESOURCE);
+
+	if (cpus > PARALLEL_MAX_HELPERS + 1)
+		cpus = PARALLEL_MAX_HELPERS + 1;
+	// The helpers are created directly: the lifecycle queue is only
+	// serviced once the main loop runs, and nothing waits on them here.
+	for (i = 0; i < cpus - 1; ++i)
+	{
+#ifdef NAMED_SYNCHRO
+		helpers[i] = NativeCreateThread (ParallelHelper, NULL, 0,
+				"Parallel helper");
+#else
+		helpers[i] = NativeCreateThread (ParallelHelper, NULL, 0);
+#endif
+		if (!helpers[i])
+			break;
+		++numHelpers;
+	}
+
+	log_add (log_Info, "Parallel loops use %d helper thread(s)", numHelpers);
+}
+
+/* Only call from main thread! (from UnInitThreadSystem) */
+void
+UnInitParallel (void)
+{
+	int i;
+
+	poolQuit = TRUE;
+	for (i = 0; i < numHelpers; ++i)
+	{
+		// Helpers go through FinishThread() on exit; reap the
+		// finished ones as we go so the lifecycle queue never fills.
+		ProcessThreadLifecycles ();
+		ClearSemaphore (wakeSem);
+		SetSemaphore (doneSem);
+	}
+	ProcessThreadLifecycles ();
+	numHelpers = 0;
+
+	DestroySemaphore (doneSem);
+	DestroySemaphore (wakeSem);
+}
+
+int
+GetParallelThreadCount (void)
+{
+	return numHelpers + 1;
+}
+
+void
+RunParallel (ParallelFunction func, void *data, int count, int grain)
+{
+	ParallelJob job;
+	int threads;
+	int woken;
+	int i;
+
+	if (count <= 0)
+		return;
+	if (grain < 1)
+		grain = 1;
+
+	if (numHelpers == 0 || count <= grain
+			|| !SDL_AtomicCAS (&poolBusy, 0, 1))
+	{	// Not worth it, or the pool is taken
+		func (data, 0, count);
+		return;
+	}
+
+	threads = numHelpers + 1;
+	job.func = func;
+	job.data = data;
+	job.count = count;
+	job.chunk = (count + threads * PARALLEL_CHUNKS_PER_THREAD - 1)
+			/ (threads * PARALLEL_CHUNKS_PER_THREAD);
+	if (job.chunk < grain)
+		job.chunk = grain;
+	job.chunks = (count + job.chunk - 1) / job.chunk;
+	SDL_AtomicSet (&job.next, 0);
+	curJob = &job;
+
+	woken = job.chunks - 1;
+	if (woken > numHelpers)
+		woken = numHelpers;
+	for (i = 0; i < woken; ++i)
+		ClearSemaphore (wakeSem);
+
+	RunChunks (&job);
+
+	// 'job' lives on this stack; every woken helper must be out of it
+	for (i = 0; i < woken; ++i)
+		SetSemaphore (doneSem);
+
+	curJob = NULL;
+	SDL_AtomicSet (&poolBusy, 0);
+}
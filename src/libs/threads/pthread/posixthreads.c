@@ -20,6 +20,8 @@
 #include "posixthreads.h"
 #include <pthread.h>
 #include <unistd.h>
+#include <time.h>
+#include <errno.h>
 
 #include <semaphore.h>
 
@@ -483,6 +485,32 @@ ClearSemaphore_PT (Semaphore s)
 	//log_add (log_Debug, "Attempt to clear semaphore %x success", sem);
 }
 
+BOOLEAN
+SetSemaphoreTimeout_PT (Semaphore s, TimePeriod timeout)
+{
+	Sem *sem = (Sem *)s;
+	struct timespec abstime;
+	long nsec;
+
+	// sem_timedwait() wants an absolute CLOCK_REALTIME deadline
+	clock_gettime (CLOCK_REALTIME, &abstime);
+	nsec = (long)((uint64)timeout * 1000000000 / ONE_SECOND);
+	abstime.tv_sec += nsec / 1000000000;
+	abstime.tv_nsec += nsec % 1000000000;
+	if (abstime.tv_nsec >= 1000000000)
+	{
+		abstime.tv_sec++;
+		abstime.tv_nsec -= 1000000000;
+	}
+
+	while (sem_timedwait (&sem->sem, &abstime) == -1)
+	{
+		if (errno != EINTR)
+			return FALSE; // timed out
+	}
+	return TRUE;
+}
+
 /* Recursive mutexes. Adapted from mixSDL code, which was adapted from
    the original DCQ code. */
 
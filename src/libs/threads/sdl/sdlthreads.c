@@ -510,6 +510,16 @@ ClearSemaphore_SDL (Semaphore s)
 	}
 }
 
+BOOLEAN
+SetSemaphoreTimeout_SDL (Semaphore s, TimePeriod timeout)
+{
+	Sem *sem = (Sem *)s;
+	int ret;
+
+	ret = SDL_SemWaitTimeout (sem->sem, timeout * 1000 / ONE_SECOND);
+	return ret == 0;
+}
+
 /* Recursive mutexes. Adapted from mixSDL code, which was adapted from
    the original DCQ code. */
 
@@ -52,11 +52,13 @@ InitThreadSystem (void)
 		pendingDeath[i] = NULL;
 	}
 	lifecycleMutex = CreateMutex ("Thread Lifecycle Mutex", SYNC_CLASS_RESOURCE);
+	InitParallel ();
 }
 
 void
 UnInitThreadSystem (void)
 {
+	UnInitParallel ();
 	NativeUnInitThreadSystem ();
 	DestroyMutex (lifecycleMutex);
 }
@@ -402,6 +404,12 @@ ClearSemaphore (Semaphore sem)
 	NativeClearSemaphore (sem);
 }
 
+BOOLEAN
+SetSemaphoreTimeout (Semaphore sem, TimePeriod timeout)
+{
+	return NativeSetSemaphoreTimeout (sem, timeout);
+}
+
 void
 DestroyCondVar (CondVar cv)
 {
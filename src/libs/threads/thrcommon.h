@@ -24,5 +24,8 @@
 #	include "pthread/posixthreads.h"
 #endif  /* defined(THREADLIB_PTHREAD) */
 
+void InitParallel (void);
+void UnInitParallel (void);
+
 
 #endif  /* _THR_COMMON_H */
@@ -29,6 +29,10 @@
 extern Uint32 SDLWrapper_GetTimeCounter (void);
 #define NativeGetTimeCounter() \
 		SDLWrapper_GetTimeCounter ()
+#define NativeGetPerfCounter() \
+		SDL_GetPerformanceCounter ()
+#define NativeGetPerfFrequency() \
+		SDL_GetPerformanceFrequency ()
 
 
 #endif  /* LIBS_TIME_SDL_SDLTIME_H_ */
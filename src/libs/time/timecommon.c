@@ -39,3 +39,15 @@ GetTimeCounter (void)
 	return NativeGetTimeCounter ();
 }
 
+QWORD
+GetPerfCounter (void)
+{
+	return NativeGetPerfCounter ();
+}
+
+QWORD
+GetPerfFrequency (void)
+{
+	return NativeGetPerfFrequency ();
+}
+
@@ -42,6 +42,11 @@ extern void InitTimeSystem (void);
 extern void UnInitTimeSystem (void);
 extern TimeCount GetTimeCounter (void);
 
+/* High-resolution counter for profiling only; GetTimeCounter() is what
+ * game timing is based on. Ticks are GetPerfFrequency() per second. */
+extern QWORD GetPerfCounter (void);
+extern QWORD GetPerfFrequency (void);
+
 #if defined(__cplusplus)
 }
 #endif
@@ -50,6 +50,7 @@ uio_FileBlock_new(uio_Handle *handle, int flags, off_t offset,
 	result->bufOffset = bufOffset;
 	result->bufFill = bufFill;
 	result->readAheadBufSize = readAheadBufSize;
+	result->mapCookie = NULL;
 	return result;
 }
 
@@ -101,16 +102,48 @@ uio_openFileBlock2(uio_Handle *handle, off_t offset, size_t size) {
 	return uio_FileBlock_new(handle, 0, offset, size, NULL, 0, 0, 0, 0);
 }
 
+// As uio_openFileBlock2(), but the block is memory mapped if the file
+// system of 'handle' supports that. uio_accessFileBlock() then returns
+// pointers into the mapping, and reading does not involve the handle.
+// If the block can't be mapped, it falls back to normal reading.
+uio_FileBlock *
+uio_openFileBlockMapped(uio_Handle *handle, off_t offset, size_t size) {
+	uio_FileBlock *block;
+	const char *data;
+	void *cookie;
+
+	if (handle->root->handler->mmap == NULL || size == 0)
+		return uio_openFileBlock2(handle, offset, size);
+
+	data = (handle->root->handler->mmap)(handle, offset, size, &cookie);
+	if (data == NULL)
+		return uio_openFileBlock2(handle, offset, size);
+
+	uio_Handle_ref(handle);
+	block = uio_FileBlock_new(handle, uio_FB_USE_MMAP, offset, size,
+			(char *) data, size, 0, size, 0);
+	block->mapCookie = cookie;
+	return block;
+}
+
+int
+uio_isFileBlockMapped(const uio_FileBlock *block) {
+	return (block->flags & uio_FB_USE_MMAP) != 0;
+}
+
 static inline ssize_t
 uio_accessFileBlockMmap(uio_FileBlock *block, off_t offset, size_t length,
 		char **buffer) {
-	// TODO
-	errno = ENOSYS;
-	(void) block;
-	(void) offset;
-	(void) length;
-	(void) buffer;
-	return -1;
+	// The whole block is in the buffer.
+	if (offset > (off_t) block->blockSize) {
+		*buffer = block->buffer;
+		return 0;
+	}
+	if (length > block->blockSize - offset)
+		length = block->blockSize - offset;
+
+	*buffer = block->buffer + offset;
+	return length;
 }
 
 static inline ssize_t
@@ -243,9 +276,14 @@ int
 uio_copyFileBlock(uio_FileBlock *block, off_t offset, char *buffer,
 		size_t length) {
 	if (block->flags & uio_FB_USE_MMAP) {
-		// TODO
-		errno = ENOSYS;
-		return -1;
+		// Don't go beyond the end of the block.
+		if (offset > (off_t) block->blockSize)
+			return 0;
+		if (length > block->blockSize - offset)
+			length = block->blockSize - offset;
+
+		memcpy(buffer, block->buffer + offset, length);
+		return length;
 	} else {
 		ssize_t numCopied = 0;
 		ssize_t readResult;
@@ -295,10 +333,8 @@ uio_copyFileBlock(uio_FileBlock *block, off_t offset, char *buffer,
 int
 uio_closeFileBlock(uio_FileBlock *block) {
 	if (block->flags & uio_FB_USE_MMAP) {
-#if 0
-		if (block->buffer != NULL)
-			uio_mmunmap(block->buffer);
-#endif
+		(block->handle->root->handler->munmap)(block->handle,
+				block->mapCookie);
 	} else {
 		if (block->buffer != NULL)
 			uio_free(block->buffer);
@@ -323,6 +359,10 @@ uio_setFileBlockUsageHint(uio_FileBlock *block, int usage,
 // call uio_closeFileBlock() instead.
 void
 uio_clearFileBlockBuffers(uio_FileBlock *block) {
+	if (block->flags & uio_FB_USE_MMAP) {
+		// The mapping is the block itself.
+		return;
+	}
 	if (block->buffer != NULL) {
 		uio_free(block->buffer);
 		block->buffer = NULL;
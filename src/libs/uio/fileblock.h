@@ -58,6 +58,9 @@ struct uio_FileBlock {
 	size_t readAheadBufSize;
 			// Try to read up to this many bytes at a time, even when less
 			// is immediately needed.
+	void *mapCookie;
+			// If uio_FB_USE_MMAP is set, what to pass to the munmap()
+			// function of the file system.
 };
 // INV: The FileBlock represents 'fileData[offset..(offset + blockSize - 1)]'
 // where 'fileData' is the contents of the file.
@@ -73,6 +76,9 @@ struct uio_FileBlock {
 uio_FileBlock *uio_openFileBlock(uio_Handle *handle);
 uio_FileBlock *uio_openFileBlock2(uio_Handle *handle, off_t offset,
 		size_t size);
+uio_FileBlock *uio_openFileBlockMapped(uio_Handle *handle, off_t offset,
+		size_t size);
+int uio_isFileBlockMapped(const uio_FileBlock *block);
 ssize_t uio_accessFileBlock(uio_FileBlock *block, off_t offset, size_t length,
 		char **buffer);
 int uio_copyFileBlock(uio_FileBlock *block, off_t offset, char *buffer,
@@ -89,6 +89,12 @@ struct uio_FileSystemHandler {
 			uio_PDirHandleExtra pDirHandleExtra);
 	void              (*deletePFileHandleExtra) (
 			uio_PFileHandleExtra pFileHandleExtra);
+
+	const char *      (*mmap)     (uio_Handle *, off_t, size_t, void **);
+			// Optional. Makes 'size' bytes at 'offset' in the file
+			// available read-only without copying. The last argument
+			// receives what is to be passed to munmap() afterwards.
+	void              (*munmap)   (uio_Handle *, void *);
 };
 
 struct uio_FileSystemInfo {
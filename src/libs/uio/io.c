@@ -656,6 +656,50 @@ uio_fstat(uio_Handle *handle, struct stat *statBuf) {
 	return (handle->root->handler->fstat)(handle, statBuf);
 }
 
+// Returns a read-only pointer to the entire contents of the file, for
+// reading it without copying. The data remains valid until the handle
+// is closed.
+// Returns NULL (and sets errno) when the file system can't provide this,
+// in which case the file is to be read as usual.
+const char *
+uio_getMappedData(uio_Handle *handle, size_t *size) {
+	struct stat statBuf;
+	const char *data;
+	void *cookie;
+
+	if (handle->mapData != NULL) {
+		*size = handle->mapSize;
+		return handle->mapData;
+	}
+
+	if (handle->root->handler->mmap == NULL) {
+		errno = ENOSYS;
+		return NULL;
+	}
+	if (uio_fstat(handle, &statBuf) == -1) {
+		// errno is set
+		return NULL;
+	}
+	if (statBuf.st_size == 0) {
+		// Nothing to map.
+		errno = EINVAL;
+		return NULL;
+	}
+
+	data = (handle->root->handler->mmap)(handle, 0,
+			(size_t) statBuf.st_size, &cookie);
+	if (data == NULL) {
+		// errno is set
+		return NULL;
+	}
+
+	handle->mapData = data;
+	handle->mapSize = (size_t) statBuf.st_size;
+	handle->mapCookie = cookie;
+	*size = handle->mapSize;
+	return data;
+}
+
 int
 uio_stat(uio_DirHandle *dir, const char *path, struct stat *statBuf) {
 	uio_PDirHandle *pReadDir;
@@ -1761,11 +1805,16 @@ uio_Handle_new(uio_PRoot *root, uio_NativeHandle native, int openFlags) {
 	handle->root = root;
 	handle->native = native;
 	handle->openFlags = openFlags;
+	handle->mapData = NULL;
+	handle->mapSize = 0;
+	handle->mapCookie = NULL;
 	return handle;
 }
 
 void
 uio_Handle_delete(uio_Handle *handle) {
+	if (handle->mapData != NULL)
+		(handle->root->handler->munmap)(handle, handle->mapCookie);
 	(handle->root->handler->close)(handle);
 	uio_PRoot_unrefHandle(handle->root);
 	uio_Handle_free(handle);
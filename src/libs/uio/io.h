@@ -131,6 +131,8 @@ int uio_unlink(uio_DirHandle *dirHandle, const char *path);
 int uio_getFileLocation(uio_DirHandle *dir, const char *inPath,
 		int flags, uio_MountHandle **mountHandle, char **outPath);
 
+const char *uio_getMappedData(uio_Handle *handle, size_t *size);
+
 // Get a directory handle.
 uio_DirHandle *uio_openDir(uio_Repository *repository, const char *path,
 		int flags);
@@ -47,6 +47,11 @@ struct uio_Handle {
 	uio_NativeHandle native;
 	int openFlags;
 			// need to know whether the handle is a RO or RW handle.
+	const char *mapData;
+	size_t mapSize;
+	void *mapCookie;
+			// The mapping returned by uio_getMappedData(), if any.
+			// It is released when the handle is deleted.
 };
 
 struct uio_DirHandle {
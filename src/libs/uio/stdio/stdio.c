@@ -34,6 +34,9 @@
 #	include <unistd.h>
 #	include <dirent.h>
 #endif
+#ifdef HAVE_MMAP
+#	include <sys/mman.h>
+#endif
 #include <stdio.h>
 #include <sys/types.h>
 #include <errno.h>
@@ -91,6 +94,14 @@ uio_FileSystemHandler stdio_fileSystemHandler = {
 	/* .deletePRootExtra       = */  uio_GPRoot_delete,
 	/* .deletePDirHandleExtra  = */  uio_GPDirHandle_delete,
 	/* .deletePFileHandleExtra = */  uio_GPFileHandle_delete,
+
+#ifdef HAVE_MMAP
+	/* .mmap   = */  stdio_mmap,
+	/* .munmap = */  stdio_munmap,
+#else
+	/* .mmap   = */  NULL,
+	/* .munmap = */  NULL,
+#endif
 };
 
 uio_GPRoot_Operations stdio_GPRootOperations = {
@@ -249,6 +260,44 @@ stdio_read(uio_Handle *handle, void *buf, size_t count) {
 	return read(handle->native->fd, buf, count);
 }
 
+#ifdef HAVE_MMAP
+typedef struct {
+	void *start;
+	size_t size;
+} stdio_Mapping;
+
+const char *
+stdio_mmap(uio_Handle *handle, off_t offset, size_t size, void **cookie) {
+	stdio_Mapping *mapping;
+	off_t pageOffset;
+	void *start;
+
+	// mmap() wants an offset that is a multiple of the page size.
+	pageOffset = offset % (off_t) sysconf(_SC_PAGESIZE);
+	start = mmap(NULL, size + pageOffset, PROT_READ, MAP_PRIVATE,
+			handle->native->fd, offset - pageOffset);
+	if (start == MAP_FAILED) {
+		// errno is set
+		return NULL;
+	}
+
+	mapping = uio_malloc(sizeof (stdio_Mapping));
+	mapping->start = start;
+	mapping->size = size + pageOffset;
+	*cookie = mapping;
+	return (const char *) start + pageOffset;
+}
+
+void
+stdio_munmap(uio_Handle *handle, void *cookie) {
+	stdio_Mapping *mapping = cookie;
+
+	munmap(mapping->start, mapping->size);
+	uio_free(mapping);
+	(void) handle;
+}
+#endif  /* HAVE_MMAP */
+
 int
 stdio_rename(uio_PDirHandle *oldPDirHandle, const char *oldName,
 		uio_PDirHandle *newPDirHandle, const char *newName) {
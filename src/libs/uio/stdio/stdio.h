@@ -89,6 +89,11 @@ int stdio_fstat(uio_Handle *handle, struct stat *statBuf);
 int stdio_stat(uio_PDirHandle *pDirHandle, const char *name,
 		struct stat *statBuf);
 ssize_t stdio_read(uio_Handle *handle, void *buf, size_t count);
+#ifdef HAVE_MMAP
+const char *stdio_mmap(uio_Handle *handle, off_t offset, size_t size,
+		void **cookie);
+void stdio_munmap(uio_Handle *handle, void *cookie);
+#endif
 int stdio_rename(uio_PDirHandle *oldPDirHandle, const char *oldName,
 		uio_PDirHandle *newPDirHandle, const char *newName);
 int stdio_rmdir(uio_PDirHandle *pDirHandle, const char *name);
@@ -179,6 +179,14 @@ typedef unsigned short mode_t;
 #	define S_IFCHR _S_IFCHR
 #	define S_IFDIR _S_IFDIR
 #endif
+
+// Memory mapped files
+#if !defined(WIN32) && !defined(_WIN32_WCE) && !defined(__SYMBIAN32__)
+	// HAVE_MMAP is defined to signify that the POSIX mmap() is available.
+	// Without it, files are always read through read().
+#	define HAVE_MMAP
+#endif
+
 #ifdef __SYMBIAN32__
 	// TODO: Symbian doesn't have readdir_r(). If uio is to be usable
 	// outside of uqm (which defines its own backup readdir_r()), an
@@ -89,6 +89,17 @@ static ssize_t zip_readStored(uio_Handle *handle, void *buf, size_t count);
 static ssize_t zip_readDeflated(uio_Handle *handle, void *buf, size_t count);
 static off_t zip_seekStored(uio_Handle *handle, off_t offset);
 static off_t zip_seekDeflated(uio_Handle *handle, off_t offset);
+static const char *zip_mmap(uio_Handle *handle, off_t offset, size_t size,
+		void **cookie);
+static void zip_munmap(uio_Handle *handle, void *cookie);
+#ifdef zip_USE_CHECKPOINTS
+static void zip_addCheckpoint(zip_Handle *zipHandle);
+static const zip_Checkpoint *zip_findCheckpoint(
+		const zip_Handle *zipHandle, off_t offset);
+static int zip_resumeFromCheckpoint(zip_Handle *zipHandle,
+		const zip_Checkpoint *checkpoint);
+static void zip_freeCheckpoints(zip_Handle *zipHandle);
+#endif
 
 uio_FileSystemHandler zip_fileSystemHandler = {
 	/* .init    = */  NULL,
@@ -119,6 +130,9 @@ uio_FileSystemHandler zip_fileSystemHandler = {
 	/* .deletePRootExtra       = */  uio_GPRoot_delete,
 	/* .deletePDirHandleExtra  = */  uio_GPDirHandle_delete,
 	/* .deletePFileHandleExtra = */  uio_GPFileHandle_delete,
+
+	/* .mmap   = */  zip_mmap,
+	/* .munmap = */  zip_munmap,
 };
 
 uio_GPRoot_Operations zip_GPRootOperations = {
@@ -192,6 +206,28 @@ static mode_t zip_makeFileMode(zip_OSType creatorOS, uio_uint32 modeBytes);
 		// TODO: make this configurable a la sysctl?
 #define zip_SEEK_BUFFER_SIZE zip_INPUT_BUFFER_SIZE
 
+#ifdef zip_USE_CHECKPOINTS
+struct zip_Checkpoint {
+	off_t uncompressedOffset;
+	off_t compressedOffset;
+			// first compressed byte not yet consumed by inflate
+	int bits;
+			// number of bits of the byte before compressedOffset that
+			// are still unused
+	int bitData;
+			// those unused bits, in the low bits
+	uInt windowSize;
+	Bytef *window;
+			// the last (up to 32 KB) uncompressed bytes
+};
+
+#	define zip_INFLATE_FLUSH Z_BLOCK
+		// Makes inflate() return at every block boundary, which is
+		// where a checkpoint can be made.
+#else
+#	define zip_INFLATE_FLUSH Z_SYNC_FLUSH
+#endif
+
 
 void
 zip_close(uio_Handle *handle) {
@@ -201,6 +237,9 @@ zip_close(uio_Handle *handle) {
 	fprintf(stderr, "zip_close - handle=%p\n", (void *) handle);
 #endif
 	zip_handle = handle->native;
+#ifdef zip_USE_CHECKPOINTS
+	zip_freeCheckpoints(zip_handle);
+#endif
 	uio_GPFile_unref(zip_handle->file);
 	zip_unInitZipStream(&zip_handle->zipStream);
 	uio_closeFileBlock(zip_handle->fileBlock);
@@ -373,8 +412,16 @@ zip_open(uio_PDirHandle *pDirHandle, const char *name, int flags,
 	handle = uio_malloc(sizeof (zip_Handle));
 	uio_GPFile_ref(gPFile);
 	handle->file = gPFile;
-	handle->fileBlock = uio_openFileBlock2(pDirHandle->pRoot->handle,
-			gPFile->extra->fileOffset, gPFile->extra->compressedSize);
+	if (gPFile->extra->compressionMethod == 0) {
+		// Stored files are read straight from a mapping of the .zip
+		// file, if possible. See zip_mmap().
+		handle->fileBlock = uio_openFileBlockMapped(
+				pDirHandle->pRoot->handle, gPFile->extra->fileOffset,
+				gPFile->extra->compressedSize);
+	} else {
+		handle->fileBlock = uio_openFileBlock2(pDirHandle->pRoot->handle,
+				gPFile->extra->fileOffset, gPFile->extra->compressedSize);
+	}
 	if (handle->fileBlock == NULL) {
 		// errno is set
 		return NULL;
@@ -387,6 +434,12 @@ zip_open(uio_PDirHandle *pDirHandle, const char *name, int flags,
 	}
 	handle->compressedOffset = 0;
 	handle->uncompressedOffset = 0;
+#ifdef zip_USE_CHECKPOINTS
+	handle->inputStart = NULL;
+	handle->checkpoints = NULL;
+	handle->numCheckpoints = 0;
+	handle->maxCheckpoints = 0;
+#endif
 	
 	(void) mode;
 	return uio_Handle_new(pDirHandle->pRoot, handle, flags);
@@ -462,9 +515,16 @@ zip_readDeflated(uio_Handle *handle, void *buf, size_t count) {
 #endif
 			zipHandle->zipStream.avail_in = numBytes;
 			zipHandle->compressedOffset += numBytes;
+#ifdef zip_USE_CHECKPOINTS
+			zipHandle->inputStart = zipHandle->zipStream.next_in;
+#endif
 		}
-		inflateResult = inflate(&zipHandle->zipStream, Z_SYNC_FLUSH);
+		inflateResult = inflate(&zipHandle->zipStream, zip_INFLATE_FLUSH);
 		zipHandle->uncompressedOffset = zipHandle->zipStream.total_out;
+#ifdef zip_USE_CHECKPOINTS
+		if (inflateResult == Z_OK)
+			zip_addCheckpoint(zipHandle);
+#endif
 		if (inflateResult == Z_STREAM_END) {
 			// Everything is decompressed
 			break;
@@ -555,6 +615,43 @@ zip_seek(uio_Handle *handle, off_t offset, int whence) {
 			(handle, offset);
 }
 
+// Only stored files can be mapped, and only when their data could be
+// mapped when the file was opened. The mapping belongs to the file block
+// of the handle, so there is nothing extra to release.
+static const char *
+zip_mmap(uio_Handle *handle, off_t offset, size_t size, void **cookie) {
+	zip_Handle *zipHandle;
+	char *buf;
+	ssize_t numBytes;
+
+	zipHandle = handle->native;
+	if (zipHandle->file->extra->compressionMethod != 0 ||
+			!uio_isFileBlockMapped(zipHandle->fileBlock)) {
+		errno = ENOSYS;
+		return NULL;
+	}
+
+	numBytes = uio_accessFileBlock(zipHandle->fileBlock, offset, size, &buf);
+	if (numBytes == -1) {
+		// errno is set
+		return NULL;
+	}
+	if ((size_t) numBytes < size) {
+		// Beyond the end of the file.
+		errno = EINVAL;
+		return NULL;
+	}
+
+	*cookie = NULL;
+	return buf;
+}
+
+static void
+zip_munmap(uio_Handle *handle, void *cookie) {
+	(void) handle;
+	(void) cookie;
+}
+
 static off_t
 zip_seekStored(uio_Handle *handle, off_t offset) {
 	zip_Handle *zipHandle;
@@ -571,9 +668,26 @@ zip_seekStored(uio_Handle *handle, off_t offset) {
 static off_t
 zip_seekDeflated(uio_Handle *handle, off_t offset) {
 	zip_Handle *zipHandle;
+#ifdef zip_USE_CHECKPOINTS
+	const zip_Checkpoint *checkpoint;
+#endif
 
 	zipHandle = handle->native;
 
+#ifdef zip_USE_CHECKPOINTS
+	// Resume from the last checkpoint before the new offset, if that
+	// saves inflating data.
+	checkpoint = zip_findCheckpoint(zipHandle, offset);
+	if (checkpoint != NULL && (offset < zipHandle->uncompressedOffset ||
+			checkpoint->uncompressedOffset >
+			zipHandle->uncompressedOffset)) {
+		if (zip_resumeFromCheckpoint(zipHandle, checkpoint) == -1) {
+			fprintf(stderr, "Warning: Could not resume from zip "
+					"checkpoint; seeking from the start.\n");
+		}
+	}
+#endif
+
 	if (offset < zipHandle->uncompressedOffset) {
 		// The new offset is earlier than the current offset. We need to
 		// seek from the beginning.
@@ -616,6 +730,140 @@ zip_seekDeflated(uio_Handle *handle, off_t offset) {
 	return zipHandle->uncompressedOffset;
 }
 
+#ifdef zip_USE_CHECKPOINTS
+// Called after each successful inflate() call. If the stream is at a
+// block boundary far enough past the last checkpoint, a new checkpoint
+// is made there.
+static void
+zip_addCheckpoint(zip_Handle *zipHandle) {
+	z_stream *zipStream;
+	zip_Checkpoint *checkpoint;
+	off_t lastOffset;
+	int bits;
+	uInt windowSize;
+
+	zipStream = &zipHandle->zipStream;
+
+	// Bit 7 of data_type is set at a block boundary, bit 6 after the
+	// last block.
+	if ((zipStream->data_type & 0xc0) != 0x80)
+		return;
+
+	lastOffset = zipHandle->numCheckpoints == 0 ? 0 :
+			zipHandle->checkpoints[zipHandle->numCheckpoints - 1].
+			uncompressedOffset;
+	if ((off_t) zipStream->total_out < lastOffset + zip_CHECKPOINT_SPACING) {
+		// Also covers reading again from before the last checkpoint.
+		return;
+	}
+
+	bits = zipStream->data_type & 7;
+	if (bits != 0 && zipStream->next_in == zipHandle->inputStart) {
+		// The partially used byte is in an earlier input buffer, which
+		// is no longer available. Try again at the next block boundary.
+		return;
+	}
+
+	if (zipHandle->numCheckpoints == zipHandle->maxCheckpoints) {
+		int newMax;
+		zip_Checkpoint *newCheckpoints;
+
+		newMax = zipHandle->maxCheckpoints == 0 ? 8 :
+				zipHandle->maxCheckpoints * 2;
+		newCheckpoints = uio_realloc(zipHandle->checkpoints,
+				newMax * sizeof (zip_Checkpoint));
+		if (newCheckpoints == NULL)
+			return;
+		zipHandle->checkpoints = newCheckpoints;
+		zipHandle->maxCheckpoints = newMax;
+	}
+
+	checkpoint = &zipHandle->checkpoints[zipHandle->numCheckpoints];
+	if (inflateGetDictionary(zipStream, Z_NULL, &windowSize) != Z_OK)
+		return;
+	checkpoint->window = uio_malloc(windowSize > 0 ? windowSize : 1);
+	if (checkpoint->window == NULL)
+		return;
+	inflateGetDictionary(zipStream, checkpoint->window, &windowSize);
+	checkpoint->windowSize = windowSize;
+	checkpoint->uncompressedOffset = zipStream->total_out;
+	checkpoint->compressedOffset =
+			zipHandle->compressedOffset - zipStream->avail_in;
+	checkpoint->bits = bits;
+	checkpoint->bitData = bits == 0 ? 0 : zipStream->next_in[-1] >> (8 - bits);
+	zipHandle->numCheckpoints++;
+}
+
+// Returns the last checkpoint at or before 'offset', or NULL if there
+// is none.
+static const zip_Checkpoint *
+zip_findCheckpoint(const zip_Handle *zipHandle, off_t offset) {
+	int low, high;
+
+	low = 0;
+	high = zipHandle->numCheckpoints;
+	while (low < high) {
+		int mid = low + (high - low) / 2;
+		if (zipHandle->checkpoints[mid].uncompressedOffset <= offset) {
+			low = mid + 1;
+		} else
+			high = mid;
+	}
+	return low == 0 ? NULL : &zipHandle->checkpoints[low - 1];
+}
+
+// On failure, the stream is reset to the start of the file.
+static int
+zip_resumeFromCheckpoint(zip_Handle *zipHandle,
+		const zip_Checkpoint *checkpoint) {
+	z_stream *zipStream;
+
+	zipStream = &zipHandle->zipStream;
+	if (zip_reInitZipStream(zipStream) == -1) {
+		// Need to abort. Handle would get in an inconsistent state.
+		// Should not fail anyhow.
+		fprintf(stderr, "Fatal: Could not reinitialise zip stream: "
+				"%s.\n", strerror(errno));
+		abort();
+	}
+	zipHandle->compressedOffset = 0;
+	zipHandle->uncompressedOffset = 0;
+
+	if (checkpoint->bits != 0 && inflatePrime(zipStream, checkpoint->bits,
+			checkpoint->bitData) != Z_OK)
+		goto err;
+	if (inflateSetDictionary(zipStream, checkpoint->window,
+			checkpoint->windowSize) != Z_OK)
+		goto err;
+
+	zipStream->total_out = checkpoint->uncompressedOffset;
+	zipHandle->compressedOffset = checkpoint->compressedOffset;
+	zipHandle->uncompressedOffset = checkpoint->uncompressedOffset;
+	return 0;
+
+err:
+	if (zip_reInitZipStream(zipStream) == -1) {
+		fprintf(stderr, "Fatal: Could not reinitialise zip stream: "
+				"%s.\n", strerror(errno));
+		abort();
+	}
+	errno = EIO;
+	return -1;
+}
+
+static void
+zip_freeCheckpoints(zip_Handle *zipHandle) {
+	int i;
+
+	for (i = 0; i < zipHandle->numCheckpoints; i++)
+		uio_free(zipHandle->checkpoints[i].window);
+	uio_free(zipHandle->checkpoints);
+	zipHandle->checkpoints = NULL;
+	zipHandle->numCheckpoints = 0;
+	zipHandle->maxCheckpoints = 0;
+}
+#endif  /* zip_USE_CHECKPOINTS */
+
 uio_PRoot *
 zip_mount(uio_Handle *handle, int flags) {
 	uio_PRoot *result;
@@ -55,6 +55,20 @@ typedef struct uio_GPDirEntries_Iterator *uio_NativeEntriesContext;
 		// inaccurate. The advantage is that a possibly costly seek and
 		// read can be avoided.
 
+#if ZLIB_VERNUM >= 0x1271
+		// inflateGetDictionary() first appeared in zlib 1.2.7.1.
+#	define zip_USE_CHECKPOINTS
+		// If defined, the state of the decompressor is saved at regular
+		// intervals while a deflated file is read, so that a later seek
+		// can resume from there instead of from the start of the file.
+#endif
+
+#define zip_CHECKPOINT_SPACING 0x40000
+		// Minimum number of uncompressed bytes between checkpoints.
+		// Each checkpoint costs up to 32 KB for the inflate window.
+
+typedef struct zip_Checkpoint zip_Checkpoint;
+
 typedef struct zip_GPFileData {
 	off_t compressedSize;
 	off_t uncompressedSize;
@@ -86,6 +100,18 @@ typedef struct zip_Handle {
 	off_t compressedOffset;
 			// seek location in the compressed stream, from the start
 			// of the compressed file
+#ifdef zip_USE_CHECKPOINTS
+	const Bytef *inputStart;
+			// start of the input buffer that zipStream.next_in points in
+	zip_Checkpoint *checkpoints;
+			// Points from which inflating can be resumed, in order of
+			// increasing uncompressed offset. Built while the file is
+			// read through this handle, and dropped when it is closed.
+			// They are kept per handle, as handles to the same file may
+			// be used from different threads.
+	int numCheckpoints;
+	int maxCheckpoints;
+#endif
 } zip_Handle;
 
 
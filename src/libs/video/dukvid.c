@@ -95,6 +95,9 @@ typedef struct tfb_duckvideodecoder
 	uio_DirHandle* basedir;
 	char* basename;
 	uio_Stream *stream;
+	const uint8* data;
+	size_t data_size;
+			// the stream contents, when they can be accessed directly
 
 // loaded from disk
 	uint32* frames;
@@ -116,7 +119,7 @@ typedef struct tfb_duckvideodecoder
 #define DUCK_END_OF_SEQUENCE 1
 
 static void
-dukv_DecodeFrame (uint8* src_p, uint32* dst_p, uint32 wb, uint32 hb,
+dukv_DecodeFrame (const uint8* src_p, uint32* dst_p, uint32 wb, uint32 hb,
 		TFB_DuckVideoDeltas* deltas)
 {
 	int iVec;
@@ -214,7 +217,7 @@ dukv_DecodeFrame (uint8* src_p, uint32* dst_p, uint32 wb, uint32 hb,
 }
 
 static void
-dukv_DecodeFrameV3 (uint8* src_p, uint32* dst_p, uint32 wb, uint32 hb,
+dukv_DecodeFrameV3 (const uint8* src_p, uint32* dst_p, uint32 wb, uint32 hb,
 		TFB_DuckVideoDeltas* deltas)
 {
 	int iVec;
@@ -285,8 +288,13 @@ dukv_OpenStream (TFB_DuckVideoDecoder* dukv)
 
 	strcat (strcpy (filename, dukv->basename), ".duk");
 
-	return (dukv->stream =
-			uio_fopen (dukv->basedir, filename, "rb")) != NULL;
+	dukv->stream = uio_fopen (dukv->basedir, filename, "rb");
+	if (!dukv->stream)
+		return false;
+
+	dukv->data = (const uint8*) uio_getMappedData (
+			uio_streamHandle (dukv->stream), &dukv->data_size);
+	return true;
 }
 
 static bool
@@ -675,6 +683,7 @@ dukv_Close (THIS_PTR)
 	{
 		uio_fclose (dukv->stream);
 		dukv->stream = NULL;
+		dukv->data = NULL;
 	}
 	if (dukv->inbuf)
 	{
@@ -696,38 +705,84 @@ dukv_DecodeNext (THIS_PTR)
 	uint32 vofs;
 	uint32 vsize;
 	uint16 ver;
+	const uint8* src;
 
 	if (!dukv->stream || dukv->iframe >= dukv->cframes)
 		return 0;
 
-	uio_fseek (dukv->stream, dukv->frames[dukv->iframe], SEEK_SET);
-	if (uio_fread (&fh, sizeof (fh), 1, dukv->stream) != 1)
+	if (dukv->data)
 	{
-		dukv->last_error = dukve_EOF;
-		return 0;
-	}
+		size_t pos = dukv->frames[dukv->iframe];
 
-	vofs = UQM_SwapBE32 (fh[0]);
-	vsize = UQM_SwapBE32 (fh[1]);
-	if (vsize > DUCK_MAX_FRAME_SIZE)
-	{
-		dukv->last_error = dukve_OutOfBuf;
-		return -1;
-	}
+		if (pos > dukv->data_size || dukv->data_size - pos < sizeof (fh))
+		{
+			dukv->last_error = dukve_EOF;
+			return 0;
+		}
+		memcpy (fh, dukv->data + pos, sizeof (fh));
+		pos += sizeof (fh);
+
+		vofs = UQM_SwapBE32 (fh[0]);
+		vsize = UQM_SwapBE32 (fh[1]);
+		if (vsize > DUCK_MAX_FRAME_SIZE)
+		{
+			dukv->last_error = dukve_OutOfBuf;
+			return -1;
+		}
+
+		if (vofs > dukv->data_size - pos
+				|| dukv->data_size - pos - vofs < vsize)
+		{
+			dukv->last_error = dukve_EOF;
+			return 0;
+		}
+		pos += vofs;
 
-	uio_fseek (dukv->stream, vofs, SEEK_CUR);
-	if (uio_fread (dukv->inbuf, 1, vsize, dukv->stream) != vsize)
+		// The decoders may read up to a full frame buffer, so only
+		// decode in place when that stays within the data.
+		if (dukv->data_size - pos >= DUCK_MAX_FRAME_SIZE)
+		{
+			src = dukv->data + pos;
+		}
+		else
+		{
+			memcpy (dukv->inbuf, dukv->data + pos, vsize);
+			src = dukv->inbuf;
+		}
+	}
+	else
 	{
-		dukv->last_error = dukve_EOF;
-		return 0;
+		uio_fseek (dukv->stream, dukv->frames[dukv->iframe], SEEK_SET);
+		if (uio_fread (&fh, sizeof (fh), 1, dukv->stream) != 1)
+		{
+			dukv->last_error = dukve_EOF;
+			return 0;
+		}
+
+		vofs = UQM_SwapBE32 (fh[0]);
+		vsize = UQM_SwapBE32 (fh[1]);
+		if (vsize > DUCK_MAX_FRAME_SIZE)
+		{
+			dukv->last_error = dukve_OutOfBuf;
+			return -1;
+		}
+
+		uio_fseek (dukv->stream, vofs, SEEK_CUR);
+		if (uio_fread (dukv->inbuf, 1, vsize, dukv->stream) != vsize)
+		{
+			dukv->last_error = dukve_EOF;
+			return 0;
+		}
+		src = dukv->inbuf;
 	}
 
-	ver = UQM_SwapBE16 (*(uint16*)dukv->inbuf);
+	// The frame may be unaligned when decoded in place
+	ver = (src[0] << 8) | src[1];
 	if (ver == 0x0300)
-		dukv_DecodeFrameV3 (dukv->inbuf + 0x10, dukv->decbuf,
+		dukv_DecodeFrameV3 (src + 0x10, dukv->decbuf,
 				dukv->wb, dukv->hb, &dukv->d);
 	else
-		dukv_DecodeFrame (dukv->inbuf + 0x10, dukv->decbuf,
+		dukv_DecodeFrame (src + 0x10, dukv->decbuf,
 				dukv->wb, dukv->hb, &dukv->d);
 
 	dukv->iframe++;
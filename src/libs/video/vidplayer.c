@@ -263,6 +263,8 @@ TFB_PlayVideo (VIDEO_REF vid, uint32 x, uint32 y)
 		vid->hAudio = LoadMusicFile (vid->decoder->filename);
 		vid->own_audio = true;
 	}
+	if (vid->hAudio)
+		TFB_SetSoundSampleStreamType (*vid->hAudio, STREAM_TYPE_VIDEO);
 
 	if (vid->decoder->audio_synced)
 	{
@@ -314,6 +316,11 @@ TFB_StopVideo (VIDEO_REF vid)
 			vid->hAudio = 0;
 			vid->own_audio = false;
 		}
+		else
+		{	// The caller may play it as plain music later
+			TFB_SetSoundSampleStreamType (*vid->hAudio,
+					STREAM_TYPE_AUTO);
+		}
 	}
 	if (vid->frame) 
 	{
@@ -150,12 +150,16 @@ OPT_ENABLABLE optSpeech;
 OPT_ENABLABLE optSubtitles;
 OPT_ENABLABLE optStereoSFX;
 OPT_ENABLABLE optKeepAspectRatio;
+BOOLEAN optNoDrawCulling;
+const char *optSoundPrewarm;
+int optRotationCache;
 float optGamma;
 uio_DirHandle *contentDir;
 uio_DirHandle *configDir;
 uio_DirHandle *saveDir;
 uio_DirHandle *meleeDir;
 uio_DirHandle *scrShotDir;
+uio_DirHandle *cacheDir;
 uio_MountHandle* contentMountHandle;
 
 char *contentDirPath;
@@ -728,7 +732,7 @@ loadIndices (uio_DirHandle *dir)
 		{
 			log_add (log_Debug, "Loading resource index '%s'",
 					indices->names[i]);
-			LoadResourceIndex (dir, indices->names[i], NULL);
+			LoadCompiledResourceIndex (dir, indices->names[i], NULL);
 			numLoaded++;
 		}
 	}
@@ -834,6 +838,29 @@ prepareAddons (const char **addons)
 	}
 }
 
+// Holds files derived from the content that are only there to speed
+// things up; everything works without it.
+void
+prepareCacheDir (void)
+{
+	struct stat sb;
+
+	if (uio_stat (configDir, "cache", &sb) == -1
+			&& uio_mkdir (configDir, "cache", 0777) == -1)
+	{
+		log_add (log_Warning, "Warning: Could not create cache dir: %s",
+				strerror (errno));
+		return;
+	}
+
+	cacheDir = uio_openDirRelative (configDir, "cache", 0);
+	if (cacheDir == NULL)
+	{
+		log_add (log_Warning, "Warning: Could not open cache dir: %s",
+				strerror (errno));
+	}
+}
+
 void
 unprepareAllDirs (void)
 {
@@ -862,6 +889,11 @@ unprepareAllDirs (void)
 		uio_closeDir (scrShotDir);
 		scrShotDir = 0;
 	}
+	if (cacheDir)
+	{
+		uio_closeDir (cacheDir);
+		cacheDir = 0;
+	}
 }
 
 bool
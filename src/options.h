@@ -142,6 +142,10 @@ extern OPT_ENABLABLE optSpeech;
 extern OPT_ENABLABLE optSubtitles;
 extern OPT_ENABLABLE optStereoSFX;
 extern OPT_ENABLABLE optKeepAspectRatio;
+extern BOOLEAN optNoDrawCulling;
+extern const char *optSoundPrewarm;
+#define ROTATION_CACHE_DEFAULT_MB 16
+extern int optRotationCache;
 extern BOOLEAN restartGame;
 
 #define GAMMA_SCALE  1000
@@ -152,6 +156,7 @@ extern uio_DirHandle *configDir;
 extern uio_DirHandle *saveDir;
 extern uio_DirHandle *meleeDir;
 extern uio_DirHandle *scrShotDir;
+extern uio_DirHandle *cacheDir;
 extern char baseContentPath[PATH_MAX];
 
 extern char *contentDirPath;
@@ -199,6 +204,7 @@ void prepareConfigDir (const char *configDirName);
 void prepareMeleeDir (void);
 void prepareSaveDir (void);
 void prepareScrShotDir (void);
+void prepareCacheDir (void);
 void prepareAddons (const char **addons);
 void prepareShadowAddons (const char **addons);
 void unprepareAllDirs (void);
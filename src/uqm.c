@@ -57,6 +57,7 @@
 #endif
 #include "uqm/setup.h"
 #include "uqm/starcon.h"
+#include "uqm/benchmark.h"
 #include "libs/math/random.h"
 
 BOOLEAN restartGame;
@@ -111,6 +112,15 @@ struct options_struct
 	int numAddons;
 
 	const char* graphicsBackend;
+
+	const char *benchmark;
+	int benchFrames;
+	const char *benchOut;
+
+	int soundCache;
+	const char *soundPrewarm;
+	int streamAhead[NUM_STREAM_TYPES];
+	int rotationCache;
 	
 	// Commandline and user config options
 	DECL_CONFIG_OPTION(bool,  opengl);
@@ -118,6 +128,7 @@ struct options_struct
 	DECL_CONFIG_OPTION(int,   fullscreen);
 	DECL_CONFIG_OPTION(bool,  scanlines);
 	DECL_CONFIG_OPTION(int,   scaler);
+	DECL_CONFIG_OPTION(int,   scaleFactor);
 	DECL_CONFIG_OPTION(bool,  showFps);
 	DECL_CONFIG_OPTION(bool,  keepAspectRatio);
 	DECL_CONFIG_OPTION(float, gamma);
@@ -241,6 +252,14 @@ static const struct option_list_value scalerList[] =
 	{NULL, 0}
 };
 
+static const struct option_list_value scaleFactorList[] = 
+{
+	{"2",        0},
+	{"3",        TFB_GFXFLAGS_SCALE_3X},
+	{"4",        TFB_GFXFLAGS_SCALE_4X},
+	{NULL, 0}
+};
+
 static const struct option_list_value meleeScaleList[] = 
 {
 	{"smooth",   TFB_SCALE_TRILINEAR},
@@ -266,6 +285,7 @@ static const struct option_list_value audioQualityList[] =
 	{"low",    audio_QUALITY_LOW},
 	{"medium", audio_QUALITY_MEDIUM},
 	{"high",   audio_QUALITY_HIGH},
+	{"best",   audio_QUALITY_BEST},
 	{NULL, 0}
 };
 
@@ -281,6 +301,8 @@ static const struct option_list_value accelList[] =
 	{"mmx",    PLATFORM_MMX},
 	{"sse",    PLATFORM_SSE},
 	{"3dnow",  PLATFORM_3DNOW},
+	{"sse2",   PLATFORM_SSE2},
+	{"avx2",   PLATFORM_AVX2},
 	{"none",   PLATFORM_C},
 	{"detect", PLATFORM_NULL},
 	{NULL, 0}
@@ -327,12 +349,20 @@ int main(int argc, char** argv)
 		/* .addons = */             NULL,
 		/* .numAddons = */          0,
 		/* .graphicsBackend = */    NULL,
+		/* .benchmark = */          NULL,
+		/* .benchFrames = */        BENCHMARK_DEFAULT_FRAMES,
+		/* .benchOut = */           NULL,
+		/* .soundCache = */         SOUND_CACHE_DEFAULT_KB,
+		/* .soundPrewarm = */       NULL,
+		/* .streamAhead = */        { 0, 0, 0 },
+		/* .rotationCache = */      ROTATION_CACHE_DEFAULT_MB,
 
 		INIT_CONFIG_OPTION(  opengl,            false ),
 		INIT_CONFIG_OPTION2( resolution,        640, 480 ),
 		INIT_CONFIG_OPTION(  fullscreen,        2 ),
 		INIT_CONFIG_OPTION(  scanlines,         false ),
 		INIT_CONFIG_OPTION(  scaler,            0 ),
+		INIT_CONFIG_OPTION(  scaleFactor,       0 ),
 		INIT_CONFIG_OPTION(  showFps,           false ),
 		INIT_CONFIG_OPTION(  keepAspectRatio,   false ),
 		INIT_CONFIG_OPTION(  gamma,             1.0f ),
@@ -436,6 +466,7 @@ int main(int argc, char** argv)
 	int optionsResult;
 	int gfxDriver;
 	int gfxFlags;
+	int exitCode = EXIT_SUCCESS;
 	int i;
 
 	// NOTE: we cannot use the logging facility yet because we may have to
@@ -535,6 +566,11 @@ int main(int argc, char** argv)
 		return optionsResult;
 	}
 
+	if (options.benchmark)
+	{	// Render offscreen; SDL reads this in TFB_PreInit()
+		setenv ("SDL_VIDEODRIVER", "dummy", 1);
+	}
+
 	TFB_PreInit ();
 	mem_init ();
 	InitThreadSystem ();
@@ -575,6 +611,15 @@ int main(int argc, char** argv)
 	   thread doesn't work */
 	snddriver = options.soundDriver.value;
 	soundflags = options.soundQuality.value;
+	if (options.benchmark)
+		snddriver = audio_DRIVER_NOSOUND;
+	SoundDecoder_SetCacheLimit ((uint32)options.soundCache * 1024);
+	for (i = 0; i < NUM_STREAM_TYPES; ++i)
+	{
+		if (options.streamAhead[i] > 0)
+			SetStreamLookAhead (i, options.streamAhead[i]);
+	}
+	optRotationCache = options.rotationCache;
 
 	// Fill in global variables:
 	opt3doMusic = options.use3doMusic.value;
@@ -728,6 +773,7 @@ int main(int argc, char** argv)
 	prepareMeleeDir ();
 	prepareSaveDir ();
 	prepareScrShotDir ();
+	prepareCacheDir ();
 	prepareShadowAddons (options.addons);
 #if 0
 	initTempDir ();
@@ -747,8 +793,8 @@ int main(int argc, char** argv)
 #endif
 
 	gfxDriver = TFB_GFXDRIVER_SDL_PURE;
-	gfxFlags = options.scaler.value;
-	if (options.fullscreen.value)
+	gfxFlags = options.scaler.value | options.scaleFactor.value;
+	if (options.fullscreen.value && !options.benchmark)
 	{
 		if (options.fullscreen.value > 1)
 			gfxFlags |= TFB_GFXFLAGS_FULLSCREEN;
@@ -781,7 +827,16 @@ int main(int argc, char** argv)
 			NUM_KEYS);
 	TFB_InitInput (TFB_INPUTDRIVER_SDL, 0);
 
-	StartThread (Starcon2Main, NULL, 1024, "Starcon2Main");
+	if (options.benchmark)
+	{	// Replaces the game entirely; see benchmark.c
+		exitCode = Benchmark_Run (options.benchmark, options.benchFrames,
+				options.benchOut);
+		MainExited = TRUE;
+	}
+	else
+	{
+		StartThread (Starcon2Main, NULL, 1024, "Starcon2Main");
+	}
 
 	for (i = 0; i < 2000 && !MainExited; )
 	{
@@ -838,7 +893,7 @@ int main(int argc, char** argv)
 
 	HFree (options.addons);
 	
-	return EXIT_SUCCESS;
+	return exitCode;
 }
 
 static void
@@ -994,6 +1049,8 @@ getUserConfigOptions (struct options_struct *options)
 	getBoolConfigValue (&options->opengl, "config.usegl");
 
 	getListConfigValue (&options->scaler, "config.scaler", scalerList);
+	getListConfigValue (&options->scaleFactor, "config.scalefactor",
+			scaleFactorList);
 
 	//getBoolConfigValue (&options->fullscreen, "config.fullscreen");
 	if (res_IsInteger ("config.fullscreen") && !options->fullscreen.set)
@@ -1265,6 +1322,15 @@ enum
 	ADDON_OPT,
 	ADDONDIR_OPT,
 	ACCEL_OPT,
+	NODRAWCULL_OPT,
+	SCALEFACTOR_OPT,
+	BENCHMARK_OPT,
+	BENCHFRAMES_OPT,
+	BENCHOUT_OPT,
+	SOUNDCACHE_OPT,
+	SOUNDPREWARM_OPT,
+	STREAMAHEAD_OPT,
+	ROTATIONCACHE_OPT,
 	SAFEMODE_OPT,
 	RENDERER_OPT,
 	CHEATMODE_OPT,
@@ -1387,6 +1453,15 @@ static struct option longOptions[] =
 	{"addon", 1, NULL, ADDON_OPT},
 	{"addondir", 1, NULL, ADDONDIR_OPT},
 	{"accel", 1, NULL, ACCEL_OPT},
+	{"nodrawcull", 0, NULL, NODRAWCULL_OPT},
+	{"scalefactor", 1, NULL, SCALEFACTOR_OPT},
+	{"benchmark", 2, NULL, BENCHMARK_OPT},
+	{"benchframes", 1, NULL, BENCHFRAMES_OPT},
+	{"benchout", 1, NULL, BENCHOUT_OPT},
+	{"soundcache", 1, NULL, SOUNDCACHE_OPT},
+	{"soundprewarm", 1, NULL, SOUNDPREWARM_OPT},
+	{"streamahead", 1, NULL, STREAMAHEAD_OPT},
+	{"rotationcache", 1, NULL, ROTATIONCACHE_OPT},
 	{"safe", 0, NULL, SAFEMODE_OPT},
 	{"renderer", 1, NULL, RENDERER_OPT},
 	{"kohrstahp", 0, NULL, CHEATMODE_OPT},
@@ -1785,6 +1860,83 @@ parseOptions (int argc, char *argv[], struct options_struct *options)
 				}
 				break;
 			}
+			case NODRAWCULL_OPT:
+				optNoDrawCulling = TRUE;
+				break;
+			case SCALEFACTOR_OPT:
+				if (!setListOption (&options->scaleFactor, optarg,
+						scaleFactorList))
+				{
+					InvalidArgument (optarg, "--scalefactor");
+					badArg = true;
+				}
+				break;
+			case BENCHMARK_OPT:
+				options->benchmark = optarg ? optarg
+						: BENCHMARK_DEFAULT_SCENES;
+				break;
+			case BENCHFRAMES_OPT:
+				if (parseIntOption (optarg, &options->benchFrames,
+						"Benchmark frames") == -1)
+				{
+					badArg = true;
+				}
+				else if (options->benchFrames < 1)
+				{
+					InvalidArgument (optarg, "--benchframes");
+					badArg = true;
+				}
+				break;
+			case BENCHOUT_OPT:
+				options->benchOut = optarg;
+				break;
+			case SOUNDCACHE_OPT:
+				if (parseIntOption (optarg, &options->soundCache,
+						"Sound cache size") == -1)
+				{
+					badArg = true;
+				}
+				else if (options->soundCache < 0
+						|| options->soundCache > 4 * 1024 * 1024)
+				{
+					InvalidArgument (optarg, "--soundcache");
+					badArg = true;
+				}
+				break;
+			case SOUNDPREWARM_OPT:
+				optSoundPrewarm = optarg;
+				break;
+			case STREAMAHEAD_OPT:
+			{
+				int *ahead = options->streamAhead;
+				int count;
+
+				// Trailing values may be left out
+				count = sscanf (optarg, "%d,%d,%d",
+						&ahead[STREAM_TYPE_MUSIC], &ahead[STREAM_TYPE_SPEECH],
+						&ahead[STREAM_TYPE_VIDEO]);
+				if (count < 1 || ahead[STREAM_TYPE_MUSIC] < 0
+						|| ahead[STREAM_TYPE_SPEECH] < 0
+						|| ahead[STREAM_TYPE_VIDEO] < 0)
+				{
+					InvalidArgument (optarg, "--streamahead");
+					badArg = true;
+				}
+				break;
+			}
+			case ROTATIONCACHE_OPT:
+				if (parseIntOption (optarg, &options->rotationCache,
+						"Rotation frame cache size") == -1)
+				{
+					badArg = true;
+				}
+				else if (options->rotationCache < 0
+						|| options->rotationCache > 1024)
+				{
+					InvalidArgument (optarg, "--rotationcache");
+					badArg = true;
+				}
+				break;
 			case SAFEMODE_OPT:
 				setBoolOption (&options->safeMode, true);
 				break;
@@ -2504,8 +2656,8 @@ usage (FILE *out, const struct options_struct *defaults)
 	log_add (log_User, "  -M, --musicvol=VOLUME (0-100, default 100)");
 	log_add (log_User, "  -S, --sfxvol=VOLUME (0-100, default 100)");
 	log_add (log_User, "  -T, --speechvol=VOLUME (0-100, default 100)");
-	log_add (log_User, "  -q, --audioquality=QUALITY (high, medium or low, "
-			"default medium)");
+	log_add (log_User, "  -q, --audioquality=QUALITY (best, high, medium or "
+			"low, default medium)");
 	log_add (log_User, "  -u, --nosubtitles");
 	log_add (log_User, "  -l, --logfile=FILE (sends console output to "
 			"logfile FILE)");
@@ -2519,7 +2671,31 @@ usage (FILE *out, const struct options_struct *defaults)
 			"mixsdl)");
 	log_add (log_User, "  --stereosfx (enables positional sound effects, "
 			"currently only for openal)");
+	log_add (log_User, "  --soundcache=KB (memory for decoded sound effects "
+			"and speech, 0 disables; default %d)", SOUND_CACHE_DEFAULT_KB);
+	log_add (log_User, "  --soundprewarm=FILE (decode the sound files listed "
+			"in content file FILE at startup)");
+	log_add (log_User, "  --streamahead=MUSIC[,SPEECH[,VIDEO]] (buffers "
+			"decoded ahead of playback per stream type, 0 keeps the "
+			"default; default %u,%u,%u)",
+			GetStreamLookAhead (STREAM_TYPE_MUSIC),
+			GetStreamLookAhead (STREAM_TYPE_SPEECH),
+			GetStreamLookAhead (STREAM_TYPE_VIDEO));
+	log_add (log_User, "  --rotationcache=MB (memory for prerendering "
+			"rotation frames of the orbit sphere, 0 disables; default %d)",
+			ROTATION_CACHE_DEFAULT_MB);
 	log_add (log_User, "  --safe (start in safe mode)");
+	log_add (log_User, "  --nodrawcull (run every queued draw command, "
+			"without dropping overdraw)");
+	log_add (log_User, "  --scalefactor=FACTOR (2, 3 or 4; enlargement "
+			"done by the software scalers, default 2)");
+	log_add (log_User, "  --benchmark[=SCENES] (render the comma separated "
+			"scenes offscreen and report frame timings; default %s)",
+			BENCHMARK_DEFAULT_SCENES);
+	log_add (log_User, "  --benchframes=N (frames measured per benchmark "
+			"scene, default %d)", BENCHMARK_DEFAULT_FRAMES);
+	log_add (log_User, "  --benchout=FILE (write the benchmark JSON report "
+			"to FILE instead of stdout)");
 #ifdef NETPLAY
 	log_add (log_User, "  --nethostN=HOSTNAME (server to connect to for "
 			"player N (1=bottom, 2=top)");
@@ -0,0 +1,1026 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+// Headless graphics benchmark (--benchmark).
+// A producer thread plays the part of Starcon2Main and draws synthetic
+// scenes built from the same gfxlib primitives the game uses, while
+// main() flushes the DCQ one frame at a time.  The two run in lockstep,
+// so every TFB_FlushGraphics() covers exactly one scene frame and the
+// stage times it leaves in TFB_FrameStageTimes belong to that frame.
+
+#include "benchmark.h"
+
+#include "libs/gfxlib.h"
+#include "libs/graphics/gfx_common.h"
+#include "libs/threadlib.h"
+#include "libs/timelib.h"
+#include "libs/memlib.h"
+#include "libs/log.h"
+#include "uqmversion.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+
+// Frames run before the measured ones, to warm up caches and the
+// scaled image variants
+#define BENCH_WARMUP_FRAMES 10
+#define BENCH_MAX_SCENES    16
+#define BENCH_MAX_FRAMES    100000
+#define BENCH_MAX_OBJECTS   256
+#define BENCH_NUM_FACINGS   16
+#define BENCH_NUM_STARS     256
+#define BENCH_DEFAULT_SHIPS 16
+
+// Sphere texture used by the orbit scene
+#define BENCH_TEX_LON 256
+#define BENCH_TEX_LAT 128
+
+enum
+{
+	BENCH_LOGIC = 0,
+	BENCH_DCQ,
+	BENCH_SCALE,
+	BENCH_UPLOAD,
+	BENCH_PRESENT,
+	BENCH_TOTAL,
+
+	BENCH_NUM_STAGES
+};
+
+static const char *benchStageNames[BENCH_NUM_STAGES] =
+{
+	"logic", "dcq", "scale", "upload", "present", "total"
+};
+
+// Something that moves: a ship, a star or an animation.
+// Positions are in 1/256 pixels.
+typedef struct
+{
+	int x, y;
+	int dx, dy;
+	int facing;
+	int period;
+	Color color;
+} BENCH_OBJECT;
+
+typedef struct bench_scene BENCH_SCENE;
+
+typedef struct
+{
+	const char *name;
+	BOOLEAN (*init) (BENCH_SCENE *scene);
+	void (*frame) (BENCH_SCENE *scene, int frame);
+	void (*uninit) (BENCH_SCENE *scene);
+} BENCH_SCENE_DESC;
+
+struct bench_scene
+{
+	const BENCH_SCENE_DESC *desc;
+	char name[32];
+	int count;
+	BOOLEAN ready;
+	QWORD *samples;
+			// frames * BENCH_NUM_STAGES entries
+
+	FRAME facings[BENCH_NUM_FACINGS];
+	FRAME pixmap;
+	Color *pixels;
+	int *texMap;
+	BYTE *shade;
+	Color *texture;
+	SIZE dim;
+	RECT view;
+	BENCH_OBJECT objects[BENCH_MAX_OBJECTS];
+	BENCH_OBJECT stars[BENCH_NUM_STARS];
+};
+
+static SIZE benchWidth, benchHeight;
+static DWORD benchSeed;
+static int benchDirX[BENCH_NUM_FACINGS];
+static int benchDirY[BENCH_NUM_FACINGS];
+
+static BENCH_SCENE *benchScenes;
+static int benchNumScenes;
+static int benchFrames;
+static Semaphore benchGo;
+static Semaphore benchDone;
+static QWORD benchLogicTime;
+		// written by the producer before it releases benchDone
+
+static DWORD
+Bench_Random (void)
+{
+	// Fixed LCG, so that every run draws the same frames
+	benchSeed = benchSeed * 1103515245 + 12345;
+	return (benchSeed >> 16) & 0x7fff;
+}
+
+static Color
+Bench_Shade (Color c, int shade)
+{
+	return BUILD_COLOR_RGBA (c.r * shade / 255, c.g * shade / 255,
+			c.b * shade / 255, c.a);
+}
+
+static void
+Bench_InitStars (BENCH_SCENE *scene, const RECT *area)
+{
+	int i;
+
+	for (i = 0; i < BENCH_NUM_STARS; ++i)
+	{
+		BENCH_OBJECT *star = &scene->stars[i];
+		BYTE v = (BYTE)(64 + (i % 3) * 80);
+
+		star->x = (area->corner.x + Bench_Random ()
+				% area->extent.width) << 8;
+		star->y = (area->corner.y + Bench_Random ()
+				% area->extent.height) << 8;
+		star->period = i % 3;
+				// parallax layer
+		star->color = BUILD_COLOR_RGBA (v, v, v, 0xff);
+	}
+}
+
+static void
+Bench_DrawStars (BENCH_SCENE *scene, POINT offset)
+{
+	int layer;
+
+	// One colour change per layer, like the game's star layers
+	for (layer = 0; layer < 3; ++layer)
+	{
+		int i;
+
+		SetContextForeGroundColor (scene->stars[layer].color);
+		for (i = layer; i < BENCH_NUM_STARS; i += 3)
+		{
+			POINT pt;
+
+			pt.x = (scene->stars[i].x >> 8) - offset.x;
+			pt.y = (scene->stars[i].y >> 8) - offset.y;
+			DrawPoint (&pt);
+		}
+	}
+}
+
+// A ship sprite with alpha edges, pre-rotated into all facings the way
+// the melee ship graphics are
+static BOOLEAN
+Bench_CreateShip (BENCH_SCENE *scene)
+{
+	SIZE size = benchHeight / 12;
+	FRAME ship;
+	Color *pixels;
+	int x, y;
+	int i;
+
+	ship = CaptureDrawable (CreateDrawable (WANT_PIXMAP | WANT_ALPHA,
+			size, size, 1));
+	pixels = HMalloc (sizeof (Color) * size * size);
+	if (!ship || !pixels)
+	{
+		HFree (pixels);
+		DestroyDrawable (ReleaseDrawable (ship));
+		return FALSE;
+	}
+
+	for (y = 0; y < size; ++y)
+	{
+		for (x = 0; x < size; ++x)
+		{
+			int dx = x - size / 2;
+			Color *p = &pixels[y * size + x];
+
+			if (dx < 0)
+				dx = -dx;
+			if (dx * 2 <= y)
+			{
+				*p = BUILD_COLOR_RGBA ((BYTE)(96 + y * 144 / size),
+						(BYTE)(160 - dx * 4), (BYTE)(255 - y * 96 / size),
+						0xff);
+			}
+			else
+			{
+				*p = BUILD_COLOR_RGBA (0, 0, 0, 0);
+			}
+		}
+	}
+	WriteFramePixelColors (ship, pixels, size, size);
+	SetFrameHot (ship, MAKE_HOT_SPOT (size / 2, size / 2));
+	HFree (pixels);
+
+	for (i = 0; i < BENCH_NUM_FACINGS; ++i)
+	{
+		scene->facings[i] = CaptureDrawable (RotateFrame (ship,
+				i * 360 / BENCH_NUM_FACINGS));
+	}
+	DestroyDrawable (ReleaseDrawable (ship));
+
+	return scene->facings[BENCH_NUM_FACINGS - 1] != NULL;
+}
+
+static void
+Bench_Uninit (BENCH_SCENE *scene)
+{
+	int i;
+
+	for (i = 0; i < BENCH_NUM_FACINGS; ++i)
+	{
+		DestroyDrawable (ReleaseDrawable (scene->facings[i]));
+		scene->facings[i] = NULL;
+	}
+	DestroyDrawable (ReleaseDrawable (scene->pixmap));
+	scene->pixmap = NULL;
+	HFree (scene->pixels);
+	scene->pixels = NULL;
+	HFree (scene->texMap);
+	scene->texMap = NULL;
+	HFree (scene->shade);
+	scene->shade = NULL;
+	HFree (scene->texture);
+	scene->texture = NULL;
+}
+
+/*
+ * melee:N -- N ships flying around a starfield while the view zooms in
+ * and out, redrawn in full every frame, with a few laser lines.
+ */
+
+static BOOLEAN
+Bench_MeleeInit (BENCH_SCENE *scene)
+{
+	RECT all;
+	int i;
+
+	if (!Bench_CreateShip (scene))
+		return FALSE;
+
+	all.corner = MAKE_POINT (0, 0);
+	all.extent.width = benchWidth;
+	all.extent.height = benchHeight;
+	Bench_InitStars (scene, &all);
+
+	for (i = 0; i < scene->count; ++i)
+	{
+		BENCH_OBJECT *ship = &scene->objects[i];
+
+		ship->x = (Bench_Random () % benchWidth) << 8;
+		ship->y = (Bench_Random () % benchHeight) << 8;
+		ship->facing = Bench_Random () % BENCH_NUM_FACINGS;
+		ship->period = 8 + Bench_Random () % 24;
+				// frames between turns
+		ship->dx = (Bench_Random () & 1) ? 1 : -1;
+				// turn direction
+	}
+	return TRUE;
+}
+
+static void
+Bench_MeleeFrame (BENCH_SCENE *scene, int frame)
+{
+	const int cx = benchWidth / 2;
+	const int cy = benchHeight / 2;
+	int phase = frame % 240;
+	int scale;
+	int i;
+
+	// Zoom between 1/2 and 1x, as the melee camera does when ships
+	// move apart and together
+	if (phase > 120)
+		phase = 240 - phase;
+	scale = GSCALE_IDENTITY / 2 + phase * (GSCALE_IDENTITY / 2) / 120;
+
+	for (i = 0; i < scene->count; ++i)
+	{
+		BENCH_OBJECT *ship = &scene->objects[i];
+
+		if (frame % ship->period == 0)
+		{
+			ship->facing = (ship->facing + ship->dx)
+					& (BENCH_NUM_FACINGS - 1);
+		}
+		ship->x += benchDirX[ship->facing] * 2;
+		ship->y += benchDirY[ship->facing] * 2;
+		if (ship->x < 0)
+			ship->x += benchWidth << 8;
+		else if (ship->x >= benchWidth << 8)
+			ship->x -= benchWidth << 8;
+		if (ship->y < 0)
+			ship->y += benchHeight << 8;
+		else if (ship->y >= benchHeight << 8)
+			ship->y -= benchHeight << 8;
+	}
+
+	SetContextBackGroundColor (BUILD_COLOR_RGBA (0, 0, 0, 0xff));
+	ClearDrawable ();
+	Bench_DrawStars (scene, MAKE_POINT (0, 0));
+
+	SetGraphicScale (scale);
+	for (i = 0; i < scene->count; ++i)
+	{
+		BENCH_OBJECT *ship = &scene->objects[i];
+		STAMP s;
+
+		s.origin.x = cx + ((ship->x >> 8) - cx) * scale / GSCALE_IDENTITY;
+		s.origin.y = cy + ((ship->y >> 8) - cy) * scale / GSCALE_IDENTITY;
+		s.frame = scene->facings[ship->facing];
+		DrawStamp (&s);
+	}
+	SetGraphicScale (GSCALE_IDENTITY);
+
+	SetContextForeGroundColor (BUILD_COLOR_RGBA (0xff, 0x40, 0x40, 0xff));
+	for (i = 0; i + 1 < scene->count; i += 4)
+	{
+		LINE l;
+
+		l.first.x = cx + ((scene->objects[i].x >> 8) - cx)
+				* scale / GSCALE_IDENTITY;
+		l.first.y = cy + ((scene->objects[i].y >> 8) - cy)
+				* scale / GSCALE_IDENTITY;
+		l.second.x = cx + ((scene->objects[i + 1].x >> 8) - cx)
+				* scale / GSCALE_IDENTITY;
+		l.second.y = cy + ((scene->objects[i + 1].y >> 8) - cy)
+				* scale / GSCALE_IDENTITY;
+		DrawLine (&l, 1);
+	}
+}
+
+/*
+ * hyperspace -- three layers of parallax stars streaming past the
+ * flagship inside the space window, next to a static status panel.
+ */
+
+static BOOLEAN
+Bench_HyperInit (BENCH_SCENE *scene)
+{
+	RECT area;
+
+	if (!Bench_CreateShip (scene))
+		return FALSE;
+
+	scene->view.corner = MAKE_POINT (8, 8);
+	scene->view.extent.width = benchWidth * 3 / 4 - 16;
+	scene->view.extent.height = benchHeight - 16;
+
+	area.corner = MAKE_POINT (0, 0);
+	area.extent = scene->view.extent;
+	Bench_InitStars (scene, &area);
+	return TRUE;
+}
+
+static void
+Bench_HyperFrame (BENCH_SCENE *scene, int frame)
+{
+	const int w = scene->view.extent.width << 8;
+	const int h = scene->view.extent.height << 8;
+	int heading = (frame / 30) & (BENCH_NUM_FACINGS - 1);
+	STAMP s;
+	int i;
+
+	for (i = 0; i < BENCH_NUM_STARS; ++i)
+	{
+		BENCH_OBJECT *star = &scene->stars[i];
+		int speed = star->period + 1;
+
+		star->x -= benchDirX[heading] * speed;
+		star->y -= benchDirY[heading] * speed;
+		if (star->x < 0)
+			star->x += w;
+		else if (star->x >= w)
+			star->x -= w;
+		if (star->y < 0)
+			star->y += h;
+		else if (star->y >= h)
+			star->y -= h;
+	}
+
+	if (frame == 0)
+	{
+		RECT panel;
+
+		SetContextBackGroundColor (BUILD_COLOR_RGBA (0, 0, 0, 0xff));
+		ClearDrawable ();
+		panel.corner.x = benchWidth * 3 / 4;
+		panel.corner.y = 0;
+		panel.extent.width = benchWidth - panel.corner.x;
+		panel.extent.height = benchHeight;
+		SetContextForeGroundColor (BUILD_COLOR_RGBA (0x40, 0x40, 0x60,
+				0xff));
+		DrawFilledRectangle (&panel);
+	}
+
+	SetContextClipRect (&scene->view);
+	SetContextBackGroundColor (BUILD_COLOR_RGBA (0x10, 0x00, 0x20, 0xff));
+	ClearDrawable ();
+	Bench_DrawStars (scene, MAKE_POINT (0, 0));
+	s.origin.x = scene->view.extent.width / 2;
+	s.origin.y = scene->view.extent.height / 2;
+	s.frame = scene->facings[heading];
+	DrawStamp (&s);
+	SetContextClipRect (NULL);
+}
+
+/*
+ * orbit -- a textured, lit planet sphere turning in place.  The sphere
+ * is re-rendered on the CPU and written into its frame every frame,
+ * like the orbit view does, and only that square is drawn.
+ */
+
+static BOOLEAN
+Bench_OrbitInit (BENCH_SCENE *scene)
+{
+	SIZE radius = benchHeight / 3;
+	SIZE dim = radius * 2;
+	RECT all;
+	int x, y;
+
+	scene->dim = dim;
+	scene->pixmap = CaptureDrawable (CreateDrawable (
+			WANT_PIXMAP | WANT_ALPHA, dim, dim, 1));
+	scene->pixels = HMalloc (sizeof (Color) * dim * dim);
+	scene->texMap = HMalloc (sizeof (int) * dim * dim);
+	scene->shade = HMalloc (dim * dim);
+	scene->texture = HMalloc (sizeof (Color) * BENCH_TEX_LON
+			* BENCH_TEX_LAT);
+	if (!scene->pixmap || !scene->pixels || !scene->texMap
+			|| !scene->shade || !scene->texture)
+		return FALSE;
+
+	for (y = 0; y < BENCH_TEX_LAT; ++y)
+	{
+		for (x = 0; x < BENCH_TEX_LON; ++x)
+		{
+			double lon = x * 2 * M_PI / BENCH_TEX_LON;
+			double lat = y * M_PI / BENCH_TEX_LAT;
+			int v = (int)(128 + 60 * sin (lon * 3 + sin (lat * 5) * 2)
+					+ 40 * sin (lat * 11));
+
+			scene->texture[y * BENCH_TEX_LON + x] = BUILD_COLOR_RGBA (
+					(BYTE)v, (BYTE)(v * 3 / 4), (BYTE)(255 - v), 0xff);
+		}
+	}
+
+	// Per-pixel sphere geometry does not change as the planet turns
+	for (y = 0; y < dim; ++y)
+	{
+		for (x = 0; x < dim; ++x)
+		{
+			double nx = (x + 0.5 - radius) / radius;
+			double ny = (y + 0.5 - radius) / radius;
+			double nz2 = 1.0 - nx * nx - ny * ny;
+			int i = y * dim + x;
+			double nz, light;
+			int lon, lat;
+
+			if (nz2 <= 0)
+			{
+				scene->texMap[i] = -1;
+				continue;
+			}
+			nz = sqrt (nz2);
+			lon = (int)((atan2 (nx, nz) + M_PI) * BENCH_TEX_LON
+					/ (2 * M_PI)) & (BENCH_TEX_LON - 1);
+			lat = (int)(acos (ny) * (BENCH_TEX_LAT - 1) / M_PI);
+			scene->texMap[i] = lat * BENCH_TEX_LON + lon;
+			light = 0.2 + 0.8 * (nz * 0.7 - nx * 0.5 - ny * 0.5);
+			if (light < 0.2)
+				light = 0.2;
+			else if (light > 1.0)
+				light = 1.0;
+			scene->shade[i] = (BYTE)(light * 255);
+		}
+	}
+
+	all.corner = MAKE_POINT (0, 0);
+	all.extent.width = benchWidth;
+	all.extent.height = benchHeight;
+	Bench_InitStars (scene, &all);
+	return TRUE;
+}
+
+static void
+Bench_OrbitFrame (BENCH_SCENE *scene, int frame)
+{
+	const SIZE dim = scene->dim;
+	const int rot = (frame * 2) & (BENCH_TEX_LON - 1);
+	const Color clear = BUILD_COLOR_RGBA (0, 0, 0, 0);
+	STAMP s;
+	int i;
+
+	for (i = 0; i < dim * dim; ++i)
+	{
+		int t = scene->texMap[i];
+
+		if (t < 0)
+		{
+			scene->pixels[i] = clear;
+			continue;
+		}
+		t = (t & ~(BENCH_TEX_LON - 1)) | ((t + rot) & (BENCH_TEX_LON - 1));
+		scene->pixels[i] = Bench_Shade (scene->texture[t], scene->shade[i]);
+	}
+	WriteFramePixelColors (scene->pixmap, scene->pixels, dim, dim);
+
+	if (frame == 0)
+	{
+		SetContextBackGroundColor (BUILD_COLOR_RGBA (0, 0, 0, 0xff));
+		ClearDrawable ();
+		Bench_DrawStars (scene, MAKE_POINT (0, 0));
+	}
+
+	s.origin.x = (benchWidth - dim) / 2;
+	s.origin.y = (benchHeight - dim) / 2;
+	s.frame = scene->pixmap;
+	DrawStamp (&s);
+}
+
+/*
+ * comm -- a static alien backdrop with small ambient animations on
+ * their own timers, the oscilloscope redrawn every frame, and a
+ * subtitle block replaced every couple of seconds.
+ */
+
+static BOOLEAN
+Bench_CommInit (BENCH_SCENE *scene)
+{
+	SIZE w = benchWidth;
+	SIZE h = benchHeight * 3 / 4;
+	int x, y;
+	int i;
+
+	scene->pixmap = CaptureDrawable (CreateDrawable (WANT_PIXMAP, w, h, 1));
+	scene->pixels = HMalloc (sizeof (Color) * w * h);
+	if (!scene->pixmap || !scene->pixels)
+		return FALSE;
+
+	for (y = 0; y < h; ++y)
+	{
+		for (x = 0; x < w; ++x)
+		{
+			scene->pixels[y * w + x] = BUILD_COLOR_RGBA (
+					(BYTE)(x * 255 / w), (BYTE)(y * 160 / h),
+					(BYTE)(((x ^ y) & 0x1f) + 0x60), 0xff);
+		}
+	}
+	WriteFramePixelColors (scene->pixmap, scene->pixels, w, h);
+
+	for (i = 0; i < 8; ++i)
+	{
+		BENCH_OBJECT *anim = &scene->objects[i];
+
+		anim->dx = w / 16 + Bench_Random () % (w / 8);
+		anim->dy = h / 16 + Bench_Random () % (h / 8);
+		anim->x = Bench_Random () % (w - anim->dx);
+		anim->y = Bench_Random () % (h - anim->dy);
+		anim->period = 2 + Bench_Random () % 8;
+	}
+	scene->count = 8;
+
+	// Oscilloscope window
+	scene->view.extent.width = benchWidth / 4;
+	scene->view.extent.height = benchHeight / 10;
+	scene->view.corner.x = benchWidth - scene->view.extent.width - 4;
+	scene->view.corner.y = h + 4;
+	return TRUE;
+}
+
+static void
+Bench_CommFrame (BENCH_SCENE *scene, int frame)
+{
+	const int steps = 32;
+	RECT r;
+	int i;
+
+	if (frame == 0)
+	{
+		STAMP s;
+
+		SetContextBackGroundColor (BUILD_COLOR_RGBA (0, 0, 0, 0xff));
+		ClearDrawable ();
+		s.origin = MAKE_POINT (0, 0);
+		s.frame = scene->pixmap;
+		DrawStamp (&s);
+	}
+
+	for (i = 0; i < scene->count; ++i)
+	{
+		BENCH_OBJECT *anim = &scene->objects[i];
+
+		if (frame % anim->period)
+			continue;
+		r.corner.x = anim->x;
+		r.corner.y = anim->y;
+		r.extent.width = anim->dx;
+		r.extent.height = anim->dy;
+		SetContextForeGroundColor (BUILD_COLOR_RGBA (
+				(BYTE)(Bench_Random () & 0xff), (BYTE)(frame * 8 & 0xff),
+				(BYTE)(i * 32), 0xff));
+		DrawFilledRectangle (&r);
+	}
+
+	SetContextForeGroundColor (BUILD_COLOR_RGBA (0, 0, 0, 0xff));
+	DrawFilledRectangle (&scene->view);
+	SetContextForeGroundColor (BUILD_COLOR_RGBA (0x00, 0xff, 0x00, 0xff));
+	for (i = 0; i < steps; ++i)
+	{
+		const int mid = scene->view.corner.y + scene->view.extent.height / 2;
+		const int amp = scene->view.extent.height / 2 - 1;
+		LINE l;
+
+		l.first.x = scene->view.corner.x
+				+ i * scene->view.extent.width / steps;
+		l.second.x = scene->view.corner.x
+				+ (i + 1) * scene->view.extent.width / steps;
+		l.first.y = mid + (int)(amp * sin ((frame + i) * 0.4)
+				* sin (frame * 0.05));
+		l.second.y = mid + (int)(amp * sin ((frame + i + 1) * 0.4)
+				* sin (frame * 0.05));
+		DrawLine (&l, 1);
+	}
+
+	// A new subtitle page every 60 frames; each glyph is a small box
+	if (frame % 60 == 0)
+	{
+		const SIZE glyph = benchHeight / 40 + 1;
+		int line;
+
+		r.corner.x = 0;
+		r.corner.y = benchHeight * 3 / 4;
+		r.extent.width = scene->view.corner.x - 4;
+		r.extent.height = benchHeight - r.corner.y;
+		SetContextForeGroundColor (BUILD_COLOR_RGBA (0, 0, 0, 0xff));
+		DrawFilledRectangle (&r);
+
+		SetContextForeGroundColor (BUILD_COLOR_RGBA (0xc0, 0xc0, 0xff,
+				0xff));
+		for (line = 0; line < 3; ++line)
+		{
+			int x = 4;
+
+			r.corner.y = benchHeight * 3 / 4 + 4 + line * glyph * 2;
+			r.extent.height = glyph;
+			while (x + glyph < scene->view.corner.x - 8)
+			{
+				r.corner.x = x;
+				r.extent.width = glyph / 2 + Bench_Random () % glyph;
+				DrawFilledRectangle (&r);
+				x += r.extent.width + 1 + (Bench_Random () % 6 == 0
+						? glyph : 0);
+			}
+		}
+	}
+}
+
+static const BENCH_SCENE_DESC benchSceneDescs[] =
+{
+	{"melee",      Bench_MeleeInit, Bench_MeleeFrame, Bench_Uninit},
+	{"hyperspace", Bench_HyperInit, Bench_HyperFrame, Bench_Uninit},
+	{"orbit",      Bench_OrbitInit, Bench_OrbitFrame, Bench_Uninit},
+	{"comm",       Bench_CommInit,  Bench_CommFrame,  Bench_Uninit},
+	{NULL,         NULL,            NULL,             NULL},
+};
+
+// Producer: stands in for Starcon2Main
+static int
+Benchmark_Thread (void *data)
+{
+	CONTEXT context;
+	FRAME screen;
+	int s, f;
+
+	context = CreateContext ("BenchmarkContext");
+	SetContext (context);
+	screen = CaptureDrawable (CreateDisplay (WANT_MASK | WANT_PIXMAP,
+			&benchWidth, &benchHeight));
+	SetContextFGFrame (screen);
+	SetContextOrigin (MAKE_POINT (0, 0));
+	SetGraphicScaleMode (TFB_SCALE_BILINEAR);
+
+	for (f = 0; f < BENCH_NUM_FACINGS; ++f)
+	{
+		double angle = f * 2 * M_PI / BENCH_NUM_FACINGS;
+		benchDirX[f] = (int)(sin (angle) * 256);
+		benchDirY[f] = (int)(-cos (angle) * 256);
+	}
+
+	for (s = 0; s < benchNumScenes; ++s)
+	{
+		BENCH_SCENE *scene = &benchScenes[s];
+
+		benchSeed = 0x2f6e2b1;
+		scene->ready = scene->desc->init (scene);
+		if (!scene->ready)
+			log_add (log_Error, "Benchmark: could not set up scene '%s'",
+					scene->name);
+
+		for (f = -BENCH_WARMUP_FRAMES; f < benchFrames; ++f)
+		{
+			QWORD start;
+
+			SetSemaphore (benchGo);
+			start = GetPerfCounter ();
+			if (scene->ready)
+			{
+				BatchGraphics ();
+				scene->desc->frame (scene, f + BENCH_WARMUP_FRAMES);
+				UnbatchGraphics ();
+			}
+			benchLogicTime = GetPerfCounter () - start;
+			ClearSemaphore (benchDone);
+		}
+
+		scene->desc->uninit (scene);
+	}
+
+	SetContext (NULL);
+	DestroyDrawable (ReleaseDrawable (screen));
+	DestroyContext (context);
+	ClearSemaphore (benchDone);
+	(void) data;
+	return 0;
+}
+
+static BOOLEAN
+Bench_ParseScenes (const char *list)
+{
+	const char *p = list;
+
+	benchNumScenes = 0;
+	while (*p)
+	{
+		const char *end = strchr (p, ',');
+		size_t len = end ? (size_t)(end - p) : strlen (p);
+		const char *colon = memchr (p, ':', len);
+		size_t nameLen = colon ? (size_t)(colon - p) : len;
+		const BENCH_SCENE_DESC *desc;
+		BENCH_SCENE *scene;
+
+		for (desc = benchSceneDescs; desc->name; ++desc)
+		{
+			if (strlen (desc->name) == nameLen
+					&& !strncmp (desc->name, p, nameLen))
+				break;
+		}
+		if (!desc->name || len >= sizeof scene->name)
+		{
+			log_add (log_Error, "Benchmark: unknown scene '%.*s'",
+					(int)len, p);
+			return FALSE;
+		}
+		if (benchNumScenes == BENCH_MAX_SCENES)
+		{
+			log_add (log_Error, "Benchmark: more than %d scenes",
+					BENCH_MAX_SCENES);
+			return FALSE;
+		}
+
+		scene = &benchScenes[benchNumScenes++];
+		scene->desc = desc;
+		memcpy (scene->name, p, len);
+		scene->name[len] = '\0';
+		scene->count = BENCH_DEFAULT_SHIPS;
+		if (colon)
+		{
+			scene->count = atoi (colon + 1);
+			if (desc->init != Bench_MeleeInit || scene->count < 1
+					|| scene->count > BENCH_MAX_OBJECTS)
+			{
+				log_add (log_Error, "Benchmark: bad parameter for scene "
+						"'%s' (melee takes 1 to %d ships)", scene->name,
+						BENCH_MAX_OBJECTS);
+				return FALSE;
+			}
+		}
+
+		p += len;
+		if (*p == ',')
+			++p;
+	}
+	return benchNumScenes > 0;
+}
+
+static int
+Bench_CompareTicks (const void *a, const void *b)
+{
+	QWORD x = *(const QWORD *)a;
+	QWORD y = *(const QWORD *)b;
+	return (x > y) - (x < y);
+}
+
+static double
+Bench_Millis (QWORD ticks)
+{
+	return (double)ticks * 1000.0 / (double)GetPerfFrequency ();
+}
+
+// Nearest-rank percentile of a sorted sample
+static QWORD
+Bench_Percentile (const QWORD *sorted, int count, int pct)
+{
+	int rank = (count * pct + 99) / 100;
+	if (rank < 1)
+		rank = 1;
+	return sorted[rank - 1];
+}
+
+static void
+Bench_WriteScene (FILE *out, BENCH_SCENE *scene, QWORD *sorted)
+{
+	int stage, f;
+
+	fprintf (out, "    {\n      \"name\": \"%s\",\n", scene->name);
+	fprintf (out, "      \"ok\": %s,\n", scene->ready ? "true" : "false");
+	fprintf (out, "      \"summary\": {\n");
+	for (stage = 0; stage < BENCH_NUM_STAGES; ++stage)
+	{
+		QWORD sum = 0;
+
+		for (f = 0; f < benchFrames; ++f)
+		{
+			sorted[f] = scene->samples[f * BENCH_NUM_STAGES + stage];
+			sum += sorted[f];
+		}
+		qsort (sorted, benchFrames, sizeof (QWORD), Bench_CompareTicks);
+
+		fprintf (out, "        \"%s\": {\"mean\": %.4f, \"p50\": %.4f, "
+				"\"p95\": %.4f, \"p99\": %.4f, \"max\": %.4f}%s\n",
+				benchStageNames[stage],
+				Bench_Millis (sum) / benchFrames,
+				Bench_Millis (Bench_Percentile (sorted, benchFrames, 50)),
+				Bench_Millis (Bench_Percentile (sorted, benchFrames, 95)),
+				Bench_Millis (Bench_Percentile (sorted, benchFrames, 99)),
+				Bench_Millis (sorted[benchFrames - 1]),
+				stage + 1 < BENCH_NUM_STAGES ? "," : "");
+	}
+	fprintf (out, "      },\n      \"frames\": [\n");
+	for (f = 0; f < benchFrames; ++f)
+	{
+		const QWORD *sample = &scene->samples[f * BENCH_NUM_STAGES];
+
+		fprintf (out, "        [");
+		for (stage = 0; stage < BENCH_NUM_STAGES; ++stage)
+		{
+			fprintf (out, "%s%.4f", stage ? ", " : "",
+					Bench_Millis (sample[stage]));
+		}
+		fprintf (out, "]%s\n", f + 1 < benchFrames ? "," : "");
+	}
+	fprintf (out, "      ]\n    }");
+}
+
+static BOOLEAN
+Bench_WriteReport (const char *outFile)
+{
+	FILE *out = stdout;
+	QWORD *sorted;
+	int stage, s;
+
+	sorted = HMalloc (sizeof (QWORD) * benchFrames);
+	if (!sorted)
+		return FALSE;
+
+	if (outFile)
+	{
+		out = fopen (outFile, "w");
+		if (!out)
+		{
+			log_add (log_Error, "Benchmark: could not open '%s' for "
+					"writing: %s", outFile, strerror (errno));
+			HFree (sorted);
+			return FALSE;
+		}
+	}
+
+	fprintf (out, "{\n  \"version\": \"%d.%d.%d %s\",\n", UQM_MAJOR_VERSION,
+			UQM_MINOR_VERSION, UQM_PATCH_VERSION, UQM_EXTRA_VERSION);
+	fprintf (out, "  \"canvas\": [%d, %d],\n", benchWidth, benchHeight);
+	fprintf (out, "  \"frames\": %d,\n  \"warmup\": %d,\n", benchFrames,
+			BENCH_WARMUP_FRAMES);
+	fprintf (out, "  \"units\": \"ms\",\n  \"stages\": [");
+	for (stage = 0; stage < BENCH_NUM_STAGES; ++stage)
+	{
+		fprintf (out, "%s\"%s\"", stage ? ", " : "",
+				benchStageNames[stage]);
+	}
+	fprintf (out, "],\n  \"scenes\": [\n");
+	for (s = 0; s < benchNumScenes; ++s)
+	{
+		Bench_WriteScene (out, &benchScenes[s], sorted);
+		fprintf (out, "%s\n", s + 1 < benchNumScenes ? "," : "");
+	}
+	fprintf (out, "  ]\n}\n");
+
+	if (out != stdout)
+		fclose (out);
+	else
+		fflush (out);
+	HFree (sorted);
+	return TRUE;
+}
+
+int
+Benchmark_Run (const char *scenes, int frames, const char *outFile)
+{
+	BOOLEAN ok;
+	int s, f;
+
+	if (frames < 1 || frames > BENCH_MAX_FRAMES)
+	{
+		log_add (log_Error, "Benchmark: frame count must be between 1 "
+				"and %d", BENCH_MAX_FRAMES);
+		return EXIT_FAILURE;
+	}
+	benchFrames = frames;
+
+	benchScenes = HCalloc (sizeof (BENCH_SCENE) * BENCH_MAX_SCENES);
+	if (!benchScenes)
+		return EXIT_FAILURE;
+	if (!Bench_ParseScenes (scenes ? scenes : BENCHMARK_DEFAULT_SCENES))
+	{
+		HFree (benchScenes);
+		return EXIT_FAILURE;
+	}
+	for (s = 0; s < benchNumScenes; ++s)
+	{
+		benchScenes[s].samples = HCalloc (sizeof (QWORD)
+				* BENCH_NUM_STAGES * benchFrames);
+	}
+
+	benchGo = CreateSemaphore (0, "Benchmark go", SYNC_CLASS_VIDEO);
+	benchDone = CreateSemaphore (0, "Benchmark done", SYNC_CLASS_VIDEO);
+	StartThread (Benchmark_Thread, NULL, 1024, "Benchmark");
+	ProcessThreadLifecycles ();
+
+	log_add (log_User, "Benchmark: %d scene(s), %d frames each",
+			benchNumScenes, benchFrames);
+	for (s = 0; s < benchNumScenes; ++s)
+	{
+		BENCH_SCENE *scene = &benchScenes[s];
+
+		for (f = -BENCH_WARMUP_FRAMES; f < benchFrames; ++f)
+		{
+			QWORD *sample;
+			TFB_FrameTimes *t = &TFB_FrameStageTimes;
+
+			// One producer frame, then one flush: the producer is idle
+			// while we render, so the timings do not overlap.
+			ClearSemaphore (benchGo);
+			SetSemaphore (benchDone);
+			TFB_ProcessEvents ();
+			TFB_FlushGraphics ();
+
+			if (f < 0 || !scene->samples)
+				continue;
+			sample = &scene->samples[f * BENCH_NUM_STAGES];
+			sample[BENCH_LOGIC] = benchLogicTime;
+			sample[BENCH_DCQ] = t->flush - t->swap;
+			sample[BENCH_SCALE] = t->scale;
+			sample[BENCH_UPLOAD] = t->upload;
+			sample[BENCH_PRESENT] = t->swap - t->scale - t->upload;
+			sample[BENCH_TOTAL] = benchLogicTime + t->flush;
+		}
+		log_add (log_User, "Benchmark: scene '%s' done", scene->name);
+	}
+
+	// Wait for the producer to let go of its drawables, and render
+	// the resulting deletions
+	SetSemaphore (benchDone);
+	ProcessThreadLifecycles ();
+	TFB_FlushGraphics ();
+	DestroySemaphore (benchGo);
+	DestroySemaphore (benchDone);
+
+	ok = TRUE;
+	for (s = 0; s < benchNumScenes; ++s)
+	{
+		if (!benchScenes[s].samples)
+			ok = FALSE;
+	}
+	if (ok)
+		ok = Bench_WriteReport (outFile);
+	else
+		log_add (log_Error, "Benchmark: out of memory for samples");
+
+	for (s = 0; s < benchNumScenes; ++s)
+		HFree (benchScenes[s].samples);
+	HFree (benchScenes);
+	benchScenes = NULL;
+
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,42 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef UQM_BENCHMARK_H_
+#define UQM_BENCHMARK_H_
+
+#include "libs/compiler.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+// Scene list used when --benchmark is given without one
+#define BENCHMARK_DEFAULT_SCENES "melee:16,hyperspace,orbit,comm"
+#define BENCHMARK_DEFAULT_FRAMES 600
+
+// Replays the synthetic scenes named in 'scenes' (comma separated,
+// "melee:N" takes a ship count) through the graphics stack and writes
+// the per-frame stage timings as JSON to 'outFile' (stdout if NULL).
+// Must be called from main(), in place of the Starcon2Main loop.
+// Returns EXIT_SUCCESS or EXIT_FAILURE.
+extern int Benchmark_Run (const char *scenes, int frames,
+		const char *outFile);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif  /* UQM_BENCHMARK_H_ */
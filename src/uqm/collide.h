@@ -40,6 +40,7 @@ extern "C" {
 
 #define InitIntersectStartPoint(eptr) \
 { \
+	CollisionGridStale = TRUE; \
 	(eptr)->IntersectControl.IntersectStamp.origin.x = \
 			WORLD_TO_DISPLAY ((eptr)->current.location.x); \
 	(eptr)->IntersectControl.IntersectStamp.origin.y = \
@@ -48,6 +49,7 @@ extern "C" {
 
 #define InitIntersectEndPoint(eptr) \
 { \
+	CollisionGridStale = TRUE; \
 	(eptr)->IntersectControl.EndPoint.x = \
 			WORLD_TO_DISPLAY ((eptr)->next.location.x); \
 	(eptr)->IntersectControl.EndPoint.y = \
@@ -56,6 +58,7 @@ extern "C" {
 
 #define InitIntersectFrame(eptr) \
 { \
+	CollisionGridStale = TRUE; \
 	(eptr)->IntersectControl.IntersectStamp.frame = \
 			 SetEquFrameIndex ((eptr)->next.image.farray[0], \
 			 (eptr)->next.image.frame); \
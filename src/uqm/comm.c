@@ -1740,6 +1740,23 @@ SetUpCommData (void)
 			LoadStringTable (CommData.ConversationPhrasesRes));
 }
 
+// The resources that SetUpCommData() will load
+static COUNT
+GetCommResources (RESOURCE *res)
+{
+	COUNT count = 0;
+
+	res[count++] = (altResFlags & USE_ALT_FRAME) ?
+			CommData.AltRes.AlienFrameRes : CommData.AlienFrameRes;
+	res[count++] = CommData.AlienFontRes;
+	res[count++] = (altResFlags & USE_ALT_COLORMAP) ?
+			CommData.AltRes.AlienColorMapRes : CommData.AlienColorMapRes;
+	res[count++] = (altResFlags & USE_ALT_SONG) ?
+			CommData.AltRes.AlienSongRes : CommData.AlienSongRes;
+	res[count++] = CommData.ConversationPhrasesRes;
+	return count;
+}
+
 static void
 HailAlien (void)
 {
@@ -1922,6 +1939,8 @@ InitCommunication (CONVERSATION which_comm)
 {
 	COUNT status;
 	LOCDATA *LocDataPtr;
+	RESOURCE commRes[5];
+	COUNT commResCount = 0;
 
 #ifdef DEBUG
 	if (disableInteractivity)
@@ -2010,6 +2029,11 @@ InitCommunication (CONVERSATION which_comm)
 	if (LocDataPtr)
 	{	// We make a copy here
 		CommData = *LocDataPtr;
+
+		// Load the alien's resources while InitEncounter() waits for
+		// the player to choose between talking and fighting.
+		commResCount = GetCommResources (commRes);
+		res_PrefetchGroup (commRes, commResCount, RES_PREFETCH_HIGH);
 	}
 
 	if (GET_GAME_STATE (BATTLE_SEGUE) == 0)
@@ -2040,6 +2064,8 @@ InitCommunication (CONVERSATION which_comm)
 
 		(*CommData.uninit_encounter_func) (); // cleanup
 	}
+	// Drop whatever was not used, e.g. when the player chose to attack
+	res_CancelPrefetchGroup (commRes, commResCount);
 
 	status = 0;
 	if (!(GLOBAL (CurrentActivity) & (CHECK_ABORT | CHECK_LOAD)))
@@ -176,6 +176,9 @@ elementsOfSamePlayer (ELEMENT *ElementPtr0, ELEMENT *ElementPtr1)
 }
 
 extern QUEUE disp_q;
+// Set whenever the display list or an element's IntersectControl
+// changes; tells the collision broad phase to rebuild its grid.
+extern BOOLEAN CollisionGridStale;
 // The maximum number of elements is chosen to provide a slight margin.
 // Currently, it is maximum *known used* in Melee + 30
 #define MAX_DISPLAY_ELEMENTS 150
@@ -206,8 +209,10 @@ extern PRIMITIVE DisplayArray[MAX_DISPLAY_PRIMS];
 
 extern HELEMENT AllocElement (void);
 extern void FreeElement (HELEMENT hElement);
-#define PutElement(h) PutQueue (&disp_q, h)
-#define InsertElement(h,i) InsertQueue (&disp_q, h, i)
+#define PutElement(h) \
+		do { CollisionGridStale = TRUE; PutQueue (&disp_q, h); } while (0)
+#define InsertElement(h,i) \
+		do { CollisionGridStale = TRUE; InsertQueue (&disp_q, h, i); } while (0)
 #define GetHeadElement() GetHeadLink (&disp_q)
 #define GetTailElement() GetTailLink (&disp_q)
 #define LockElement(h,ppe) (*(ppe) = (ELEMENT*)LockLink (&disp_q, h))
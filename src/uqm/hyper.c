@@ -45,6 +45,7 @@
 #include "libs/mathlib.h"
 #include "libs/log.h"
 #include "util.h"
+#include "planets/solarsys.h"
 
 #define XOFFS ((RADAR_SCAN_WIDTH + (UNIT_SCREEN_WIDTH << 2)) >> 1)
 #define YOFFS ((RADAR_SCAN_HEIGHT + (UNIT_SCREEN_HEIGHT << 2)) >> 1)
@@ -668,6 +669,7 @@ InterplanetaryTransition (ELEMENT *ElementPtr)
 		// Enter a solar system from HyperSpace.
 		GLOBAL (CurrentActivity) |= START_INTERPLANETARY;
 		SET_GAME_STATE (ESCAPE_COUNTER, 0);
+		PrefetchIPData ();
 	}
 	else
 	{
@@ -1465,6 +1467,7 @@ AddEncounterElement (ENCOUNTER *EncounterPtr, POINT *puniverse)
 
 		ElementPtr->IntersectControl.IntersectStamp.frame =
 				DecFrameIndex (stars_in_space);
+		CollisionGridStale = TRUE;
 		SetPrimType (&DisplayArray[ElementPtr->PrimIndex], NO_PRIM);
 		ElementPtr->state_flags |= NONSOLID | IGNORE_VELOCITY;
 
@@ -1948,6 +1951,7 @@ SeedUniverse (void)
 				HyperSpaceElementPtr->
 						IntersectControl.IntersectStamp.frame =
 							DecFrameIndex (stars_in_space);
+				CollisionGridStale = TRUE;
 			}
 
 			UnlockElement (hHyperSpaceElement);
@@ -2055,6 +2059,7 @@ SeedUniverse (void)
 				HyperSpaceElementPtr->
 					IntersectControl.IntersectStamp.frame =
 						DecFrameIndex (stars_in_space);
+				CollisionGridStale = TRUE;
 			}
 			UnlockElement (hHyperSpaceElement);
 
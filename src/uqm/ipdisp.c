@@ -855,6 +855,7 @@ spawn_ip_group (IP_GROUP *GroupPtr)
 		SetUpElement (IPSHIPElementPtr);
 		IPSHIPElementPtr->IntersectControl.IntersectStamp.frame = 
 				DecFrameIndex (stars_in_space);
+		CollisionGridStale = TRUE;
 		
 		UnlockElement (hIPSHIPElement);
 
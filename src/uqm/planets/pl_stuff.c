@@ -42,6 +42,276 @@ static int rotPointIndex;
 static int rotwidth;
 static int rotheight;
 
+static FRAME rotSphereFrames;
+		// the two alternating sphere frames of the orbit
+
+// Rotation frame ring.
+// With --rotationcache, the rotation frames of the 3DO and UQM spheres
+// are rendered ahead of the rotation into a ring of frames, a few at a
+// time while RotatePlanetSphere() waits for its next tick. Rotating the
+// sphere is then just a matter of drawing the next frame of the ring.
+// The ring has as many frames as the budget holds, up to one for every
+// rotation point; when it has fewer, the frames of the points that come
+// up last (the ones just passed) are rendered over with the points
+// coming up next. All frames are refilled when the scan type changes
+// the sphere colors.
+#define ROT_RING_MIN_FRAMES 4
+		// the two frames that may wait to be drawn, and two ahead
+static FRAME rotRing;
+static int rotRingSize;
+		// frames in the ring
+static int *rotRingPoint;
+		// the rotation point of every ring frame, or -1
+static int *rotRingFrame;
+		// the ring frame of every rotation point, or -1
+static COUNT rotRingScanType;
+		// the scan type the ring frames were rendered with
+static int rotRingShown[2];
+		// ring frames that may still be waiting to be drawn; these are
+		// not rendered over, like the alternating frames
+static BOOLEAN rotRingTried;
+
+// Renders the 3DO or UQM sphere for rotation point 'index'
+static void
+renderSphereFrame (PLANET_ORBIT *Orbit, FRAME frame, int index)
+{
+	if (use3DOSpheres)
+	{
+		Render3DOPlanetSphere (Orbit, frame, index, rotwidth, rotheight);
+	}
+	else
+	{
+		RenderPlanetSphere (Orbit, frame, index,
+				pSolarSysState->pOrbitalDesc->data_index
+					& PLANET_SHIELDED,
+				throbShield, rotwidth, rotheight,
+				(rotheight >> 1) - IF_HD (2));
+	}
+}
+
+static void
+clearRotationRing (void)
+{
+	int i;
+
+	for (i = 0; i < rotRingSize; ++i)
+		rotRingPoint[i] = -1;
+	for (i = 0; i < rotwidth; ++i)
+		rotRingFrame[i] = -1;
+}
+
+static BOOLEAN
+createRotationRing (void)
+{
+	SIZE width, height;
+	QWORD frameSize;
+	QWORD budget;
+	int size;
+
+	if (rotRingTried || !optRotationCache || useDosSpheres
+			|| !rotSphereFrames)
+		return FALSE;
+	rotRingTried = TRUE;
+
+	width = GetFrameWidth (rotSphereFrames);
+	height = GetFrameHeight (rotSphereFrames);
+	frameSize = (QWORD)width * height * sizeof (Color);
+	budget = (QWORD)optRotationCache << 20;
+	size = rotwidth;
+	if (budget < frameSize * rotwidth)
+		size = (int)(budget / frameSize);
+	if (size < ROT_RING_MIN_FRAMES)
+	{
+		log_add (log_Debug, "Rotation frames need %lu KB each, too much "
+				"for the rotation cache; rendering them as needed.",
+				(unsigned long)(frameSize >> 10));
+		return FALSE;
+	}
+
+	rotRingPoint = HMalloc (sizeof (int) * (size + rotwidth));
+	rotRing = CaptureDrawable (CreateDrawable (WANT_PIXMAP | WANT_ALPHA,
+			width, height, size));
+	if (!rotRingPoint || !rotRing)
+	{
+		HFree (rotRingPoint);
+		rotRingPoint = NULL;
+		DestroyDrawable (ReleaseDrawable (rotRing));
+		rotRing = 0;
+		return FALSE;
+	}
+	rotRingFrame = rotRingPoint + size;
+	rotRingSize = size;
+	if (size < rotwidth)
+	{
+		log_add (log_Debug, "The rotation cache holds %d of the %d "
+				"rotation frames.", size, rotwidth);
+	}
+
+	clearRotationRing ();
+	rotRingScanType = pSolarSysState->Orbit.scanType;
+	rotRingShown[0] = rotRingShown[1] = -1;
+	return TRUE;
+}
+
+static void
+destroyRotationRing (void)
+{
+	PLANET_ORBIT *Orbit = &pSolarSysState->Orbit;
+
+	if (rotRing)
+	{	// the orbit gets its own frames back
+		Orbit->SphereFrame = SetAbsFrameIndex (rotSphereFrames,
+				rotFrameIndex);
+		DestroyDrawable (ReleaseDrawable (rotRing));
+		rotRing = 0;
+		HFree (rotRingPoint);
+		rotRingPoint = NULL;
+		rotRingFrame = NULL;
+		rotRingSize = 0;
+	}
+	rotRingTried = FALSE;
+}
+
+// Forgets the ring frames once the scan type no longer matches them
+static void
+checkRotationRing (PLANET_ORBIT *Orbit)
+{
+	if (Orbit->scanType == rotRingScanType)
+		return;
+
+	clearRotationRing ();
+	rotRingScanType = Orbit->scanType;
+}
+
+static BOOLEAN
+ringFrameBusy (int frame)
+{
+	return frame == rotRingShown[0] || frame == rotRingShown[1];
+}
+
+// How many rotation steps from now the sphere shows rotation point 'point'
+static int
+rotationStepsTo (int point)
+{
+	int steps = (point - rotPointIndex) * rotDirection;
+
+	if (steps < 0)
+		steps += rotwidth;
+	return steps;
+}
+
+// Picks the ring frame for the rotation point 'steps' ahead: an unused
+// frame, or else the frame of the point that comes up last, if that is
+// further ahead. Returns -1 when all frames hold nearer points.
+static int
+pickRingFrame (int steps)
+{
+	int best = -1;
+	int bestSteps = steps;
+	int i;
+
+	for (i = 0; i < rotRingSize; ++i)
+	{
+		int s;
+
+		if (ringFrameBusy (i))
+			continue;
+		if (rotRingPoint[i] < 0)
+			return i;
+
+		s = rotationStepsTo (rotRingPoint[i]);
+		if (s > bestSteps)
+		{
+			best = i;
+			bestSteps = s;
+		}
+	}
+	return best;
+}
+
+static void
+showRingFrame (PLANET_ORBIT *Orbit, int frame)
+{
+	rotRingShown[1] = rotRingShown[0];
+	rotRingShown[0] = frame;
+	if (frame >= 0)
+		Orbit->SphereFrame = SetAbsFrameIndex (rotRing, frame);
+}
+
+static void
+renderRingFrame (PLANET_ORBIT *Orbit, int point, int frame)
+{
+	if (rotRingPoint[frame] >= 0)
+		rotRingFrame[rotRingPoint[frame]] = -1;
+
+	renderSphereFrame (Orbit, SetAbsFrameIndex (rotRing, frame), point);
+	rotRingPoint[frame] = point;
+	rotRingFrame[point] = frame;
+}
+
+// Renders ring frames ahead of the rotation until 'until', or until the
+// ring holds the next rotation points
+static void
+fillRotationRing (TimeCount until)
+{
+	PLANET_ORBIT *Orbit = &pSolarSysState->Orbit;
+	int point = rotPointIndex;
+	int steps;
+
+	if (!rotRing && !createRotationRing ())
+		return;
+	checkRotationRing (Orbit);
+
+	for (steps = 1; steps < rotwidth && GetTimeCounter () < until; ++steps)
+	{
+		int frame;
+
+		point += rotDirection;
+		if (point < 0)
+			point = rotwidth - 1;
+		else if (point >= rotwidth)
+			point = 0;
+
+		if (rotRingFrame[point] >= 0)
+			continue;
+
+		frame = pickRingFrame (steps);
+		if (frame < 0)
+			break; // the ring is full of nearer points
+		renderRingFrame (Orbit, point, frame);
+	}
+}
+
+// Makes Orbit->SphereFrame show the 3DO or UQM sphere for the current
+// rotation point, from the ring when there is one
+static void
+setSphereFrame (PLANET_ORBIT *Orbit)
+{
+	FRAME frame;
+
+	if (rotRing)
+	{
+		int ringFrame;
+
+		checkRotationRing (Orbit);
+		ringFrame = rotRingFrame[rotPointIndex];
+		if (ringFrame < 0)
+		{
+			ringFrame = pickRingFrame (0);
+			if (ringFrame >= 0)
+				renderRingFrame (Orbit, rotPointIndex, ringFrame);
+		}
+
+		showRingFrame (Orbit, ringFrame);
+		if (ringFrame >= 0)
+			return;
+	}
+
+	frame = SetAbsFrameIndex (rotSphereFrames, rotFrameIndex);
+	renderSphereFrame (Orbit, frame, rotPointIndex);
+	Orbit->SphereFrame = frame;
+}
+
 void
 DrawCurrentPlanetSphere (void)
 {
@@ -69,25 +339,8 @@ DrawCurrentPlanetSphere (void)
 			RenderDOSPlanetSphere (
 					Orbit, Orbit->SphereFrame, rotPointIndex);
 		}
-		else if (use3DOSpheres)
-		{
-			Orbit->SphereFrame = SetAbsFrameIndex (Orbit->SphereFrame,
-					rotFrameIndex);
-
-			Render3DOPlanetSphere (
-					Orbit, Orbit->SphereFrame, rotPointIndex, rotwidth,
-						rotheight);
-		}
 		else
-		{
-			Orbit->SphereFrame = SetAbsFrameIndex (Orbit->SphereFrame,
-					rotFrameIndex);
-			RenderPlanetSphere (Orbit, Orbit->SphereFrame, rotPointIndex,
-					pSolarSysState->pOrbitalDesc->data_index
-						& PLANET_SHIELDED,
-					throbShield, rotwidth, rotheight,
-					(rotheight >> 1) - IF_HD (2));
-		}
+			setSphereFrame (Orbit);
 	}
 	BatchGraphics ();
 	s.frame = Orbit->SphereFrame;
@@ -183,6 +436,9 @@ InitSphereRotation (int direction, BOOLEAN shielded, COUNT width,
 {
 	PLANET_ORBIT *Orbit = &pSolarSysState->Orbit;
 
+	destroyRotationRing ();
+	rotSphereFrames = Orbit->SphereFrame;
+
 	rotwidth = width;
 	rotheight = height;
 
@@ -214,6 +470,9 @@ UninitSphereRotation (void)
 {
 	PLANET_ORBIT *Orbit = &pSolarSysState->Orbit;
 
+	destroyRotationRing ();
+	rotSphereFrames = 0;
+
 	if (Orbit->WorkFrame)
 	{
 		DestroyDrawable (ReleaseDrawable (Orbit->ObjectFrame));
@@ -250,23 +509,8 @@ PrepareNextRotationFrame (void)
 
 		RenderDOSPlanetSphere (Orbit, Orbit->SphereFrame, rotPointIndex);
 	}
-	else if (use3DOSpheres)
-	{
-		Orbit->SphereFrame = SetAbsFrameIndex (Orbit->SphereFrame,
-				rotFrameIndex);
-
-		Render3DOPlanetSphere (Orbit, Orbit->SphereFrame, rotPointIndex,
-				rotwidth, rotheight);
-	}
 	else
-	{
-		Orbit->SphereFrame = SetAbsFrameIndex(Orbit->SphereFrame,
-			rotFrameIndex);
-		RenderPlanetSphere(Orbit, Orbit->SphereFrame, rotPointIndex,
-			pSolarSysState->pOrbitalDesc->data_index & PLANET_SHIELDED,
-			throbShield, rotwidth, rotheight,
-			(rotheight >> 1) - IF_HD(2));
-	}
+		setSphereFrame (Orbit);
 	
 	if (throbShield)
 	{	// prepare the next shield throb frame
@@ -437,7 +681,10 @@ RotatePlanetSphere (BOOLEAN keepRate, STAMP *onTop)
 	TimeCount Now = GetTimeCounter ();
 
 	if (keepRate && Now < NextTime)
-		return; // not time yet
+	{	// not time yet; spend the wait on the frame ring
+		fillRotationRing (NextTime);
+		return;
+	}
 
 	if (DIF_HARD && Now >= TimeOutClock)
 	{
@@ -60,7 +60,7 @@ BOOLEAN use3DOSpheres = FALSE;
 BYTE OrbitNum = 0;
 
 void
-DestroyOrbitStruct (PLANET_ORBIT* Orbit, SIZE height)
+DestroyOrbitStruct (PLANET_ORBIT* Orbit)
 {
 	DestroyDrawable (ReleaseDrawable (Orbit->TopoZoomFrame));
 	Orbit->TopoZoomFrame = 0;
@@ -114,27 +114,12 @@ DestroyOrbitStruct (PLANET_ORBIT* Orbit, SIZE height)
 
 	if (Orbit->light_diff)
 	{
-		COUNT j;
-		for (j = 0; j < height; j++)
-		{
-			HFree (Orbit->light_diff[j]);
-			Orbit->light_diff[j] = NULL;
-		}
 		HFree (Orbit->light_diff);
 		Orbit->light_diff = NULL;
 	}
 
-	if (Orbit->map_rotate)
-	{
-		COUNT k;
-		for (k = 0; k < height; k++)
-		{
-			HFree (Orbit->map_rotate[k]);
-			Orbit->map_rotate[k] = NULL;
-		}
-		HFree (Orbit->map_rotate);
-		Orbit->map_rotate = NULL;
-	}
+	ReleaseSphereTiltMap (Orbit->tiltMap);
+	Orbit->tiltMap = NULL;
 
 	DestroyDrawable (ReleaseDrawable (Orbit->TopoMask));
 	Orbit->TopoMask = 0;
@@ -601,7 +586,7 @@ FreePlanet (void)
 	DestroyColorMap (ReleaseColorMap (pSolarSysState->OrbitalCMap));
 	pSolarSysState->OrbitalCMap = 0;
 
-	DestroyOrbitStruct (Orbit, MAP_HEIGHT);
+	DestroyOrbitStruct (Orbit);
 
 	DestroyStringTable (ReleaseStringTable (
 			pSolarSysState->SysInfo.PlanetInfo.DiscoveryString
@@ -153,11 +153,9 @@ typedef struct portal_location PORTAL_LOCATION;
 #include "sundata.h"
 #include "../gendef.h" //JSD need gendef.h unless we move plots & starmap to starmap
  
-typedef struct
-{
-	POINT p[4];
-	DWORD m[4];
-} MAP3D_POINT;
+typedef struct sphere_tilt_map SPHERE_TILT_MAP;
+		// Maps sphere pixels onto the topo map for one size and tilt;
+		// shared by all planets that have both in common
 
 struct planet_orbit
 {
@@ -187,9 +185,9 @@ struct planet_orbit
 	FRAME BackFrame;
 			// background frame to make shields transparent with nebulae on
 	// BW: extra stuff for animated IP
-	DWORD **light_diff;
-	MAP3D_POINT **map_rotate;
-	// doubly dynamically allocated depending on map size
+	DWORD *light_diff;
+			// diffuse light per sphere pixel, row by row
+	SPHERE_TILT_MAP *tiltMap;
 
 	// stuff to draw DOS spheres
 	FRAME TopoMask;
@@ -402,7 +400,8 @@ POINT locationToDisplay (POINT pt, SIZE scaleRadius);
 POINT displayToLocation (POINT pt, SIZE scaleRadius);
 POINT planetOuterLocation (COUNT planetI);
 
-extern void DestroyOrbitStruct (PLANET_ORBIT *Orbit, SIZE height);
+extern void DestroyOrbitStruct (PLANET_ORBIT *Orbit);
+extern void ReleaseSphereTiltMap (SPHERE_TILT_MAP *map);
 extern void LoadPlanet (FRAME SurfDefFrame);
 extern void DrawPlanet (int dy, Color tintColor);
 extern void DrawPCScanTint (COUNT cur_scan);
@@ -452,12 +451,24 @@ extern void Draw3DOShield (STAMP ShieldFrame);
 extern void ZoomInPlanetSphere (void);
 extern void RotatePlanetSphere (BOOLEAN keepRate, STAMP *onTop);
 
+typedef struct
+{
+	PLANET_DESC *world;
+	COUNT width;
+	COUNT height;
+} PLANET_SURFACE_SPEC;
+		// A world and the surface size GeneratePlanetSurface() will be
+		// asked for
+
 extern void DrawScannedObjects (BOOLEAN Reversed);
 extern void GetPlanetTopography (PLANET_DESC *pPlanetDesc, FRAME SurfDefFrame);
 extern void GeneratePlanetSurface (PLANET_DESC *pPlanetDesc,
 		FRAME SurfDefFrame, COUNT width, COUNT height);
+extern void PrebuildPlanetSurfaces (const PLANET_SURFACE_SPEC *specs,
+		COUNT count);
+extern void FreePrebuiltPlanetSurfaces (void);
 extern void DeltaTopography (COUNT num_iterations, SBYTE *DepthArray,
-		RECT *pRect, SIZE depth_delta);
+		RECT *pRect, SIZE depth_delta, RandomContext *rng);
 
 extern void TransformColor (Color *c, COUNT scan);
 
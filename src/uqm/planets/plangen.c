@@ -23,6 +23,7 @@
 
 #include "planets.h"
 #include "scan.h"
+#include "topocache.h"
 #include "../nameref.h"
 #include "../resinst.h"
 #include "../setup.h"
@@ -32,12 +33,16 @@
 #include "libs/mathlib.h"
 #include "libs/log.h"
 #include "libs/memlib.h"
+#include "libs/threadlib.h"
 #include "../starmap.h"
 #include "../gendef.h"
 #include "../colors.h"
 #include <math.h>
 #include <time.h>
 
+#include SDL_INCLUDE(SDL.h)
+#include "libs/graphics/sdl/blendspan.h"
+
 #undef PROFILE_ROTATION
 
 // define USE_ALPHA_SHIELD to use an aloha overlay instead of
@@ -68,6 +73,11 @@
 
 #define DIFFUSE_BITS 16
 #define AA_WEIGHT_BITS 16
+#define AA_WEIGHT_ONE  (1 << AA_WEIGHT_BITS)
+#define AA_WEIGHT_MAX  (AA_WEIGHT_ONE - 1)
+
+#define SPHERE_BAND_PIXELS 4096
+		// Minimum number of sphere pixels given to one worker thread
 
 #ifndef M_TWOPI
   #ifndef M_PI
@@ -85,19 +95,34 @@
 // biggest resolution, 4x.
 // DWORD light_diff[330][330]; //DWORD light_diff[DIAMETER][DIAMETER];
 
-// BW: Moved to planets.h
-// typedef struct 
-// {
-// 	POINT p[4];
-// 	DWORD m[4];
-// } MAP3D_POINT;
+// Tilt maps used to be a MAP3D_POINT map_rotate[DIAMETER][DIAMETER]
+// with 4 POINTs and 4 DWORD weights per pixel. They only depend on the
+// sphere size and the planet tilt, so they are now kept once per such
+// pair, one array per field, in a single allocation.
+struct sphere_tilt_map
+{
+	COUNT height;
+	COUNT radius;
+	int angle;
+			// what the map was built for
+	COUNT diameter;
+			// the map is diameter x diameter, row by row
+	COUNT refCount;
+	SPHERE_TILT_MAP *next;
+
+	UWORD *x0, *y0;
+			// the integer topo point under each sphere pixel
+	UWORD *x1, *y1;
+			// its neighbours; the 4 samples are (x0,y0), (x1,y0),
+			// (x0,y1) and (x1,y1)
+	UWORD (*m)[4];
+			// weights of the 4 samples, each rounded to 1/65536
+			// as the DWORD weights were, so they sum to about
+			// AA_WEIGHT_ONE; m[0] == 0 means (x0,y0) is the exact pixel
+};
 
-// BW: dynamically allocated in the orbit structure
-// JMS_GFX: Changed initialization to constant numbers since DIAMETER is
-// now variably defined The value 330 is the value that's reached at the
-// biggest resolution, 4x.
-// MAP3D_POINT map_rotate[330][330];
-// //MAP3D_POINT map_rotate[DIAMETER][DIAMETER];
+static SPHERE_TILT_MAP *tiltMaps;
+			// tilt maps currently in use
 
 typedef struct
 {
@@ -672,7 +697,8 @@ GenerateSphereMask (POINT loc, COUNT radius)
 				diff_int = (DWORD)(diff * step);
 			}
 
-			pSolarSysState->Orbit.light_diff[pt.y][pt.x] = diff_int;
+			pSolarSysState->Orbit.light_diff[pt.y * (tworadius + 1) + pt.x]
+					= diff_int;
 		}
 	}
 }
@@ -682,11 +708,13 @@ GenerateSphereMask (POINT loc, COUNT radius)
 //  the concept is to compute the weight based on the
 //  distance from the integer location points to the ideal point
 static void
-create_aa_points (MAP3D_POINT *ppt, double x, double y, COUNT height)
+create_aa_points (SPHERE_TILT_MAP *map, int i, double x, double y,
+		COUNT height)
 {
 	double deltax, deltay, inv_deltax, inv_deltay;
-	COORD nextx, nexty;
-	COUNT i;
+	UWORD x0, y0;
+	int j;
+	DWORD w[4];
 	double d1, d2, d3, d4, m[4];
 	COUNT spherespanx = height;
 
@@ -700,36 +728,25 @@ create_aa_points (MAP3D_POINT *ppt, double x, double y, COUNT height)
 		y = height - 1;
 
 	// get  the integer value of this point
-	ppt->p[0].x = (COORD)x;
-	ppt->p[0].y = (COORD)y;
-	deltax = x - ppt->p[0].x;
-	deltay = y - ppt->p[0].y;
+	x0 = (UWORD)x;
+	y0 = (UWORD)y;
+	deltax = x - x0;
+	deltay = y - y0;
+	map->x0[i] = map->x1[i] = x0;
+	map->y0[i] = map->y1[i] = y0;
 	
 	// if this point doesn't need modificaton, set m[0]=0
 	if (deltax == 0 && deltay == 0)
 	{
-		ppt->m[0] = 0;
+		map->m[i][0] = 0;
 		return;
 	}
 
 	// get the neighboring points surrounding the 'ideal' point
 	if (deltax != 0)
-		nextx = ppt->p[0].x + 1;
-	else
-		nextx = ppt->p[0].x;
+		map->x1[i] = x0 + 1;
 	if (deltay != 0)
-		nexty = ppt->p[0].y + 1;
-	else 
-		nexty = ppt->p[0].y;
-	//(x1,y)
-	ppt->p[1].x = nextx;
-	ppt->p[1].y = ppt->p[0].y;
-	//(x,y1)
-	ppt->p[2].x = ppt->p[0].x;
-	ppt->p[2].y = nexty;
-	//(x1y1)
-	ppt->p[3].x = nextx;
-	ppt->p[3].y = nexty;
+		map->y1[i] = y0 + 1;
 	//the square  1x1, so opposite poinnts are at 1-delta
 	inv_deltax = 1.0 - fabs (deltax);
 	inv_deltax *= inv_deltax;
@@ -742,61 +759,69 @@ create_aa_points (MAP3D_POINT *ppt, double x, double y, COUNT height)
 	d2 = sqrt (inv_deltax + deltay);
 	d3 = sqrt (deltax + inv_deltay);
 	d4 = sqrt (inv_deltax + inv_deltay);
-	//compute the weights.  the sum(ppt->m[])=65536
+	//compute the weights.  the sum(m[])=1
 	m[0] = 1 / (1 + d1 * (1 / d2 + 1 / d3 + 1 / d4));
 	m[1] = m[0] * d1 / d2;
 	m[2] = m[0] * d1 / d3;
 	m[3] = m[0] * d1 / d4;
 
-	for (i = 0; i < 4; i++)
-		ppt->m[i] = (DWORD)(m[i] * (1 << AA_WEIGHT_BITS) + 0.5);
-}
-
-static inline BYTE
-get_color_channel (Color c, int channel)
-{
-	switch (channel)
+	for (j = 0; j < 4; j++)
+		w[j] = (DWORD)(m[j] * AA_WEIGHT_ONE + 0.5);
+
+	// Only m[0] can round up to a full AA_WEIGHT_ONE and leave the point
+	// fractional: next to any other sample, the remaining two weigh at
+	// least 0.7 m[0] each, which rounds m[0] to 0. A full m[0] leaves a
+	// rounding 1 on the others at most, so every channel comes out as
+	// the (x0,y0) one; all 4 samples then go to (x0,y0), keeping the
+	// weight sum that the light variance uses.
+	if (w[0] > AA_WEIGHT_MAX)
 	{
-		case 0:
-			return c.r;
-		case 1:
-			return c.g;
-		case 2:
-			return c.b;
-		default:
-			return 0;
+		map->x1[i] = x0;
+		map->y1[i] = y0;
+		w[1] += w[0] + w[2] + w[3] - AA_WEIGHT_MAX;
+		w[0] = AA_WEIGHT_MAX;
+		w[2] = w[3] = 0;
 	}
+
+	for (j = 0; j < 4; j++)
+		map->m[i][j] = (UWORD)w[j];
 }
 
-// Creates either a red, green, or blue value by
-// computing the weighted averages of the 4 points in p
-static BYTE
-get_avg_channel (Color p[4], DWORD mult[4], int channel)
+// Creates the red, green and blue values by computing the weighted
+// averages of the 4 points in p. The channels are independent and all
+// use the same weights, so the compiler can do them side by side.
+static inline void
+get_avg_color (Color *c, const Color p[4], const UWORD mult[4])
 {
 	COUNT j;
-	DWORD ci = 0;
-	
-	//sum(mult[])==65536
-	//c is the red/green/blue value of this pixel
+	DWORD r = 0, g = 0, b = 0;
+
+	//sum(mult[])~=AA_WEIGHT_ONE
 	for (j = 0; j < 4; j++)
 	{
-		BYTE c = get_color_channel (p[j], channel);
-		ci += c * mult[j];
+		r += p[j].r * mult[j];
+		g += p[j].g * mult[j];
+		b += p[j].b * mult[j];
 	}
-	ci >>= AA_WEIGHT_BITS;
+	r >>= AA_WEIGHT_BITS;
+	g >>= AA_WEIGHT_BITS;
+	b >>= AA_WEIGHT_BITS;
 	//check for overflow
-	if (ci > 255)
-		ci = 255;
-	
-	return ((UBYTE)ci);
+	c->r = (r > 255) ? 255 : (UBYTE)r;
+	c->g = (g > 255) ? 255 : (UBYTE)g;
+	c->b = (b > 255) ? 255 : (UBYTE)b;
 }
 
-// CreateSphereTiltMap creates 'map_rotate' to map the topo data
+// BuildSphereTiltMap fills 'map' to map the topo data
 //  for a tilted planet.  It also does the sphere->plane mapping
 static void
-CreateSphereTiltMap (int angle, COUNT height, COUNT radius)
+BuildSphereTiltMap (SPHERE_TILT_MAP *map)
 {
 	int x, y;
+	int i = 0;
+	const int angle = map->angle;
+	const COUNT height = map->height;
+	const COUNT radius = map->radius;
 	const double multx = ((double)height / M_PI);
 	const double multy = ((double)height / M_PI);
 	const double xadj = ((double)height / 2.0);
@@ -805,31 +830,28 @@ CreateSphereTiltMap (int angle, COUNT height, COUNT radius)
 	{
 		int y_2 = y * y;
 
-		for (x = -radius; x <= radius; x++)
+		for (x = -radius; x <= radius; x++, i++)
 		{
 			double dx, dy, newx, newy;
 			double da, rad, rad_2;
 			double xa, ya;
-			MAP3D_POINT *ppt =
-					&pSolarSysState->Orbit.map_rotate[y + radius]
-						[x + radius];
-			
+
 			rad_2 = x * x + y_2;
 
 			if (rad_2 >= RADIUS_THRES(radius))
 			{	// pixel won't be present
-				ppt->p[0].x = x + radius;
-				ppt->p[0].y = y + radius;
-				ppt->m[0] = 0;
+				map->x0[i] = map->x1[i] = x + radius;
+				map->y0[i] = map->y1[i] = y + radius;
+				map->m[i][0] = 0;
 
 				continue;
 			}
-			
+
 			rad = sqrt (rad_2);
 			// antialiasing goes beyond the actual radius
 			if (rad >= radius)
 				rad = (double)radius - 0.1;
-			
+
 			da = atan2 ((double)y, (double)x);
 			// compute the planet-tilt
 			da += M_DEG2RAD * -angle;
@@ -847,11 +869,72 @@ CreateSphereTiltMap (int angle, COUNT height, COUNT radius)
 			else
 				newx = xadj + ((newx - xadj) / sin (ya));
 
-			create_aa_points (ppt, newx, newy, height);
+			create_aa_points (map, i, newx, newy, height);
 		}
 	}
 }
 
+// CreateSphereTiltMap returns the tilt map for a sphere of this size and
+//  tilt, sharing it with any other planet that already has one
+static SPHERE_TILT_MAP *
+CreateSphereTiltMap (int angle, COUNT height, COUNT radius)
+{
+	SPHERE_TILT_MAP *map;
+	COUNT diameter = (radius << 1) + 1;
+	size_t count = (size_t)diameter * diameter;
+
+	for (map = tiltMaps; map; map = map->next)
+	{
+		if (map->angle == angle && map->height == height
+				&& map->radius == radius)
+		{
+			++map->refCount;
+			return map;
+		}
+	}
+
+	// The header and all the arrays live in one block; the UWORD
+	// arrays come first so that every array stays aligned
+	map = HMalloc (sizeof (*map) + count * (4 * sizeof (UWORD)
+			+ sizeof (map->m[0])));
+	map->height = height;
+	map->radius = radius;
+	map->angle = angle;
+	map->diameter = diameter;
+	map->refCount = 1;
+	map->x0 = (UWORD *)(map + 1);
+	map->y0 = map->x0 + count;
+	map->x1 = map->y0 + count;
+	map->y1 = map->x1 + count;
+	map->m = (UWORD (*)[4])(map->y1 + count);
+
+	BuildSphereTiltMap (map);
+
+	map->next = tiltMaps;
+	tiltMaps = map;
+
+	return map;
+}
+
+void
+ReleaseSphereTiltMap (SPHERE_TILT_MAP *map)
+{
+	SPHERE_TILT_MAP **link;
+
+	if (!map || --map->refCount > 0)
+		return;
+
+	for (link = &tiltMaps; *link; link = &(*link)->next)
+	{
+		if (*link == map)
+		{
+			*link = map->next;
+			break;
+		}
+	}
+	HFree (map);
+}
+
 //CreateShieldMask
 // The shield is created in two parts.  This routine creates the Halo.
 // The red tint of the planet is currently applied in RenderPlanetSphere
@@ -1151,53 +1234,81 @@ get_map_elev (SBYTE *elevs, int x, int y, int offset, COUNT width)
 	return elevs[y * width + (offset + x) % width];
 }
 
-// RenderPlanetSphere builds a frame for the rotating planet view
-// offset is effectively the angle of rotation around the planet's axis
-// We use the SDL routines to directly write to the SDL_Surface to improve
-// performance
-void
-RenderPlanetSphere (PLANET_ORBIT *Orbit, FRAME MaskFrame, int offset,
-		BOOLEAN shielded, BOOLEAN doThrob, COUNT width, COUNT height,
-		COUNT radius)
+// What the row bands of one sphere frame share
+typedef struct
 {
-	POINT pt;
-	Color *pix;
-	Color clear;
-	int x, y;
+	PLANET_ORBIT *Orbit;
 	Color *pixels;
 	SBYTE *elevs;
+	int offset;
+	COUNT width;
+	COUNT spherespanx;
+	COUNT diameter;
+	BOOLEAN shielded;
+	BOOLEAN doThrob;
+	BOOLEAN tinted;
 	int shLevel;
-	COUNT spherespanx = height;
-	COUNT tworadius = radius << 1;
-	COUNT diameter = tworadius + 1;
+} SPHERE_JOB;
 
-#if PROFILE_ROTATION
-	static clock_t t = 0;
-	static int frames_done = 1;
-	clock_t t1;
-	t1 = clock ();
-#endif
+static int
+sphere_band_rows (COUNT diameter)
+{
+	return (SPHERE_BAND_PIXELS + diameter - 1) / diameter;
+}
 
-	shLevel = shield_level (offset);
+// Rows [begin, end) of RenderPlanetSphere()
+// Unshielded rows go through the blend kernel of the platform
+// (Blend_Funcs->sphere_light) first; the loop below is its reference.
+static void
+RenderPlanetSphereRows (void *data, int begin, int end)
+{
+	const SPHERE_JOB *job = data;
+	PLANET_ORBIT *Orbit = job->Orbit;
+	const SPHERE_TILT_MAP *map = Orbit->tiltMap;
+	Color clear = BUILD_COLOR_RGBA (0, 0, 0, 0);
+	int x, y, i;
 
-	pix = Orbit->ScratchArray;
-	clear = BUILD_COLOR_RGBA (0, 0, 0, 0);
+	for (y = begin; y < end; ++y)
+	{
+		Color *pix = Orbit->ScratchArray + y * job->diameter;
 
-	if ((Orbit->scanType < NUM_SCAN_TYPES) && Orbit->ScanColors)
-		pixels = Orbit->ScanColors[Orbit->scanType] + offset;
-	else
-		pixels = Orbit->TopoColors + offset;
+		x = 0;
+		i = y * job->diameter;
+		if (!job->shielded && Blend_Funcs->sphere_light)
+		{	// the vector kernel does what it can, C does the rest
+			Blend_SphereRow krow;
+			Color alpha = BUILD_COLOR_RGBA (0, 0, 0, 0xff);
+			int k;
+
+			krow.dst = (Uint32 *)pix;
+			krow.count = job->diameter;
+			krow.pixels = (const Uint32 *)job->pixels;
+			krow.pitch = job->width + job->spherespanx;
+			krow.elevs = job->elevs;
+			krow.width = job->width;
+			krow.offset = job->offset;
+			krow.x0 = map->x0 + i;
+			krow.y0 = map->y0 + i;
+			krow.x1 = map->x1 + i;
+			krow.y1 = map->y1 + i;
+			krow.m = (const Uint16 (*)[4])map->m + i;
+			krow.light = Orbit->light_diff + i;
+			memcpy (&krow.alpha, &alpha, sizeof (krow.alpha));
+			x = Blend_Funcs->sphere_light (&krow);
+
+			for (k = 0; job->tinted && k < x; ++k)
+			{
+				if (Orbit->light_diff[i + k] != 0)
+					pix[k] = apply_alpha_pixel (pix[k], Orbit->scanType);
+			}
+			i += x;
+			pix += x;
+		}
 
-	elevs = Orbit->lpTopoData;
-	
-	for (pt.y = 0, y = -radius; pt.y <= tworadius; ++pt.y, ++y)
-	{
-		for (pt.x = 0, x = -radius; pt.x <= tworadius; ++pt.x, ++x, ++pix)
+		for (; x < job->diameter; ++x, ++i, ++pix)
 		{
 			Color c;
-			DWORD diffus = Orbit->light_diff[pt.y][pt.x];
-			int i;
-			MAP3D_POINT *ppt = &Orbit->map_rotate[pt.y][pt.x];
+			DWORD diffus = Orbit->light_diff[i];
 			int lvf; // light variance factor
 	
 			if (diffus == 0)
@@ -1207,37 +1318,37 @@ RenderPlanetSphere (PLANET_ORBIT *Orbit, FRAME MaskFrame, int offset,
 			}
 
 			// get pixel from topo map and factor from light variance map
-			if (ppt->m[0] == 0) 
+			lvf = get_map_elev (job->elevs, map->x0[i], map->y0[i],
+					job->offset, job->width);
+			if (map->m[i][0] == 0) 
 			{	// exact pixel from the topo map
-				c = get_map_pixel (pixels, ppt->p[0].x, ppt->p[0].y, width,
-						spherespanx);
-				lvf = get_map_elev (elevs, ppt->p[0].x, ppt->p[0].y,
-						offset, width);
+				c = get_map_pixel (job->pixels, map->x0[i], map->y0[i],
+						job->width, job->spherespanx);
 			}
 			else
 			{	// fractional pixel -- blend from 4
 				Color p[4];
-				int lvsum;
 
 				// compute 'ideal' pixel
-				for (i = 0; i < 4; i++)
-					p[i] = get_map_pixel (pixels, ppt->p[i].x, ppt->p[i].y,
-							width, spherespanx);
-				
-				c.r = get_avg_channel (p, ppt->m, 0);
-				c.g = get_avg_channel (p, ppt->m, 1);
-				c.b = get_avg_channel (p, ppt->m, 2);
-
-				// compute 'ideal' light variance
-				for (i = 0, lvsum = 0; i < 4; i++)
-					lvsum += get_map_elev (elevs, ppt->p[0].x, ppt->p[0].y,
-							offset, width) * ppt->m[i];
-				lvf = lvsum >> AA_WEIGHT_BITS;
+				p[0] = get_map_pixel (job->pixels, map->x0[i], map->y0[i],
+						job->width, job->spherespanx);
+				p[1] = get_map_pixel (job->pixels, map->x1[i], map->y0[i],
+						job->width, job->spherespanx);
+				p[2] = get_map_pixel (job->pixels, map->x0[i], map->y1[i],
+						job->width, job->spherespanx);
+				p[3] = get_map_pixel (job->pixels, map->x1[i], map->y1[i],
+						job->width, job->spherespanx);
+				get_avg_color (&c, p, map->m[i]);
+
+				// compute 'ideal' light variance; the weights have
+				// always all been applied to the elevation at (x0,y0)
+				lvf = (lvf * (int)(map->m[i][0] + map->m[i][1]
+						+ map->m[i][2] + map->m[i][3])) >> AA_WEIGHT_BITS;
 			}
 		
 			// Apply the lighting model.  This also bounds the sphere
 			// to make it circular.
-			if (shielded)
+			if (job->shielded)
 			{
 				int r;
 				
@@ -1253,9 +1364,9 @@ RenderPlanetSphere (PLANET_ORBIT *Orbit, FRAME MaskFrame, int offset,
 				r = calc_map_light (SHIELD_REFLECT_COMP, diffus, 0);
 				r += SHIELD_GLOW_COMP;
 				
-				if (doThrob)
+				if (job->doThrob)
 				{	// adjust red level for throbbing shield
-					r = r * shLevel / THROB_MAX_LEVEL;
+					r = r * job->shLevel / THROB_MAX_LEVEL;
 				}
 
 				r += c.r;
@@ -1272,13 +1383,55 @@ RenderPlanetSphere (PLANET_ORBIT *Orbit, FRAME MaskFrame, int offset,
 
 			c.a = 0xff;
 
-			if (optScanStyle == OPT_3DO && optTintPlanSphere == OPT_PC
-					&& Orbit->scanType < NUM_SCAN_TYPES)
+			if (job->tinted)
 				*pix = apply_alpha_pixel (c, Orbit->scanType);
 			else
 				*pix = c;
 		}
 	}
+}
+
+// RenderPlanetSphere builds a frame for the rotating planet view
+// offset is effectively the angle of rotation around the planet's axis
+// We use the SDL routines to directly write to the SDL_Surface to improve
+// performance
+// The rows are independent, and are rendered in bands on the worker pool.
+void
+RenderPlanetSphere (PLANET_ORBIT *Orbit, FRAME MaskFrame, int offset,
+		BOOLEAN shielded, BOOLEAN doThrob, COUNT width, COUNT height,
+		COUNT radius)
+{
+	SPHERE_JOB job;
+	COUNT tworadius = radius << 1;
+	COUNT diameter = tworadius + 1;
+
+#if PROFILE_ROTATION
+	static clock_t t = 0;
+	static int frames_done = 1;
+	clock_t t1;
+	t1 = clock ();
+#endif
+
+	job.Orbit = Orbit;
+	job.offset = offset;
+	job.width = width;
+	job.spherespanx = height;
+	job.diameter = diameter;
+	job.shielded = shielded;
+	job.doThrob = doThrob;
+	job.shLevel = shield_level (offset);
+	job.tinted = optScanStyle == OPT_3DO && optTintPlanSphere == OPT_PC
+			&& Orbit->scanType < NUM_SCAN_TYPES;
+
+	if ((Orbit->scanType < NUM_SCAN_TYPES) && Orbit->ScanColors)
+		job.pixels = Orbit->ScanColors[Orbit->scanType] + offset;
+	else
+		job.pixels = Orbit->TopoColors + offset;
+
+	job.elevs = Orbit->lpTopoData;
+
+	RunParallel (RenderPlanetSphereRows, &job, diameter,
+			sphere_band_rows (diameter));
 	
 	WriteFramePixelColors (MaskFrame, Orbit->ScratchArray, diameter,
 			diameter);
@@ -1300,6 +1453,30 @@ RenderPlanetSphere (PLANET_ORBIT *Orbit, FRAME MaskFrame, int offset,
 #endif
 }
 
+// Sphere rows [begin, end) of RenderDOSPlanetSphere()
+static void
+RenderDOSPlanetSphereRows (void *data, int begin, int end)
+{
+	const SPHERE_JOB *job = data;
+	PLANET_ORBIT *Orbit = job->Orbit;
+	int x, y;
+
+	for (y = begin; y < end; ++y)
+	{
+		BYTE *pix = Orbit->sphereBytes + y * job->width;
+		const Color *color = Orbit->ScratchArray + y * job->width;
+
+		for (x = 0; x < job->width; ++x, ++color, ++pix)
+		{
+			if (*pix < 0xFF)// If not transparent
+			{	// Normalize index to first 32-bit range, then add
+				// offset from mask
+				*pix = *pix - ((*pix / 32) * 32) + (color->r * 32);
+			}
+		}
+	}
+}
+
 void
 RenderDOSPlanetSphere (PLANET_ORBIT *Orbit, FRAME MaskFrame, int offset)
 {
@@ -1307,9 +1484,7 @@ RenderDOSPlanetSphere (PLANET_ORBIT *Orbit, FRAME MaskFrame, int offset)
 		return;
 	else
 	{	// Prepare new frame (oh god...)
-		BYTE *pix;
-		Color *color;
-		COUNT x, y;
+		SPHERE_JOB job;
 		SIZE width = MaskFrame->Bounds.width;
 		SIZE height = Orbit->TopoMask->Bounds.height;
 		RECT r;
@@ -1365,21 +1540,13 @@ RenderDOSPlanetSphere (PLANET_ORBIT *Orbit, FRAME MaskFrame, int offset)
 			ReadFramePixelColors (dupeframe, Orbit->ScratchArray, width,
 					height);
 
-		pix = Orbit->sphereBytes;
-		color = Orbit->ScratchArray;
-
 		// Set indexes for sphere frame pixel by pixel
-		for (y = 0; y < MaskFrame->Bounds.height; ++y)
-		{
-			for (x = 0; x < MaskFrame->Bounds.width; ++x, ++color, ++pix)
-			{
-				if (*pix < 0xFF)// If not transparent
-				{	// Normalize index to first 32-bit range, then add
-					// offset from mask
-					*pix = *pix - ((*pix / 32) * 32) + (color->r * 32);
-				}
-			}
-		}
+		job.Orbit = Orbit;
+		job.width = MaskFrame->Bounds.width;
+		RunParallel (RenderDOSPlanetSphereRows, &job,
+				MaskFrame->Bounds.height,
+				sphere_band_rows (MaskFrame->Bounds.width));
+
 		WriteFramePixelIndexes (MaskFrame, Orbit->sphereBytes,
 				MaskFrame->Bounds.width, MaskFrame->Bounds.height);
 
@@ -1388,47 +1555,39 @@ RenderDOSPlanetSphere (PLANET_ORBIT *Orbit, FRAME MaskFrame, int offset)
 	}
 }
 
-void
-Render3DOPlanetSphere (PLANET_ORBIT* Orbit, FRAME MaskFrame, int offset,
-		COUNT rotwidth, COUNT height)
+// Rows [begin, end) of Render3DOPlanetSphere()
+static void
+Render3DOPlanetSphereRows (void *data, int begin, int end)
 {
-	int x, y;
-	Color *c, *pixels, *shade;
-	Color clear;
-	POINT pt;
-	COUNT spherespanx = height;
-	COUNT radius = (spherespanx >> 1) - IF_HD(2);
-	COUNT tworadius = radius << 1;
-	COUNT diameter = tworadius + 1;
+	const SPHERE_JOB *job = data;
+	PLANET_ORBIT *Orbit = job->Orbit;
+	const SPHERE_TILT_MAP *map = Orbit->tiltMap;
+	Color clear = BUILD_COLOR_RGBA (0, 0, 0, 0);
+	int x, y, i;
 
-	c = Orbit->ScratchArray;
-	shade = Orbit->ShadeColors;
-	pixels = Orbit->TopoColors + offset;
-	clear = BUILD_COLOR_RGBA (0, 0, 0, 0);
-
-	for (pt.y = 0, y = -radius; pt.y <= tworadius; ++pt.y, ++y)
+	for (y = begin; y < end; ++y)
 	{
-		for (pt.x = 0, x = -radius; pt.x <= tworadius; ++pt.x, ++x, ++c,
-				++shade)
-		{
-			MAP3D_POINT* ppt = &Orbit->map_rotate[pt.y][pt.x];
+		Color *c = Orbit->ScratchArray + y * job->diameter;
+		const Color *shade = Orbit->ShadeColors + y * job->diameter;
 
-			if (ppt->m[0] == 0 || shade->r == 0xFF)
+		for (x = 0, i = y * job->diameter; x < job->diameter;
+				++x, ++i, ++c, ++shade)
+		{
+			if (map->m[i][0] == 0 || shade->r == 0xFF)
 			{	// exact pixel from the topo map
 				*c = clear;
 				continue;
 			}
 			else
 			{
-				*c = get_map_pixel (pixels, ppt->p[0].x, ppt->p[0].y,
-						rotwidth, spherespanx);
+				*c = get_map_pixel (job->pixels, map->x0[i], map->y0[i],
+						job->width, job->spherespanx);
 
 				c->r = clip_channel (c->r - shade->r);
 				c->g = clip_channel (c->g - shade->g);
 				c->b = clip_channel (c->b - shade->b);
 
-				if (optTintPlanSphere == OPT_PC
-					&& Orbit->scanType < NUM_SCAN_TYPES)
+				if (job->tinted)
 				{
 					if (optScanStyle == OPT_3DO)
 						*c = apply_additive_pixel (
@@ -1439,6 +1598,28 @@ Render3DOPlanetSphere (PLANET_ORBIT* Orbit, FRAME MaskFrame, int offset,
 			}
 		}
 	}
+}
+
+void
+Render3DOPlanetSphere (PLANET_ORBIT* Orbit, FRAME MaskFrame, int offset,
+		COUNT rotwidth, COUNT height)
+{
+	SPHERE_JOB job;
+	COUNT spherespanx = height;
+	COUNT radius = (spherespanx >> 1) - IF_HD(2);
+	COUNT tworadius = radius << 1;
+	COUNT diameter = tworadius + 1;
+
+	job.Orbit = Orbit;
+	job.pixels = Orbit->TopoColors + offset;
+	job.width = rotwidth;
+	job.spherespanx = spherespanx;
+	job.diameter = diameter;
+	job.tinted = optTintPlanSphere == OPT_PC
+			&& Orbit->scanType < NUM_SCAN_TYPES;
+
+	RunParallel (Render3DOPlanetSphereRows, &job, diameter,
+			sphere_band_rows (diameter));
 
 	WriteFramePixelColors (MaskFrame, Orbit->ScratchArray, diameter,
 			diameter);
@@ -1448,7 +1629,8 @@ Render3DOPlanetSphere (PLANET_ORBIT* Orbit, FRAME MaskFrame, int offset,
 #define RANGE_SHIFT 6
 
 static void
-DitherMap (SBYTE *DepthArray, COUNT width, COUNT height)
+DitherMap (SBYTE *DepthArray, COUNT width, COUNT height,
+		RandomContext *rng)
 {
 #define DITHER_VARIANCE  (1 << (RANGE_SHIFT - 3))
 	DWORD i;
@@ -1460,7 +1642,7 @@ DitherMap (SBYTE *DepthArray, COUNT width, COUNT height)
 	{
 		// Use up the random value byte by byte
 		if ((i & 3) == 0)
-			rand_val = RandomContext_Random (SysGenRNG);
+			rand_val = RandomContext_Random (rng);
 		else
 			rand_val >>= 8;
 
@@ -1663,7 +1845,7 @@ MakeCrater (RECT *pRect, SBYTE *DepthArray, SIZE rim_delta, SIZE
 
 static void
 MakeStorms (COUNT storm_count, SBYTE *DepthArray, COUNT width,
-		COUNT height)
+		COUNT height, RandomContext *rng)
 {
 #define MAX_STORMS 8
 	COUNT i;
@@ -1685,7 +1867,7 @@ MakeStorms (COUNT storm_count, SBYTE *DepthArray, COUNT width,
 
 			intersect = FALSE;
 
-			rand_val = RandomContext_Random (SysGenRNG);
+			rand_val = RandomContext_Random (rng);
 			loword = LOWORD (rand_val);
 			hiword = HIWORD (rand_val);
 			switch (HIBYTE (hiword) & 31)
@@ -1713,7 +1895,7 @@ MakeStorms (COUNT storm_count, SBYTE *DepthArray, COUNT width,
 			if (pstorm_r->extent.height <= 4)
 				pstorm_r->extent.height += 4;
 
-			rand_val = RandomContext_Random (SysGenRNG);
+			rand_val = RandomContext_Random (rng);
 			loword = LOWORD (rand_val);
 			hiword = HIWORD (rand_val);
 
@@ -1797,7 +1979,7 @@ MakeStorms (COUNT storm_count, SBYTE *DepthArray, COUNT width,
 
 static void
 MakeGasGiant (COUNT num_bands, SBYTE *DepthArray, RECT *pRect, SIZE
-		depth_delta)
+		depth_delta, RandomContext *rng)
 {
 	COORD last_y, next_y;
 	SIZE band_error, band_bump, band_delta;
@@ -1811,7 +1993,7 @@ MakeGasGiant (COUNT num_bands, SBYTE *DepthArray, RECT *pRect, SIZE
 	band_error = num_bands >> 1;
 	lpDst = DepthArray;
 
-	band_delta = ((LOWORD (RandomContext_Random (SysGenRNG))
+	band_delta = ((LOWORD (RandomContext_Random (rng))
 			& (NUM_BAND_COLORS - 1)) << RANGE_SHIFT)
 			+ (1 << (RANGE_SHIFT - 1));
 	last_y = next_y = 0;
@@ -1819,7 +2001,7 @@ MakeGasGiant (COUNT num_bands, SBYTE *DepthArray, RECT *pRect, SIZE
 	{
 		COORD cur_y;
 
-		rand_val = RandomContext_Random (SysGenRNG);
+		rand_val = RandomContext_Random (rng);
 		loword = LOWORD (rand_val);
 		hiword = HIWORD (rand_val);
 
@@ -1846,7 +2028,7 @@ MakeGasGiant (COUNT num_bands, SBYTE *DepthArray, RECT *pRect, SIZE
 			DeltaTopography (50,
 					&DepthArray[(cur_y - (r.extent.height >> 1))
 						* r.extent.width],
-					&r, depth_delta);
+					&r, depth_delta, rng);
 		}
 
 		for (j = cur_y - last_y; j > 0; --j)
@@ -1863,10 +2045,10 @@ MakeGasGiant (COUNT num_bands, SBYTE *DepthArray, RECT *pRect, SIZE
 				& (((1 << RANGE_SHIFT) * NUM_BAND_COLORS) - 1);
 	}
 
-	MakeStorms (4 + (RandomContext_Random (SysGenRNG) & 3) + 1,
-			DepthArray, pRect->extent.width, pRect->extent.height);
+	MakeStorms (4 + (RandomContext_Random (rng) & 3) + 1,
+			DepthArray, pRect->extent.width, pRect->extent.height, rng);
 
-	DitherMap (DepthArray, pRect->extent.width, pRect->extent.height);
+	DitherMap (DepthArray, pRect->extent.width, pRect->extent.height, rng);
 }
 
 static void
@@ -1957,7 +2139,7 @@ planet_orbit_init (COUNT width, COUNT height, BOOLEAN forOrbit)
 		Orbit->BackFrame = 0;
 
 		Orbit->light_diff = NULL;
-		Orbit->map_rotate = NULL;
+		Orbit->tiltMap = NULL;
 
 		Orbit->TopoMask = 0;
 		Orbit->sphereBytes = NULL;
@@ -1990,17 +2172,9 @@ planet_orbit_init (COUNT width, COUNT height, BOOLEAN forOrbit)
 		}
 
 		if (!use3DOSpheres)
-			Orbit->light_diff = HMalloc (sizeof (DWORD *) * diameter);
-
-		Orbit->map_rotate = HMalloc (sizeof (MAP3D_POINT *) * diameter);
-
-		for (i = 0; i < diameter; i++)
-		{
-			if (!use3DOSpheres)
-				Orbit->light_diff[i] = HMalloc (sizeof (DWORD) * diameter);
-			Orbit->map_rotate[i] =
-					HMalloc (sizeof (MAP3D_POINT) * diameter);
-		}
+			Orbit->light_diff =
+					HMalloc (sizeof (DWORD) * diameter * diameter);
+		// the tilt map is shared and comes with the planet's tilt
 
 		if (use3DOSpheres)
 		{
@@ -2483,10 +2657,12 @@ load_color_resources (PLANET_DESC *pPlanetDesc,
 	pSolarSysState->XlatPtr = GetStringAddress (pSolarSysState->XlatRef);
 }
 
-void
-generate_surface_frame (COUNT width, COUNT height, PLANET_ORBIT *Orbit,
-		const PlanetFrame *PlanDataPtr)
-{	// Generate planet surface elevation data and look
+// Generates planet surface elevation data.  Touches nothing but its
+// arguments, so it can run on any thread.
+static void
+GenerateElevationMap (SBYTE *DepthArray, COUNT width, COUNT height,
+		const PlanetFrame *PlanDataPtr, RandomContext *rng)
+{
 	RECT r;
 	COUNT i;
 
@@ -2494,26 +2670,26 @@ generate_surface_frame (COUNT width, COUNT height, PLANET_ORBIT *Orbit,
 	r.extent.width = width;
 	r.extent.height = height;
 
-	memset (Orbit->lpTopoData, 0, width * height);
+	memset (DepthArray, 0, width * height);
 	switch (PLANALGO (PlanDataPtr->Type))
 	{
 		case GAS_GIANT_ALGO:
 			MakeGasGiant (PlanDataPtr->num_faults,
-					Orbit->lpTopoData, &r, PlanDataPtr->fault_depth);
+					DepthArray, &r, PlanDataPtr->fault_depth, rng);
 			break;
 		case TOPO_ALGO:
 		case CRATERED_ALGO:
 			if (PlanDataPtr->num_faults)
 				DeltaTopography (PlanDataPtr->num_faults,
-						Orbit->lpTopoData, &r,
-						PlanDataPtr->fault_depth);
+						DepthArray, &r,
+						PlanDataPtr->fault_depth, rng);
 
 			for (i = 0; i < PlanDataPtr->num_blemishes; ++i)
 			{
 				RECT crater_r;
 				UWORD loword;
 
-				loword = LOWORD (RandomContext_Random (SysGenRNG));
+				loword = LOWORD (RandomContext_Random (rng));
 				switch (HIBYTE (loword) & 31)
 				{
 					case 0:
@@ -2539,7 +2715,7 @@ generate_surface_frame (COUNT width, COUNT height, PLANET_ORBIT *Orbit,
 						break;
 				}
 
-				loword = LOWORD (RandomContext_Random (SysGenRNG));
+				loword = LOWORD (RandomContext_Random (rng));
 				crater_r.extent.height = crater_r.extent.width;
 				crater_r.corner.x = HIBYTE (loword)
 						% (ORIGINAL_MAP_WIDTH
@@ -2557,23 +2733,149 @@ generate_surface_frame (COUNT width, COUNT height, PLANET_ORBIT *Orbit,
 				crater_r.corner.y = crater_r.corner.y
 						* height / ORIGINAL_MAP_HEIGHT;
 
-				MakeCrater (&crater_r, Orbit->lpTopoData,
+				MakeCrater (&crater_r, DepthArray,
 						PlanDataPtr->fault_depth << 2,
 						-(PlanDataPtr->fault_depth << 2),
 						FALSE, width);
 			}
 			if (PLANALGO (PlanDataPtr->Type) == CRATERED_ALGO)
-				DitherMap (Orbit->lpTopoData, width, height);
-			ValidateMap (Orbit->lpTopoData, width, height);
+				DitherMap (DepthArray, width, height, rng);
+			ValidateMap (DepthArray, width, height);
 			break;
 	}
+}
+
+// Renders the topo frame from the elevation data
+static void
+CreateSurfaceFrame (COUNT width, COUNT height, PLANET_ORBIT *Orbit)
+{
 	pSolarSysState->TopoFrame = CaptureDrawable (
 			CreateDrawable (WANT_PIXMAP, (SIZE)width,
 				(SIZE)height, 1));
 
 	RenderTopography (pSolarSysState->TopoFrame,
 			Orbit->lpTopoData, width, height, FALSE, NULL);
+}
 
+void
+generate_surface_frame (COUNT width, COUNT height, PLANET_ORBIT *Orbit,
+		const PlanetFrame *PlanDataPtr)
+{	// Generate planet surface elevation data and look
+	GenerateElevationMap (Orbit->lpTopoData, width, height, PlanDataPtr,
+			SysGenRNG);
+	CreateSurfaceFrame (width, height, Orbit);
+}
+
+// Surfaces computed ahead of GeneratePlanetSurface() calls
+typedef struct
+{
+	const PLANET_DESC *world;
+	COUNT width;
+	COUNT height;
+	PLANET_SURFACE_DATA data;
+	BOOLEAN cached;
+			// data came from the surface cache
+} PREBUILT_TOPO;
+
+static PREBUILT_TOPO *prebuiltTopo;
+static COUNT prebuiltCount;
+
+static void
+PrebuildElevationMaps (void *data, int begin, int end)
+{
+	PREBUILT_TOPO *jobs = data;
+	RandomContext *rng = RandomContext_New ();
+	int i;
+
+	// Each world gets the same random sequence GeneratePlanetSurface()
+	// would give it from SysGenRNG, so the results do not change
+	for (i = begin; i < end; ++i)
+	{
+		PREBUILT_TOPO *job = &jobs[i];
+		const PlanetFrame *PlanDataPtr =
+				&PlanData[job->world->data_index & ~PLANET_SHIELDED];
+
+		if (job->cached)
+			continue;
+
+		RandomContext_SeedRandom (rng, job->world->rand_seed);
+		job->data.elevation = HMalloc (job->width * job->height);
+		GenerateElevationMap (job->data.elevation, job->width, job->height,
+				PlanDataPtr, rng);
+		job->data.seed = RandomContext_GetSeed (rng);
+	}
+
+	RandomContext_Delete (rng);
+}
+
+// Generates the elevation data of these worlds on the worker pool, for
+// the following GeneratePlanetSurface() calls to pick up.  Worlds that
+// turn out to have a defined surface simply never pick theirs up.
+void
+PrebuildPlanetSurfaces (const PLANET_SURFACE_SPEC *specs, COUNT count)
+{
+	COUNT i;
+
+	FreePrebuiltPlanetSurfaces ();
+	if (!count)
+		return;
+
+	prebuiltTopo = HCalloc (sizeof (prebuiltTopo[0]) * count);
+	if (!prebuiltTopo)
+		return;
+	for (i = 0; i < count; ++i)
+	{
+		PREBUILT_TOPO *job = &prebuiltTopo[i];
+
+		job->world = specs[i].world;
+		job->width = specs[i].width;
+		job->height = specs[i].height;
+		// The cache is read here, as uio is not thread safe
+		job->cached = LoadCachedSurface (job->world, &PlanData[
+				job->world->data_index & ~PLANET_SHIELDED],
+				job->width, job->height, &job->data);
+	}
+	prebuiltCount = count;
+
+	RunParallel (PrebuildElevationMaps, prebuiltTopo, count, 1);
+}
+
+void
+FreePrebuiltPlanetSurfaces (void)
+{
+	COUNT i;
+
+	for (i = 0; i < prebuiltCount; ++i)
+		FreeSurfaceData (&prebuiltTopo[i].data);
+	HFree (prebuiltTopo);
+	prebuiltTopo = NULL;
+	prebuiltCount = 0;
+}
+
+// Hands over the prebuilt surface of the world, if there is one.
+// Returns TRUE and fills 'data' then; 'cached' tells whether it came
+// from the surface cache.
+static BOOLEAN
+TakePrebuiltSurface (const PLANET_DESC *world, COUNT width, COUNT height,
+		PLANET_SURFACE_DATA *data, BOOLEAN *cached)
+{
+	COUNT i;
+
+	for (i = 0; i < prebuiltCount; ++i)
+	{
+		PREBUILT_TOPO *job = &prebuiltTopo[i];
+
+		if (job->world != world || job->width != width
+				|| job->height != height || !job->data.elevation)
+			continue;
+
+		*data = job->data;
+		*cached = job->cached;
+		memset (&job->data, 0, sizeof job->data);
+		return TRUE;
+	}
+
+	return FALSE;
 }
 
 void
@@ -2602,6 +2904,8 @@ GetPlanetTopography (PLANET_DESC *pPlanetDesc, FRAME SurfDefFrame)
 	}
 	else
 	{
+		PLANET_SURFACE_DATA surface;
+
 		pSolarSysState->OrbitalCMap = CaptureColorMap(
 			LoadColorMap(shielded && useDosSpheres ? DOS_SHIELDED_COLOR_TAB
 				: PlanDataPtr->CMapInstance));
@@ -2625,9 +2929,27 @@ GetPlanetTopography (PLANET_DESC *pPlanetDesc, FRAME SurfDefFrame)
 
 		pSolarSysState->XlatPtr = GetStringAddress (pSolarSysState->XlatRef);
 
-		Orbit->lpTopoData = HCalloc (width * height);
-		RandomContext_SeedRandom (SysGenRNG, pPlanetDesc->rand_seed);
-		generate_surface_frame (width, height, Orbit, PlanDataPtr);
+		if (LoadCachedSurface (pPlanetDesc, PlanDataPtr, width, height,
+				&surface))
+		{
+			Orbit->lpTopoData = surface.elevation;
+			surface.elevation = NULL;
+			RandomContext_SeedRandom (SysGenRNG, surface.seed);
+			CreateSurfaceFrame (width, height, Orbit);
+		}
+		else
+		{	// GeneratePlanetSurface() follows and will find this in the
+			// cache, adding what it computes on top
+			Orbit->lpTopoData = HCalloc (width * height);
+			RandomContext_SeedRandom (SysGenRNG, pPlanetDesc->rand_seed);
+			generate_surface_frame (width, height, Orbit, PlanDataPtr);
+			surface.elevation = Orbit->lpTopoData;
+			surface.seed = RandomContext_GetSeed (SysGenRNG);
+			SaveCachedSurface (pPlanetDesc, PlanDataPtr, width, height,
+					&surface);
+			surface.elevation = NULL;
+		}
+		FreeSurfaceData (&surface);
 
 		DestroyColorMap (ReleaseColorMap (pSolarSysState->OrbitalCMap));
 		pSolarSysState->OrbitalCMap = 0;
@@ -2655,6 +2977,12 @@ GeneratePlanetSurface (PLANET_DESC *pPlanetDesc, FRAME SurfDefFrame,
 	BOOLEAN ForIP;
 	BOOLEAN customTexture =
 			solTexturesPresent && CurStarDescPtr->Index == SOL_DEFINED;
+	PLANET_SURFACE_DATA surface;
+	BOOLEAN storeSurface = FALSE;
+			// whether the surface got generated and goes to the cache
+	BOOLEAN flatLight;
+
+	memset (&surface, 0, sizeof surface);
 
 	if (!width && !height)
 	{
@@ -2755,7 +3083,31 @@ GeneratePlanetSurface (PLANET_DESC *pPlanetDesc, FRAME SurfDefFrame,
 	}
 	else
 	{	
-		generate_surface_frame (width, height, Orbit, PlanDataPtr);
+		BOOLEAN cached = FALSE;
+		BOOLEAN ready = TakePrebuiltSurface (pPlanetDesc, width, height,
+				&surface, &cached);
+
+		if (!ready)
+		{
+			ready = LoadCachedSurface (pPlanetDesc, PlanDataPtr, width,
+					height, &surface);
+			cached = ready;
+		}
+
+		if (ready)
+		{	// leave SysGenRNG as generating the map would have
+			HFree (Orbit->lpTopoData);
+			Orbit->lpTopoData = surface.elevation;
+			surface.elevation = NULL;
+			RandomContext_SeedRandom (SysGenRNG, surface.seed);
+			CreateSurfaceFrame (width, height, Orbit);
+		}
+		else
+		{
+			generate_surface_frame (width, height, Orbit, PlanDataPtr);
+			surface.seed = RandomContext_GetSeed (SysGenRNG);
+		}
+		storeSurface = !cached;
 	}
 
 	if (!ForIP && useDosSpheres)
@@ -2840,23 +3192,35 @@ GeneratePlanetSurface (PLANET_DESC *pPlanetDesc, FRAME SurfDefFrame,
 		}
 		else
 		{	// usual smooth 3DO landscape
-			SBYTE* pScaledTopo = HMalloc (
-					SCALED_MAP_WIDTH * 4 * MAP_HEIGHT * 4);
+			SBYTE* pScaledTopo = surface.scaledTopo;
 
 			Orbit->TopoZoomFrame = CaptureDrawable (CreateDrawable (
 				WANT_PIXMAP, width << 2, height << 2, 1));
 
+			if (!pScaledTopo)
+			{
+				pScaledTopo = HMalloc (
+						SCALED_MAP_WIDTH * 4 * MAP_HEIGHT * 4);
+				if (pScaledTopo)
+				{
+					TopoScale4x (pScaledTopo, Orbit->lpTopoData,
+							PlanDataPtr->num_faults,
+							PlanDataPtr->fault_depth * (PLANALGO (
+								PlanDataPtr->Type) == CRATERED_ALGO
+									? 2 : 1 ));
+					// a generated surface completes its cache file
+					storeSurface = !SurfDef;
+				}
+			}
+
 			if (pScaledTopo)
 			{
-				TopoScale4x (pScaledTopo, Orbit->lpTopoData,
-						PlanDataPtr->num_faults, PlanDataPtr->fault_depth
-						* (PLANALGO (
-							PlanDataPtr->Type) == CRATERED_ALGO ? 2 : 1 ));
 				RenderTopography (Orbit->TopoZoomFrame, pScaledTopo,
 						SCALED_MAP_WIDTH * 4, MAP_HEIGHT * 4, SurfDef, NULL
 					);
 
-				HFree (pScaledTopo);
+				// kept for the surface cache, freed below
+				surface.scaledTopo = pScaledTopo;
 			}
 		}
 	}
@@ -2900,14 +3264,43 @@ GeneratePlanetSurface (PLANET_DESC *pPlanetDesc, FRAME SurfDefFrame,
 		}
 	}
 
-	if (PLANALGO (PlanDataPtr->Type) == GAS_GIANT_ALGO
-			|| (customTexture && use3DOSpheres))
+	flatLight = PLANALGO (PlanDataPtr->Type) == GAS_GIANT_ALGO
+			|| (customTexture && use3DOSpheres);
+	if (!SurfDef && !flatLight && !surface.lightMap)
+	{	// the light map is about to be generated; cache it too
+		storeSurface = TRUE;
+	}
+
+	if (storeSurface)
+	{	// the light map replaces the elevation data
+		surface.elevation = HMalloc (width * height);
+		if (surface.elevation)
+			memcpy (surface.elevation, Orbit->lpTopoData, width * height);
+	}
+
+	if (flatLight)
 	{	// convert topo data to a light map, based on relative
 		// map point elevations
 		memset (Orbit->lpTopoData, 0, width * height);
 	}
+	else if (surface.lightMap)
+		memcpy (Orbit->lpTopoData, surface.lightMap, width * height);
 	else
+	{
 		GenerateLightMap (Orbit->lpTopoData, width, height);
+		if (storeSurface)
+		{
+			surface.lightMap = HMalloc (width * height);
+			if (surface.lightMap)
+				memcpy (surface.lightMap, Orbit->lpTopoData,
+						width * height);
+		}
+	}
+
+	if (storeSurface)
+		SaveCachedSurface (pPlanetDesc, PlanDataPtr, width, height,
+				&surface);
+	FreeSurfaceData (&surface);
 
 	if (pSolarSysState->pOrbitalDesc->pPrevDesc ==
 			&pSolarSysState->SunDesc[0])
@@ -2923,7 +3316,8 @@ GeneratePlanetSurface (PLANET_DESC *pPlanetDesc, FRAME SurfDefFrame,
 	if (!(useDosSpheres || use3DOSpheres) || ForIP)
 	{
 		GenerateSphereMask (loc, radius);
-		CreateSphereTiltMap (PlanetInfo->AxialTilt, height, radius);
+		Orbit->tiltMap = CreateSphereTiltMap (PlanetInfo->AxialTilt,
+				height, radius);
 	}
 	else if (useDosSpheres || use3DOSpheres)
 	{
@@ -2941,7 +3335,8 @@ GeneratePlanetSurface (PLANET_DESC *pPlanetDesc, FRAME SurfDefFrame,
 		}
 		else if (use3DOSpheres)
 		{
-			CreateSphereTiltMap (PlanetInfo->AxialTilt, height, radius);
+			Orbit->tiltMap = CreateSphereTiltMap (PlanetInfo->AxialTilt,
+					height, radius);
 			Orbit->Shade =
 					SetAbsFrameIndex (Orbit->Shade, facing);
 			ReadFramePixelColors (Orbit->Shade, Orbit->ShadeColors,
@@ -289,6 +289,45 @@ playerInInnerSystem (void)
 	return pSolarSysState->pBaseDesc != pSolarSysState->PlanetDesc;
 }
 
+static SIZE
+moonDiameter (const PLANET_DESC *pMoonDesc)
+{
+	return pMoonDesc->data_index > LAST_SMALL_ROCKY_WORLD ?
+			LARGE_MOON_DIAMETER : MOON_DIAMETER;
+}
+
+// The generated worlds' elevation maps only depend on their seeds, so
+// they are all computed up front on the worker pool.  Sol's worlds are
+// mostly defined by images and are left alone.
+static void
+PrebuildTexturedWorlds (PLANET_DESC *worlds, COUNT count, BOOLEAN moons)
+{
+	PLANET_SURFACE_SPEC specs[MAX_PLANETS];
+	COUNT i, num = 0;
+
+	if (CurStarDescPtr->Index == SOL_DEFINED)
+		return;
+
+	for (i = 0; i < count && num < MAX_PLANETS; ++i)
+	{
+		SIZE diameter = PLANET_DIAMETER;
+
+		if (moons)
+		{
+			if (worlds[i].data_index & WORLD_TYPE_SPECIAL)
+				continue;
+			diameter = moonDiameter (&worlds[i]);
+		}
+
+		specs[num].world = &worlds[i];
+		specs[num].width = GENERATE_PERIMETER (diameter);
+		specs[num].height = diameter;
+		++num;
+	}
+
+	PrebuildPlanetSurfaces (specs, num);
+}
+
 static void
 GenerateTexturedMoons (SOLARSYS_STATE *system, PLANET_DESC *planet)
 {
@@ -298,6 +337,8 @@ GenerateTexturedMoons (SOLARSYS_STATE *system, PLANET_DESC *planet)
 	PLANET_DESC *previousOrbitalDesc = pSolarSysState->pOrbitalDesc;
 	PLANET_INFO *planetInfo = &pSolarSysState->SysInfo.PlanetInfo;
 
+	PrebuildTexturedWorlds (system->MoonDesc, planet->NumPlanets, TRUE);
+
 	for (i = 0, pMoonDesc = &system->MoonDesc[0];
 			i < planet->NumPlanets; ++i, ++pMoonDesc)
 	{
@@ -366,8 +407,7 @@ GenerateTexturedMoons (SOLARSYS_STATE *system, PLANET_DESC *planet)
 				}
 			}
 
-			MoonDiameter = pMoonDesc->data_index > LAST_SMALL_ROCKY_WORLD ?
-					LARGE_MOON_DIAMETER : MOON_DIAMETER;
+			MoonDiameter = moonDiameter (pMoonDesc);
 			GeneratePlanetSurface (pMoonDesc,
 					CaptureDrawable (LoadGraphic (maskAnim)),
 					GENERATE_PERIMETER (MoonDiameter), MoonDiameter
@@ -385,6 +425,7 @@ GenerateTexturedMoons (SOLARSYS_STATE *system, PLANET_DESC *planet)
 			pSolarSysState->OrbitalCMap = 0;
 		}
 	}
+	FreePrebuiltPlanetSurfaces ();
 	pSolarSysState->pOrbitalDesc = previousOrbitalDesc;
 }
 
@@ -552,6 +593,28 @@ LoadIPData (void)
 		SysGenRNGDebug = SysGenRNG;
 	}
 }
+
+// Called as soon as it is known that a solar system is about to be
+// entered, so that LoadIPData() finds its graphics already loaded.
+void
+PrefetchIPData (void)
+{
+	RESOURCE ipRes[] =
+	{
+		IPBKGND_MASK_PMAP_ANIM,
+		SIS_IP_MASK,
+		ORBPLAN_COLOR_MAP,
+		PLANETS_MASK,
+		ORBSHLD_MASK_PMAP_ANIM,
+		IPSUN_COLOR_MAP,
+		SUN_MASK,
+	};
+
+	if (SpaceJunkFrame != 0)
+		return;
+
+	res_PrefetchGroup (ipRes, ARRAY_SIZE (ipRes), RES_PREFETCH_NORMAL);
+}
 	
 
 static void
@@ -663,6 +726,9 @@ GenerateTexturedPlanets (void)
 	PLANET_DESC *pCurDesc;
 	PLANET_DESC *previousOrbitalDesc;
 	previousOrbitalDesc = pSolarSysState->pOrbitalDesc;
+
+	PrebuildTexturedWorlds (pSolarSysState->PlanetDesc,
+			pSolarSysState->SunDesc[0].NumPlanets, FALSE);
 	
 	for (i = 0, pCurDesc = pSolarSysState->PlanetDesc;
 			i < pSolarSysState->SunDesc[0].NumPlanets; ++i, ++pCurDesc)
@@ -743,6 +809,7 @@ GenerateTexturedPlanets (void)
 		pSolarSysState->OrbitalCMap = 0;
 		// End clean up
 	}
+	FreePrebuiltPlanetSurfaces ();
 	pSolarSysState->pOrbitalDesc = previousOrbitalDesc;
 }
 
@@ -919,7 +986,7 @@ FreeSolarSys (void)
 		for (i = 0, pCurDesc = pSolarSysState->PlanetDesc;
 				i < pSolarSysState->SunDesc[0].NumPlanets; ++i, ++pCurDesc)
 		{
-			DestroyOrbitStruct (&pCurDesc->orbit, PLANET_DIAMETER);
+			DestroyOrbitStruct (&pCurDesc->orbit);
 			// JMS: Not sure if these do any good...
 			DestroyStringTable (
 					ReleaseStringTable (pSolarSysState->XlatRef));
@@ -948,11 +1015,7 @@ FreeSolarSys (void)
 			{
 				if (!(pCurDesc->data_index & WORLD_TYPE_SPECIAL))
 				{
-					SIZE diameterPick =
-							pCurDesc->data_index > LAST_SMALL_ROCKY_WORLD ?
-								LARGE_MOON_DIAMETER : MOON_DIAMETER;
-
-					DestroyOrbitStruct (&pCurDesc->orbit, diameterPick);
+					DestroyOrbitStruct (&pCurDesc->orbit);
 					pCurDesc->frame_offset = UNDEFINED_OFFSET;
 				}
 			}
@@ -1648,13 +1711,7 @@ leaveInnerSystem (PLANET_DESC *planet)
 			 i < planet->NumPlanets; ++i, ++pMoonDesc)
 		{
 			if (!(pMoonDesc->data_index & WORLD_TYPE_SPECIAL))
-			{
-				SIZE diameterPick =
-					pMoonDesc->data_index > LAST_SMALL_ROCKY_WORLD ?
-					LARGE_MOON_DIAMETER : MOON_DIAMETER;
-
-				DestroyOrbitStruct (&pMoonDesc->orbit, diameterPick);
-			}
+				DestroyOrbitStruct (&pMoonDesc->orbit);
 			pMoonDesc->frame_offset = UNDEFINED_OFFSET;
 		}
 	}	// End clean up
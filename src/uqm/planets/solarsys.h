@@ -29,6 +29,7 @@ extern void InitialIntersect (void);
 
 extern void LoadIPData (void);
 extern void FreeIPData (void);
+extern void PrefetchIPData (void);
 
 #if defined(__cplusplus)
 }
@@ -0,0 +1,420 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/* Cache of generated planet surfaces.
+ *
+ * A generated world's elevation map, light map and planetside topo only
+ * depend on its seed, its world type's generation parameters and the
+ * map size, so they are stored in the cache dir under a name derived
+ * from those and read back instead of being generated again.
+ *
+ * Colour data (topo colours, scan maps) is not stored; it depends on the
+ * loaded colour tables and is cheap to build from the elevation map.
+ *
+ * The files are native endian and only meant for the machine that wrote
+ * them. When the total size of the cache goes over TOPOCACHE_MAX_SIZE,
+ * the least recently written files are removed. The directory is only
+ * scanned for that on the first write of a session and when the running
+ * total says the limit is crossed.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "topocache.h"
+#include "options.h"
+#include "libs/uio.h"
+#include "libs/memlib.h"
+#include "libs/log.h"
+#include "types.h"
+#ifdef HAVE_ZIP
+#	include <zlib.h>
+#endif
+
+#define TOPOCACHE_MAGIC "UQMTOPO"
+#define TOPOCACHE_VERSION 1
+#define TOPOCACHE_PREFIX "topo-"
+#define TOPOCACHE_MAX_SIZE (64 << 20)
+
+// Sections present in a file
+#define TOPOCACHE_LIGHTMAP 0x01
+#define TOPOCACHE_SCALED   0x02
+
+typedef struct
+{
+	char magic[8];
+	uint32 version;
+	uint32 worldSeed;
+	uint32 params;
+			// hash of everything else the surface depends on
+	uint16 width;
+	uint16 height;
+	uint32 rngSeed;
+	uint32 sections;
+	uint32 compressed;
+	uint32 rawSize;
+	uint32 packedSize;
+} TopoCacheHeader;
+
+typedef struct
+{
+	const char *name;
+	off_t size;
+	time_t mtime;
+} TopoCacheFile;
+
+static off_t cacheSize = -1;
+		// Total size of the cache files as of the last scan plus what was
+		// written since; -1 before the first scan
+
+
+static uint32
+hashBytes (uint32 hash, const void *data, size_t size)
+{
+	// FNV-1a
+	const BYTE *p = data;
+
+	for (; size > 0; --size, ++p)
+	{
+		hash ^= *p;
+		hash *= 16777619U;
+	}
+	return hash;
+}
+
+static uint32
+surfaceParams (const PLANET_DESC *world, const PlanetFrame *PlanDataPtr,
+		COUNT width, COUNT height)
+{
+	uint32 hash = 2166136261U;
+	BYTE type = PlanDataPtr->Type;
+	BYTE index = world->data_index;
+
+	// The generation parameters are hashed rather than just the world
+	// type, so a mod changing them gets different files
+	hash = hashBytes (hash, &index, sizeof index);
+	hash = hashBytes (hash, &type, sizeof type);
+	hash = hashBytes (hash, &PlanDataPtr->num_faults,
+			sizeof PlanDataPtr->num_faults);
+	hash = hashBytes (hash, &PlanDataPtr->fault_depth,
+			sizeof PlanDataPtr->fault_depth);
+	hash = hashBytes (hash, &PlanDataPtr->num_blemishes,
+			sizeof PlanDataPtr->num_blemishes);
+	hash = hashBytes (hash, &width, sizeof width);
+	hash = hashBytes (hash, &height, sizeof height);
+	return hash;
+}
+
+static void
+cacheFileName (char *buf, size_t size, DWORD worldSeed, uint32 params)
+{
+	snprintf (buf, size, TOPOCACHE_PREFIX "%08lx-%08lx.bin",
+			(unsigned long) worldSeed, (unsigned long) params);
+}
+
+static SBYTE *
+takeSection (const BYTE **src, size_t size)
+{
+	SBYTE *section = HMalloc (size);
+
+	if (section)
+		memcpy (section, *src, size);
+	*src += size;
+	return section;
+}
+
+BOOLEAN
+LoadCachedSurface (const PLANET_DESC *world, const PlanetFrame *PlanDataPtr,
+		COUNT width, COUNT height, PLANET_SURFACE_DATA *data)
+{
+	char name[64];
+	uio_Stream *f;
+	TopoCacheHeader header;
+	uint32 params;
+	size_t mapSize = (size_t) width * height;
+	size_t rawSize;
+	BYTE *packed = NULL;
+	BYTE *raw = NULL;
+	const BYTE *src;
+
+	memset (data, 0, sizeof *data);
+	if (!cacheDir)
+		return FALSE;
+
+	params = surfaceParams (world, PlanDataPtr, width, height);
+	cacheFileName (name, sizeof name, world->rand_seed, params);
+	f = uio_fopen (cacheDir, name, "rb");
+	if (!f)
+		return FALSE;
+
+	if (uio_fread (&header, sizeof header, 1, f) != 1)
+		goto err;
+
+	rawSize = mapSize;
+	if (header.sections & TOPOCACHE_LIGHTMAP)
+		rawSize += mapSize;
+	if (header.sections & TOPOCACHE_SCALED)
+		rawSize += mapSize * 16;
+
+	if (memcmp (header.magic, TOPOCACHE_MAGIC, sizeof header.magic) != 0
+			|| header.version != TOPOCACHE_VERSION
+			|| header.worldSeed != world->rand_seed
+			|| header.params != params
+			|| header.width != width || header.height != height
+			|| header.rawSize != rawSize
+			|| (header.compressed && header.packedSize > rawSize * 2)
+			|| (!header.compressed && header.packedSize != rawSize))
+		goto err;  // Stale, foreign or damaged; regenerate
+
+#ifndef HAVE_ZIP
+	if (header.compressed)
+		goto err;
+#endif
+
+	packed = HMalloc (header.packedSize);
+	if (!packed || uio_fread (packed, 1, header.packedSize, f)
+			!= header.packedSize)
+		goto err;
+	uio_fclose (f);
+	f = NULL;
+
+	if (header.compressed)
+	{
+#ifdef HAVE_ZIP
+		uLongf destLen = rawSize;
+
+		raw = HMalloc (rawSize);
+		if (!raw || uncompress (raw, &destLen, packed, header.packedSize)
+				!= Z_OK || destLen != rawSize)
+			goto err;
+		HFree (packed);
+		packed = NULL;
+#endif
+	}
+	else
+	{
+		raw = packed;
+		packed = NULL;
+	}
+
+	src = raw;
+	data->elevation = takeSection (&src, mapSize);
+	if (header.sections & TOPOCACHE_LIGHTMAP)
+		data->lightMap = takeSection (&src, mapSize);
+	if (header.sections & TOPOCACHE_SCALED)
+		data->scaledTopo = takeSection (&src, mapSize * 16);
+	data->seed = header.rngSeed;
+	HFree (raw);
+
+	if (!data->elevation
+			|| (!data->lightMap && (header.sections & TOPOCACHE_LIGHTMAP))
+			|| (!data->scaledTopo && (header.sections & TOPOCACHE_SCALED)))
+	{
+		FreeSurfaceData (data);
+		return FALSE;
+	}
+	return TRUE;
+
+err:
+	if (f)
+		uio_fclose (f);
+	HFree (packed);
+	HFree (raw);
+	return FALSE;
+}
+
+static int
+compareFileAge (const void *a, const void *b)
+{
+	const TopoCacheFile *fa = a;
+	const TopoCacheFile *fb = b;
+
+	if (fa->mtime != fb->mtime)
+		return fa->mtime < fb->mtime ? -1 : 1;
+	return 0;
+}
+
+// Removes the oldest cache files until the rest fit TOPOCACHE_MAX_SIZE
+static void
+trimCache (void)
+{
+	uio_DirList *dirList;
+	TopoCacheFile *files;
+	off_t total = 0;
+	COUNT i, count = 0;
+
+	dirList = uio_getDirList (cacheDir, "", TOPOCACHE_PREFIX,
+			match_MATCH_PREFIX);
+	if (!dirList)
+		return;
+
+	files = HMalloc (sizeof (files[0]) * (dirList->numNames + 1));
+	if (!files)
+	{
+		uio_DirList_free (dirList);
+		return;
+	}
+
+	for (i = 0; i < dirList->numNames; ++i)
+	{
+		struct stat sb;
+
+		if (uio_stat (cacheDir, dirList->names[i], &sb) != 0)
+			continue;
+		files[count].name = dirList->names[i];
+		files[count].size = sb.st_size;
+		files[count].mtime = sb.st_mtime;
+		total += sb.st_size;
+		++count;
+	}
+
+	if (total > TOPOCACHE_MAX_SIZE)
+	{
+		qsort (files, count, sizeof (files[0]), compareFileAge);
+		for (i = 0; i < count && total > TOPOCACHE_MAX_SIZE; ++i)
+		{
+			if (uio_unlink (cacheDir, files[i].name) == 0)
+				total -= files[i].size;
+		}
+	}
+	cacheSize = total;
+
+	HFree (files);
+	uio_DirList_free (dirList);
+}
+
+void
+SaveCachedSurface (const PLANET_DESC *world, const PlanetFrame *PlanDataPtr,
+		COUNT width, COUNT height, const PLANET_SURFACE_DATA *data)
+{
+	char name[64];
+	char tmpName[72];
+	uio_Stream *f;
+	TopoCacheHeader header;
+	size_t mapSize = (size_t) width * height;
+	BYTE *raw;
+	BYTE *dst;
+	const BYTE *out;
+	BOOLEAN ok;
+#ifdef HAVE_ZIP
+	BYTE *packed = NULL;
+#endif
+
+	if (!cacheDir || !data->elevation)
+		return;
+
+	memset (&header, 0, sizeof header);
+	memcpy (header.magic, TOPOCACHE_MAGIC, sizeof header.magic);
+	header.version = TOPOCACHE_VERSION;
+	header.worldSeed = world->rand_seed;
+	header.params = surfaceParams (world, PlanDataPtr, width, height);
+	header.width = width;
+	header.height = height;
+	header.rngSeed = data->seed;
+	header.rawSize = mapSize;
+	if (data->lightMap)
+	{
+		header.sections |= TOPOCACHE_LIGHTMAP;
+		header.rawSize += mapSize;
+	}
+	if (data->scaledTopo)
+	{
+		header.sections |= TOPOCACHE_SCALED;
+		header.rawSize += mapSize * 16;
+	}
+
+	raw = HMalloc (header.rawSize);
+	if (!raw)
+		return;
+	dst = raw;
+	memcpy (dst, data->elevation, mapSize);
+	dst += mapSize;
+	if (data->lightMap)
+	{
+		memcpy (dst, data->lightMap, mapSize);
+		dst += mapSize;
+	}
+	if (data->scaledTopo)
+		memcpy (dst, data->scaledTopo, mapSize * 16);
+
+	out = raw;
+	header.packedSize = header.rawSize;
+#ifdef HAVE_ZIP
+	{
+		uLongf packedSize = compressBound (header.rawSize);
+
+		packed = HMalloc (packedSize);
+		if (packed && compress2 (packed, &packedSize, raw, header.rawSize,
+				Z_BEST_SPEED) == Z_OK && packedSize < header.rawSize)
+		{
+			out = packed;
+			header.packedSize = packedSize;
+			header.compressed = 1;
+		}
+	}
+#endif
+
+	cacheFileName (name, sizeof name, world->rand_seed, header.params);
+
+	// Write to a temporary file first, so that an interrupted write
+	// doesn't leave a truncated cache file behind.
+	snprintf (tmpName, sizeof tmpName, "%s.tmp", name);
+	f = uio_fopen (cacheDir, tmpName, "wb");
+	if (f)
+	{
+		ok = uio_fwrite (&header, sizeof header, 1, f) == 1
+				&& uio_fwrite (out, 1, header.packedSize, f)
+					== header.packedSize;
+		uio_fclose (f);
+
+		uio_unlink (cacheDir, name);
+		if (!ok || uio_rename (cacheDir, tmpName, cacheDir, name) != 0)
+		{
+			log_add (log_Debug, "Could not write surface cache '%s'.",
+					name);
+			uio_unlink (cacheDir, tmpName);
+		}
+		else
+		{
+			off_t size = sizeof header + header.packedSize;
+
+			// A replaced file is counted twice until the next scan,
+			// which only makes that scan come sooner
+			if (cacheSize < 0 || cacheSize + size > TOPOCACHE_MAX_SIZE)
+				trimCache ();
+			else
+				cacheSize += size;
+		}
+	}
+
+#ifdef HAVE_ZIP
+	HFree (packed);
+#endif
+	HFree (raw);
+}
+
+void
+FreeSurfaceData (PLANET_SURFACE_DATA *data)
+{
+	HFree (data->elevation);
+	HFree (data->lightMap);
+	HFree (data->scaledTopo);
+	data->elevation = NULL;
+	data->lightMap = NULL;
+	data->scaledTopo = NULL;
+}
@@ -0,0 +1,51 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef UQM_PLANETS_TOPOCACHE_H_
+#define UQM_PLANETS_TOPOCACHE_H_
+
+#include "planets.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+// The generated, colour independent parts of a world's surface
+typedef struct
+{
+	SBYTE *elevation;
+			// width x height elevation map, before the light map pass
+	SBYTE *lightMap;
+			// width x height light variance map, or NULL
+	SBYTE *scaledTopo;
+			// (4 * width) x (4 * height) planetside topo, or NULL
+	DWORD seed;
+			// the SysGenRNG state generating the elevation left behind
+} PLANET_SURFACE_DATA;
+
+extern BOOLEAN LoadCachedSurface (const PLANET_DESC *world,
+		const PlanetFrame *PlanDataPtr, COUNT width, COUNT height,
+		PLANET_SURFACE_DATA *data);
+extern void SaveCachedSurface (const PLANET_DESC *world,
+		const PlanetFrame *PlanDataPtr, COUNT width, COUNT height,
+		const PLANET_SURFACE_DATA *data);
+extern void FreeSurfaceData (PLANET_SURFACE_DATA *data);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* UQM_PLANETS_TOPOCACHE_H_ */
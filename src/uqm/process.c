@@ -361,269 +361,574 @@ CalcView (DPOINT *pNewScrollPt, SIZE next_reduction,
 }
 
 
-static ELEMENT_FLAGS
-ProcessCollisions (HELEMENT hSuccElement, ELEMENT *ElementPtr,
-		TIME_VALUE min_time, ELEMENT_FLAGS process_flags)
+// Broad phase for ProcessCollisions(). The swept intersect rectangle of
+// every element (where its IntersectControl will test for overlap) is
+// binned into a uniform grid laid over the battle space. Cells wrap the
+// same way the space does, so an element is binned into every cell its
+// rectangle touches modulo the space size. An element then only has to
+// be tested against the elements it shares a cell with.
+// Each cell keeps a bitmask of display list positions rather than a list
+// of elements, so the candidates of a query come out deduplicated and in
+// display list order, which keeps collision processing (and therefore
+// netplay) exactly as it is with the plain list walk.
+// The grid is rebuilt on demand whenever CollisionGridStale is set, which
+// happens whenever the display list changes or any element's
+// IntersectControl is initialized. While some element in the list has not
+// been preprocessed yet, the plain walk is used instead, because it
+// preprocesses the elements it passes.
+#define COLLISION_GRID_CELLS 16
+		// Number of cells in each dimension
+#define COLLISION_GRID_MAX 256
+		// disp_q.num_objects is a BYTE
+#define COLLISION_SET_WORDS (COLLISION_GRID_MAX / 32)
+
+typedef struct
 {
-	HELEMENT hTestElement;
+	DWORD bits[COLLISION_SET_WORDS];
+} COLLISION_SET;
+
+BOOLEAN CollisionGridStale = TRUE;
+static COUNT collisionGridGen;
+static SDWORD collisionSpaceWidth;
+static SDWORD collisionSpaceHeight;
+static SDWORD collisionCellWidth;
+static SDWORD collisionCellHeight;
+static HELEMENT collisionGridElement[COLLISION_GRID_MAX];
+		// Element at each display list position
+static BYTE collisionGridOrder[COLLISION_GRID_MAX];
+		// Display list position of each disp_q slot
+static COLLISION_SET collisionGrid[COLLISION_GRID_CELLS]
+		[COLLISION_GRID_CELLS];
+
+static inline COUNT
+ElementSlot (HELEMENT hElement)
+{
+	return (COUNT)(((BYTE *)hElement - disp_q.pq_tab)
+			/ disp_q.object_size);
+}
 
-	while ((hTestElement = hSuccElement) != 0)
+// The rectangle DrawablesIntersect() may find ElementPtr in, in display
+// coordinates. Returns FALSE if the element cannot intersect anything.
+static BOOLEAN
+GetSweptRect (ELEMENT *ElementPtr, RECT *pRect)
+{
+	INTERSECT_CONTROL *pControl = &ElementPtr->IntersectControl;
+	RECT r;
+	COORD x0, y0, x1, y1;
+
+	if (pControl->IntersectStamp.frame == NULL)
+		return FALSE;
+
+	GetFrameRect (pControl->IntersectStamp.frame, &r);
+	x0 = pControl->IntersectStamp.origin.x;
+	x1 = pControl->EndPoint.x;
+	if (x0 > x1)
 	{
-		ELEMENT *TestElementPtr;
+		x0 = pControl->EndPoint.x;
+		x1 = pControl->IntersectStamp.origin.x;
+	}
+	y0 = pControl->IntersectStamp.origin.y;
+	y1 = pControl->EndPoint.y;
+	if (y0 > y1)
+	{
+		y0 = pControl->EndPoint.y;
+		y1 = pControl->IntersectStamp.origin.y;
+	}
 
-		LockElement (hTestElement, &TestElementPtr);
-		if (!(TestElementPtr->state_flags & process_flags))
-			PreProcess (TestElementPtr);
-		hSuccElement = GetSuccElement (TestElementPtr);
+	// DrawablesIntersect() widens its search by a step at either end,
+	// so leave some slack on each side
+	pRect->corner.x = x0 + r.corner.x - 2;
+	pRect->corner.y = y0 + r.corner.y - 2;
+	pRect->extent.width = x1 - x0 + r.extent.width + 4;
+	pRect->extent.height = y1 - y0 + r.extent.height + 4;
+
+	return TRUE;
+}
+
+// Finds the run of cells covering [c, c + len) along one dimension.
+// The run may wrap past the last cell.
+static void
+GetCellSpan (SDWORD c, SDWORD len, SDWORD space, SDWORD cell,
+		COUNT *pFirst, COUNT *pCount)
+{
+	SDWORD last;
+
+	if (len + cell >= space)
+	{
+		*pFirst = 0;
+		*pCount = COLLISION_GRID_CELLS;
+		return;
+	}
+
+	c %= space;
+	if (c < 0)
+		c += space;
+	last = c + len - 1;
+	if (last >= space)
+		last -= space;
+
+	*pFirst = (COUNT)(c / cell);
+	last /= cell;
+	if (last < *pFirst)
+		last += COLLISION_GRID_CELLS;
+	*pCount = (COUNT)(last - *pFirst + 1);
+}
 
-		if (TestElementPtr == ElementPtr)
+static BOOLEAN
+BuildCollisionGrid (ELEMENT_FLAGS process_flags)
+{
+	HELEMENT hElement, hNextElement;
+	COUNT order;
+
+	for (hElement = GetHeadElement (), order = 0; hElement != 0;
+			hElement = hNextElement, ++order)
+	{
+		ELEMENT *ElementPtr;
+
+		LockElement (hElement, &ElementPtr);
+		hNextElement = GetSuccElement (ElementPtr);
+		if (!(ElementPtr->state_flags & process_flags)
+				|| order >= COLLISION_GRID_MAX)
 		{
-			UnlockElement (hTestElement);
-			continue;
+			UnlockElement (hElement);
+			return FALSE;
 		}
+		UnlockElement (hElement);
+	}
 
-		if (CollisionPossible (TestElementPtr, ElementPtr))
-		{
-			ELEMENT_FLAGS state_flags, test_state_flags;
-			TIME_VALUE time_val;
+	collisionSpaceWidth = WORLD_TO_DISPLAY (LOG_SPACE_WIDTH);
+	collisionSpaceHeight = WORLD_TO_DISPLAY (LOG_SPACE_HEIGHT);
+	collisionCellWidth = (collisionSpaceWidth + COLLISION_GRID_CELLS - 1)
+			/ COLLISION_GRID_CELLS;
+	collisionCellHeight = (collisionSpaceHeight + COLLISION_GRID_CELLS - 1)
+			/ COLLISION_GRID_CELLS;
+	memset (collisionGrid, 0, sizeof (collisionGrid));
 
-			state_flags = ElementPtr->state_flags;
-			test_state_flags = TestElementPtr->state_flags;
-			if (((state_flags | test_state_flags) & FINITE_LIFE)
-					&& (((state_flags & APPEARING)
-					&& ElementPtr->life_span > 1)
-					|| ((test_state_flags & APPEARING)
-					&& TestElementPtr->life_span > 1)))
-				time_val = 0;
-			else
+	for (hElement = GetHeadElement (), order = 0; hElement != 0;
+			hElement = hNextElement, ++order)
+	{
+		ELEMENT *ElementPtr;
+		RECT r;
+
+		LockElement (hElement, &ElementPtr);
+		hNextElement = GetSuccElement (ElementPtr);
+		collisionGridElement[order] = hElement;
+		collisionGridOrder[ElementSlot (hElement)] = (BYTE)order;
+
+		if (GetSweptRect (ElementPtr, &r))
+		{
+			COUNT col0, cols, row0, rows;
+			COUNT i, j;
+			DWORD word = order >> 5;
+			DWORD bit = (DWORD)1 << (order & 31);
+
+			GetCellSpan (r.corner.x, r.extent.width, collisionSpaceWidth,
+					collisionCellWidth, &col0, &cols);
+			GetCellSpan (r.corner.y, r.extent.height, collisionSpaceHeight,
+					collisionCellHeight, &row0, &rows);
+			for (j = 0; j < rows; ++j)
 			{
-				while ((time_val = DrawablesIntersect (&ElementPtr->IntersectControl,
-						&TestElementPtr->IntersectControl, min_time)) == 1
-						&& !((state_flags | test_state_flags) & FINITE_LIFE))
+				COUNT row = (row0 + j) % COLLISION_GRID_CELLS;
+
+				for (i = 0; i < cols; ++i)
 				{
-#ifdef DEBUG_PROCESS
-					log_add (log_Debug, "BAD NEWS 0x%x <--> 0x%x", ElementPtr,
-							TestElementPtr);
-#endif /* DEBUG_PROCESS */
-					if (state_flags & COLLISION)
-					{
-						InitIntersectEndPoint (TestElementPtr);
-						TestElementPtr->IntersectControl.IntersectStamp.origin =
-								TestElementPtr->IntersectControl.EndPoint;
-						time_val = DrawablesIntersect (&ElementPtr->IntersectControl,
-								&TestElementPtr->IntersectControl, 1);
-						InitIntersectStartPoint (TestElementPtr);
-					}
+					COUNT col = (col0 + i) % COLLISION_GRID_CELLS;
 
-					if (time_val == 1)
-					{
-						FRAME CurFrame, NextFrame,
-								TestCurFrame, TestNextFrame;
-
-						CurFrame = ElementPtr->current.image.frame;
-						NextFrame = ElementPtr->next.image.frame;
-						TestCurFrame = TestElementPtr->current.image.frame;
-						TestNextFrame = TestElementPtr->next.image.frame;
-						if (NextFrame == CurFrame
-								&& TestNextFrame == TestCurFrame)
-						{
-							if (test_state_flags & APPEARING)
-							{
-								do_damage (TestElementPtr, TestElementPtr->hit_points);
-								if (TestElementPtr->pParent) /* untarget this dead element */
-									Untarget (TestElementPtr);
+					collisionGrid[row][col].bits[word] |= bit;
+				}
+			}
+		}
+		UnlockElement (hElement);
+	}
 
-								TestElementPtr->state_flags |= (COLLISION | DISAPPEARING);
-								if (TestElementPtr->death_func)
-									(*TestElementPtr->death_func) (TestElementPtr);
-							}
-							if (state_flags & APPEARING)
-							{
-								do_damage (ElementPtr, ElementPtr->hit_points);
-								if (ElementPtr->pParent) /* untarget this dead element */
-									Untarget (ElementPtr);
+	CollisionGridStale = FALSE;
+	++collisionGridGen;
 
-								ElementPtr->state_flags |= (COLLISION | DISAPPEARING);
-								if (ElementPtr->death_func)
-									(*ElementPtr->death_func) (ElementPtr);
+	return TRUE;
+}
 
-								UnlockElement (hTestElement);
-								return (COLLISION);
-							}
+// Collects the elements from hSuccElement onwards that ElementPtr could
+// possibly intersect. Returns FALSE if the grid cannot be used right now.
+static BOOLEAN
+GetCollisionCandidates (HELEMENT hSuccElement, ELEMENT *ElementPtr,
+		ELEMENT_FLAGS process_flags, COLLISION_SET *pSet)
+{
+	RECT r;
+	COUNT first;
+	COUNT col0, cols, row0, rows;
+	COUNT i, j, k;
+
+	if (hSuccElement == 0)
+		return FALSE;
+	if (CollisionGridStale && !BuildCollisionGrid (process_flags))
+		return FALSE;
+
+	memset (pSet, 0, sizeof (*pSet));
+	if (!GetSweptRect (ElementPtr, &r))
+		return TRUE;
+
+	GetCellSpan (r.corner.x, r.extent.width, collisionSpaceWidth,
+			collisionCellWidth, &col0, &cols);
+	GetCellSpan (r.corner.y, r.extent.height, collisionSpaceHeight,
+			collisionCellHeight, &row0, &rows);
+	for (j = 0; j < rows; ++j)
+	{
+		COUNT row = (row0 + j) % COLLISION_GRID_CELLS;
 
-							time_val = 0;
-						}
-						else
-						{
-							if (GetFrameIndex (CurFrame) !=
-									GetFrameIndex (NextFrame))
-								ElementPtr->next.image.frame =
-										SetEquFrameIndex (NextFrame,
-										CurFrame);
-							else if (NextFrame != CurFrame)
-							{
-								ElementPtr->next.image =
-										ElementPtr->current.image;
-								if (ElementPtr->life_span > NORMAL_LIFE)
-									ElementPtr->life_span = NORMAL_LIFE;
-							}
+		for (i = 0; i < cols; ++i)
+		{
+			COLLISION_SET *pCell = &collisionGrid[row]
+					[(col0 + i) % COLLISION_GRID_CELLS];
 
-							if (GetFrameIndex (TestCurFrame) !=
-									GetFrameIndex (TestNextFrame))
-								TestElementPtr->next.image.frame =
-										SetEquFrameIndex (TestNextFrame,
-										TestCurFrame);
-							else if (TestNextFrame != TestCurFrame)
-							{
-								TestElementPtr->next.image =
-										TestElementPtr->current.image;
-								if (TestElementPtr->life_span > NORMAL_LIFE)
-									TestElementPtr->life_span = NORMAL_LIFE;
-							}
+			for (k = 0; k < COLLISION_SET_WORDS; ++k)
+				pSet->bits[k] |= pCell->bits[k];
+		}
+	}
 
-							InitIntersectStartPoint (ElementPtr);
-							InitIntersectEndPoint (ElementPtr);
-							InitIntersectFrame (ElementPtr);
-							if (state_flags & PLAYER_SHIP)
-							{
-								STARSHIP *StarShipPtr;
+	// Drop everything before hSuccElement
+	first = collisionGridOrder[ElementSlot (hSuccElement)];
+	for (k = 0; k < (first >> 5); ++k)
+		pSet->bits[k] = 0;
+	pSet->bits[k] &= ~(DWORD)0 << (first & 31);
 
-								GetElementStarShip (ElementPtr, &StarShipPtr);
-								StarShipPtr->ShipFacing =
-										GetFrameIndex (
-										ElementPtr->next.image.frame);
-							}
+	return TRUE;
+}
 
-							InitIntersectStartPoint (TestElementPtr);
-							InitIntersectEndPoint (TestElementPtr);
-							InitIntersectFrame (TestElementPtr);
-							if (test_state_flags & PLAYER_SHIP)
-							{
-								STARSHIP *StarShipPtr;
+// Returns the first display list position in pSet at or after 'from',
+// or -1 if there is none
+static int
+NextCollisionCandidate (const COLLISION_SET *pSet, int from)
+{
+	int k;
 
-								GetElementStarShip (TestElementPtr, &StarShipPtr);
-								StarShipPtr->ShipFacing =
-										GetFrameIndex (
-										TestElementPtr->next.image.frame);
-							}
-						}
-					}
+	for (k = from >> 5; k < COLLISION_SET_WORDS; ++k)
+	{
+		DWORD bits = pSet->bits[k];
 
-					if (time_val == 0)
-					{
-						InitIntersectEndPoint (ElementPtr);
-						InitIntersectEndPoint (TestElementPtr);
+		if (k == (from >> 5))
+			bits &= ~(DWORD)0 << (from & 31);
+		if (bits)
+		{
+			int i = k << 5;
 
-						break;
-					}
-				}
+			while (!(bits & 1))
+			{
+				bits >>= 1;
+				++i;
 			}
+			return i;
+		}
+	}
 
-			if (time_val > 0)
-			{
-				POINT SavePt, TestSavePt;
+	return -1;
+}
 
+static ELEMENT_FLAGS ProcessCollisions (HELEMENT hSuccElement,
+		ELEMENT *ElementPtr, TIME_VALUE min_time,
+		ELEMENT_FLAGS process_flags);
+
+// Collides ElementPtr with TestElementPtr, whose successor is hSuccElement.
+// Returns COLLISION if ElementPtr is done colliding for this frame.
+static ELEMENT_FLAGS
+CollideElements (HELEMENT hSuccElement, ELEMENT *ElementPtr,
+		ELEMENT *TestElementPtr, TIME_VALUE min_time,
+		ELEMENT_FLAGS process_flags)
+{
+	ELEMENT_FLAGS state_flags, test_state_flags;
+	TIME_VALUE time_val;
+
+	if (!CollisionPossible (TestElementPtr, ElementPtr))
+		return (0);
+
+	state_flags = ElementPtr->state_flags;
+	test_state_flags = TestElementPtr->state_flags;
+	if (((state_flags | test_state_flags) & FINITE_LIFE)
+			&& (((state_flags & APPEARING)
+			&& ElementPtr->life_span > 1)
+			|| ((test_state_flags & APPEARING)
+			&& TestElementPtr->life_span > 1)))
+		time_val = 0;
+	else
+	{
+		while ((time_val = DrawablesIntersect (&ElementPtr->IntersectControl,
+				&TestElementPtr->IntersectControl, min_time)) == 1
+				&& !((state_flags | test_state_flags) & FINITE_LIFE))
+		{
 #ifdef DEBUG_PROCESS
-				log_add (log_Debug, "0x%x <--> 0x%x at %u", ElementPtr,
-						TestElementPtr, time_val);
+			log_add (log_Debug, "BAD NEWS 0x%x <--> 0x%x", ElementPtr,
+					TestElementPtr);
 #endif /* DEBUG_PROCESS */
-				SavePt = ElementPtr->IntersectControl.EndPoint;
-				TestSavePt = TestElementPtr->IntersectControl.EndPoint;
-				InitIntersectEndPoint (ElementPtr);
+			if (state_flags & COLLISION)
+			{
 				InitIntersectEndPoint (TestElementPtr);
-				if (time_val == 1
-						|| (((state_flags & COLLISION)
-						|| !ProcessCollisions (hSuccElement, ElementPtr,
-						time_val - 1, process_flags))
-						&& ((test_state_flags & COLLISION)
-						|| !ProcessCollisions (
-						!(TestElementPtr->state_flags & APPEARING) ?
-						GetSuccElement (ElementPtr) :
-						GetHeadElement (), TestElementPtr,
-						time_val - 1, process_flags))))
+				TestElementPtr->IntersectControl.IntersectStamp.origin =
+						TestElementPtr->IntersectControl.EndPoint;
+				time_val = DrawablesIntersect (&ElementPtr->IntersectControl,
+						&TestElementPtr->IntersectControl, 1);
+				InitIntersectStartPoint (TestElementPtr);
+			}
+
+			if (time_val == 1)
+			{
+				FRAME CurFrame, NextFrame,
+						TestCurFrame, TestNextFrame;
+
+				CurFrame = ElementPtr->current.image.frame;
+				NextFrame = ElementPtr->next.image.frame;
+				TestCurFrame = TestElementPtr->current.image.frame;
+				TestNextFrame = TestElementPtr->next.image.frame;
+				if (NextFrame == CurFrame
+						&& TestNextFrame == TestCurFrame)
 				{
-					state_flags = ElementPtr->state_flags;
-					test_state_flags = TestElementPtr->state_flags;
+					if (test_state_flags & APPEARING)
+					{
+						do_damage (TestElementPtr, TestElementPtr->hit_points);
+						if (TestElementPtr->pParent) /* untarget this dead element */
+							Untarget (TestElementPtr);
 
-#ifdef DEBUG_PROCESS
-					log_add (log_Debug, "PROCESSING 0x%x <--> 0x%x at %u",
-							ElementPtr, TestElementPtr, time_val);
-#endif /* DEBUG_PROCESS */
-					if (test_state_flags & PLAYER_SHIP)
+						TestElementPtr->state_flags |= (COLLISION | DISAPPEARING);
+						if (TestElementPtr->death_func)
+							(*TestElementPtr->death_func) (TestElementPtr);
+					}
+					if (state_flags & APPEARING)
 					{
-						(*TestElementPtr->collision_func) (
-								TestElementPtr, &TestSavePt,
-								ElementPtr, &SavePt
-								);
-						(*ElementPtr->collision_func) (
-								ElementPtr, &SavePt,
-								TestElementPtr, &TestSavePt
-								);
+						do_damage (ElementPtr, ElementPtr->hit_points);
+						if (ElementPtr->pParent) /* untarget this dead element */
+							Untarget (ElementPtr);
+
+						ElementPtr->state_flags |= (COLLISION | DISAPPEARING);
+						if (ElementPtr->death_func)
+							(*ElementPtr->death_func) (ElementPtr);
+
+						return (COLLISION);
 					}
-					else
+
+					time_val = 0;
+				}
+				else
+				{
+					if (GetFrameIndex (CurFrame) !=
+							GetFrameIndex (NextFrame))
+						ElementPtr->next.image.frame =
+								SetEquFrameIndex (NextFrame,
+								CurFrame);
+					else if (NextFrame != CurFrame)
 					{
-						(*ElementPtr->collision_func) (
-								ElementPtr, &SavePt,
-								TestElementPtr, &TestSavePt
-								);
-						(*TestElementPtr->collision_func) (
-								TestElementPtr, &TestSavePt,
-								ElementPtr, &SavePt
-								);
+						ElementPtr->next.image =
+								ElementPtr->current.image;
+						if (ElementPtr->life_span > NORMAL_LIFE)
+							ElementPtr->life_span = NORMAL_LIFE;
 					}
 
-					if (TestElementPtr->state_flags & COLLISION)
+					if (GetFrameIndex (TestCurFrame) !=
+							GetFrameIndex (TestNextFrame))
+						TestElementPtr->next.image.frame =
+								SetEquFrameIndex (TestNextFrame,
+								TestCurFrame);
+					else if (TestNextFrame != TestCurFrame)
 					{
-						if (!(test_state_flags & COLLISION))
-						{
-							TestElementPtr->IntersectControl.IntersectStamp.origin =
-									TestSavePt;
-							TestElementPtr->next.location.x =
-									DISPLAY_TO_WORLD (TestSavePt.x);
-							TestElementPtr->next.location.y =
-									DISPLAY_TO_WORLD (TestSavePt.y);
-							InitIntersectEndPoint (TestElementPtr);
-						}
+						TestElementPtr->next.image =
+								TestElementPtr->current.image;
+						if (TestElementPtr->life_span > NORMAL_LIFE)
+							TestElementPtr->life_span = NORMAL_LIFE;
 					}
 
-					if (ElementPtr->state_flags & COLLISION)
+					InitIntersectStartPoint (ElementPtr);
+					InitIntersectEndPoint (ElementPtr);
+					InitIntersectFrame (ElementPtr);
+					if (state_flags & PLAYER_SHIP)
 					{
-						if (!(state_flags & COLLISION))
-						{
-							ElementPtr->IntersectControl.IntersectStamp.origin =
-									SavePt;
-							ElementPtr->next.location.x =
-									DISPLAY_TO_WORLD (SavePt.x);
-							ElementPtr->next.location.y =
-									DISPLAY_TO_WORLD (SavePt.y);
-							InitIntersectEndPoint (ElementPtr);
-
-							if (!(state_flags & FINITE_LIFE) &&
-									!(test_state_flags & FINITE_LIFE))
-							{
-								collide (ElementPtr, TestElementPtr);
+						STARSHIP *StarShipPtr;
 
-								ProcessCollisions (GetHeadElement (), ElementPtr,
-										MAX_TIME_VALUE, process_flags);
-								ProcessCollisions (GetHeadElement (), TestElementPtr,
-										MAX_TIME_VALUE, process_flags);
-							}
-						}
-						UnlockElement (hTestElement);
-						return (COLLISION);
+						GetElementStarShip (ElementPtr, &StarShipPtr);
+						StarShipPtr->ShipFacing =
+								GetFrameIndex (
+								ElementPtr->next.image.frame);
 					}
 
-					if (!CollidingElement (ElementPtr))
+					InitIntersectStartPoint (TestElementPtr);
+					InitIntersectEndPoint (TestElementPtr);
+					InitIntersectFrame (TestElementPtr);
+					if (test_state_flags & PLAYER_SHIP)
 					{
-						ElementPtr->state_flags |= COLLISION;
-						UnlockElement (hTestElement);
-						return (COLLISION);
+						STARSHIP *StarShipPtr;
+
+						GetElementStarShip (TestElementPtr, &StarShipPtr);
+						StarShipPtr->ShipFacing =
+								GetFrameIndex (
+								TestElementPtr->next.image.frame);
 					}
 				}
 			}
+
+			if (time_val == 0)
+			{
+				InitIntersectEndPoint (ElementPtr);
+				InitIntersectEndPoint (TestElementPtr);
+
+				break;
+			}
 		}
+	}
+
+	if (time_val > 0)
+	{
+		POINT SavePt, TestSavePt;
+
+#ifdef DEBUG_PROCESS
+		log_add (log_Debug, "0x%x <--> 0x%x at %u", ElementPtr,
+				TestElementPtr, time_val);
+#endif /* DEBUG_PROCESS */
+		SavePt = ElementPtr->IntersectControl.EndPoint;
+		TestSavePt = TestElementPtr->IntersectControl.EndPoint;
+		InitIntersectEndPoint (ElementPtr);
+		InitIntersectEndPoint (TestElementPtr);
+		if (time_val == 1
+				|| (((state_flags & COLLISION)
+				|| !ProcessCollisions (hSuccElement, ElementPtr,
+				time_val - 1, process_flags))
+				&& ((test_state_flags & COLLISION)
+				|| !ProcessCollisions (
+				!(TestElementPtr->state_flags & APPEARING) ?
+				GetSuccElement (ElementPtr) :
+				GetHeadElement (), TestElementPtr,
+				time_val - 1, process_flags))))
+		{
+			state_flags = ElementPtr->state_flags;
+			test_state_flags = TestElementPtr->state_flags;
+
+#ifdef DEBUG_PROCESS
+			log_add (log_Debug, "PROCESSING 0x%x <--> 0x%x at %u",
+					ElementPtr, TestElementPtr, time_val);
+#endif /* DEBUG_PROCESS */
+			if (test_state_flags & PLAYER_SHIP)
+			{
+				(*TestElementPtr->collision_func) (
+						TestElementPtr, &TestSavePt,
+						ElementPtr, &SavePt
+						);
+				(*ElementPtr->collision_func) (
+						ElementPtr, &SavePt,
+						TestElementPtr, &TestSavePt
+						);
+			}
+			else
+			{
+				(*ElementPtr->collision_func) (
+						ElementPtr, &SavePt,
+						TestElementPtr, &TestSavePt
+						);
+				(*TestElementPtr->collision_func) (
+						TestElementPtr, &TestSavePt,
+						ElementPtr, &SavePt
+						);
+			}
+
+			if (TestElementPtr->state_flags & COLLISION)
+			{
+				if (!(test_state_flags & COLLISION))
+				{
+					TestElementPtr->IntersectControl.IntersectStamp.origin =
+							TestSavePt;
+					TestElementPtr->next.location.x =
+							DISPLAY_TO_WORLD (TestSavePt.x);
+					TestElementPtr->next.location.y =
+							DISPLAY_TO_WORLD (TestSavePt.y);
+					InitIntersectEndPoint (TestElementPtr);
+				}
+			}
+
+			if (ElementPtr->state_flags & COLLISION)
+			{
+				if (!(state_flags & COLLISION))
+				{
+					ElementPtr->IntersectControl.IntersectStamp.origin =
+							SavePt;
+					ElementPtr->next.location.x =
+							DISPLAY_TO_WORLD (SavePt.x);
+					ElementPtr->next.location.y =
+							DISPLAY_TO_WORLD (SavePt.y);
+					InitIntersectEndPoint (ElementPtr);
+
+					if (!(state_flags & FINITE_LIFE) &&
+							!(test_state_flags & FINITE_LIFE))
+					{
+						collide (ElementPtr, TestElementPtr);
+
+						ProcessCollisions (GetHeadElement (), ElementPtr,
+								MAX_TIME_VALUE, process_flags);
+						ProcessCollisions (GetHeadElement (), TestElementPtr,
+								MAX_TIME_VALUE, process_flags);
+					}
+				}
+				return (COLLISION);
+			}
+
+			if (!CollidingElement (ElementPtr))
+			{
+				ElementPtr->state_flags |= COLLISION;
+				return (COLLISION);
+			}
+		}
+	}
+	return (0);
+}
+
+static ELEMENT_FLAGS
+ProcessCollisions (HELEMENT hSuccElement, ELEMENT *ElementPtr,
+		TIME_VALUE min_time, ELEMENT_FLAGS process_flags)
+{
+	HELEMENT hTestElement;
+	COLLISION_SET candidates;
+
+	if (GetCollisionCandidates (hSuccElement, ElementPtr, process_flags,
+			&candidates))
+	{
+		COUNT gen = collisionGridGen;
+		int order = -1;
+
+		hSuccElement = 0;
+		while ((order = NextCollisionCandidate (&candidates, order + 1))
+				>= 0)
+		{
+			ELEMENT *TestElementPtr;
+			ELEMENT_FLAGS result = 0;
+
+			hTestElement = collisionGridElement[order];
+			LockElement (hTestElement, &TestElementPtr);
+			hSuccElement = GetSuccElement (TestElementPtr);
+			if (TestElementPtr != ElementPtr)
+				result = CollideElements (hSuccElement, ElementPtr,
+						TestElementPtr, min_time, process_flags);
+			UnlockElement (hTestElement);
+			if (result)
+				return (result);
+
+			// Something moved or the list changed; go on with
+			// the plain walk from where we are
+			if (CollisionGridStale || gen != collisionGridGen)
+				break;
+		}
+		if (order < 0)
+			return (ElementPtr->state_flags & COLLISION);
+	}
+
+	while ((hTestElement = hSuccElement) != 0)
+	{
+		ELEMENT *TestElementPtr;
+		ELEMENT_FLAGS result = 0;
+
+		LockElement (hTestElement, &TestElementPtr);
+		if (!(TestElementPtr->state_flags & process_flags))
+			PreProcess (TestElementPtr);
+		hSuccElement = GetSuccElement (TestElementPtr);
 
+		if (TestElementPtr != ElementPtr)
+			result = CollideElements (hSuccElement, ElementPtr,
+					TestElementPtr, min_time, process_flags);
 		UnlockElement (hTestElement);
+		if (result)
+			return (result);
 	}
 
 	return (ElementPtr->state_flags & COLLISION);
@@ -994,6 +1299,7 @@ InitDisplayList (void)
 	}
 
 	ReinitQueue (&disp_q);
+	CollisionGridStale = TRUE;
 
 	for (i = 0; i < MAX_DISPLAY_PRIMS; ++i)
 		SetPrimLinks (&DisplayArray[i], END_OF_LIST, i + 1);
@@ -1098,6 +1404,7 @@ RemoveElement (HLINK hLink)
 		UnlockElement (hLink);
 	}
 	RemoveQueue (&disp_q, hLink);
+	CollisionGridStale = TRUE;
 }
 
 
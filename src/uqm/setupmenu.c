@@ -2919,7 +2919,8 @@ GetGlobalOptions (GLOBALOPTS *opts)
 	}
 	audioDriver = opts->adriver;
 
-	if (soundflags & audio_QUALITY_HIGH)
+	// The menu has no entry for "best"; it shows as high
+	if (soundflags & (audio_QUALITY_HIGH | audio_QUALITY_BEST))
 		opts->aquality = OPTVAL_HIGH;
 	else if (soundflags & audio_QUALITY_LOW)
 		opts->aquality = OPTVAL_LOW;
@@ -47,6 +47,7 @@
 #include "libs/graphics/tfb_draw.h"
 #include "libs/misc.h"
 #include "libs/scriptlib.h"
+#include "libs/sound/sound.h"
 #include "build.h"
 #include "uqmversion.h"
 #include "options.h"
@@ -261,6 +262,10 @@ while (--ac > 0)
 	}
 	log_add (log_Info, "We've loaded the Kernel");
 
+	// After the kernel, so that the list can name addon sounds
+	if (optSoundPrewarm)
+		SoundDecoder_PrewarmCache (contentDir, optSoundPrewarm);
+
 	GLOBAL (CurrentActivity) = 0;
 	luaUqm_initState ();
 	// show logo then splash and init the kernel in the meantime
@@ -0,0 +1,487 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/* Measures how long the cels of the .ani animations of a content
+ * directory take to load. Every animation is loaded twice: one cel
+ * after another, the way _GetCelData() in libs/graphics/gfxload.c does,
+ * and with a window of cels read (or mapped) ahead on the main thread
+ * and decoded on a number of threads. Both must give the same pixels.
+ * The .zip and .uqm packages in CONTENTDIR/packages are mounted below
+ * the directory, as the game does.
+ *
+ * Usage: anibench CONTENTDIR [threads [window]]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include "port.h"
+#include "libs/uio.h"
+#include "libs/log.h"
+#include "libs/graphics/sdl/sdluio.h"
+#include "libs/graphics/sdl/png2sdl.h"
+#include SDL_INCLUDE(SDL.h)
+#include SDL_INCLUDE(SDL_thread.h)
+
+#define MAX_THREADS 64
+
+typedef struct
+{
+	char name[PATH_MAX];
+	uio_Stream *stream;
+	const char *data;
+	size_t size;
+	char *copy;
+			// the file data when it could not be mapped
+	SDL_Surface *img;
+} CEL;
+
+typedef struct
+{
+	CEL *cels;
+	int count;
+	SDL_atomic_t next;
+	SDL_sem *go;
+	SDL_sem *done;
+	int quit;
+} WORK;
+
+static uio_Repository *repository;
+static uio_DirHandle *contentDir;
+
+static char **aniNames;
+static int aniCount;
+static int aniMax;
+
+/* the game's log, which uio writes to */
+
+void
+log_add (log_Level level, const char *fmt, ...)
+{
+	va_list args;
+
+	if (level > log_Warning)
+		return;
+	va_start (args, fmt);
+	vfprintf (stderr, fmt, args);
+	va_end (args);
+	fputc ('\n', stderr);
+}
+
+static double
+now_ms (void)
+{
+	return SDL_GetPerformanceCounter () * 1000.0
+			/ SDL_GetPerformanceFrequency ();
+}
+
+static void
+mountContent (const char *contentPath)
+{
+	static uio_AutoMount *autoMount[] = { NULL };
+	const char *pattern = "\\.([zZ][iI][pP]|[uU][qQ][mM])$";
+	uio_MountHandle *contentHandle;
+	uio_DirHandle *packagesDir;
+	uio_DirList *dirList;
+	int i;
+
+	contentHandle = uio_mountDir (repository, "/", uio_FSTYPE_STDIO,
+			NULL, NULL, contentPath, autoMount,
+			uio_MOUNT_TOP | uio_MOUNT_RDONLY, NULL);
+	if (contentHandle == NULL)
+	{
+		fprintf (stderr, "Could not mount '%s': %s\n", contentPath,
+				strerror (errno));
+		exit (EXIT_FAILURE);
+	}
+
+	packagesDir = uio_openDir (repository, "/packages", 0);
+	if (packagesDir == NULL)
+		return;
+
+	dirList = uio_getDirList (packagesDir, "", pattern, match_MATCH_REGEX);
+	for (i = 0; dirList != NULL && i < dirList->numNames; i++)
+	{
+		if (uio_mountDir (repository, "/", uio_FSTYPE_ZIP, packagesDir,
+				dirList->names[i], "/", autoMount,
+				uio_MOUNT_BELOW | uio_MOUNT_RDONLY, contentHandle) == NULL)
+		{
+			fprintf (stderr, "Could not mount '%s': %s\n",
+					dirList->names[i], strerror (errno));
+		}
+	}
+	uio_DirList_free (dirList);
+	uio_closeDir (packagesDir);
+}
+
+static void
+addAni (const char *path)
+{
+	if (aniCount == aniMax)
+	{
+		aniMax = aniMax ? aniMax * 2 : 64;
+		aniNames = realloc (aniNames, aniMax * sizeof *aniNames);
+		if (aniNames == NULL)
+			abort ();
+	}
+	aniNames[aniCount++] = strdup (path);
+}
+
+// Collects the .ani files in and below 'path' (without the leading '/')
+static void
+findAnis (const char *path)
+{
+	uio_DirList *dirList;
+	int i;
+
+	dirList = uio_getDirList (contentDir, path, "", match_MATCH_PREFIX);
+	for (i = 0; dirList != NULL && i < dirList->numNames; i++)
+	{
+		char sub[PATH_MAX];
+		struct stat sb;
+		size_t len;
+
+		snprintf (sub, sizeof sub, "%s%s%s", path, *path ? "/" : "",
+				dirList->names[i]);
+		if (uio_stat (contentDir, sub, &sb) == -1)
+			continue;
+		if (S_ISDIR (sb.st_mode))
+		{
+			findAnis (sub);
+			continue;
+		}
+		len = strlen (sub);
+		if (len > 4 && strcasecmp (sub + len - 4, ".ani") == 0)
+			addAni (sub);
+	}
+	uio_DirList_free (dirList);
+}
+
+// Reads the cel file names of an animation; the names are relative to
+// the directory of the .ani file, as in _GetCelData()
+static int
+readAni (const char *aniName, CEL **cels)
+{
+	char line[1024], file[PATH_MAX];
+	const char *slash;
+	uio_Stream *fp;
+	int count = 0, max = 0;
+	int n;
+
+	fp = uio_fopen (contentDir, aniName, "r");
+	if (fp == NULL)
+		return 0;
+
+	slash = strrchr (aniName, '/');
+	n = slash ? (int) (slash - aniName + 1) : 0;
+
+	*cels = NULL;
+	while (uio_fgets (line, sizeof line, fp))
+	{
+		int transparent, cmap, hsx, hsy;
+
+		if (sscanf (line, "%s %d %d %d %d", file, &transparent, &cmap,
+				&hsx, &hsy) != 5)
+			break;
+		if (count == max)
+		{
+			max = max ? max * 2 : 16;
+			*cels = realloc (*cels, max * sizeof **cels);
+			if (*cels == NULL)
+				abort ();
+		}
+		memset (&(*cels)[count], 0, sizeof **cels);
+		snprintf ((*cels)[count].name, PATH_MAX, "%.*s%s", n, aniName, file);
+		++count;
+	}
+	uio_fclose (fp);
+
+	return count;
+}
+
+// Maps the file of a cel, or reads it into memory when it can't be
+static bool
+openCel (CEL *cel)
+{
+	struct stat sb;
+
+	cel->stream = uio_fopen (contentDir, cel->name, "rb");
+	if (cel->stream == NULL)
+		return false;
+
+	cel->data = uio_getMappedData (uio_streamHandle (cel->stream),
+			&cel->size);
+	if (cel->data != NULL)
+		return true;
+
+	if (uio_fstat (uio_streamHandle (cel->stream), &sb) == -1)
+		return false;
+	cel->size = sb.st_size;
+	cel->copy = malloc (cel->size ? cel->size : 1);
+	if (cel->copy == NULL
+			|| uio_fread (cel->copy, 1, cel->size, cel->stream) != cel->size)
+		return false;
+	cel->data = cel->copy;
+	return true;
+}
+
+static void
+closeCel (CEL *cel)
+{
+	if (cel->stream)
+		uio_fclose (cel->stream);
+	free (cel->copy);
+	cel->stream = NULL;
+	cel->copy = NULL;
+	cel->data = NULL;
+}
+
+static void
+decodeCels (WORK *work)
+{
+	int i;
+
+	while ((i = SDL_AtomicAdd (&work->next, 1)) < work->count)
+	{
+		CEL *cel = &work->cels[i];
+		SDL_RWops *rwops;
+
+		if (cel->data == NULL)
+			continue;
+		rwops = SDL_RWFromConstMem (cel->data, (int) cel->size);
+		if (rwops == NULL)
+			continue;
+		cel->img = TFB_png_to_sdl (rwops);
+		SDL_RWclose (rwops);
+	}
+}
+
+static int
+decodeThread (void *data)
+{
+	WORK *work = data;
+
+	for (;;)
+	{
+		SDL_SemWait (work->go);
+		if (work->quit)
+			break;
+		decodeCels (work);
+		SDL_SemPost (work->done);
+	}
+	return 0;
+}
+
+static bool
+sameImage (SDL_Surface *a, SDL_Surface *b)
+{
+	Uint32 ka, kb;
+	int y;
+
+	if (a == NULL || b == NULL)
+		return a == b;
+	if (a->w != b->w || a->h != b->h
+			|| a->format->format != b->format->format
+			|| (SDL_GetColorKey (a, &ka) == 0)
+					!= (SDL_GetColorKey (b, &kb) == 0))
+		return false;
+	if (SDL_GetColorKey (a, &ka) == 0 && ka != kb)
+		return false;
+	if (a->format->palette)
+	{
+		// png2sdl.c only sets the r, g and b of the colors
+		const SDL_Palette *pa = a->format->palette;
+		const SDL_Palette *pb = b->format->palette;
+		int i;
+
+		if (pb == NULL || pa->ncolors != pb->ncolors)
+			return false;
+		for (i = 0; i < pa->ncolors; ++i)
+		{
+			if (pa->colors[i].r != pb->colors[i].r
+					|| pa->colors[i].g != pb->colors[i].g
+					|| pa->colors[i].b != pb->colors[i].b)
+				return false;
+		}
+	}
+	for (y = 0; y < a->h; ++y)
+	{
+		if (memcmp ((Uint8 *) a->pixels + y * a->pitch,
+				(Uint8 *) b->pixels + y * b->pitch,
+				a->w * a->format->BytesPerPixel) != 0)
+			return false;
+	}
+	return true;
+}
+
+int
+main (int argc, char *argv[])
+{
+	int threads = SDL_GetCPUCount ();
+	int window = 0;
+	SDL_Thread *thread[MAX_THREADS];
+	WORK work;
+	double serialMs = 0, parallelMs = 0;
+	double bytes = 0;
+	int cels = 0, failed = 0, differ = 0;
+	int a, i;
+
+	if (argc < 2 || argc > 4)
+	{
+		fprintf (stderr, "Usage: %s CONTENTDIR [threads [window]]\n",
+				argv[0]);
+		return EXIT_FAILURE;
+	}
+	if (argc > 2)
+		threads = atoi (argv[2]);
+	if (argc > 3)
+		window = atoi (argv[3]);
+	if (threads < 1)
+		threads = 1;
+	if (threads > MAX_THREADS)
+		threads = MAX_THREADS;
+	if (window < 1)
+		window = threads * 4;
+
+	if (SDL_Init (0) != 0)
+	{
+		fprintf (stderr, "SDL_Init: %s\n", SDL_GetError ());
+		return EXIT_FAILURE;
+	}
+	uio_init ();
+	repository = uio_openRepository (0);
+	mountContent (argv[1]);
+	contentDir = uio_openDir (repository, "/", 0);
+	if (contentDir == NULL)
+	{
+		fprintf (stderr, "Could not open the content dir: %s\n",
+				strerror (errno));
+		return EXIT_FAILURE;
+	}
+
+	findAnis ("");
+	if (aniCount == 0)
+	{
+		fprintf (stderr, "No .ani files in '%s'\n", argv[1]);
+		return EXIT_FAILURE;
+	}
+
+	work.go = SDL_CreateSemaphore (0);
+	work.done = SDL_CreateSemaphore (0);
+	work.quit = 0;
+	for (i = 1; i < threads; ++i)
+		thread[i] = SDL_CreateThread (decodeThread, "anibench", &work);
+
+	for (a = 0; a < aniCount; ++a)
+	{
+		CEL *cel = NULL;
+		SDL_Surface **serial;
+		int count = readAni (aniNames[a], &cel);
+		double t;
+
+		if (count == 0)
+			continue;
+		serial = calloc (count, sizeof *serial);
+		if (serial == NULL)
+			abort ();
+
+		// read the files once, so that neither pass pays for the disk
+		for (i = 0; i < count; ++i)
+		{
+			if (openCel (&cel[i]))
+				bytes += cel[i].size;
+			closeCel (&cel[i]);
+		}
+
+		t = now_ms ();
+		for (i = 0; i < count; ++i)
+			serial[i] = sdluio_loadImage (contentDir, cel[i].name);
+		serialMs += now_ms () - t;
+
+		t = now_ms ();
+		for (i = 0; i < count; i += window)
+		{
+			int n = count - i < window ? count - i : window;
+			int k;
+
+			for (k = 0; k < n; ++k)
+				openCel (&cel[i + k]);
+
+			work.cels = cel + i;
+			work.count = n;
+			SDL_AtomicSet (&work.next, 0);
+			for (k = 1; k < threads; ++k)
+				SDL_SemPost (work.go);
+			decodeCels (&work);
+			for (k = 1; k < threads; ++k)
+				SDL_SemWait (work.done);
+
+			for (k = 0; k < n; ++k)
+				closeCel (&cel[i + k]);
+		}
+		parallelMs += now_ms () - t;
+
+		for (i = 0; i < count; ++i)
+		{
+			if (serial[i] == NULL)
+			{
+				fprintf (stderr, "%s: could not load '%s': %s\n",
+						aniNames[a], cel[i].name, SDL_GetError ());
+				++failed;
+			}
+			else if (!sameImage (serial[i], cel[i].img))
+			{
+				fprintf (stderr, "%s: '%s' differs\n", aniNames[a],
+						cel[i].name);
+				++differ;
+			}
+			if (serial[i])
+				SDL_FreeSurface (serial[i]);
+			if (cel[i].img)
+				SDL_FreeSurface (cel[i].img);
+		}
+		cels += count;
+		free (serial);
+		free (cel);
+	}
+
+	work.quit = 1;
+	for (i = 1; i < threads; ++i)
+		SDL_SemPost (work.go);
+	for (i = 1; i < threads; ++i)
+		SDL_WaitThread (thread[i], NULL);
+	SDL_DestroySemaphore (work.go);
+	SDL_DestroySemaphore (work.done);
+
+	printf ("%d animations, %d cels, %.1f MB of cel files, %d CPUs\n",
+			aniCount, cels, bytes / (1024 * 1024), SDL_GetCPUCount ());
+	printf ("one after another:             %8.1f ms\n", serialMs);
+	printf ("%2d threads, window of %3d cels: %8.1f ms (%.2fx)\n",
+			threads, window, parallelMs,
+			parallelMs > 0 ? serialMs / parallelMs : 0.0);
+	if (failed || differ)
+		printf ("%d cels failed to load, %d differ\n", failed, differ);
+
+	uio_closeDir (contentDir);
+	uio_unmountAllDirs (repository);
+	uio_closeRepository (repository);
+	uio_unInit ();
+	SDL_Quit ();
+
+	return failed || differ ? EXIT_FAILURE : EXIT_SUCCESS;
+}
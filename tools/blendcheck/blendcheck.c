@@ -0,0 +1,547 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/* Checks that every vector blend kernel compiled in gives exactly the
+ * pixels of the plain C code:
+ *  - the blend spans against the C spans of primitives.c, for every
+ *    kind, factor, source shape and 32bpp channel order;
+ *  - bilinear and trilinear rescaling against the C loops of canvas.c,
+ *    over random images, formats, transparency and sizes;
+ *  - the orbit sphere kernel against the math of
+ *    RenderPlanetSphereRows() in plangen.c.
+ * primitives.c, canvas.c and the kernel files are built right into
+ * this program, with the few library functions they need stubbed out
+ * below (and the ones the checks never reach in stubs.c).
+ * ISAs the CPU does not have are skipped.
+ *
+ * Usage: blendcheck [rounds]
+ * Exits with 1 when any kernel differs.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include "port.h"
+#include "libs/threadlib.h"
+#include "libs/log.h"
+#include "libs/memlib.h"
+#include "libs/graphics/sdl/sdl_common.h"
+#include "libs/graphics/tfb_draw.h"
+#include "libs/graphics/sdl/primitives.h"
+#include "libs/graphics/sdl/blendspan.h"
+
+/* stubs for the library functions the graphics code uses */
+
+PLATFORM_TYPE force_platform = PLATFORM_NULL;
+SDL_Surface *SDL_Screen;
+SDL_Surface *format_conv_surf;
+
+void
+log_add (log_Level level, const char *fmt, ...)
+{
+	va_list args;
+
+	if (level > log_Warning)
+		return;
+	va_start (args, fmt);
+	vfprintf (stderr, fmt, args);
+	va_end (args);
+	fputc ('\n', stderr);
+}
+
+void *
+HMalloc (size_t size)
+{
+	void *p = malloc (size ? size : 1);
+	if (!p)
+		abort ();
+	return p;
+}
+
+void
+HFree (void *p)
+{
+	free (p);
+}
+
+void *
+HCalloc (size_t size)
+{
+	void *p = HMalloc (size);
+	memset (p, 0, size);
+	return p;
+}
+
+void
+LockMutex (Mutex sem)
+{
+	(void) sem;
+}
+
+void
+UnlockMutex (Mutex sem)
+{
+	(void) sem;
+}
+
+/* The chunks run last to first, so that a loop that depends on the
+ * order of its bands shows up as a difference too. */
+void
+RunParallel (ParallelFunction func, void *data, int count, int grain)
+{
+	int begin;
+
+	if (grain < 1)
+		grain = 1;
+	for (begin = (count - 1) / grain * grain; begin >= 0; begin -= grain)
+		func (data, begin, begin + grain < count ? begin + grain : count);
+}
+
+int
+TFB_GetColorKey (SDL_Surface *surface, Uint32 *key)
+{
+	if (!surface || !key)
+		return -1;
+	return SDL_GetColorKey (surface, key);
+}
+
+typedef struct
+{
+	const char *name;
+	const Blend_Funcs_t *funcs;
+	SDL_bool (*has) (void);
+} IsaDef;
+
+static const IsaDef isas[] =
+{
+#ifdef BLEND_AVX2
+	{"AVX2", &Blend_AVX2_Functions, SDL_HasAVX2},
+#endif
+#ifdef BLEND_SSE2
+	{"SSE2", &Blend_SSE2_Functions, SDL_HasSSE2},
+#endif
+	{NULL, NULL, NULL}
+};
+
+static const Uint32 masks[][4] =
+{	// Red, Green, Blue, Alpha
+	{0x00ff0000, 0x0000ff00, 0x000000ff, 0x00000000},
+	{0x00ff0000, 0x0000ff00, 0x000000ff, 0xff000000},
+	{0xff000000, 0x00ff0000, 0x0000ff00, 0x000000ff},
+	{0x000000ff, 0x0000ff00, 0x00ff0000, 0xff000000},
+};
+#define NUM_MASKS (sizeof (masks) / sizeof (masks[0]))
+
+static Uint32 seed = 0x1234567;
+
+static Uint32
+rnd (void)
+{
+	seed = seed * 1103515245 + 12345;
+	return seed ^ (seed >> 15);
+}
+
+static SDL_Surface *
+newSurface (int w, int h, const Uint32 *mask)
+{
+	SDL_Surface *surf = SDL_CreateRGBSurface (0, w, h, 32,
+			mask[0], mask[1], mask[2], mask[3]);
+	if (!surf)
+	{
+		fprintf (stderr, "SDL_CreateRGBSurface: %s\n", SDL_GetError ());
+		exit (2);
+	}
+	return surf;
+}
+
+static void
+fillRandom (SDL_Surface *surf)
+{
+	int y, x;
+
+	for (y = 0; y < surf->h; ++y)
+	{
+		Uint32 *p = (Uint32 *) ((Uint8 *) surf->pixels + y * surf->pitch);
+
+		for (x = 0; x < surf->w; ++x)
+		{
+			p[x] = rnd ();
+			// plenty of fully transparent and fully opaque pixels
+			if ((rnd () & 7) == 0)
+				p[x] &= ~surf->format->Amask;
+			else if ((rnd () & 7) == 0)
+				p[x] |= surf->format->Amask;
+		}
+	}
+}
+
+static BOOLEAN
+sameSurface (SDL_Surface *a, SDL_Surface *b)
+{
+	int y;
+
+	for (y = 0; y < a->h; ++y)
+	{
+		if (memcmp ((Uint8 *) a->pixels + y * a->pitch,
+				(Uint8 *) b->pixels + y * b->pitch, a->w * 4) != 0)
+			return FALSE;
+	}
+	return TRUE;
+}
+
+/* The spans of every kind, factor and source shape. The spans have odd
+ * lengths and offsets so the vector tails are exercised too. */
+static int
+checkSpans (const IsaDef *isa)
+{
+	enum { TEST_PIXELS = 67 };
+	static const int factors[] =
+	{
+		0, 1, 64, 127, 128, 190, 254, 255, -1, -128, -255, 300
+	};
+	int bad = 0;
+	size_t m, f;
+
+	for (m = 0; m < NUM_MASKS; ++m)
+	{
+		SDL_Surface *surf = newSurface (TEST_PIXELS, 1, masks[m]);
+		Uint32 *res = (Uint32 *) surf->pixels;
+		Uint32 src[TEST_PIXELS];
+		Uint32 base[TEST_PIXELS];
+		Uint32 ref[TEST_PIXELS];
+		int kind, i;
+
+		for (i = 0; i < TEST_PIXELS; ++i)
+		{
+			src[i] = rnd ();
+			base[i] = rnd ();
+		}
+		// and the corner cases
+		src[0] = 0x00000000;
+		src[1] = 0xffffffff;
+		base[2] = 0x00000000;
+		base[3] = 0xffffffff;
+
+		for (kind = renderReplace; kind <= renderDesatur; ++kind)
+		{
+			RenderSpanFn span = renderspan_for (surf, kind, TRUE);
+
+			for (f = 0; f < sizeof (factors) / sizeof (factors[0]); ++f)
+			{
+				int srcinc;
+
+				for (srcinc = 0; srcinc <= 1; ++srcinc)
+				{
+					const Uint32 *s = srcinc ? src + 1 : src + 5;
+
+					memcpy (ref, base, sizeof (ref));
+					Blend_Funcs = &Blend_C_Functions;
+					span (ref + 3, s, srcinc, NULL, factors[f],
+							TEST_PIXELS - 3, surf->format);
+
+					memcpy (res, base, sizeof (ref));
+					Blend_Funcs = isa->funcs;
+					span (res + 3, s, srcinc, NULL, factors[f],
+							TEST_PIXELS - 3, surf->format);
+
+					if (memcmp (ref, res, sizeof (ref)) != 0)
+					{
+						if (bad++ < 10)
+							printf ("  span kind %d, factor %d, "
+									"masks %d, srcinc %d differs\n",
+									kind, factors[f], (int) m, srcinc);
+					}
+				}
+			}
+		}
+
+		SDL_FreeSurface (surf);
+	}
+
+	return bad;
+}
+
+/* One random rescale case, bilinear or trilinear, with the kernel and
+ * without it. */
+static int
+checkRescaleCase (const IsaDef *isa, BOOLEAN trilinear)
+{
+	const Uint32 *smask = masks[rnd () % NUM_MASKS];
+	const Uint32 *dmask = masks[rnd () % NUM_MASKS];
+	const int sw = 2 + rnd () % 60;
+	const int sh = 2 + rnd () % 40;
+	int dw = 1 + rnd () % 120;
+	int dh = 1 + rnd () % 80;
+	SDL_Surface *src, *mm = NULL, *ref, *res;
+	HOT_SPOT src_hs, mm_hs, dst_hs;
+	EXTENT size;
+	int scale = 0;
+	int bad = 0;
+
+	// the match of the source and destination channels decides whether
+	// the kernel runs at all
+	if (rnd () & 1)
+		dmask = smask;
+
+	src = newSurface (sw, sh, smask);
+	fillRandom (src);
+	if (!smask[3] && (rnd () & 1))
+	{
+		Uint32 *p = (Uint32 *) src->pixels;
+		SDL_SetColorKey (src, SDL_TRUE, p[rnd () % sw] & ~smask[3]);
+	}
+	if (trilinear)
+	{
+		mm = newSurface ((sw + 1) / 2, (sh + 1) / 2, smask);
+		fillRandom (mm);
+	}
+
+	src_hs.x = rnd () % sw;
+	src_hs.y = rnd () % sh;
+	mm_hs.x = src_hs.x / 2;
+	mm_hs.y = src_hs.y / 2;
+	if (rnd () & 1)
+	{	// shrunk by a scale factor, as the game draws; the scaled
+		// image can be a pixel larger than the source
+		scale = trilinear ? 128 + rnd () % 128 : 32 + rnd () % 224;
+		dw = sw + 1;
+		dh = sh + 1;
+	}
+
+	ref = newSurface (dw, dh, dmask);
+	res = newSurface (dw, dh, dmask);
+	if (!dmask[3] && (rnd () & 1))
+	{
+		SDL_SetColorKey (ref, SDL_TRUE, 0);
+		SDL_SetColorKey (res, SDL_TRUE, 0);
+	}
+	SDL_FillRect (ref, NULL, 0);
+	SDL_FillRect (res, NULL, 0);
+
+	Blend_Funcs = &Blend_C_Functions;
+	if (trilinear)
+		TFB_DrawCanvas_Rescale_Trilinear (src, mm, ref, scale, &src_hs,
+				&mm_hs, &size, &dst_hs);
+	else
+		TFB_DrawCanvas_Rescale_Bilinear (src, ref, scale, &src_hs,
+				&size, &dst_hs);
+
+	Blend_Funcs = isa->funcs;
+	if (trilinear)
+		TFB_DrawCanvas_Rescale_Trilinear (src, mm, res, scale, &src_hs,
+				&mm_hs, &size, &dst_hs);
+	else
+		TFB_DrawCanvas_Rescale_Bilinear (src, res, scale, &src_hs,
+				&size, &dst_hs);
+
+	if (!sameSurface (ref, res))
+	{
+		printf ("  %s %dx%d -> %dx%d, scale %d differs\n",
+				trilinear ? "trilinear" : "bilinear", sw, sh, dw, dh, scale);
+		bad = 1;
+	}
+
+	SDL_FreeSurface (res);
+	SDL_FreeSurface (ref);
+	if (mm)
+		SDL_FreeSurface (mm);
+	SDL_FreeSurface (src);
+	return bad;
+}
+
+// calc_map_light() of plangen.c
+static Uint8
+sphereChannel (Uint8 val, Uint32 dif, int lvf)
+{
+	int i = (dif * val) >> 16;
+
+	i += (lvf * val) >> 7;
+	if (i < 0)
+		i = 0;
+	else if (i > 255)
+		i = 255;
+	return (Uint8) i;
+}
+
+/* One random row of sphere pixels */
+static int
+checkSphereRow (const IsaDef *isa)
+{
+	enum { TEST_PIXELS = 67, TOPO_W = 16, TOPO_H = 8 };
+	Uint32 pixels[TOPO_W * TOPO_H];
+	Sint8 elevs[TOPO_W * TOPO_H];
+	Uint16 x0[TEST_PIXELS], y0[TEST_PIXELS];
+	Uint16 x1[TEST_PIXELS], y1[TEST_PIXELS];
+	Uint16 m[TEST_PIXELS][4];
+	Uint32 light[TEST_PIXELS];
+	Uint32 ref[TEST_PIXELS];
+	Uint32 res[TEST_PIXELS];
+	const Uint8 alpha[4] = {0, 0, 0, 0xff};
+	const int offset = rnd () % TOPO_W;
+	Blend_SphereRow row;
+	int done;
+	int i, j;
+
+	for (i = 0; i < TOPO_W * TOPO_H; ++i)
+	{
+		pixels[i] = rnd ();
+		elevs[i] = (Sint8) rnd ();
+	}
+	for (i = 0; i < TEST_PIXELS; ++i)
+	{
+		const int heavy = rnd () & 3;
+		int left = 65536 + (int) (rnd () % 5) - 2;
+
+		x0[i] = rnd () % (TOPO_W - 1);
+		y0[i] = rnd () % (TOPO_H - 1);
+		x1[i] = x0[i] + (rnd () & 1);
+		y1[i] = y0[i] + (rnd () & 1);
+		// some lights are 0 or full
+		switch (rnd () & 7)
+		{
+			case 0:
+				light[i] = 0;
+				break;
+			case 1:
+				light[i] = 0x10000;
+				break;
+			default:
+				light[i] = rnd () % 0x10001;
+		}
+		// weights sum to 65536 but for the rounding of plangen.c, one
+		// of them heavy; m[0] == 0 leaves the rest unset
+		for (j = 0; j < 4; ++j)
+		{
+			if (j == heavy)
+				continue;
+			m[i][j] = (Uint16) (rnd () & 0x3fff);
+			left -= m[i][j];
+		}
+		if (left > 0xffff)
+		{
+			m[i][(heavy + 1) & 3] += (Uint16) (left - 0xffff);
+			left = 0xffff;
+		}
+		m[i][heavy] = (Uint16) left;
+		if (rnd () % 5 == 0)
+			m[i][0] = 0;
+	}
+
+	for (i = 0; i < TEST_PIXELS; ++i)
+	{
+		Uint8 *c = (Uint8 *) &ref[i];
+		const int elev = elevs[y0[i] * TOPO_W + (offset + x0[i]) % TOPO_W];
+		const int wsum = m[i][0] + m[i][1] + m[i][2] + m[i][3];
+		const int lvf = m[i][0] == 0 ? elev : (elev * wsum) >> 16;
+		const Uint8 *p[4];
+
+		p[0] = (const Uint8 *) &pixels[y0[i] * TOPO_W + x0[i]];
+		p[1] = (const Uint8 *) &pixels[y0[i] * TOPO_W + x1[i]];
+		p[2] = (const Uint8 *) &pixels[y1[i] * TOPO_W + x0[i]];
+		p[3] = (const Uint8 *) &pixels[y1[i] * TOPO_W + x1[i]];
+		for (j = 0; j < 3; ++j)
+		{
+			Uint32 sum = p[0][j] << 16;
+
+			if (m[i][0] != 0)
+			{
+				sum = p[0][j] * m[i][0] + p[1][j] * m[i][1]
+						+ p[2][j] * m[i][2] + p[3][j] * m[i][3];
+			}
+			sum >>= 16;
+			c[j] = sphereChannel (sum > 255 ? 255 : (Uint8) sum,
+					light[i], lvf);
+		}
+		c[3] = 0xff;
+		if (light[i] == 0)
+			ref[i] = 0;
+	}
+
+	row.dst = res;
+	row.count = TEST_PIXELS;
+	row.pixels = pixels;
+	row.pitch = TOPO_W;
+	row.elevs = elevs;
+	row.width = TOPO_W;
+	row.offset = offset;
+	row.x0 = x0;
+	row.y0 = y0;
+	row.x1 = x1;
+	row.y1 = y1;
+	row.m = (const Uint16 (*)[4]) m;
+	row.light = light;
+	memcpy (&row.alpha, alpha, sizeof (row.alpha));
+	done = isa->funcs->sphere_light (&row);
+
+	if (done < 0 || done > TEST_PIXELS
+			|| memcmp (ref, res, done * sizeof (ref[0])) != 0)
+	{
+		printf ("  sphere row differs\n");
+		return 1;
+	}
+	return 0;
+}
+
+int
+main (int argc, char *argv[])
+{
+	int rounds = 200;
+	int failed = 0;
+	const IsaDef *isa;
+
+	if (argc > 1)
+		rounds = atoi (argv[1]);
+	if (rounds < 1)
+	{
+		fprintf (stderr, "Usage: %s [rounds]\n", argv[0]);
+		return 1;
+	}
+
+	// the weight table of the C code
+	TFB_DrawCanvas_Initialize ();
+
+	for (isa = isas; isa->name; ++isa)
+	{
+		int bad = 0;
+		int i;
+
+		if (!isa->has ())
+		{
+			printf ("%-5s skipped, not supported by this CPU\n", isa->name);
+			continue;
+		}
+
+		if (isa->funcs->additive)
+			bad += checkSpans (isa);
+		for (i = 0; i < rounds; ++i)
+		{
+			if (isa->funcs->rescale_bilinear)
+				bad += checkRescaleCase (isa, FALSE);
+			if (isa->funcs->rescale_trilinear)
+				bad += checkRescaleCase (isa, TRUE);
+			if (isa->funcs->sphere_light)
+				bad += checkSphereRow (isa);
+		}
+
+		printf ("%-5s %s\n", isa->name, bad ? "DIFFERS" : "ok");
+		if (bad)
+			failed = 1;
+	}
+
+	Blend_Funcs = &Blend_C_Functions;
+	return failed;
+}
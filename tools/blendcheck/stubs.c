@@ -0,0 +1,43 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/* Functions canvas.c refers to that blendcheck never reaches. They are
+ * only here so that the program links; none of them may be called. */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define LINK_STUB(name) \
+	void name (void); \
+	void name (void) \
+	{ \
+		fprintf (stderr, "blendcheck: " #name " called\n"); \
+		abort (); \
+	}
+
+LINK_STUB (TFB_DisableColorKey)
+LINK_STUB (TFB_DisableSurfaceAlphaMod)
+LINK_STUB (TFB_DisplayFormatAlpha)
+LINK_STUB (TFB_DrawImage_FixScaling)
+LINK_STUB (TFB_GetColorMap)
+LINK_STUB (TFB_HasSurfaceAlphaMod)
+LINK_STUB (TFB_ReturnColorMap)
+LINK_STUB (TFB_SetColorKey)
+LINK_STUB (TFB_SetColors)
+LINK_STUB (TFB_SetSurfaceAlphaMod)
+LINK_STUB (rotateSurface)
+LINK_STUB (rotozoomSurfaceSize)
+LINK_STUB (sdluio_loadImage)
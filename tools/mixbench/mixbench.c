@@ -0,0 +1,243 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/* Measures the CPU time the mixer spends per second of mixed audio for
+ * every resampling quality, for the source formats the game plays.
+ * The mixer is built right into this program, with the few library
+ * functions it needs stubbed out below.
+ *
+ * Usage: mixbench [seconds]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <time.h>
+#include "libs/threadlib.h"
+#include "libs/log.h"
+#include "libs/memlib.h"
+
+#include "libs/sound/mixer/mixer.c"
+
+#define OUT_FREQ    44100
+#define OUT_FORMAT  MIX_FORMAT_MAKE (2, 2)
+#define CHUNK_BYTES (4096 * 4)
+
+/* stubs for the library functions the mixer uses */
+
+RecursiveMutex
+CreateRecursiveMutex_Core (const char *name, DWORD syncClass)
+{
+	(void) name;
+	(void) syncClass;
+	return (RecursiveMutex) 1;
+}
+
+void
+DestroyRecursiveMutex (RecursiveMutex m)
+{
+	(void) m;
+}
+
+void
+LockRecursiveMutex (RecursiveMutex m)
+{
+	(void) m;
+}
+
+void
+UnlockRecursiveMutex (RecursiveMutex m)
+{
+	(void) m;
+}
+
+void
+log_add (log_Level level, const char *fmt, ...)
+{
+	va_list args;
+
+	if (level > log_Warning)
+		return;
+	va_start (args, fmt);
+	vfprintf (stderr, fmt, args);
+	va_end (args);
+	fputc ('\n', stderr);
+}
+
+void *
+HMalloc (size_t size)
+{
+	void *p = malloc (size ? size : 1);
+	if (!p)
+		abort ();
+	return p;
+}
+
+void
+HFree (void *p)
+{
+	free (p);
+}
+
+void *
+HCalloc (size_t size)
+{
+	void *p = HMalloc (size);
+	memset (p, 0, size);
+	return p;
+}
+
+void *
+HRealloc (void *p, size_t size)
+{
+	p = realloc (p, size ? size : 1);
+	if (!p)
+		abort ();
+	return p;
+}
+
+typedef struct
+{
+	const char *name;
+	uint32 freq;
+	uint32 chans;
+} SourceFormat;
+
+static const SourceFormat formats[] =
+{
+	{"mono 11025",   11025, 1},
+	{"mono 22050",   22050, 1},
+	{"stereo 22050", 22050, 2},
+	{"stereo 44100", 44100, 2},
+	{"stereo 48000", 48000, 2},
+};
+
+static const struct
+{
+	const char *name;
+	mixer_Quality quality;
+} qualities[] =
+{
+	{"low",    MIX_QUALITY_LOW},
+	{"medium", MIX_QUALITY_MEDIUM},
+	{"high",   MIX_QUALITY_HIGH},
+	{"best",   MIX_QUALITY_BEST},
+};
+
+#define NUM_FORMATS   (sizeof (formats) / sizeof (formats[0]))
+#define NUM_QUALITIES (sizeof (qualities) / sizeof (qualities[0]))
+
+/* a few seconds of a tone sweep, one buffer per second */
+static sint16 *
+makeSound (const SourceFormat *fmt, uint32 seconds, uint32 *psize)
+{
+	uint32 frames = fmt->freq * seconds;
+	sint16 *data = HMalloc (frames * fmt->chans * sizeof (sint16));
+	double phase = 0;
+	uint32 i, c;
+
+	for (i = 0; i < frames; i++)
+	{
+		double f = 100.0 + 10000.0 * i / frames;
+
+		phase += 2 * M_PI * f / fmt->freq;
+		for (c = 0; c < fmt->chans; c++)
+			data[i * fmt->chans + c] = (sint16) (12000 * sin (phase));
+	}
+
+	*psize = frames * fmt->chans * sizeof (sint16);
+	return data;
+}
+
+/* CPU milliseconds per second of audio */
+static double
+runMix (mixer_Quality quality, const SourceFormat *fmt, uint32 seconds)
+{
+	mixer_Object src;
+	mixer_Object bufs[64];
+	sint16 *data;
+	uint32 size, persec, i;
+	uint8 *out;
+	uint32 mixed = 0;
+	clock_t start;
+	double cpu;
+
+	mixer_Init (OUT_FREQ, OUT_FORMAT, quality, 0);
+
+	data = makeSound (fmt, seconds, &size);
+	persec = size / seconds;
+	mixer_GenSources (1, &src);
+	mixer_GenBuffers (seconds, bufs);
+	for (i = 0; i < seconds; i++)
+	{
+		mixer_BufferData (bufs[i], MIX_FORMAT_MAKE (2, fmt->chans),
+				(uint8 *) data + i * persec, persec, fmt->freq);
+	}
+	mixer_SourceQueueBuffers (src, seconds, bufs);
+	mixer_SourcePlay (src);
+
+	out = HMalloc (CHUNK_BYTES);
+	start = clock ();
+	while (mixed < OUT_FREQ * 4 * seconds)
+	{
+		mixer_MixChannels (NULL, out, CHUNK_BYTES);
+		mixed += CHUNK_BYTES;
+	}
+	cpu = (double) (clock () - start) / CLOCKS_PER_SEC;
+
+	mixer_SourceStop (src);
+	mixer_SourceUnqueueBuffers (src, seconds, bufs);
+	mixer_DeleteSources (1, &src);
+	mixer_DeleteBuffers (seconds, bufs);
+	mixer_Uninit ();
+	HFree (out);
+	HFree (data);
+
+	return cpu * 1000.0 / seconds;
+}
+
+int
+main (int argc, char *argv[])
+{
+	uint32 seconds = 20;
+	uint32 q, f;
+
+	if (argc > 1)
+		seconds = (uint32) atoi (argv[1]);
+	if (seconds < 1 || seconds > 64)
+	{
+		fprintf (stderr, "Usage: %s [seconds (1-64)]\n", argv[0]);
+		return 1;
+	}
+
+	printf ("CPU ms per second of audio, mixed to %d Hz stereo\n",
+			OUT_FREQ);
+	printf ("%-14s", "source");
+	for (q = 0; q < NUM_QUALITIES; q++)
+		printf ("%10s", qualities[q].name);
+	printf ("\n");
+
+	for (f = 0; f < NUM_FORMATS; f++)
+	{
+		printf ("%-14s", formats[f].name);
+		for (q = 0; q < NUM_QUALITIES; q++)
+			printf ("%10.3f", runMix (qualities[q].quality, &formats[f],
+					seconds));
+		printf ("\n");
+	}
+
+	return 0;
+}